@@ -0,0 +1,134 @@
+#include "plumed/wrapper/Plumed.h"
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that a calculation done with startCalc and waitCalc,
+  while the MD engine computes its own forces in between, gives the same
+  results as calc.
+*/
+
+void init(Plumed & p,int natoms,const std::string & file) {
+  double dt=0.002;
+  p.cmd("setNatoms",&natoms);
+  p.cmd("setMDEngine","asynccalc");
+  p.cmd("setTimestep",&dt);
+  p.cmd("setLogFile","/dev/null");
+  p.cmd("init");
+  p.cmd("readInputLine","d: DISTANCE ATOMS=1,2");
+  p.cmd("readInputLine","c: COORDINATION GROUPA=1-10 GROUPB=11-20 R_0=0.3");
+  p.cmd("readInputLine","g: GYRATION ATOMS=1-20");
+  p.cmd("readInputLine","RESTRAINT ARG=d,c,g AT=0.1,2.0,0.5 KAPPA=10,20,30");
+  p.cmd("readInputLine",("METAD ARG=d SIGMA=0.1 HEIGHT=0.5 PACE=2 FILE=HILLS_"+file).c_str());
+  p.cmd("readInputLine",("PRINT ARG=d,c,g FMT=%10.6f FILE="+file).c_str());
+}
+
+// forces of the MD engine, which are written while plumed is computing its own
+void mdForces(const std::vector<double> & pos,std::vector<double> & forces) {
+  for(unsigned i=0; i<pos.size(); i++) forces[i]=-std::sin(pos[i]);
+}
+
+int main() {
+  std::ofstream ofs("output");
+  const int natoms=20;
+  std::vector<double> pos(3*natoms),masses(natoms,1.0),charges(natoms,0.0);
+  std::vector<double> forces1(3*natoms),forces2(3*natoms);
+  std::vector<double> box(9,0.0),virial1(9),virial2(9);
+  for(int i=0; i<3; i++) box[4*i]=3.0;
+
+  Plumed p1,p2;
+  init(p1,natoms,"COLVAR1");
+  init(p2,natoms,"COLVAR2");
+
+  for(int step=0; step<10; step++) {
+    for(int i=0; i<3*natoms; i++) pos[i]=0.07*i+0.05*step*((i%3)-1)+0.01*step*step*(i%2);
+    for(int i=0; i<9; i++) virial1[i]=virial2[i]=0.0;
+    double bias1=0,bias2=0;
+
+// standard protocol: the MD forces are computed before calling plumed
+    mdForces(pos,forces1);
+    p1.cmd("setStep",&step);
+    p1.cmd("setBox",&box[0]);
+    p1.cmd("setMasses",&masses[0]);
+    p1.cmd("setCharges",&charges[0]);
+    p1.cmd("setPositions",&pos[0]);
+    p1.cmd("setForces",&forces1[0]);
+    p1.cmd("setVirial",&virial1[0]);
+    p1.cmd("calc");
+    p1.cmd("getBias",&bias1);
+
+// asynchronous protocol: the MD forces are computed while plumed is running
+    p2.cmd("setStep",&step);
+    p2.cmd("setBox",&box[0]);
+    p2.cmd("setMasses",&masses[0]);
+    p2.cmd("setCharges",&charges[0]);
+    p2.cmd("setPositions",&pos[0]);
+    p2.cmd("setForces",&forces2[0]);
+    p2.cmd("setVirial",&virial2[0]);
+    p2.cmd("prepareCalc");
+    p2.cmd("startCalc");
+    mdForces(pos,forces2);
+// the positions were already copied, so they can be changed here
+    std::vector<double> save(pos);
+    for(auto & x : pos) x+=1.0;
+    p2.cmd("waitCalc");
+    pos=save;
+    p2.cmd("getBias",&bias2);
+
+// with OpenMP the reductions done in the actions might be summed in a different order
+    bool same=(std::fabs(bias1-bias2)<1e-10);
+    for(int i=0; i<3*natoms; i++) if(std::fabs(forces1[i]-forces2[i])>1e-10) same=false;
+    for(int i=0; i<9; i++) if(std::fabs(virial1[i]-virial2[i])>1e-10) same=false;
+    ofs<<"step "<<step<<" bias "<<bias1<<" results "<<(same ? "match" : "differ")<<"\n";
+  }
+
+// commands other than waitCalc cannot be used while the calculation is running
+  {
+    int step=10;
+    p2.cmd("setStep",&step);
+    p2.cmd("setBox",&box[0]);
+    p2.cmd("setMasses",&masses[0]);
+    p2.cmd("setPositions",&pos[0]);
+    p2.cmd("setForces",&forces2[0]);
+    p2.cmd("setVirial",&virial2[0]);
+    p2.cmd("prepareCalc");
+    p2.cmd("startCalc");
+    try {
+      p2.cmd("setStep",&step);
+      ofs<<"cmd between startCalc and waitCalc: not catched\n";
+    } catch(Plumed::Exception &e) {
+      ofs<<"cmd between startCalc and waitCalc: catched\n";
+    }
+    p2.cmd("waitCalc");
+    ofs<<"waitCalc: done\n";
+  }
+
+// errors in the calculation are reported by waitCalc
+  {
+    Plumed p3;
+    init(p3,natoms,"COLVAR3");
+    p3.cmd("readInputLine","ene: ENERGY");
+    p3.cmd("readInputLine","PRINT ARG=ene FILE=ENERGY3");
+    int step=0;
+    p3.cmd("setStep",&step);
+    p3.cmd("setBox",&box[0]);
+    p3.cmd("setMasses",&masses[0]);
+    p3.cmd("setPositions",&pos[0]);
+    p3.cmd("setForces",&forces2[0]);
+    p3.cmd("setVirial",&virial2[0]);
+    p3.cmd("prepareCalc");
+    p3.cmd("startCalc");
+    ofs<<"startCalc without energy: returned\n";
+    try {
+      p3.cmd("waitCalc");
+      ofs<<"waitCalc without energy: not catched\n";
+    } catch(Plumed::Exception &e) {
+      ofs<<"waitCalc without energy: catched\n";
+    }
+  }
+  return 0;
+}
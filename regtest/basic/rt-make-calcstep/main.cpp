@@ -0,0 +1,98 @@
+#include "plumed/wrapper/Plumed.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that passing the data of each step with a
+  plumed_step_descriptor and cmd("calcStep") gives the same results
+  as the separate commands.
+*/
+
+void init(Plumed & p,int natoms,const std::string & file) {
+  double dt=0.002;
+  p.cmd("setNatoms",&natoms);
+  p.cmd("setMDEngine","calcstep");
+  p.cmd("setTimestep",&dt);
+  p.cmd("setLogFile","/dev/null");
+  p.cmd("init");
+  p.cmd("readInputLine","d: DISTANCE ATOMS=1,2");
+  p.cmd("readInputLine","c: COORDINATION GROUPA=1-3 GROUPB=4-6 R_0=0.3");
+  p.cmd("readInputLine","q: CUSTOM ARG=d FUNC=x*x PERIODIC=NO");
+  p.cmd("readInputLine","ene: ENERGY");
+  p.cmd("readInputLine","RESTRAINT ARG=d,c AT=0.1,2.0 KAPPA=10,20");
+  p.cmd("readInputLine",("PRINT ARG=d,c,q,ene FMT=%10.6f FILE="+file).c_str());
+}
+
+int main() {
+  std::ofstream ofs("output");
+  const int natoms=6;
+  std::vector<double> pos(3*natoms),masses(natoms,1.0),charges(natoms,0.0);
+  std::vector<double> forces1(3*natoms),forces2(3*natoms);
+  std::vector<double> box(9,0.0),virial1(9),virial2(9);
+  for(int i=0; i<3; i++) box[4*i]=2.0;
+  double energy=0.0;
+
+  Plumed p1,p2;
+  init(p1,natoms,"COLVAR1");
+  init(p2,natoms,"COLVAR2");
+
+  // the descriptor is set up once and reused at every step
+  plumed_step_descriptor d;
+  d.box=&box[0];
+  d.masses=&masses[0];
+  d.charges=&charges[0];
+  d.positions=&pos[0];
+  d.forces=&forces2[0];
+  d.virial=&virial2[0];
+  d.energy=&energy;
+  int hstep=0;
+  p2.cmd("getCmdHandle calcStep",&hstep);
+
+  for(int step=0; step<10; step++) {
+    for(int i=0; i<3*natoms; i++) pos[i]=0.1*i+0.05*step*((i%3)-1)+0.01*step*step*(i%2);
+    for(int i=0; i<3*natoms; i++) forces1[i]=forces2[i]=0.0;
+    for(int i=0; i<9; i++) virial1[i]=virial2[i]=0.0;
+    energy=-1.0-0.1*step;
+    double bias1=0,bias2=0;
+
+    p1.cmd("setStep",&step);
+    p1.cmd("setBox",&box[0]);
+    p1.cmd("setMasses",&masses[0]);
+    p1.cmd("setCharges",&charges[0]);
+    p1.cmd("setPositions",&pos[0]);
+    p1.cmd("setForces",&forces1[0]);
+    p1.cmd("setVirial",&virial1[0]);
+    p1.cmd("setEnergy",&energy);
+    p1.cmd("calc");
+    p1.cmd("getBias",&bias1);
+
+    d.step=step;
+    // odd steps use the handle, even steps the string
+    if(step%2) p2.cmdHandle(hstep,&d);
+    else p2.cmd("calcStep",&d);
+    p2.cmd("getBias",&bias2);
+
+    bool same=(bias1==bias2);
+    for(int i=0; i<3*natoms; i++) if(forces1[i]!=forces2[i]) same=false;
+    for(int i=0; i<9; i++) if(virial1[i]!=virial2[i]) same=false;
+    ofs<<"step "<<step<<" bias "<<bias1<<" results "<<(same ? "match" : "differ")<<"\n";
+  }
+
+  // optional pointers can be NULL, the box that was set before is kept
+  d.box=NULL;
+  d.charges=NULL;
+  d.step=10;
+  p2.cmd("calcStep",&d);
+  ofs<<"calcStep without box and charges: done\n";
+
+  try {
+    p2.cmd("calcStep");
+    ofs<<"NULL descriptor: not catched\n";
+  } catch(Plumed::Exception &e) {
+    ofs<<"NULL descriptor: catched\n";
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include "plumed/wrapper/Plumed.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that the commands executed through the handles
+  obtained with getCmdHandle give the same results as the commands
+  sent as strings.
+*/
+
+void init(Plumed & p,int natoms,const std::string & file) {
+  double dt=0.002;
+  p.cmd("setNatoms",&natoms);
+  p.cmd("setMDEngine","cmd-handle");
+  p.cmd("setTimestep",&dt);
+  p.cmd("setLogFile","/dev/null");
+  p.cmd("init");
+  p.cmd("readInputLine","d: DISTANCE ATOMS=1,2");
+  p.cmd("readInputLine","g: GYRATION ATOMS=1-6");
+  p.cmd("readInputLine","RESTRAINT ARG=d,g AT=0.1,0.2 KAPPA=10,20");
+  p.cmd("readInputLine",("PRINT ARG=d,g FMT=%10.6f FILE="+file).c_str());
+}
+
+int main() {
+  std::ofstream ofs("output");
+  const int natoms=6;
+  std::vector<double> pos(3*natoms),masses(natoms,1.0),charges(natoms,0.0);
+  std::vector<double> forces1(3*natoms),forces2(3*natoms);
+  std::vector<double> box(9,0.0),virial1(9),virial2(9);
+
+  Plumed p1,p2;
+  init(p1,natoms,"COLVAR1");
+  init(p2,natoms,"COLVAR2");
+
+  int hstep=0,hbox=0,hmasses=0,hcharges=0,hpositions=0,hforces=0,hvirial=0,hcalc=0,hbias=0;
+  p2.cmd("getCmdHandle setStep",&hstep);
+  p2.cmd("getCmdHandle setBox",&hbox);
+  p2.cmd("getCmdHandle setMasses",&hmasses);
+  p2.cmd("getCmdHandle setCharges",&hcharges);
+  p2.cmd("getCmdHandle setPositions",&hpositions);
+  p2.cmd("getCmdHandle setForces",&hforces);
+  p2.cmd("getCmdHandle setVirial",&hvirial);
+  p2.cmd("getCmdHandle calc",&hcalc);
+  p2.cmd("getCmdHandle getBias",&hbias);
+
+  // resolving the same command twice gives the same handle
+  int hcalc2=0;
+  p2.cmd("getCmdHandle calc",&hcalc2);
+  ofs<<"same handle for the same command: "<<(hcalc==hcalc2 ? "yes" : "no")<<"\n";
+
+  for(int step=0; step<10; step++) {
+    for(int i=0; i<3*natoms; i++) pos[i]=0.1*i+0.05*step*((i%3)-1)+0.01*step*step*(i%2);
+    for(int i=0; i<3*natoms; i++) forces1[i]=forces2[i]=0.0;
+    for(int i=0; i<9; i++) virial1[i]=virial2[i]=0.0;
+    double bias1=0,bias2=0;
+
+    p1.cmd("setStep",&step);
+    p1.cmd("setBox",&box[0]);
+    p1.cmd("setMasses",&masses[0]);
+    p1.cmd("setCharges",&charges[0]);
+    p1.cmd("setPositions",&pos[0]);
+    p1.cmd("setForces",&forces1[0]);
+    p1.cmd("setVirial",&virial1[0]);
+    p1.cmd("calc");
+    p1.cmd("getBias",&bias1);
+
+    p2.cmdHandle(hstep,&step);
+    p2.cmdHandle(hbox,&box[0]);
+    p2.cmdHandle(hmasses,&masses[0]);
+    p2.cmdHandle(hcharges,&charges[0]);
+    p2.cmdHandle(hpositions,&pos[0]);
+    p2.cmdHandle(hforces,&forces2[0]);
+    p2.cmdHandle(hvirial,&virial2[0]);
+    p2.cmdHandle(hcalc);
+    p2.cmdHandle(hbias,&bias2);
+
+    bool same=(bias1==bias2);
+    for(int i=0; i<3*natoms; i++) if(forces1[i]!=forces2[i]) same=false;
+    for(int i=0; i<9; i++) if(virial1[i]!=virial2[i]) same=false;
+    ofs<<"step "<<step<<" bias "<<bias1<<" results "<<(same ? "match" : "differ")<<"\n";
+  }
+
+  // handles can also be used for commands with more than one word
+  int hcheck=0,found=-1;
+  p2.cmd("getCmdHandle checkAction DISTANCE",&hcheck);
+  p2.cmdHandle(hcheck,&found);
+  ofs<<"checkAction DISTANCE through a handle: "<<found<<"\n";
+
+  // errors
+  try {
+    p2.cmdHandle(1000);
+    ofs<<"invalid handle: not catched\n";
+  } catch(Plumed::Exception &e) {
+    ofs<<"invalid handle: catched\n";
+  }
+  try {
+    int h=0;
+    p2.cmd("getCmdHandle nonExistingCommand",&h);
+    ofs<<"unknown command: not catched\n";
+  } catch(Plumed::Exception &e) {
+    ofs<<"unknown command: catched\n";
+  }
+  return 0;
+}
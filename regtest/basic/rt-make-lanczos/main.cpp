@@ -0,0 +1,54 @@
+#include "plumed/tools/Lanczos.h"
+#include "plumed/tools/Matrix.h"
+#include "plumed/tools/Random.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that the largest eigenpairs found with the Lanczos
+  algorithm are the same as those found by diagonalizing the whole matrix.
+*/
+
+void compare( std::ofstream& ofs, const std::string& name, const Matrix<double>& A, const unsigned& k, const bool& uselanczos ) {
+  unsigned n=A.nrows(); std::vector<double> eval, leval; Matrix<double> evec, levec;
+  diagMat( A, eval, evec );
+  if( uselanczos ) lanczosEigenpairs( A, k, leval, levec );
+  else largestEigenpairs( A, k, leval, levec );
+  double maxval=0, maxvec=0, scale=std::fabs(eval[n-1]);
+  for(unsigned i=0; i<k; ++i) {
+    double dv=std::fabs( leval[i]-eval[n-1-i] )/scale; if( dv>maxval ) maxval=dv;
+    for(unsigned j=0; j<n; ++j) {
+      double dd=std::fabs( levec(i,j)-evec(n-1-i,j) ); if( dd>maxvec ) maxvec=dd;
+    }
+  }
+  ofs<<name<<" eigenvalues "<<(maxval<1e-10 ? "match" : "differ")<<" eigenvectors "<<(maxvec<1e-6 ? "match" : "differ")<<"\n";
+}
+
+int main() {
+  std::ofstream ofs("output"); Random rnd; rnd.setSeed(-2468);
+  // A covariance matrix with a few large eigenvalues and many that are zero
+  unsigned n=300, p=40; Matrix<double> X( n, p ), C( n, n );
+  for(unsigned i=0; i<n; ++i) for(unsigned j=0; j<p; ++j) X(i,j)=rnd.Gaussian()*(1.0+5.0*std::exp(-0.5*j));
+  for(unsigned i=0; i<n; ++i) for(unsigned j=0; j<=i; ++j) {
+      double sum=0; for(unsigned l=0; l<p; ++l) sum+=X(i,l)*X(j,l);
+      C(i,j)=C(j,i)=sum/p;
+    }
+  compare( ofs, "covariance", C, 5, true );
+  // A symmetric matrix with positive and negative eigenvalues
+  Matrix<double> S( n, n );
+  for(unsigned i=0; i<n; ++i) for(unsigned j=0; j<=i; ++j) S(i,j)=S(j,i)=rnd.Gaussian() + ( i==j ? 0.1*i : 0.0 );
+  compare( ofs, "indefinite", S, 4, true );
+  // A larger matrix for which largestEigenpairs uses the Lanczos algorithm and a small one for which it does not
+  unsigned m=700; Matrix<double> L( m, m );
+  for(unsigned i=0; i<m; ++i) for(unsigned j=0; j<=i; ++j) L(i,j)=L(j,i)=std::exp( -0.01*(i-j)*(i-j) ) + 0.01*rnd.Gaussian();
+  ofs<<"lanczos used for large matrix "<<(lanczosIsFaster( m, 3 ) ? "yes" : "no")<<" and small matrix "<<(lanczosIsFaster( 50, 3 ) ? "yes" : "no")<<"\n";
+  compare( ofs, "large", L, 3, false );
+  Matrix<double> s( 50, 50 );
+  for(unsigned i=0; i<50; ++i) for(unsigned j=0; j<=i; ++j) s(i,j)=s(j,i)=rnd.Gaussian();
+  compare( ofs, "small", s, 3, false );
+  return 0;
+}
@@ -0,0 +1,60 @@
+#include "plumed/tools/MultiReferenceRMSD.h"
+#include "plumed/tools/RMSD.h"
+#include "plumed/tools/Random.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that the distances and derivatives computed for many
+  references at once with MultiReferenceRMSD are the same as those that
+  are obtained with one RMSD object per reference.
+*/
+
+int main() {
+  std::ofstream ofs("output"); Random rnd; rnd.setSeed(-4321);
+  unsigned natoms=15, nrefs=23;
+  std::vector<double> w( natoms );
+  for(unsigned i=0; i<natoms; ++i) w[i]=0.5+rnd.RandU01();
+  std::vector<std::vector<Vector> > refs( nrefs, std::vector<Vector>( natoms ) );
+  for(unsigned k=0; k<nrefs; ++k) {
+    for(unsigned i=0; i<natoms; ++i) refs[k][i]=Vector( rnd.Gaussian(), rnd.Gaussian(), rnd.Gaussian() );
+  }
+  std::vector<Vector> pos( natoms );
+  for(unsigned i=0; i<natoms; ++i) pos[i]=refs[3][i] + 0.3*Vector( rnd.Gaussian(), rnd.Gaussian(), rnd.Gaussian() );
+
+  std::vector<std::string> types; types.push_back("OPTIMAL"); types.push_back("OPTIMAL-FAST");
+  for(unsigned t=0; t<types.size(); ++t) {
+    MultiReferenceRMSD multi; multi.setType( types[t] ); multi.setAlign( w );
+    for(unsigned k=0; k<nrefs; ++k) multi.addReference( refs[k] );
+    for(unsigned sq=0; sq<2; ++sq) {
+      std::vector<double> dist; std::vector<Vector> der;
+      multi.calculate( pos, dist, der, sq==1 );
+      double maxdist=0, maxder=0;
+      for(unsigned k=0; k<nrefs; ++k) {
+        RMSD rmsd; rmsd.set( w, w, refs[k], types[t] );
+        std::vector<Vector> rder; double d=rmsd.calculate( pos, rder, sq==1 );
+        if( std::fabs(d-dist[k])>maxdist ) maxdist=std::fabs(d-dist[k]);
+        for(unsigned i=0; i<natoms; ++i) {
+          double dd=delta( rder[i], der[k*natoms+i] ).modulo();
+          if( dd>maxder ) maxder=dd;
+        }
+      }
+      ofs<<types[t]<<" squared="<<sq<<" distances "<<(maxdist<1e-10 ? "match" : "differ")<<" derivatives "<<(maxder<1e-10 ? "match" : "differ")<<"\n";
+    }
+    // Only some of the references
+    std::vector<unsigned> which; which.push_back(7); which.push_back(3); which.push_back(19);
+    std::vector<double> dist; std::vector<Vector> der;
+    multi.calculate( pos, which, dist, der, true );
+    double maxdist=0;
+    for(unsigned k=0; k<which.size(); ++k) {
+      RMSD rmsd; rmsd.set( w, w, refs[which[k]], types[t] );
+      std::vector<Vector> rder; double d=rmsd.calculate( pos, rder, true );
+      if( std::fabs(d-dist[k])>maxdist ) maxdist=std::fabs(d-dist[k]);
+    }
+    ofs<<types[t]<<" subset of references "<<(maxdist<1e-10 ? "match" : "differ")<<"\n";
+  }
+  return 0;
+}
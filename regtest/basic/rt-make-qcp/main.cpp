@@ -0,0 +1,100 @@
+#include "plumed/tools/RMSD.h"
+#include "plumed/tools/Random.h"
+#include "plumed/tools/Stopwatch.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that the QCP solver for the lowest eigenpair of the 4x4
+  quaternion matrix gives the same results as LAPACK. It also times the two
+  methods. The timings are written to a file that is not compared with a reference.
+*/
+
+// Build the quaternion matrix that is diagonalized when aligning two structures
+Tensor4d quaternionMatrix( const std::vector<Vector>& pos, const std::vector<Vector>& ref ) {
+  Vector cp, cr; double w=1.0/pos.size();
+  for(unsigned i=0; i<pos.size(); ++i) { cp+=w*pos[i]; cr+=w*ref[i]; }
+  Tensor rr01;
+  for(unsigned i=0; i<pos.size(); ++i) rr01+=w*Tensor(pos[i]-cp,ref[i]-cr);
+  Tensor4d m;
+  m[0][0]=2.0*(-rr01[0][0]-rr01[1][1]-rr01[2][2]);
+  m[1][1]=2.0*(-rr01[0][0]+rr01[1][1]+rr01[2][2]);
+  m[2][2]=2.0*(+rr01[0][0]-rr01[1][1]+rr01[2][2]);
+  m[3][3]=2.0*(+rr01[0][0]+rr01[1][1]-rr01[2][2]);
+  m[0][1]=m[1][0]=2.0*(-rr01[1][2]+rr01[2][1]);
+  m[0][2]=m[2][0]=2.0*(+rr01[0][2]-rr01[2][0]);
+  m[0][3]=m[3][0]=2.0*(-rr01[0][1]+rr01[1][0]);
+  m[1][2]=m[2][1]=2.0*(-rr01[0][1]-rr01[1][0]);
+  m[1][3]=m[3][1]=2.0*(-rr01[0][2]-rr01[2][0]);
+  m[2][3]=m[3][2]=2.0*(-rr01[1][2]-rr01[2][1]);
+  return m;
+}
+
+int main() {
+  std::ofstream ofs("output"); Random rnd; rnd.setSeed(-1234);
+  unsigned natoms=20, nmat=1000;
+  std::vector<Tensor4d> mats( nmat ); std::vector<Vector> pos( natoms ), ref( natoms );
+  for(unsigned k=0; k<nmat; ++k) {
+    for(unsigned i=0; i<natoms; ++i) {
+      ref[i]=Vector( rnd.Gaussian(), rnd.Gaussian(), rnd.Gaussian() );
+      pos[i]=ref[i] + (k%10)*0.1*Vector( rnd.Gaussian(), rnd.Gaussian(), rnd.Gaussian() );
+    }
+    mats[k]=quaternionMatrix( pos, ref );
+  }
+
+  // Compare the eigenvalues, the eigenvectors and the perturbation matrices
+  unsigned nqcp=0; double maxeval=0, maxevec=0, maxpert=0;
+  for(unsigned k=0; k<nmat; ++k) {
+    // diagMatSym overwrites the input matrix so it is passed a copy
+    Tensor4d mcopy( mats[k] ); Vector4d evals; Tensor4d evecs; diagMatSym( mcopy, evals, evecs );
+    Tensor4d pert0;
+    for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) {
+        for(unsigned l=1; l<4; ++l) pert0[i][j]+=evecs[l][i]*evecs[l][j]/(evals[0]-evals[l]);
+      }
+    double eval; Vector4d q; if( lowestEigenpairQCP( mats[k], eval, q ) ) nqcp++;
+    Tensor4d pert; lowestQuaternionEigenpair( mats[k], eval, q, pert );
+    maxeval=std::max( maxeval, std::abs( eval-evals[0] ) );
+    for(unsigned i=0; i<4; ++i) maxevec=std::max( maxevec, std::abs( q[i]-evecs[0][i] ) );
+    for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) maxpert=std::max( maxpert, std::abs( pert[i][j]-pert0[i][j] ) );
+  }
+  ofs<<"QCP used for "<<nqcp<<" of "<<nmat<<" matrices\n";
+  ofs<<"eigenvalues agree "<<( maxeval<1e-10 )<<"\n";
+  ofs<<"eigenvectors agree "<<( maxevec<1e-8 )<<"\n";
+  ofs<<"perturbation matrices agree "<<( maxpert<1e-6 )<<"\n";
+
+  // Structures that only differ by a rotation about the axis of a linear molecule have a degenerate
+  // lowest eigenvalue.  QCP must refuse these and the LAPACK fallback must be used
+  for(unsigned i=0; i<natoms; ++i) { ref[i]=Vector( 0.1*i, 0.2*i, 0.3*i ); pos[i]=ref[i]; }
+  Tensor4d mlin=quaternionMatrix( pos, ref ); double eval; Vector4d q;
+  ofs<<"QCP used for linear molecule "<<lowestEigenpairQCP( mlin, eval, q )<<"\n";
+  Tensor4d pert; lowestQuaternionEigenpair( mlin, eval, q, pert );
+  ofs<<"lowest eigenvalue for linear molecule "<<( std::abs( eval - quaternionMatrix( pos, ref )[0][0] )<1e-10 )<<"\n";
+
+  // And time the two methods
+  Stopwatch sw; unsigned nrepeat=100; double sum=0;
+  sw.start("LAPACK");
+  for(unsigned r=0; r<nrepeat; ++r) for(unsigned k=0; k<nmat; ++k) {
+      Tensor4d mcopy( mats[k] ); VectorGeneric<1> evals; TensorGeneric<1,4> evecs; diagMatSym( mcopy, evals, evecs ); sum+=evals[0];
+    }
+  sw.stop("LAPACK");
+  sw.start("QCP");
+  for(unsigned r=0; r<nrepeat; ++r) for(unsigned k=0; k<nmat; ++k) {
+      lowestQuaternionEigenpair( mats[k], eval, q ); sum+=eval;
+    }
+  sw.stop("QCP");
+  sw.start("LAPACK with derivatives");
+  for(unsigned r=0; r<nrepeat; ++r) for(unsigned k=0; k<nmat; ++k) {
+      Tensor4d mcopy( mats[k] ); Vector4d evals; Tensor4d evecs; diagMatSym( mcopy, evals, evecs ); sum+=evals[0];
+    }
+  sw.stop("LAPACK with derivatives");
+  sw.start("QCP with derivatives");
+  for(unsigned r=0; r<nrepeat; ++r) for(unsigned k=0; k<nmat; ++k) {
+      Tensor4d pert; lowestQuaternionEigenpair( mats[k], eval, q, pert ); sum+=eval;
+    }
+  sw.stop("QCP with derivatives");
+  std::ofstream tfs("timing"); tfs<<sw<<"\n"<<sum<<"\n";
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include "plumed/tools/XdrFile.h"
+#include "plumed/tools/Random.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test writes xtc and trr files with XdrFile, reads them back and checks
+  that the coordinates are recovered within the precision of the format.
+  The xtc systems are chosen so as to exercise the different parts of the
+  compression: uncompressed small systems, water-like molecules that are
+  stored as runs of small differences, and coordinates spanning a range
+  so large that each integer is stored separately.
+*/
+
+std::vector<Vector> makeSystem(Random&rnd,unsigned natoms,double range,double spread) {
+  std::vector<Vector> pos(natoms);
+  for(unsigned i=0; i<natoms; ++i) {
+    if(i%3==0) pos[i]=range*Vector(rnd.RandU01(),rnd.RandU01(),rnd.RandU01());
+    else pos[i]=pos[i-i%3]+spread*Vector(rnd.Gaussian(),rnd.Gaussian(),rnd.Gaussian());
+  }
+  return pos;
+}
+
+int main() {
+  std::ofstream ofs("output"); Random rnd; rnd.setSeed(-1234);
+  struct Case { const char* name; unsigned natoms; double range; double spread; double precision; };
+  const Case cases[]= {
+    {"small",7,5.0,0.1,1000.0},
+    {"water",3000,5.0,0.1,1000.0},
+    {"scattered",500,5.0,1.0,1000.0},
+    {"precise",300,5.0,0.1,1000000.0},
+    {"huge",200,30000.0,0.1,1000.0}
+  };
+  for(const auto & c : cases) {
+    std::vector<std::vector<Vector> > frames;
+    Tensor box(c.range,0.1,0.0,0.0,c.range,0.2,0.0,0.0,c.range);
+    {
+      XdrFile xd; xd.open(std::string(c.name)+".xtc","w",XdrFile::xtc); xd.setPrecision(c.precision);
+      for(unsigned f=0; f<4; ++f) {
+        frames.push_back( makeSystem(rnd,c.natoms,c.range,c.spread) );
+        xd.write(10*f,0.5*f,box,frames.back());
+      }
+    }
+// a frame is appended to check mode "a"
+    {
+      XdrFile xd; xd.open(std::string(c.name)+".xtc","a",XdrFile::xtc); xd.setPrecision(c.precision);
+      frames.push_back( makeSystem(rnd,c.natoms,c.range,c.spread) );
+      xd.write(40,2.0,box,frames.back());
+    }
+    XdrFile xd; xd.open(std::string(c.name)+".xtc","r",XdrFile::xtc);
+    long int step; double time; Tensor rbox; std::vector<Vector> pos;
+    unsigned nframes=0; double maxerr=0; bool headers=true;
+    while(xd.read(step,time,rbox,pos)) {
+      if(pos.size()!=c.natoms || step!=10*long(nframes) || std::fabs(time-0.5*nframes)>1e-6) headers=false;
+      for(unsigned i=0; i<3; ++i) for(unsigned j=0; j<3; ++j) if(std::fabs(box(i,j)-rbox(i,j))>1e-6*c.range) headers=false;
+      for(unsigned i=0; i<c.natoms; ++i) for(unsigned j=0; j<3; ++j) {
+          double err=std::fabs(pos[i][j]-frames[nframes][i][j])*c.precision;
+          if(err>maxerr) maxerr=err;
+        }
+      nframes++;
+    }
+// coordinates are converted to float before and after compression; those of small systems are stored as floats
+    double tolerance=(c.natoms<=9 ? 0.0 : 0.5)+2.5e-7*c.range*c.precision;
+    ofs<<"xtc "<<c.name<<" frames "<<nframes<<" headers "<<(headers ? "match" : "differ")<<" coordinates "<<(maxerr<tolerance ? "match" : "differ")<<"\n";
+  }
+
+  std::vector<std::vector<Vector> > frames;
+  Tensor box(3.0,0.0,0.0,0.5,3.0,0.0,0.3,0.2,3.0);
+  {
+    XdrFile xd; xd.open("test.trr","w",XdrFile::trr);
+    for(unsigned f=0; f<3; ++f) {
+      frames.push_back( makeSystem(rnd,100,3.0,0.1) );
+      xd.write(f,0.1*f,box,frames.back());
+    }
+  }
+  XdrFile xd; xd.open("test.trr","r",XdrFile::trr);
+  long int step; double time; Tensor rbox; std::vector<Vector> pos;
+  unsigned nframes=0; double maxerr=0;
+  while(xd.read(step,time,rbox,pos)) {
+    for(unsigned i=0; i<pos.size(); ++i) {
+      double err=delta(pos[i],frames[nframes][i]).modulo();
+      if(err>maxerr) maxerr=err;
+    }
+    if(pos.size()!=100 || step!=long(nframes)) maxerr=1.0;
+    nframes++;
+  }
+  ofs<<"trr frames "<<nframes<<" coordinates "<<(maxerr<1e-5 ? "match" : "differ")<<"\n";
+  return 0;
+}
@@ -52,6 +52,8 @@ public:
   void getInputData( const unsigned& ind, const bool& normed, const multicolvar::AtomValuePack& myatoms, std::vector<double>& orient0 ) const override;
 /// Add the derivatives on a connection
   void addConnectionDerivatives( const unsigned& i, const unsigned& j, MultiValue& myvals, MultiValue& myvout ) const ;
+/// Add the derivatives of the jelem th stored element of the matrix
+  void addSequentialConnectionDerivatives( const unsigned& jelem, MultiValue& myvals, MultiValue& myvout ) const ;
 /// Get vector derivatives
   MultiValue& getInputDerivatives( const unsigned& ind, const bool& normed, const multicolvar::AtomValuePack& myatoms ) const override;
   unsigned getNumberOfDerivatives() override;
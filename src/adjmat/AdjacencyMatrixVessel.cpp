@@ -22,6 +22,7 @@
 #include "AdjacencyMatrixVessel.h"
 #include "AdjacencyMatrixBase.h"
 #include "vesselbase/ActionWithVessel.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace adjmat {
@@ -99,40 +100,82 @@ void AdjacencyMatrixVessel::retrieveMatrix( DynamicList<unsigned>& myactive_elem
   myactive_elements.updateActiveMembers();
 }
 
-void AdjacencyMatrixVessel::retrieveAdjacencyLists( std::vector<unsigned>& nneigh, Matrix<unsigned>& adj_list ) {
-  plumed_dbg_assert( undirectedGraph() );
-  // Currently everything has zero neighbors
-  for(unsigned i=0; i<nneigh.size(); ++i) nneigh[i]=0;
+unsigned AdjacencyMatrixVessel::getElementIndicesStart() const {
+  return bufstart + getNumberOfStoredValues()*getNumberOfComponents()*getNumberOfDerivativeSpacesPerComponent();
+}
 
-  // And set up the adjacency list
-  std::vector<double> myvals( getNumberOfComponents() );
-  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
-    // Check if atoms are connected
-    retrieveSequentialValue( i, false, myvals );
-    if( myvals[0]<epsilon || myvals[1]<epsilon ) continue ;
+void AdjacencyMatrixVessel::resize() {
+  StoreDataVessel::resize();
+  resizeBuffer( getSizeOfBuffer() + 2*getNumberOfStoredValues() );
+}
 
-    unsigned j, k; getMatrixIndices( function->getPositionInFullTaskList(i), k, j );
+void AdjacencyMatrixVessel::calculate( const unsigned& current, MultiValue& myvals, std::vector<double>& buffer, std::vector<unsigned>& der_list ) const {
+  StoreDataVessel::calculate( current, myvals, buffer, der_list );
+  if( myvals.get(0)<epsilon ) return;
+
+  // The row and column of the element are put in the buffer so that they are gathered together with its value
+  std::vector<unsigned> myatoms; function->decodeIndexToAtoms( function->getTaskCode( current ), myatoms );
+  unsigned k=myatoms[0], j=myatoms[1];
+  if( !undirectedGraph() ) j -= function->ablocks[0].size();
+  else if( k==j ) return;
+
+  unsigned ibuf = getElementIndicesStart() + 2*getAction()->getPositionInCurrentTaskList( current );
+  buffer[ibuf]=k+1; buffer[ibuf+1]=j+1;
+}
+
+void AdjacencyMatrixVessel::finish( const std::vector<double>& buffer ) {
+  StoreDataVessel::finish( buffer );
+  // The sparse representation is only rebuilt if an element has been added, removed or moved to another place in the store
+  bool changed=( element_indices.size()!=2*getNumberOfStoredValues() || row_starts.size()!=getNumberOfRows()+1 );
+  element_indices.resize( 2*getNumberOfStoredValues() );
+  unsigned ibuf=getElementIndicesStart();
+  for(unsigned i=0; i<element_indices.size(); ++i) {
+    unsigned ind=static_cast<unsigned>( buffer[ibuf+i] );
+    if( ind!=element_indices[i] ) { element_indices[i]=ind; changed=true; }
+  }
+  if( changed ) buildSparseStorage();
+}
 
-    if( nneigh[j]>=adj_list.ncols() || nneigh[k]>=adj_list.ncols() ) error("adjacency lists are not large enough, increase maxconnections");
-    // Store if atoms are connected
-    // unsigned j, k; getMatrixIndices( i, k, j );
-    adj_list(k,nneigh[k])=j; nneigh[k]++;
-    adj_list(j,nneigh[j])=k; nneigh[j]++;
+void AdjacencyMatrixVessel::buildSparseStorage() {
+  tmp_rows.resize(0); tmp_cols.resize(0);
+  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
+    if( element_indices[2*i]==0 ) continue ;
+    unsigned k=element_indices[2*i]-1, j=element_indices[2*i+1]-1;
+
+    tmp_rows.push_back( std::pair<unsigned,std::pair<unsigned,unsigned> >( k, std::pair<unsigned,unsigned>( j, i ) ) );
+    // Symmetric matrices only store one of the two triangles so the transpose of each element is added to the rows
+    if( symmetric ) tmp_rows.push_back( std::pair<unsigned,std::pair<unsigned,unsigned> >( j, std::pair<unsigned,unsigned>( k, i ) ) );
+    else tmp_cols.push_back( std::pair<unsigned,std::pair<unsigned,unsigned> >( j, std::pair<unsigned,unsigned>( k, i ) ) );
   }
+  row_starts.resize( getNumberOfRows()+1 ); sortElements( tmp_rows, row_starts, row_elements );
+  if( !symmetric ) { col_starts.resize( getNumberOfColumns()+1 ); sortElements( tmp_cols, col_starts, col_elements ); }
+}
+
+void AdjacencyMatrixVessel::sortElements( const std::vector<std::pair<unsigned,std::pair<unsigned,unsigned> > >& elems, std::vector<unsigned>& starts, std::vector<std::pair<unsigned,unsigned> >& sorted ) const {
+  // Count the number of elements in each row
+  std::fill( starts.begin(), starts.end(), 0 );
+  for(unsigned i=0; i<elems.size(); ++i) starts[elems[i].first+1]++;
+  for(unsigned i=1; i<starts.size(); ++i) starts[i]+=starts[i-1];
+  // And put each element in its row.  Elements within a row remain in the order they are stored in
+  sorted.resize( elems.size() ); std::vector<unsigned> nfilled( starts.begin(), starts.end()-1 );
+  for(unsigned i=0; i<elems.size(); ++i) { sorted[nfilled[elems[i].first]]=elems[i].second; nfilled[elems[i].first]++; }
 }
 
 void AdjacencyMatrixVessel::retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,unsigned> >& edge_list ) {
   plumed_dbg_assert( undirectedGraph() ); nedge=0;
   std::vector<double> myvals( getNumberOfComponents() );
-  if( getNumberOfStoredValues()>edge_list.size() ) error("adjacency lists are not large enough, increase maxconnections");
-
-  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
-    // Check if atoms are connected
-    retrieveSequentialValue( i, false, myvals );
-    if( myvals[0]<epsilon || myvals[1]<epsilon ) continue ;
-
-    getMatrixIndices( function->getPositionInFullTaskList(i), edge_list[nedge].first, edge_list[nedge].second );
-    nedge++;
+  if( edge_list.size()<row_elements.size() ) edge_list.resize( row_elements.size() );
+
+  for(unsigned i=0; i<getNumberOfRows(); ++i) {
+    for(unsigned k=row_starts[i]; k<row_starts[i+1]; ++k) {
+      // Each element of a symmetric matrix appears twice in the rows
+      if( symmetric && row_elements[k].first>i ) continue;
+      // Check if atoms are connected
+      retrieveSequentialValue( row_elements[k].second, false, myvals );
+      if( myvals[0]<epsilon || myvals[1]<epsilon ) continue ;
+
+      edge_list[nedge].first=i; edge_list[nedge].second=row_elements[k].first; nedge++;
+    }
   }
 }
 
@@ -44,6 +44,24 @@ private:
   AdjacencyMatrixBase* function;
 /// Is the matrix symmetric and are we calculating hbonds
   bool symmetric, hbonds;
+/// The row and column (plus one) of each stored element that the last compressed sparse representation was built from
+  std::vector<unsigned> element_indices;
+/// The start of each row in the compressed sparse row representation of the non-zero elements
+  std::vector<unsigned> row_starts;
+/// The column index and the store index of each non-zero element in row order
+  std::vector<std::pair<unsigned,unsigned> > row_elements;
+/// The start of each column in the compressed sparse column representation of the non-zero elements
+  std::vector<unsigned> col_starts;
+/// The row index and the store index of each non-zero element in column order
+  std::vector<std::pair<unsigned,unsigned> > col_elements;
+/// Get the position in the buffer of the row and column of the first stored element
+  unsigned getElementIndicesStart() const ;
+/// Build the compressed sparse row and column representations of the matrix
+  void buildSparseStorage();
+/// Sort a list of elements into compressed sparse format using a counting sort
+  void sortElements( const std::vector<std::pair<unsigned,std::pair<unsigned,unsigned> > >& elems, std::vector<unsigned>& starts, std::vector<std::pair<unsigned,unsigned> >& sorted ) const ;
+/// The elements of the matrix before they are sorted into rows and columns
+  std::vector<std::pair<unsigned,std::pair<unsigned,unsigned> > > tmp_rows, tmp_cols;
 public:
   static void registerKeywords( Keywords& keys );
 /// Constructor
@@ -56,10 +74,22 @@ public:
   unsigned getStoreIndexFromMatrixIndices( const unsigned& ielem, const unsigned& jelem ) const ;
 /// Get the adjacency matrix
   void retrieveMatrix( DynamicList<unsigned>& myactive_elements, Matrix<double>& mymatrix );
-/// Get the neighbour list based on the adjacency matrix
-  void retrieveAdjacencyLists( std::vector<unsigned>& nneigh, Matrix<unsigned>& adj_list );
-/// Retrieve the list of edges in the adjacency matrix/graph
+/// Retrieve the list of edges in the adjacency matrix/graph.  The edge list is resized if it is too small
   void retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,unsigned> >& edge_list );
+/// Make space in the buffer for the row and column of each stored element
+  void resize() override;
+/// Store the data and the row and column of the element if it is not zero
+  void calculate( const unsigned& current, MultiValue& myvals, std::vector<double>& buffer, std::vector<unsigned>& der_list ) const override;
+/// Gather the stored data and rebuild the sparse representation of the matrix if the non-zero elements have changed
+  void finish( const std::vector<double>& buffer ) override;
+/// Get the number of non-zero elements in a row of the matrix
+  unsigned getNumberOfElementsInRow( const unsigned& irow ) const ;
+/// Get the column index and the store index of the kth non-zero element in a row of the matrix
+  const std::pair<unsigned,unsigned>& getRowElement( const unsigned& irow, const unsigned& k ) const ;
+/// Get the number of non-zero elements in a column of the matrix
+  unsigned getNumberOfElementsInColumn( const unsigned& icol ) const ;
+/// Get the row index and the store index of the kth non-zero element in a column of the matrix
+  const std::pair<unsigned,unsigned>& getColumnElement( const unsigned& icol, const unsigned& k ) const ;
 ///
   void getMatrixIndices( const unsigned& code, unsigned& i, unsigned& j ) const ;
 /// Can we think of the matrix as an undirected graph
@@ -78,6 +108,32 @@ public:
   Vector getNodePosition( const unsigned& taskIndex ) const ;
 };
 
+inline
+unsigned AdjacencyMatrixVessel::getNumberOfElementsInRow( const unsigned& irow ) const {
+  plumed_dbg_assert( irow+1<row_starts.size() );
+  return row_starts[irow+1] - row_starts[irow];
+}
+
+inline
+const std::pair<unsigned,unsigned>& AdjacencyMatrixVessel::getRowElement( const unsigned& irow, const unsigned& k ) const {
+  plumed_dbg_assert( k<getNumberOfElementsInRow( irow ) );
+  return row_elements[row_starts[irow]+k];
+}
+
+inline
+unsigned AdjacencyMatrixVessel::getNumberOfElementsInColumn( const unsigned& icol ) const {
+  if( symmetric ) return getNumberOfElementsInRow( icol );
+  plumed_dbg_assert( icol+1<col_starts.size() );
+  return col_starts[icol+1] - col_starts[icol];
+}
+
+inline
+const std::pair<unsigned,unsigned>& AdjacencyMatrixVessel::getColumnElement( const unsigned& icol, const unsigned& k ) const {
+  if( symmetric ) return getRowElement( icol, k );
+  plumed_dbg_assert( k<getNumberOfElementsInColumn( icol ) );
+  return col_elements[col_starts[icol]+k];
+}
+
 }
 }
 #endif
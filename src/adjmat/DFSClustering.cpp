@@ -22,6 +22,7 @@
 #include "ClusteringBase.h"
 #include "AdjacencyMatrixVessel.h"
 #include "core/ActionRegister.h"
+#include "tools/UnionFind.h"
 
 #ifdef __PLUMED_HAS_BOOST_GRAPH
 #include <boost/graph/adjacency_list.hpp>
@@ -41,6 +42,11 @@ a depth first search clustering to find the connected components of this graph.
 
 https://en.wikipedia.org/wiki/Depth-first_search
 
+When PLUMED is not compiled with the boost graph library the connected components are found by merging the nodes
+at the ends of each of the edges in the graph using a disjoint-set (union-find) data structure.  This avoids the deep recursion
+that a depth first search requires for very large clusters and the edges are merged using multiple OpenMP threads.  The clusters
+that are found and the order in which they are numbered are the same as those that would be found by the depth first search.
+
 This action is useful if you are looking at a phenomenon such as nucleation where the aim is to detect the sizes of the crystalline nuclei that have formed
 in your simulation cell.
 
@@ -73,14 +79,10 @@ private:
 /// The list of edges in the graph
   std::vector<std::pair<unsigned,unsigned> > edge_list;
 #else
-/// The number of neighbors each atom has
-  std::vector<unsigned> nneigh;
-/// The adjacency list
-  Matrix<unsigned> adj_list;
-/// The color that tells us whether a node has been visited
-  std::vector<unsigned> color;
-/// The recursive function at the heart of this method
-  int explore( const unsigned& index );
+/// The list of edges in the graph
+  std::vector<std::pair<unsigned,unsigned> > edge_list;
+/// The disjoint sets that are used to find the connected components
+  UnionFind components;
 #endif
 public:
 /// Create manual
@@ -98,7 +100,7 @@ void DFSClustering::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","MAXCONNECT","0","maximum number of connections that can be formed by any given node in the graph. "
            "By default this is set equal to zero and the number of connections is set equal to the number "
            "of nodes.  You only really need to set this if you are working with a very large system and "
-           "memory is at a premium");
+           "memory is at a premium.  This is only used if PLUMED is compiled with the boost graph library");
 }
 
 DFSClustering::DFSClustering(const ActionOptions&ao):
@@ -110,9 +112,7 @@ DFSClustering::DFSClustering(const ActionOptions&ao):
   if( maxconnections>0 ) edge_list.resize( getNumberOfNodes()*maxconnections );
   else edge_list.resize(0.5*getNumberOfNodes()*(getNumberOfNodes()-1));
 #else
-  nneigh.resize( getNumberOfNodes() ); color.resize(getNumberOfNodes());
-  if( maxconnections>0 ) adj_list.resize(getNumberOfNodes(),maxconnections);
-  else adj_list.resize(getNumberOfNodes(),getNumberOfNodes());
+  components.resize( getNumberOfNodes() );
 #endif
 }
 
@@ -130,32 +130,18 @@ void DFSClustering::performClustering() {
   // And work out the size of each cluster
   for(unsigned i=0; i<which_cluster.size(); ++i) cluster_sizes[which_cluster[i]].first++;
 #else
-  // Get the adjacency matrix
-  getAdjacencyVessel()->retrieveAdjacencyLists( nneigh, adj_list );
-
-  // Perform clustering
-  number_of_cluster=-1; color.assign(color.size(),0);
-  for(unsigned i=0; i<getNumberOfNodes(); ++i) {
-    if( color[i]==0 ) { number_of_cluster++; color[i]=explore(i); }
-  }
-#endif
-}
-
-#ifndef __PLUMED_HAS_BOOST_GRAPH
-int DFSClustering::explore( const unsigned& index ) {
+  // Get the list of edges.  This only has to be as large as the number of stored matrix elements
+  if( edge_list.size()<getAdjacencyVessel()->getNumberOfStoredValues() ) edge_list.resize( getAdjacencyVessel()->getNumberOfStoredValues() );
+  unsigned nedges=0; getAdjacencyVessel()->retrieveEdgeList( nedges, edge_list );
 
-  color[index]=1;
-  for(unsigned i=0; i<nneigh[index]; ++i) {
-    unsigned j=adj_list(index,i);
-    if( color[j]==0 ) color[j]=explore(j);
-  }
+  // Find the connected components by merging the nodes at the ends of each edge (-1 here for compatibility with boost version)
+  components.clear(); components.mergeEdges( nedges, edge_list );
+  number_of_cluster=components.getComponents( which_cluster ) - 1;
 
-  // Count the size of the cluster
-  cluster_sizes[number_of_cluster].first++;
-  which_cluster[index] = number_of_cluster;
-  return color[index];
-}
+  // And work out the size of each cluster
+  for(unsigned i=0; i<which_cluster.size(); ++i) cluster_sizes[which_cluster[i]].first++;
 #endif
+}
 
 }
 }
@@ -42,12 +42,12 @@ Write out the connectivity of the nodes in the graph in dot format.
 
 class DumpGraph : public ActionPilot {
 private:
-///
-  size_t maxconnections;
 /// The vessel that contains the graph
   AdjacencyMatrixVessel* mymatrix;
 /// The name of the file on which we are outputting the graph
   std::string filename;
+/// The maximum number of connections of each node (zero if there is no limit)
+  unsigned maxconnections;
 public:
 /// Create manual
   static void registerKeywords( Keywords& keys );
@@ -68,17 +68,19 @@ void DumpGraph::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","STRIDE","1","the frequency with which you would like to output the graph");
   keys.add("compulsory","FILE","the name of the file on which to output the data");
   keys.add("compulsory","MAXCONNECT","0","maximum number of connections that can be formed by any given node in the graph. "
-           "By default this is set equal to zero and the number of connections is set equal to the number "
-           "of nodes.  You only really need to set this if you are working with a very large system and "
-           "memory is at a premium");
+           "By default this is set equal to zero and the number of connections is not limited.  The memory "
+           "required to store the graph scales with the number of edges, so this is only used to check the graph: "
+           "PLUMED stops with an error if a node has more connections than this");
 
 }
 
 DumpGraph::DumpGraph( const ActionOptions& ao):
   Action(ao),
   ActionPilot(ao),
-  mymatrix(NULL)
+  mymatrix(NULL),
+  maxconnections(0)
 {
+  setStateful(false);
   parse("MAXCONNECT",maxconnections); std::string mstring; parse("MATRIX",mstring);
   AdjacencyMatrixBase* mm = plumed.getActionSet().selectWithLabel<AdjacencyMatrixBase*>( mstring );
   if( !mm ) error("found no action in set with label " + mstring + " that calculates matrix");
@@ -91,7 +93,7 @@ DumpGraph::DumpGraph( const ActionOptions& ao):
   }
   if( !mymatrix ) error( mm->getLabel() + " does not calculate an adjacency matrix");
   if( !mymatrix->isSymmetric() ) error("input contact matrix must be symmetric");
-  if( maxconnections==0 ) maxconnections=mymatrix->getNumberOfRows();
+  if( maxconnections>0 ) log.printf("  nodes can have at most %u connections\n",maxconnections);
   parse("FILE",filename);
   log.printf("  printing graph to file named %s \n",filename.c_str() );
   checkRead();
@@ -103,8 +105,18 @@ void DumpGraph::update() {
   // Print all nodes
   for(unsigned i=0; i<mymatrix->getNumberOfRows(); ++i) ofile.printf("%u [label=\"%u\"];\n",i,i);
   // Now retrieve connectivitives
-  unsigned nedge; std::vector<std::pair<unsigned,unsigned> > edge_list( mymatrix->getNumberOfRows()*maxconnections );
+  unsigned nedge; std::vector<std::pair<unsigned,unsigned> > edge_list;
   mymatrix->retrieveEdgeList( nedge, edge_list );
+  if( maxconnections>0 ) {
+    std::vector<unsigned> nconnections( mymatrix->getNumberOfRows(), 0 );
+    for(unsigned i=0; i<nedge; ++i) { nconnections[edge_list[i].first]++; nconnections[edge_list[i].second]++; }
+    for(unsigned i=0; i<nconnections.size(); ++i) {
+      if( nconnections[i]>maxconnections ) {
+        std::string num, nconn; Tools::convert(i,num); Tools::convert(nconnections[i],nconn);
+        error("node " + num + " has " + nconn + " connections, which is more than MAXCONNECT");
+      }
+    }
+  }
   for(unsigned i=0; i<nedge; ++i) ofile.printf("%u -- %u \n", edge_list[i].first, edge_list[i].second );
   ofile.printf("} \n");
 }
@@ -101,19 +101,16 @@ MatrixColumnSums::MatrixColumnSums(const ActionOptions& ao):
 
 double MatrixColumnSums::compute( const unsigned& tinded, multicolvar::AtomValuePack& myatoms ) const {
   double sum=0.0; std::vector<double> tvals( mymatrix->getNumberOfComponents() );
-  unsigned nrows = mymatrix->getNumberOfRows();
-  for(unsigned i=0; i<nrows; ++i) {
-    if( mymatrix->undirectedGraph() && tinded==i ) continue;
-    sum+=retrieveConnectionValue( i, tinded, tvals );
+  unsigned nelem = mymatrix->getNumberOfElementsInColumn( tinded );
+  for(unsigned k=0; k<nelem; ++k) {
+    mymatrix->retrieveSequentialValue( mymatrix->getColumnElement( tinded, k ).second, false, tvals );
+    sum+=tvals[0]*tvals[1];
   }
 
   if( !doNotCalculateDerivatives() ) {
     MultiValue myvals( mymatrix->getNumberOfComponents(), myatoms.getNumberOfDerivatives() );
     MultiValue& myvout=myatoms.getUnderlyingMultiValue();
-    for(unsigned i=0; i<nrows; ++i) {
-      if( mymatrix->isSymmetric() && tinded==i ) continue ;
-      addConnectionDerivatives( i, tinded, myvals, myvout );
-    }
+    for(unsigned k=0; k<nelem; ++k) addSequentialConnectionDerivatives( mymatrix->getColumnElement( tinded, k ).second, myvals, myvout );
   }
   return sum;
 }
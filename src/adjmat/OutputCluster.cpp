@@ -105,6 +105,7 @@ OutputCluster::OutputCluster(const ActionOptions& ao):
   ActionPilot(ao),
   myclusters(NULL)
 {
+  setStateful(false);
   // Setup output file
   ofile.link(*this); std::string file; parse("FILE",file);
   if( file.length()==0 ) error("output file name was not specified");
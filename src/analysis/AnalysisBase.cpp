@@ -55,6 +55,7 @@ AnalysisBase::AnalysisBase(const ActionOptions&ao):
       addDependency( my_input_data );
     }
   }
+  setStateful();
 }
 
 std::vector<std::string> AnalysisBase::getArgumentNames() {
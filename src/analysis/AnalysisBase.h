@@ -74,6 +74,8 @@ public:
   virtual double getNormalization() const ;
 /// Ensures that dissimilarities were set somewhere
   virtual bool dissimilaritiesWereSet() const ;
+/// Can getDissimilarity be called from several OpenMP threads at the same time
+  virtual bool dissimilaritiesAreThreadSafe() const ;
 /// Get the information on how dissimilarities were calculated for output PDB
   virtual std::string getDissimilarityInstruction() const ;
 /// Get the squared dissimilarity between two reference configurations
@@ -149,6 +151,11 @@ bool AnalysisBase::dissimilaritiesWereSet() const {
   return my_input_data->dissimilaritiesWereSet();
 }
 
+inline
+bool AnalysisBase::dissimilaritiesAreThreadSafe() const {
+  return my_input_data->dissimilaritiesAreThreadSafe();
+}
+
 inline
 double AnalysisBase::getDissimilarity( const unsigned& i, const unsigned& j ) {
   return my_input_data->getDissimilarity( i, j );
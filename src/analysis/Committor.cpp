@@ -24,6 +24,7 @@
 #include "core/ActionWithArguments.h"
 #include "core/ActionRegister.h"
 #include "core/PlumedMain.h"
+#include "tools/CheckpointData.h"
 
 namespace PLMD {
 namespace analysis {
@@ -72,6 +73,8 @@ public:
   explicit Committor(const ActionOptions&ao);
   void calculate() override;
   void apply() override {}
+  void writeCheckpoint(CheckpointData&cp) override {cp.write(basin);}
+  void readCheckpoint(CheckpointData&cp) override {cp.read(basin);}
 };
 
 PLUMED_REGISTER_ACTION(Committor,"COMMITTOR")
@@ -126,6 +129,7 @@ Committor::Committor(const ActionOptions&ao):
   parseFlag("NOSTOP", doNotStop);
 
   checkRead();
+  setStateful();
 
 
   for(unsigned b=0; b<nbasins; b++) {
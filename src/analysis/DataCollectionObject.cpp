@@ -25,8 +25,20 @@
 namespace PLMD {
 namespace analysis {
 
+DataCollectionObject::DataCollectionObject():
+  store(NULL),
+  storeindex(0)
+{
+}
+
+void DataCollectionObject::setFrameInStore( const std::string& action_label, const FrameStore* fstore, const unsigned& iframe ) {
+  plumed_dbg_assert( iframe<fstore->getNumberOfFrames() );
+  myaction=action_label; store=fstore; storeindex=iframe;
+  indices.resize(0); positions.resize(0); args.clear();
+}
+
 void DataCollectionObject::setAtomNumbersAndArgumentNames( const std::string& action_label, const std::vector<AtomNumber>& ind, const std::vector<std::string>& arg_names ) {
-  myaction=action_label; indices.resize( ind.size() ); positions.resize( indices.size() );
+  myaction=action_label; store=NULL; indices.resize( ind.size() ); positions.resize( indices.size() );
   for(unsigned i=0; i<ind.size(); ++i) indices[i]=ind[i];
   for(unsigned i=0; i<arg_names.size(); ++i) args.insert( std::pair<std::string,double>( arg_names[i], 0.0 ) );
 }
@@ -42,20 +54,31 @@ void DataCollectionObject::setArgument( const std::string& name, const double& v
   else args.insert( std::pair<std::string,double>( name, value ) );
 }
 
+bool DataCollectionObject::findArgument( const std::string& name, double& value ) const {
+  std::map<std::string,double>::const_iterator it = args.find(name);
+  if( it!=args.end() ) { value=it->second; return true; }
+  if( store ) {
+    int k=store->getArgumentIndex( name );
+    if( k>=0 ) { value=store->getArguments( storeindex )[k]; return true; }
+  }
+  return false;
+}
+
 bool DataCollectionObject::transferDataToPDB( PDB& mypdb ) {
   // Check if PDB contains argument names
   std::vector<std::string> pdb_args( mypdb.getArgumentNames() );
   // Now set the argument values
-  std::map<std::string,double>::iterator it;
+  double value;
   for(unsigned i=0; i<pdb_args.size(); ++i) {
-    it=args.find( pdb_args[i] );
-    if( it==args.end() ) return false;
-    mypdb.setArgumentValue( pdb_args[i], it->second );
+    if( !findArgument( pdb_args[i], value ) ) return false;
+    mypdb.setArgumentValue( pdb_args[i], value );
   }
   // Now set the atomic positions
-  std::vector<AtomNumber> pdb_pos( mypdb.getAtomNumbers() );
-  if( pdb_pos.size()==positions.size() ) mypdb.setAtomPositions( positions );
-  else if( pdb_pos.size()>0 ) plumed_merror("This feature is currently not ready");
+  unsigned natoms=getNumberOfAtoms();
+  if( mypdb.getAtomNumbers().size()==natoms ) {
+    if( store ) mypdb.setAtomPositions( std::vector<Vector>( getAtomPositions(), getAtomPositions()+natoms ) );
+    else mypdb.setAtomPositions( positions );
+  } else if( mypdb.getAtomNumbers().size()>0 ) plumed_merror("This feature is currently not ready");
   return true;
 }
 
@@ -26,6 +26,7 @@
 #include <vector>
 #include "tools/Vector.h"
 #include "tools/AtomNumber.h"
+#include "FrameStore.h"
 
 namespace PLMD {
 
@@ -44,7 +45,16 @@ private:
   std::vector<Vector> positions;
 /// The map containing the arguments that we are storing
   std::map<std::string,double> args;
+/// The store that holds the positions and arguments.  If this is NULL they are held in the object
+  const FrameStore* store;
+/// The index of the frame in the store
+  unsigned storeindex;
+/// Find the value of one of the arguments
+  bool findArgument( const std::string& name, double& value ) const ;
 public:
+  DataCollectionObject();
+/// Use the positions and arguments of one of the frames in a store rather than copies held in the object
+  void setFrameInStore( const std::string& action_label, const FrameStore* fstore, const unsigned& iframe );
 /// Set the names and atom numbers
   void setAtomNumbersAndArgumentNames( const std::string& action_label, const std::vector<AtomNumber>& ind, const std::vector<std::string>& arg_names );
 /// Set the positions of all the atoms
@@ -53,24 +63,40 @@ public:
   void setArgument( const std::string& name, const double& value );
 /// Return one of the atomic positions
   Vector getAtomPosition( const AtomNumber& ind ) const ;
+/// Get the number of atoms
+  unsigned getNumberOfAtoms() const ;
+/// Return a pointer to the first of the getNumberOfAtoms() atomic positions
+  const Vector* getAtomPositions() const ;
 /// Get the value of one of the arguments
   double getArgumentValue( const std::string& name ) const ;
 /// Transfer the data inside the object to a PDB object
   bool transferDataToPDB( PDB& mypdb );
 };
 
+inline
+unsigned DataCollectionObject::getNumberOfAtoms() const {
+  if( store ) return store->getNumberOfAtoms();
+  return positions.size();
+}
+
+inline
+const Vector* DataCollectionObject::getAtomPositions() const {
+  if( store ) return store->getPositions( storeindex );
+  return positions.data();
+}
+
 inline
 Vector DataCollectionObject::getAtomPosition( const AtomNumber& ind ) const {
-  return positions[ind.index()];
+  return getAtomPositions()[ind.index()];
 }
 
 inline
 double DataCollectionObject::getArgumentValue( const std::string& name ) const {
-  std::map<std::string,double>::const_iterator it = args.find(name);
-  if( it != args.end() ) return it->second;
+  double value;
+  if( findArgument( name, value ) ) return value;
   std::size_t dot=name.find_first_of('.'); std::string a=name.substr(0,dot);
-  if( a==myaction ) return args.find( name.substr(dot+1) )->second;
-  else plumed_merror("could not find required data in collection object");
+  if( a==myaction && findArgument( name.substr(dot+1), value ) ) return value;
+  plumed_merror("could not find required data in collection object");
 }
 
 }
@@ -24,6 +24,9 @@
 #include "core/ActionRegister.h"
 #include "reference/MetricRegister.h"
 #include "reference/ReferenceConfiguration.h"
+#include "tools/MultiReferenceRMSD.h"
+#include "tools/OpenMP.h"
+#include "tools/Pbc.h"
 
 //+PLUMEDOC ANALYSIS EUCLIDEAN_DISSIMILARITIES
 /*
@@ -42,6 +45,37 @@ private:
   PDB mypdb;
   std::string mtype;
   Matrix<double> dissimilarities;
+/// The metrics that can be calculated directly from the stored data.  Anything else is done by creating
+/// ReferenceConfiguration objects for each pair of frames
+  enum {generic,euclidean,normeuclidean,mahalanobis,optimal,simple,drmsd} kernel;
+/// The names of the arguments used by the kernels
+  std::vector<std::string> kernel_args;
+/// The weights of the arguments for NORM-EUCLIDEAN
+  std::vector<double> kernel_weights;
+/// The metric for MAHALANOBIS
+  Matrix<double> kernel_metric;
+/// With LOWMEM each thread keeps the RMSD object for the last frame that was the first argument of getDissimilarity,
+/// so the reference is only set up once when the distances between one frame and many others are calculated
+  struct RowRMSD {
+    unsigned frame;
+    MultiReferenceRMSD rmsd;
+    std::vector<unsigned> which;
+    std::vector<double> dist;
+    MultiReferenceRMSD::Workspace ws;
+  };
+  std::vector<RowRMSD> row_rmsd;
+/// The arguments for all the frames (the argument index runs fastest).  This is only used while the matrix is calculated
+  std::vector<double> frame_args;
+/// The positions of the atoms in each of the frames.  This is only used while the matrix is calculated
+  std::vector<const Vector*> frame_pos;
+/// The number of atoms in each frame
+  unsigned frame_natoms;
+/// Get the values of the arguments in a frame
+  void retrieveArguments( const DataCollectionObject& myobj, double* args ) const ;
+/// Calculate the dissimilarity between two frames using one of the kernels
+  double calculateDissimilarity( const unsigned& natoms, const Vector* ipos, const double* iarg, const Vector* jpos, const double* jarg ) const ;
+/// Calculate the dissimilarities between frames in [rstart,rend) and all the frames with larger indices
+  void calculateBlock( const unsigned& rstart, const unsigned& rend );
 public:
   static void registerKeywords( Keywords& keys );
   explicit EuclideanDissimilarityMatrix( const ActionOptions& ao );
@@ -49,6 +83,8 @@ public:
   void performAnalysis() override;
 /// This ensures that classes that use this data know that dissimilarities were set
   bool dissimilaritiesWereSet() const override { return true; }
+/// The generic metrics are calculated with a shared PDB object and stored in the matrix when they are first needed
+  bool dissimilaritiesAreThreadSafe() const override { return kernel!=generic; }
 /// Get information on how to calculate dissimilarities
   std::string getDissimilarityInstruction() const override;
 /// Get the squared dissimilarity between two reference configurations
@@ -63,11 +99,15 @@ void EuclideanDissimilarityMatrix::registerKeywords( Keywords& keys ) {
   AnalysisBase::registerKeywords( keys ); keys.use("ARG"); keys.reset_style("ARG","optional");
   keys.add("compulsory","METRIC","EUCLIDEAN","the method that you are going to use to measure the distances between points");
   keys.add("atoms","ATOMS","the list of atoms that you are going to use in the measure of distance that you are using");
+  keys.add("optional","SIGMA","the weights of the arguments for the NORM-EUCLIDEAN metric or the elements of the upper triangle of the metric, "
+           "row by row, for the MAHALANOBIS metric");
 }
 
 EuclideanDissimilarityMatrix::EuclideanDissimilarityMatrix( const ActionOptions& ao ):
   Action(ao),
-  AnalysisBase(ao)
+  AnalysisBase(ao),
+  kernel(generic),
+  frame_natoms(0)
 {
   parse("METRIC",mtype); std::vector<AtomNumber> atoms;
   if( my_input_data->getNumberOfAtoms()>0 ) {
@@ -111,12 +151,148 @@ EuclideanDissimilarityMatrix::EuclideanDissimilarityMatrix( const ActionOptions&
       mypdb.setArgumentNames( argnames ); requestArguments( myargs );
     }
   }
+  // Check if there is a kernel that works directly with the stored data for this metric
+  if( mypdb.getAtomNumbers().size()==0 && getNumberOfArguments()>0 ) {
+    if( mtype=="EUCLIDEAN" ) kernel=euclidean;
+    else if( mtype=="NORM-EUCLIDEAN" ) kernel=normeuclidean;
+    else if( mtype=="MAHALANOBIS" ) kernel=mahalanobis;
+    if( kernel!=generic ) kernel_args=mypdb.getArgumentNames();
+  } else if( mypdb.getAtomNumbers().size()>0 && getNumberOfArguments()==0 ) {
+    if( mtype=="OPTIMAL" || mtype=="OPTIMAL-FAST" ) kernel=optimal;
+    else if( mtype=="SIMPLE" ) kernel=simple;
+    else if( mtype=="DRMSD" ) kernel=drmsd;
+  }
+  std::vector<double> sigma; parseVector("SIGMA",sigma); unsigned nargs=getNumberOfArguments();
+  if( kernel==normeuclidean ) {
+    if( sigma.size()!=nargs ) error("there should be one value in SIGMA for each argument");
+    kernel_weights=sigma;
+  } else if( kernel==mahalanobis ) {
+    if( sigma.size()!=(nargs*(nargs+1))/2 ) error("SIGMA should contain the elements of the upper triangle of the metric");
+    kernel_metric.resize( nargs, nargs ); unsigned k=0;
+    for(unsigned i=0; i<nargs; ++i) {
+      for(unsigned j=i; j<nargs; ++j) { kernel_metric(i,j)=kernel_metric(j,i)=sigma[k]; k++; }
+    }
+  } else if( sigma.size()>0 ) error("SIGMA can only be used with the NORM-EUCLIDEAN and MAHALANOBIS metrics");
+  if( sigma.size()>0 ) {
+    log.printf("  sigma values are");
+    for(unsigned i=0; i<sigma.size(); ++i) log.printf(" %f",sigma[i]);
+    log.printf("\n");
+  }
 }
 
 void EuclideanDissimilarityMatrix::performAnalysis() {
+  // The frames may have changed so the RMSD objects from the last analysis cannot be used
+  if( usingLowMem() && kernel==optimal ) {
+    row_rmsd.resize( OpenMP::getNumThreads() );
+    for(unsigned t=0; t<row_rmsd.size(); ++t) {
+      row_rmsd[t].frame=getNumberOfDataPoints(); row_rmsd[t].which.assign( 1, 0 );
+    }
+  }
   // Resize dissimilarities matrix and set all elements to zero
   if( !usingLowMem() ) {
     dissimilarities.resize( getNumberOfDataPoints(), getNumberOfDataPoints() ); dissimilarities=0;
+    if( kernel==generic ) return;
+    // Collect the data from all the frames
+    unsigned nframes=getNumberOfDataPoints(), nargs=getNumberOfArguments();
+    frame_pos.resize( nframes ); frame_args.resize( nframes*nargs );
+    for(unsigned i=0; i<nframes; ++i) {
+      DataCollectionObject& myobj=getStoredData( i, true ); frame_pos[i]=myobj.getAtomPositions();
+      if( i==0 ) frame_natoms=myobj.getNumberOfAtoms();
+      else plumed_massert( myobj.getNumberOfAtoms()==frame_natoms, "frames have different numbers of atoms" );
+      if( nargs>0 ) retrieveArguments( myobj, &frame_args[i*nargs] );
+    }
+    // Calculate the upper triangle of the matrix in blocks of rows.  The blocks are divided between the
+    // MPI processes and the OpenMP threads.  Blocks near the top of the matrix have more work so the
+    // threads take them dynamically
+    const unsigned bsize=32, nblocks=(getNumberOfDataPoints()+bsize-1)/bsize;
+    unsigned rank=comm.Get_rank(), size=comm.Get_size(), nmine=0;
+    if( rank<nblocks ) nmine=(nblocks-rank+size-1)/size;
+    #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic,1)
+    for(unsigned k=0; k<nmine; ++k) {
+      unsigned rstart=(rank+k*size)*bsize, rend=rstart+bsize;
+      if( rend>getNumberOfDataPoints() ) rend=getNumberOfDataPoints();
+      calculateBlock( rstart, rend );
+    }
+    comm.Sum( dissimilarities ); frame_pos.resize(0); frame_args.resize(0);
+  }
+}
+
+void EuclideanDissimilarityMatrix::retrieveArguments( const DataCollectionObject& myobj, double* args ) const {
+  for(unsigned k=0; k<getNumberOfArguments(); ++k) args[k]=myobj.getArgumentValue( kernel_args[k] );
+}
+
+double EuclideanDissimilarityMatrix::calculateDissimilarity( const unsigned& natoms, const Vector* ipos, const double* iarg, const Vector* jpos, const double* jarg ) const {
+  if( kernel==euclidean || kernel==normeuclidean ) {
+    unsigned nargs=getNumberOfArguments(); double dd=0;
+    for(unsigned k=0; k<nargs; ++k) {
+      double tmp=getArguments()[k]->difference( iarg[k], jarg[k] );
+      dd+=( kernel==normeuclidean ? kernel_weights[k] : 1.0 )*tmp*tmp;
+    }
+    return dd;
+  } else if( kernel==mahalanobis ) {
+    // The differences are computed in the same order as in ReferenceArguments
+    unsigned nargs=getNumberOfArguments(); double dd=0;
+    for(unsigned i=0; i<nargs; ++i) {
+      double dp_i=getArguments()[i]->difference( iarg[i], jarg[i] );
+      for(unsigned j=0; j<nargs; ++j) {
+        double dp_j = (i==j) ? dp_i : getArguments()[j]->difference( iarg[j], jarg[j] );
+        dd+=dp_i*dp_j*kernel_metric(i,j);
+      }
+    }
+    return dd;
+  }
+  if( kernel==optimal ) {
+    MultiReferenceRMSD myrmsd; myrmsd.setType( mtype ); myrmsd.addReference( natoms, ipos );
+    std::vector<unsigned> which( 1, 0 ); std::vector<double> dist; MultiReferenceRMSD::Workspace ws;
+    myrmsd.calculate( jpos, which, dist, true, ws );
+    return dist[0];
+  } else if( kernel==simple ) {
+    // All the atoms have the same weight when the reference is created from the stored data
+    Vector icenter, jcenter; double w=1.0/natoms;
+    for(unsigned i=0; i<natoms; ++i) { icenter+=w*ipos[i]; jcenter+=w*jpos[i]; }
+    double dd=0;
+    for(unsigned i=0; i<natoms; ++i) dd+=w*modulo2( (jpos[i]-jcenter) - (ipos[i]-icenter) );
+    return dd;
+  } else if( kernel==drmsd ) {
+    // Periodic boundary conditions are only used for the second frame as the targets from the first frame are computed without them
+    const Pbc& pbc=getPbc(); double dd=0; unsigned npairs=0;
+    for(unsigned i=0; i<natoms; ++i) {
+      for(unsigned j=i+1; j<natoms; ++j) {
+        double target=delta( ipos[i], ipos[j] ).modulo();
+        if( target<=0 ) continue;
+        double diff=pbc.distance( jpos[i], jpos[j] ).modulo() - target;
+        dd+=diff*diff; npairs++;
+      }
+    }
+    plumed_massert( npairs>0, "drmsd will compare no distances" );
+    return dd / static_cast<double>( npairs );
+  }
+  plumed_error();
+  return 0.0;
+}
+
+void EuclideanDissimilarityMatrix::calculateBlock( const unsigned& rstart, const unsigned& rend ) {
+  if( kernel==optimal ) {
+    // The distances between each frame and all the frames in the block are computed together
+    MultiReferenceRMSD myrmsd; myrmsd.setType( mtype );
+    for(unsigned i=rstart; i<rend; ++i) myrmsd.addReference( frame_natoms, frame_pos[i] );
+    // This is called from inside a loop that is divided between the threads so the distances are computed serially
+    std::vector<unsigned> which; std::vector<double> dist; MultiReferenceRMSD::Workspace ws;
+    for(unsigned j=rstart+1; j<getNumberOfDataPoints(); ++j) {
+      which.resize(0);
+      for(unsigned i=rstart; i<rend && i<j; ++i) which.push_back( i-rstart );
+      myrmsd.calculate( frame_pos[j], which, dist, true, ws );
+      for(unsigned k=0; k<which.size(); ++k) dissimilarities(rstart+k,j)=dissimilarities(j,rstart+k)=dist[k];
+    }
+    return;
+  }
+  unsigned nargs=getNumberOfArguments();
+  for(unsigned i=rstart; i<rend; ++i) {
+    const double* iarg=nargs>0 ? &frame_args[i*nargs] : NULL;
+    for(unsigned j=i+1; j<getNumberOfDataPoints(); ++j) {
+      const double* jarg=nargs>0 ? &frame_args[j*nargs] : NULL;
+      dissimilarities(i,j)=dissimilarities(j,i)=calculateDissimilarity( frame_natoms, frame_pos[i], iarg, frame_pos[j], jarg );
+    }
   }
 }
 
@@ -126,6 +302,25 @@ std::string EuclideanDissimilarityMatrix::getDissimilarityInstruction() const {
 
 double EuclideanDissimilarityMatrix::getDissimilarity( const unsigned& iframe, const unsigned& jframe ) {
   plumed_dbg_assert( iframe<getNumberOfDataPoints() && jframe<getNumberOfDataPoints() );
+  if( kernel!=generic ) {
+    if( !usingLowMem() ) return dissimilarities(iframe,jframe);
+    if( iframe==jframe ) return 0.0;
+    DataCollectionObject& iobj=getStoredData( iframe, true ); DataCollectionObject& jobj=getStoredData( jframe, true );
+    plumed_massert( iobj.getNumberOfAtoms()==jobj.getNumberOfAtoms(), "frames have different numbers of atoms" );
+    if( kernel==optimal ) {
+      unsigned t=OpenMP::getThreadNum(); plumed_assert( t<row_rmsd.size() );
+      RowRMSD& row=row_rmsd[t];
+      if( row.frame!=iframe ) {
+        row.rmsd.clear(); row.rmsd.setType( mtype );
+        row.rmsd.addReference( iobj.getNumberOfAtoms(), iobj.getAtomPositions() ); row.frame=iframe;
+      }
+      row.rmsd.calculate( jobj.getAtomPositions(), row.which, row.dist, true, row.ws );
+      return row.dist[0];
+    }
+    std::vector<double> iarg( getNumberOfArguments() ), jarg( getNumberOfArguments() );
+    if( getNumberOfArguments()>0 ) { retrieveArguments( iobj, &iarg[0] ); retrieveArguments( jobj, &jarg[0] ); }
+    return calculateDissimilarity( iobj.getNumberOfAtoms(), iobj.getAtomPositions(), iarg.data(), jobj.getAtomPositions(), jarg.data() );
+  }
   if( !usingLowMem() ) {
     if( dissimilarities(iframe,jframe)>0. ) { return dissimilarities(iframe,jframe); }
   }
@@ -0,0 +1,139 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "FrameStore.h"
+#include "tools/Exception.h"
+#include <cerrno>
+#include <cstring>
+#ifdef __PLUMED_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace PLMD {
+namespace analysis {
+
+static_assert( sizeof(Vector)==3*sizeof(double), "positions are stored as three consecutive doubles" );
+
+FrameStore::FrameStore():
+  natoms(0),
+  nargs(0),
+  framesize(0),
+  nframes(0),
+  capacity(0),
+  data(NULL),
+  maxmemory(0),
+  fd(-1),
+  mapped(0)
+{
+}
+
+FrameStore::~FrameStore() {
+  closeScratchFile();
+}
+
+void FrameStore::setup( const std::vector<AtomNumber>& ind, const std::vector<std::string>& arg_names ) {
+  closeScratchFile(); indices=ind; argnames=arg_names;
+  natoms=indices.size(); nargs=argnames.size(); framesize=3*natoms+nargs;
+  nframes=capacity=0; buffer.resize(0); data=NULL;
+}
+
+void FrameStore::useScratchFile( const std::string& filename, const std::size_t& maxbytes ) {
+#ifdef __PLUMED_HAS_MMAP
+  plumed_assert( nframes==0 && fd<0 ); scratchfile=filename; maxmemory=maxbytes;
+#else
+  plumed_merror("cannot store frames in " + filename + " as plumed was compiled without mmap");
+#endif
+}
+
+void FrameStore::clear() {
+  nframes=0;
+}
+
+void FrameStore::addFrame( const std::vector<Vector>& pos, const std::vector<double>& args ) {
+  plumed_dbg_assert( pos.size()==natoms && args.size()==nargs );
+  if( framesize==0 ) { nframes++; return; }
+  if( nframes==capacity ) reserve( nframes+1 );
+  double* frame=data + nframes*framesize;
+  for(unsigned i=0; i<natoms; ++i) {
+    frame[3*i+0]=pos[i][0]; frame[3*i+1]=pos[i][1]; frame[3*i+2]=pos[i][2];
+  }
+  for(unsigned i=0; i<nargs; ++i) frame[3*natoms+i]=args[i];
+  nframes++;
+}
+
+int FrameStore::getArgumentIndex( const std::string& name ) const {
+  for(unsigned i=0; i<nargs; ++i) {
+    if( argnames[i]==name ) return i;
+  }
+  return -1;
+}
+
+void FrameStore::reserve( const unsigned& n ) {
+  if( n<=capacity ) return;
+  // The space is doubled so the number of times the data is moved grows logarithmically with the number of frames
+  unsigned newcap=2*capacity; if( newcap<n ) newcap=n; if( newcap<16 ) newcap=16;
+  if( fd>=0 || (!scratchfile.empty() && newcap*framesize*sizeof(double)>maxmemory) ) {
+    mapScratchFile( newcap );
+  } else {
+    buffer.resize( newcap*framesize ); data=buffer.data();
+  }
+  capacity=newcap;
+}
+
+#ifdef __PLUMED_HAS_MMAP
+void FrameStore::mapScratchFile( const unsigned& n ) {
+  std::size_t nbytes=n*framesize*sizeof(double);
+  bool first=(fd<0);
+  if( first ) {
+    fd=open( scratchfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+    if( fd<0 ) plumed_merror("could not open scratch file " + scratchfile + ": " + std::strerror(errno) );
+    // The file is removed straight away so nothing is left behind if the calculation stops.  The data remains accessible through the mapping
+    unlink( scratchfile.c_str() );
+  } else if( munmap( data, mapped )!=0 ) plumed_merror("could not unmap scratch file " + scratchfile );
+  if( ftruncate( fd, nbytes )!=0 ) plumed_merror("could not resize scratch file " + scratchfile + ": " + std::strerror(errno) );
+  void* ptr=mmap( NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if( ptr==MAP_FAILED ) plumed_merror("could not map scratch file " + scratchfile + ": " + std::strerror(errno) );
+  data=static_cast<double*>( ptr ); mapped=nbytes;
+  // The first time the file is mapped the frames that are already in memory are copied into it
+  if( first ) {
+    if( nframes>0 ) std::memcpy( data, buffer.data(), nframes*framesize*sizeof(double) );
+    std::vector<double>().swap( buffer );
+  }
+}
+
+void FrameStore::closeScratchFile() {
+  if( fd<0 ) return;
+  munmap( data, mapped ); close( fd );
+  fd=-1; mapped=0; data=NULL; nframes=capacity=0;
+}
+#else
+void FrameStore::mapScratchFile( const unsigned& n ) {
+  plumed_error();
+}
+
+void FrameStore::closeScratchFile() {
+}
+#endif
+
+}
+}
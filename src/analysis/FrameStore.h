@@ -0,0 +1,142 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_analysis_FrameStore_h
+#define __PLUMED_analysis_FrameStore_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "tools/Vector.h"
+#include "tools/AtomNumber.h"
+#include "tools/Exception.h"
+
+namespace PLMD {
+namespace analysis {
+
+/// A store for the frames collected by COLLECT_FRAMES.  Each frame is saved as a fixed length
+/// record that contains the 3*natoms coordinates followed by the arguments so the data for all the
+/// frames sits in one contiguous block of memory.  By default this block is kept in memory.  If a
+/// scratch file is given the data is moved into a memory-mapped copy of that file once it grows beyond
+/// a threshold so that trajectories that do not fit in memory can still be analyzed.  Pointers returned
+/// by the get functions are invalidated when further frames are added.
+class FrameStore {
+private:
+/// The number of atoms and arguments in each frame
+  unsigned natoms, nargs;
+/// The number of doubles in the record for each frame
+  std::size_t framesize;
+/// The number of frames stored and the number of frames there is currently space for
+  unsigned nframes, capacity;
+/// The numbers of the atoms that are stored
+  std::vector<AtomNumber> indices;
+/// The names of the arguments that are stored
+  std::vector<std::string> argnames;
+/// The memory used when the frames are not in the scratch file
+  std::vector<double> buffer;
+/// The start of the stored data.  This points into buffer or into the mapped scratch file
+  double* data;
+/// The name of the scratch file (if this is empty the data is always kept in memory)
+  std::string scratchfile;
+/// The number of bytes the frames can use before they are moved to the scratch file
+  std::size_t maxmemory;
+/// The descriptor of the scratch file (this is negative when the data is in memory)
+  int fd;
+/// The number of bytes of the scratch file that are mapped
+  std::size_t mapped;
+/// Make sure there is space for n frames
+  void reserve( const unsigned& n );
+/// Map the scratch file with space for n frames
+  void mapScratchFile( const unsigned& n );
+/// Unmap and close the scratch file
+  void closeScratchFile();
+public:
+  FrameStore();
+  ~FrameStore();
+  FrameStore( const FrameStore& ) = delete;
+  FrameStore& operator=( const FrameStore& ) = delete;
+/// Set the atoms and arguments that are stored.  This deletes all the frames
+  void setup( const std::vector<AtomNumber>& ind, const std::vector<std::string>& arg_names );
+/// Move the data to a memory-mapped file named filename once it is larger than maxbytes
+  void useScratchFile( const std::string& filename, const std::size_t& maxbytes );
+/// Is the data currently in the scratch file
+  bool inScratchFile() const ;
+/// Delete all the frames.  The space that was used is kept for the frames that are added later
+  void clear();
+/// Add a frame
+  void addFrame( const std::vector<Vector>& pos, const std::vector<double>& args );
+/// Get the number of frames
+  unsigned getNumberOfFrames() const ;
+/// Get the number of atoms in each frame
+  unsigned getNumberOfAtoms() const ;
+/// Get the numbers of the atoms that are stored
+  const std::vector<AtomNumber>& getAtomNumbers() const ;
+/// Get the names of the arguments that are stored
+  const std::vector<std::string>& getArgumentNames() const ;
+/// Get the index of an argument from its name.  This returns a negative number if the argument is not stored
+  int getArgumentIndex( const std::string& name ) const ;
+/// Get the positions of the atoms in one of the frames
+  const Vector* getPositions( const unsigned& iframe ) const ;
+/// Get the arguments in one of the frames
+  const double* getArguments( const unsigned& iframe ) const ;
+};
+
+inline
+bool FrameStore::inScratchFile() const {
+  return fd>=0;
+}
+
+inline
+unsigned FrameStore::getNumberOfFrames() const {
+  return nframes;
+}
+
+inline
+unsigned FrameStore::getNumberOfAtoms() const {
+  return natoms;
+}
+
+inline
+const std::vector<AtomNumber>& FrameStore::getAtomNumbers() const {
+  return indices;
+}
+
+inline
+const std::vector<std::string>& FrameStore::getArgumentNames() const {
+  return argnames;
+}
+
+inline
+const Vector* FrameStore::getPositions( const unsigned& iframe ) const {
+  plumed_dbg_assert( iframe<nframes );
+  return reinterpret_cast<const Vector*>( data + iframe*framesize );
+}
+
+inline
+const double* FrameStore::getArguments( const unsigned& iframe ) const {
+  plumed_dbg_assert( iframe<nframes );
+  return data + iframe*framesize + 3*natoms;
+}
+
+}
+}
+
+#endif
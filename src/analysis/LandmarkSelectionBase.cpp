@@ -20,6 +20,7 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "LandmarkSelectionBase.h"
+#include "tools/OpenMP.h"
 
 namespace PLMD {
 namespace analysis {
@@ -67,20 +68,57 @@ void LandmarkSelectionBase::performAnalysis() {
 
 void LandmarkSelectionBase::voronoiAnalysis( const std::vector<unsigned>& myindices, std::vector<double>& lweights, std::vector<unsigned>& assignments ) const {
   plumed_dbg_assert( myindices.size()==lweights.size() && assignments.size()==my_input_data->getNumberOfDataPoints() );
-  lweights.assign( lweights.size(), 0 );
+  lweights.assign( lweights.size(), 0 ); assignments.assign( assignments.size(), 0 );
+  std::vector<double> mindist( my_input_data->getNumberOfDataPoints() );
+  for(unsigned j=0; j<myindices.size(); ++j) updateClosestLandmarks( j, myindices[j], mindist, assignments );
   unsigned rank=comm.Get_rank(), size=comm.Get_size();
-  for(unsigned i=rank; i<my_input_data->getNumberOfDataPoints(); i+=size) {
-    assignments[i]=0;
-    double mindist=my_input_data->getDissimilarity( i, myindices[0] );
-    for(unsigned j=1; j<nlandmarks; ++j) {
-      double dist=my_input_data->getDissimilarity( i, myindices[j] );
-      if( dist<mindist ) { mindist=dist; assignments[i]=j; }
-    }
-    lweights[ assignments[i] ] += my_input_data->getWeight(i);
-  }
+  for(unsigned i=rank; i<my_input_data->getNumberOfDataPoints(); i+=size) lweights[ assignments[i] ] += my_input_data->getWeight(i);
   comm.Sum( &lweights[0], lweights.size() );
   comm.Sum( &assignments[0], assignments.size() );
 }
 
+unsigned LandmarkSelectionBase::updateClosestLandmarks( const unsigned& ilandmark, const unsigned& iframe, std::vector<double>& mindist, std::vector<unsigned>& assignments ) const {
+  plumed_dbg_assert( mindist.size()==my_input_data->getNumberOfDataPoints() && assignments.size()==mindist.size() );
+  unsigned rank=comm.Get_rank(), size=comm.Get_size();
+  // Only the dissimilarities from the new landmark are required as we keep track of the distance to the closest landmark.
+  // Each thread finds the farthest of its points and ties are resolved in favour of the point with the lowest index
+  double maxd=0; unsigned imax=0;
+  unsigned nt=my_input_data->dissimilaritiesAreThreadSafe() ? OpenMP::getNumThreads() : 1;
+  #pragma omp parallel num_threads(nt)
+  {
+    double tmaxd=0; unsigned timax=0;
+    #pragma omp for nowait
+    for(unsigned i=rank; i<mindist.size(); i+=size) {
+      double dist=my_input_data->getDissimilarity( iframe, i );
+      if( ilandmark==0 || dist<mindist[i] ) { mindist[i]=dist; assignments[i]=ilandmark; }
+      if( mindist[i]>tmaxd ) { tmaxd=mindist[i]; timax=i; }
+    }
+    #pragma omp critical
+    if( tmaxd>maxd || (tmaxd==maxd && timax<imax) ) { maxd=tmaxd; imax=timax; }
+  }
+  return imax;
+}
+
+void LandmarkSelectionBase::farthestPointSampling( std::vector<unsigned>& landmarks ) const {
+  plumed_dbg_assert( landmarks.size()>0 && landmarks[0]<my_input_data->getNumberOfDataPoints() );
+  // We only store the (squared) distance between each point and the closest landmark so memory scales linearly with the number of points
+  std::vector<double> mindist( my_input_data->getNumberOfDataPoints() );
+  std::vector<unsigned> assignments( my_input_data->getNumberOfDataPoints() );
+  unsigned rank=comm.Get_rank(), size=comm.Get_size();
+  std::vector<double> allmax( size ); std::vector<unsigned> allind( size );
+  for(unsigned i=1; i<landmarks.size(); ++i) {
+    unsigned imax=updateClosestLandmarks( i-1, landmarks[i-1], mindist, assignments );
+    if( size==1 ) { landmarks[i]=imax; continue; }
+    // Find the farthest point on all the processes.  Ties are resolved in favour of the point with the lowest index
+    allmax.assign( size, 0.0 ); allind.assign( size, 0 );
+    if( imax%size==rank ) allmax[rank]=mindist[imax];
+    allind[rank]=imax; comm.Sum( allmax ); comm.Sum( allind );
+    double maxd=allmax[0]; landmarks[i]=allind[0];
+    for(unsigned k=1; k<size; ++k) {
+      if( allmax[k]>maxd || (allmax[k]==maxd && allind[k]<landmarks[i]) ) { maxd=allmax[k]; landmarks[i]=allind[k]; }
+    }
+  }
+}
+
 }
 }
@@ -43,6 +43,11 @@ protected:
   void selectFrame( const unsigned& );
 /// Do a voronoi analysis
   void voronoiAnalysis( const std::vector<unsigned>& myindices, std::vector<double>& lweights, std::vector<unsigned>& assignments ) const ;
+/// Update the dissimilarity between each point and the closest landmark once landmark number ilandmark (frame iframe) has been added.
+/// Each MPI process only updates the points it is responsible for and returns the one of these points that is farthest from all the landmarks
+  unsigned updateClosestLandmarks( const unsigned& ilandmark, const unsigned& iframe, std::vector<double>& mindist, std::vector<unsigned>& assignments ) const ;
+/// Select landmarks using farthest point sampling.  The first landmark must be in landmarks[0] on input
+  void farthestPointSampling( std::vector<unsigned>& landmarks ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit LandmarkSelectionBase( const ActionOptions& ao );
@@ -73,25 +73,7 @@ void LandmarkStaged::selectLandmarks() {
   fpslandmarks[0] = std::floor( N*rand );
 
   // using FPS we want to find m landmarks where m = sqrt(nN)
-  // Now find distance to all other points
-  Matrix<double> distances( m, N );
-  for(unsigned int i=0; i<N; ++i) {
-    distances(0,i) = my_input_data->getDissimilarity( fpslandmarks[0], i );
-  }
-
-  // Now find all other landmarks
-  for(unsigned i=1; i<m; ++i) {
-    // Find point that has the largest minimum distance from the landmarks selected thus far
-    double maxd=0;
-    for(unsigned j=0; j<N; ++j) {
-      double mind=distances(0,j);
-      for(unsigned k=1; k<i; ++k) {
-        if( distances(k,j)<mind ) { mind=distances(k,j); }
-      }
-      if( mind>maxd ) { maxd=mind; fpslandmarks[i]=j; }
-    }
-    for(unsigned k=0; k<N; ++k) distances(i,k) = my_input_data->getDissimilarity( fpslandmarks[i], k );
-  }
+  farthestPointSampling( fpslandmarks );
 
   // Initial FPS selection of m landmarks completed
   // Now find voronoi weights of these m points
@@ -28,6 +28,12 @@
 /*
 This allows you to convert a trajectory and a dissimilarity matrix into a dissimilarity object
 
+The positions and arguments from all the frames are stored in one contiguous block of memory.  When
+very long trajectories are analyzed this block can be moved into a memory-mapped file by using the
+SCRATCH_FILE keyword.  The data is then only moved to the file once it is larger than SCRATCH_MEMORY
+megabytes so small inputs are still kept in memory.  The scratch file is deleted as soon as it is opened
+so nothing is left on disk when the calculation finishes.
+
 \par Examples
 
 */
@@ -44,6 +50,8 @@ void ReadAnalysisFrames::registerKeywords( Keywords& keys ) {
   keys.add("atoms-1","ATOMS","the atoms whose positions we are tracking for the purpose of analyzing the data");
   keys.add("atoms-1","STRIDE","the frequency with which data should be stored for analysis.  By default data is collected on every step");
   keys.add("compulsory","CLEAR","0","the frequency with which data should all be deleted and restarted");
+  keys.add("optional","SCRATCH_FILE","the name of a file to which the stored data should be moved once it is larger than SCRATCH_MEMORY");
+  keys.add("compulsory","SCRATCH_MEMORY","1024","the amount of memory in megabytes that the stored data can use before it is moved to the SCRATCH_FILE");
   keys.add("optional","LOGWEIGHTS","list of actions that calculates log weights that should be used to weight configurations when calculating averages");
   ActionWithValue::useCustomisableComponents( keys );
 }
@@ -67,6 +75,19 @@ ReadAnalysisFrames::ReadAnalysisFrames( const ActionOptions& ao ):
     for(unsigned i=0; i<atom_numbers.size(); ++i) log.printf("%d ",atom_numbers[i].serial() );
     log.printf("\n"); requestAtoms(atom_numbers);
   }
+  store.setup( atom_numbers, argument_names ); frame_args.resize( argument_names.size() );
+  std::string scratch; parse("SCRATCH_FILE",scratch); double maxmem; parse("SCRATCH_MEMORY",maxmem);
+  if( scratch.length()>0 ) {
+#ifdef __PLUMED_HAS_MMAP
+    // Each process needs its own file
+    scratch += plumed.getSuffix();
+    if( comm.Get_size()>1 ) { std::string num; Tools::convert( comm.Get_rank(), num ); scratch += "." + num; }
+    log.printf("  moving stored data to file %s once it uses more than %f megabytes\n", scratch.c_str(), maxmem );
+    store.useScratchFile( scratch, static_cast<std::size_t>( maxmem*1024*1024 ) );
+#else
+    error("cannot use SCRATCH_FILE as plumed was compiled without mmap");
+#endif
+  }
 
   // Get stuff for any reweighting that should go on
   std::vector<std::string> wwstr; parseVector("LOGWEIGHTS",wwstr);
@@ -131,7 +152,7 @@ void ReadAnalysisFrames::update() {
   if( getStep()==0 ) return;
   // Delete everything we stored now that it has been analyzed
   if( clearonnextstep ) {
-    my_data_stash.clear(); my_data_stash.resize(0);
+    my_data_stash.clear(); my_data_stash.resize(0); store.clear();
     logweights.clear(); logweights.resize(0);
     if( wham_pointer ) wham_pointer->clearData();
     clearonnextstep=false;
@@ -141,11 +162,11 @@ void ReadAnalysisFrames::update() {
   double ww=0; for(unsigned i=0; i<weight_vals.size(); ++i) ww+=weight_vals[i]->get();
   weights_calculated=false; logweights.push_back(ww);
 
-  // Now create the data collection object and push it back to be stored
+  // Now store the frame and create the data collection object that is used to access it
+  for(unsigned i=0; i<argument_names.size(); ++i) frame_args[i]=getArgument(i);
+  store.addFrame( getPositions(), frame_args );
   unsigned index = my_data_stash.size(); my_data_stash.push_back( DataCollectionObject() );
-  my_data_stash[index].setAtomNumbersAndArgumentNames( getLabel(), atom_numbers, argument_names );
-  my_data_stash[index].setAtomPositions( getPositions() );
-  for(unsigned i=0; i<argument_names.size(); ++i) my_data_stash[index].setArgument( argument_names[i], getArgument(i) );
+  my_data_stash[index].setFrameInStore( getLabel(), &store, store.getNumberOfFrames()-1 );
 
   if( clearstride>0 ) {
     if( getStep()%clearstride==0 ) clearonnextstep=true;
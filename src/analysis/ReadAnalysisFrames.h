@@ -23,6 +23,7 @@
 #define __PLUMED_analysis_ReadAnalysisFrames_h
 
 #include "AnalysisBase.h"
+#include "FrameStore.h"
 #include "bias/ReweightBase.h"
 
 namespace PLMD {
@@ -44,7 +45,11 @@ private:
 /// The weights of all the data points
   bool weights_calculated;
   std::vector<double> logweights, weights;
-/// The data that has been collected from the trajectory
+/// The positions and arguments that have been collected from the trajectory
+  FrameStore store;
+/// Space for the arguments in the current frame
+  std::vector<double> frame_args;
+/// The objects through which the frames in the store are passed to other actions
   std::vector<DataCollectionObject> my_data_stash;
 /// Calculate the weights of the various points from the logweights
   void calculateWeights();
@@ -64,6 +69,8 @@ public:
   std::vector<Value*> getArgumentList() override;
 /// Have dissimilarities between thses objects been calculated
   bool dissimilaritiesWereSet() const override;
+/// There are no dissimilarities to calculate
+  bool dissimilaritiesAreThreadSafe() const override { return false; }
 /// How are dissimilarities calcualted is not known
   std::string getDissimilarityInstruction() const override;
 /// Get the weight of one of the objects
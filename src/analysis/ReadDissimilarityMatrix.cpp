@@ -59,6 +59,8 @@ public:
   DataCollectionObject& getStoredData( const unsigned& idata, const bool& calcdist ) override;
 /// Tell everyone we have dissimilarities
   bool dissimilaritiesWereSet() const override { return true; }
+/// The dissimilarities are only read from the matrix
+  bool dissimilaritiesAreThreadSafe() const override { return true; }
 /// Get the dissimilarity between two data points
   double getDissimilarity( const unsigned&, const unsigned& ) override;
 /// Get the weight from the input file
@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Bias.h"
 #include "tools/Random.h"
+#include "tools/CheckpointData.h"
 #include "ActionRegister.h"
 #include <ctime>
 
@@ -91,6 +92,8 @@ class ABMD : public Bias {
 public:
   explicit ABMD(const ActionOptions&);
   void calculate() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords(Keywords& keys);
 };
 
@@ -128,6 +131,7 @@ ABMD::ABMD(const ActionOptions&ao):
   parseVector("SEED",seed);
   parseVector("TO",to);
   checkRead();
+  setStateful();
 
   log.printf("  min");
   for(unsigned i=0; i<min.size(); i++) log.printf(" %f",min[i]);
@@ -182,6 +186,18 @@ void ABMD::calculate() {
   getPntrToComponent("force2")->set(totf2);
 }
 
+void ABMD::writeCheckpoint(CheckpointData&cp) {
+  cp.write(min);
+  cp.write(temp);
+  for(const auto & r : random) r.writeCheckpoint(cp);
+}
+
+void ABMD::readCheckpoint(CheckpointData&cp) {
+  cp.read(min);
+  cp.read(temp);
+  for(auto & r : random) r.readCheckpoint(cp);
+}
+
 }
 }
 
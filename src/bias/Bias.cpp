@@ -32,6 +32,7 @@ Bias::Bias(const ActionOptions&ao):
   ActionWithArguments(ao),
   outputForces(getNumberOfArguments(),0.0)
 {
+  setStateful(false);
   addComponentWithDerivatives("bias");
   componentIsNotPeriodic("bias");
   valueBias=getPntrToComponent("bias");
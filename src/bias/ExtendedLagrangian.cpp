@@ -22,6 +22,7 @@
 #include "Bias.h"
 #include "ActionRegister.h"
 #include "tools/Random.h"
+#include "tools/CheckpointData.h"
 #include "core/PlumedMain.h"
 #include "core/Atoms.h"
 
@@ -129,6 +130,8 @@ public:
   explicit ExtendedLagrangian(const ActionOptions&);
   void calculate() override;
   void update() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords(Keywords& keys);
 };
 
@@ -172,6 +175,7 @@ ExtendedLagrangian::ExtendedLagrangian(const ActionOptions&ao):
   if(temp>=0.0) kbt=plumed.getAtoms().getKBoltzmann()*temp;
   else kbt=plumed.getAtoms().getKbT();
   checkRead();
+  setStateful();
 
   log.printf("  with harmonic force constant");
   for(unsigned i=0; i<kappa.size(); i++) log.printf(" %f",kappa[i]);
@@ -268,6 +272,22 @@ void ExtendedLagrangian::update() {
   }
 }
 
+void ExtendedLagrangian::writeCheckpoint(CheckpointData&cp) {
+  cp.write(firsttime);
+  cp.write(fict);
+  cp.write(vfict);
+  cp.write(vfict_laststep);
+  rand.writeCheckpoint(cp);
+}
+
+void ExtendedLagrangian::readCheckpoint(CheckpointData&cp) {
+  cp.read(firsttime);
+  cp.read(fict);
+  cp.read(vfict);
+  cp.read(vfict_laststep);
+  rand.readCheckpoint(cp);
+}
+
 }
 
 }
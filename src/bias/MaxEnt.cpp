@@ -281,6 +281,7 @@ MaxEnt::MaxEnt(const ActionOptions&ao):
   if(simtemp<=0 && reweight) error("Set the temperature (TEMP) if you want to do reweighting.");
 
   checkRead();
+  setStateful();
 
   log.printf("  at");
   for(unsigned i=0; i<at.size(); i++) log.printf(" %f",at[i]);
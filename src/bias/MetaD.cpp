@@ -29,6 +29,7 @@
 #include "core/FlexibleBin.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/CheckpointData.h"
 #include <string>
 #include <cstring>
 #include "tools/File.h"
@@ -478,6 +479,8 @@ public:
   explicit MetaD(const ActionOptions&);
   void calculate() override;
   void update() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords(Keywords& keys);
   bool checkNeedsGradients()const override;
 };
@@ -855,6 +858,7 @@ MetaD::MetaD(const ActionOptions& ao):
   }
 
   checkRead();
+  setStateful();
 
   log.printf("  Gaussian width ");
   if (adaptive_==FlexibleBin::diffusion)log.printf(" (Note: The units of sigma are in timesteps) ");
@@ -1151,6 +1155,9 @@ MetaD::MetaD(const ActionOptions& ao):
     }
   }
 
+  // the hills read from the files of the other walkers are not stored in binary checkpoints
+  if(getRestartFromCheckpoint() && mw_n_>1) error("binary checkpoints cannot be used with multiple walkers that share the hills through files");
+
   // creating vector of ifile* for hills reading
   // open all files at the beginning and read Gaussians if restarting
   for(int i=0; i<mw_n_; ++i) {
@@ -1179,7 +1186,7 @@ MetaD::MetaD(const ActionOptions& ao):
     ifile->link(*this);
     if(ifile->FileExist(fname)) {
       ifile->open(fname);
-      if(getRestart()&&!restartedFromGrid) {
+      if(getRestart()&&!restartedFromGrid&&!getRestartFromCheckpoint()) {
         log.printf("  Restarting from %s:",ifilesnames[i].c_str());
         readGaussians(ifiles[i].get());
       }
@@ -1405,6 +1412,66 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
   file.printField();
 }
 
+void MetaD::writeCheckpoint(CheckpointData&cp)
+{
+  cp.write(std::uint64_t(hills_.size()));
+  for(const auto & h : hills_) {
+    cp.write(h.center);
+    cp.write(h.sigma);
+    cp.write(h.height);
+    cp.write(h.multivariate);
+  }
+  if(grid_) BiasGrid_->writeCheckpoint(cp);
+  if(adaptive_!=FlexibleBin::none) flexbin->writeCheckpoint(cp);
+  cp.write(work_);
+  cp.write(acc);
+  if(acceleration) cp.write(getPntrToComponent("acc")->get());
+  cp.write(current_stride);
+  cp.write(reweight_factor_);
+  cp.write(max_bias_);
+  cp.write(transition_bias_);
+  cp.write(isFirstStep);
+}
+
+void MetaD::readCheckpoint(CheckpointData&cp)
+{
+  std::uint64_t nhills;
+  cp.read(nhills);
+  hills_.clear();
+  hills_.reserve(nhills);
+  for(unsigned i=0; i<nhills; i++) {
+    vector<double> center,sigma;
+    double height;
+    bool multivariate;
+    cp.read(center);
+    cp.read(sigma);
+    cp.read(height);
+    cp.read(multivariate);
+    hills_.push_back(Gaussian(center,sigma,height,multivariate));
+  }
+  if(grid_) BiasGrid_->readCheckpoint(cp);
+  if(adaptive_!=FlexibleBin::none) flexbin->readCheckpoint(cp);
+  cp.read(work_);
+  cp.read(acc);
+  if(acceleration) {
+    double mean_acc;
+    cp.read(mean_acc);
+    getPntrToComponent("acc")->set(mean_acc);
+    // the acceleration factor read from the checkpoint is used in place of ACCELERATION_RFILE
+    acc_restart_mean_=0.0;
+  }
+  cp.read(current_stride);
+  if(freq_adaptive_) getPntrToComponent("pace")->set(current_stride);
+  cp.read(reweight_factor_);
+  if(calc_rct_) getPntrToComponent("rct")->set(reweight_factor_);
+  cp.read(max_bias_);
+  if(calc_max_bias_) getPntrToComponent("maxbias")->set(max_bias_);
+  cp.read(transition_bias_);
+  if(calc_transition_bias_) getPntrToComponent("transbias")->set(transition_bias_);
+  // the checkpoint is taken after a complete step, so the next step is not treated as the first one
+  cp.read(isFirstStep);
+}
+
 void MetaD::addGaussian(const Gaussian& hill)
 {
   if(!grid_) hills_.push_back(hill);
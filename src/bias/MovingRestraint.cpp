@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Bias.h"
 #include "ActionRegister.h"
+#include "tools/CheckpointData.h"
 
 
 using namespace std;
@@ -115,6 +116,8 @@ class MovingRestraint : public Bias {
 public:
   explicit MovingRestraint(const ActionOptions&);
   void calculate() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords( Keywords& keys );
 };
 
@@ -175,6 +178,7 @@ MovingRestraint::MovingRestraint(const ActionOptions&ao):
     at.push_back(aa);
   }
   checkRead();
+  setStateful();
 
   for(unsigned i=0; i<step.size(); i++) {
     log.printf("  step%u %ld\n",i,step[i]);
@@ -264,6 +268,22 @@ void MovingRestraint::calculate() {
   getPntrToComponent("force2")->set(totf2);
 }
 
+void MovingRestraint::writeCheckpoint(CheckpointData&cp) {
+  cp.write(work);
+  cp.write(oldaa);
+  cp.write(oldk);
+  cp.write(olddpotdk);
+  cp.write(oldf);
+}
+
+void MovingRestraint::readCheckpoint(CheckpointData&cp) {
+  cp.read(work);
+  cp.read(oldaa);
+  cp.read(oldk);
+  cp.read(olddpotdk);
+  cp.read(oldf);
+}
+
 }
 }
 
@@ -529,6 +529,7 @@ PBMetaD::PBMetaD(const ActionOptions& ao):
   }
 
   checkRead();
+  setStateful();
 
   log.printf("  Gaussian width ");
   if (adaptive_==FlexibleBin::diffusion)log.printf(" (Note: The units of sigma are in timesteps) ");
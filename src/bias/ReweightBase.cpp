@@ -40,6 +40,7 @@ ReweightBase::ReweightBase(const ActionOptions&ao):
   ActionWithValue(ao),
   ActionWithArguments(ao)
 {
+  setStateful(false);
   simtemp=0.; parse("TEMP",simtemp);
   if(simtemp>0) simtemp*=plumed.getAtoms().getKBoltzmann();
   else simtemp=plumed.getAtoms().getKbT();
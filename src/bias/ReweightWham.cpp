@@ -107,6 +107,7 @@ ReweightWham::ReweightWham(const ActionOptions&ao):
   ReweightBase(ao),
   weightsCalculated(false)
 {
+  setStateful();
   parse("MAXITER",maxiter); parse("WHAMTOL",thresh);
   if(comm.Get_rank()==0) nreplicas=multi_sim_comm.Get_size();
   comm.Bcast(nreplicas,0);
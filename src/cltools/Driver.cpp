@@ -26,8 +26,11 @@
 #include "tools/Communicator.h"
 #include "tools/Random.h"
 #include "tools/Pbc.h"
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <memory>
@@ -35,6 +38,11 @@
 #include "tools/PDB.h"
 #include "tools/FileBase.h"
 #include "tools/IFile.h"
+#include "tools/OFile.h"
+#include "tools/XdrFile.h"
+#include "core/ActionSet.h"
+#include "tools/OpenMP.h"
+#include <exception>
 
 // when using molfile plugin
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
@@ -52,9 +60,18 @@ using namespace PLMD::molfile;
 #endif
 #endif
 
-#ifdef __PLUMED_HAS_XDRFILE
-#include <xdrfile/xdrfile_trr.h>
-#include <xdrfile/xdrfile_xtc.h>
+
+#ifdef __PLUMED_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __PLUMED_HAS_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #endif
 
 using namespace std;
@@ -166,14 +183,74 @@ plumed driver --plumed plumed.dat --imf_crd trajectory.crd --natoms 128
 
 Check the available molfile plugins and limitations at [this link](http://www.ks.uiuc.edu/Research/vmd/plugins/molfile/).
 
-Additionally, you can use the xdrfile implementation of xtc and trr. To this aim, just
-download and install properly the xdrfile library (see [this link](http://www.gromacs.org/Developer_Zone/Programming_Guide/XTC_Library)).
-If the xdrfile library is installed properly the PLUMED configure script should be able to
-detect it and enable it.
-Notice that the xdrfile implementation of xtc and trr
+Additionally, you can use the PLUMED implementation of xtc and trr with the `--ixtc` and `--itrr` options.
+It does not require any external library and
 is more robust than the molfile one, since it provides support for generic cell shapes.
-In addition, it allows \ref DUMPATOMS to write compressed xtc files.
+The same implementation allows \ref DUMPATOMS to write xtc and trr files.
+
+When long trajectories are analyzed, reading the file can take as long as the analysis itself.
+With the `--prefetch` option the frames are read by a separate thread while PLUMED is analyzing the previous ones.
+The number given is the number of frames that are kept in memory. Frames in text formats (xyz, gro and DL_POLY_4)
+are also converted to numbers in parallel, using the number of threads set with PLUMED_NUM_THREADS:
+
+\verbatim
+PLUMED_NUM_THREADS=4 plumed driver --plumed plumed.dat --igro traj.gro --prefetch 16
+\endverbatim
+
+When the input only contains actions that do not keep a state between frames (e.g. collective variables,
+functions, \ref PRINT, \ref DUMPATOMS or \ref RESTRAINT) the frames can be analyzed independently.
+With the `--frame-parallel` flag, each MPI process reads its own block of consecutive frames
+and analyzes it with a separate copy of PLUMED. At the end, the output files written by the
+other processes are appended, in frame order, to those written by the first process, so that the
+result is the same that is obtained in serial. Only the log of the first process is written.
+An error is reported if the input contains an action that keeps a state between frames (e.g. \ref METAD or analysis actions).
+Notice that collective variables using neighbor lists are allowed, but, since the lists are rebuilt at the
+beginning of each block, their results can be slightly different from those obtained in serial.
+This option cannot be used together with `--multi`:
+
+\verbatim
+mpirun -np 4 plumed driver --plumed plumed.dat --igro traj.gro --frame-parallel
+\endverbatim
+
+A subset of the frames can be analyzed with the `--frame-range` and `--frame-stride` options.
+Frames are counted from zero, and the step number of each frame is computed from its position in the trajectory,
+so that the output is the same that would be obtained by analyzing all the frames with a plumed input using a larger `STRIDE`.
+The following command analyzes frames 1000, 1010, 1020, ... up to frame 2000:
+
+\verbatim
+plumed driver --plumed plumed.dat --ixtc traj.xtc --frame-range 1000,2000 --frame-stride 10
+\endverbatim
+
+The frames that are not analyzed are skipped without converting them. For xtc and trr files only the header of each frame is read, and dcd files read with `--mf_dcd` are also skipped without reading the coordinates.
+When the same trajectory is analyzed many times, the position of each frame in the file can be stored with `--frame-index`.
+The index is written the first time the trajectory is read and it is used in the following runs to go directly to the requested frames.
+It is written again if the size of the trajectory or the content of its first and last 4 kB have changed. The index can be used with the xyz, gro, DL_POLY_4, xtc and trr formats,
+and it is also used by `--frame-parallel` to find the block of frames of each process.
+Notice that text trajectories are indexed by counting their lines, so the number of atoms written in each xyz and gro frame should be correct.
 
+When the trajectories of a Hamiltonian replica exchange simulation are analyzed with `--multi`, the bias of each replica can be evaluated on the
+frames of all the replicas, as needed for instance to reweight them with MBAR. With `--bias-matrix`, at each frame the positions of the atoms used by
+each replica are passed around the ring of replicas, each replica evaluates its own bias on the positions received from all the others, and the first
+replica writes a line containing the time and the \f$N\times N\f$ matrix of biases. The column `bias.i.j` is the bias of replica `i` evaluated on the frame of replica `j`,
+in kJ/mol. The input of replica `i` is read from `plumed.i.dat` if it exists, otherwise from `plumed.dat`, and all the trajectories should contain the same number of frames:
+
+\verbatim
+mpirun -np 4 plumed driver --plumed plumed.dat --ixtc traj.xtc --multi 4 --bias-matrix bias_matrix
+\endverbatim
+
+Here the trajectory of replica `i` is read from `traj.i.xtc`. The actions that are updated during the simulation (e.g. \ref METAD) are not updated while the bias is evaluated on the frames of the other replicas.
+
+The state of the actions that are updated during the simulation (e.g. the hills of \ref METAD) can be saved at the end of the analysis
+in a binary checkpoint with `--write-checkpoint`, and restored in a following run with `--read-checkpoint`. The following commands
+analyze the first 1000 frames and then the remaining ones, with the same result as a single run over the whole trajectory:
+
+\verbatim
+plumed driver --plumed plumed.dat --ixtc traj.xtc --frame-range 0,999 --write-checkpoint state.cpt
+plumed driver --plumed plumed.dat --ixtc traj.xtc --frame-range 1000 --read-checkpoint state.cpt
+\endverbatim
+
+The input file should be the same in the two runs. The output files are appended as with \ref RESTART, and the restart files of the
+actions (e.g. the HILLS file) are not read. With `--multi`, each replica writes and reads its own checkpoint, with the replica number as a suffix.
 
 */
 //+ENDPLUMEDOC
@@ -195,6 +272,712 @@ static int register_cb(void *v, vmdplugin_t *p) {
 }
 #endif
 
+/// A frame of the trajectory, as it is read by DriverReader
+template<typename real>
+struct DriverFrame {
+/// Number of atoms in the frame
+  int natoms=0;
+/// Step number, only for the formats that store it
+  bool hasStep=false;
+  long int step=0;
+/// Timestep, only for the formats that store it
+  bool hasTimestep=false;
+  real timestep=0.0;
+/// Coordinates and cell, in nm
+  std::vector<real> coordinates;
+  std::vector<real> cell;
+/// Masses and charges, only for the formats that store them (dlp4)
+  std::vector<real> masses;
+  std::vector<real> charges;
+/// Lines of the frame for text formats. They are kept between frames to reuse their memory
+  std::vector<std::string> lines;
+/// Number of lines of this frame
+  unsigned nlines=0;
+/// Number of the frame in the trajectory, counting from zero
+  long unsigned index=0;
+/// True if the end of the trajectory was found instead of this frame
+  bool eof=false;
+/// Error found while reading this frame
+  std::exception_ptr error;
+};
+
+/// Reads the lines of a text trajectory.
+/// When mmap is available the file is mapped in memory and the lines are found with memchr,
+/// so that going to a frame of the index only changes the position in the mapped region
+class DriverLineScanner {
+#ifdef __PLUMED_HAS_MMAP
+  const char* data=NULL;
+  std::size_t size=0;
+  std::size_t pos=0;
+#else
+  FILE* fp=NULL;
+  std::string line;
+#endif
+public:
+  explicit DriverLineScanner(const std::string & path,bool sequential=true) {
+#ifdef __PLUMED_HAS_MMAP
+    int fd=open(path.c_str(),O_RDONLY);
+    if(fd<0) plumed_merror("cannot open trajectory file " + path + ": " + std::strerror(errno));
+    struct stat st;
+    if(fstat(fd,&st)!=0) {
+      close(fd);
+      plumed_merror("cannot get the size of trajectory file " + path);
+    }
+    size=st.st_size;
+    if(size>0) {
+      void* ptr=mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+      close(fd);
+      if(ptr==MAP_FAILED) plumed_merror("cannot map trajectory file " + path + ": " + std::strerror(errno));
+      madvise(ptr,size,sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+      data=static_cast<const char*>(ptr);
+    } else close(fd);
+#else
+    fp=std::fopen(path.c_str(),"r");
+    if(!fp) plumed_merror("cannot open trajectory file " + path);
+#endif
+  }
+  ~DriverLineScanner() {
+#ifdef __PLUMED_HAS_MMAP
+    if(data) munmap(const_cast<char*>(data),size);
+#else
+    if(fp) std::fclose(fp);
+#endif
+  }
+  DriverLineScanner(const DriverLineScanner&) = delete;
+  DriverLineScanner& operator=(const DriverLineScanner&) = delete;
+/// Position of the next line, in bytes
+  long unsigned tell() {
+#ifdef __PLUMED_HAS_MMAP
+    return pos;
+#else
+    return std::ftell(fp);
+#endif
+  }
+/// Go to a position, in bytes
+  void seek(long unsigned offset) {
+#ifdef __PLUMED_HAS_MMAP
+    pos=offset;
+#else
+    if(std::fseek(fp,offset,SEEK_SET)!=0) plumed_merror("cannot go to the requested frame of the trajectory");
+#endif
+  }
+/// Go past the next line, which is copied in copy if it is not NULL.
+/// As for Tools::getline, false is returned at the end of the file, an incomplete last line is ignored
+/// and a carriage return at the end of the line is removed
+  bool next(std::string* copy=NULL) {
+#ifdef __PLUMED_HAS_MMAP
+    if(pos>=size) return false;
+    const char* begin=data+pos;
+    const char* end=static_cast<const char*>(std::memchr(begin,'\n',size-pos));
+    if(!end) {
+      pos=size;
+      return false;
+    }
+    pos+=end-begin+1;
+    if(copy) {
+      if(end>begin && *(end-1)=='\r') end--;
+      copy->assign(begin,end-begin);
+    }
+    return true;
+#else
+    return Tools::getline(fp,copy ? *copy : line);
+#endif
+  }
+};
+
+/// Reads the frames of the trajectory given to the driver.
+/// Reading is split in two parts. read() does the input/output and, for text formats,
+/// only stores the lines of the frame. parse() converts the lines into numbers, so that
+/// several frames can be parsed at the same time.
+template<typename real>
+class DriverReader {
+/// Read a line and append it to the lines of frame f
+  bool getline(DriverFrame<real>& f);
+/// Read the frame at the present position of the file
+  bool readFrame(DriverFrame<real>& f);
+/// Go to a position of the file taken from the index
+  void seek(long unsigned offset);
+/// Number of the frame at the present position of the file
+  long unsigned position=0;
+/// Number of frames returned by read()
+  long unsigned nreturned=0;
+public:
+/// The following are set by the driver before reading
+  std::string fmt;
+  bool use_molfile=false;
+/// Text trajectories are read from lines, or from fp when they come from standard input
+  DriverLineScanner* lines=NULL;
+  FILE* fp=NULL;
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+  molfile_plugin_t *api=NULL;
+  void *h_in=NULL;
+  molfile_timestep_t* ts_in=NULL;
+#endif
+  XdrFile* xd=NULL;
+/// Box and positions of xtc and trr frames
+  Tensor xdrBox;
+  std::vector<Vector> xdrPositions;
+  int natoms=0;
+  int lvl=0;
+  unsigned stride=1;
+  bool pbc_cli_given=false;
+  std::vector<double> pbc_cli_box;
+/// Frames returned by read() are first, first+every, first+2*every, etc, and at most count of them
+  long unsigned first=0;
+  long unsigned every=1;
+  long unsigned count=std::numeric_limits<long unsigned>::max();
+/// Position of each frame in the file, in bytes. When it is not empty, read() goes directly to the
+/// frames that are requested. Otherwise, the frames in between are skipped with skip()
+  std::vector<long unsigned> index;
+/// Read the next requested frame. Returns false at the end of the trajectory
+  bool read(DriverFrame<real>& f);
+/// Go past the next frame of the file without converting it. Returns false at the end of the trajectory
+  bool skip(DriverFrame<real>& f);
+/// To be called when the file has been opened again, so that frames are read from the beginning
+  void restart() {position=0; nreturned=0;}
+/// Number of lines of a frame in DL_POLY_4 format
+  unsigned dlp4Lines() const {
+    return (pbc_cli_given ? 0 : 3)+natoms*(2+(lvl>0 ? 1 : 0)+(lvl>1 ? 1 : 0));
+  }
+/// Fill the index of the trajectory in file path. xtc and trr files are read without decoding the coordinates,
+/// for text files only the lines are counted
+  void buildIndex(const std::string & path);
+/// Read the index from file. Returns false if the file does not exist or if it was written
+/// for a trajectory with a different format, size (in bytes) or checksum
+  bool readIndex(const std::string & file,long unsigned trajsize,long unsigned checksum);
+/// Write the index to file
+  void writeIndex(const std::string & file,long unsigned trajsize,long unsigned checksum) const;
+/// Convert the lines read by read() into numbers. Nothing is done for binary formats
+  void parse(DriverFrame<real>& f) const;
+/// True if the format is read with read() and parse(), false if read() does everything
+  bool isText() const {
+    return !use_molfile && (fmt=="xyz" || fmt=="gro" || fmt=="dlp4");
+  }
+};
+
+template<typename real>
+bool DriverReader<real>::getline(DriverFrame<real>& f) {
+  if(f.lines.size()<=f.nlines) f.lines.resize(f.nlines+1);
+  if(!(lines ? lines->next(&f.lines[f.nlines]) : Tools::getline(fp,f.lines[f.nlines]))) return false;
+  f.nlines++;
+  return true;
+}
+
+template<typename real>
+bool DriverReader<real>::read(DriverFrame<real>& f) {
+  if(nreturned>=count) return false;
+  const long unsigned wanted=first+nreturned*every;
+  if(wanted!=position && index.size()>0) {
+    if(wanted>=index.size()) return false;
+    seek(index[wanted]);
+    position=wanted;
+  }
+  plumed_massert(wanted>=position,"frames can only be read again with an index");
+  while(position<wanted) if(!skip(f)) return false;
+  if(!readFrame(f)) return false;
+  f.index=position;
+  position++;
+  nreturned++;
+  return true;
+}
+
+template<typename real>
+bool DriverReader<real>::skip(DriverFrame<real>& f) {
+  if(use_molfile) {
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+// with a null timestep, the plugins skip the frame (e.g. dcd uses a seek)
+    if(api->read_next_timestep(h_in,natoms,NULL)==MOLFILE_EOF) return false;
+#endif
+  } else if(fmt=="xdr-xtc" || fmt=="xdr-trr") {
+    if(!xd->skip()) return false;
+  } else {
+// lines are read but not converted
+    if(!readFrame(f)) return false;
+  }
+  position++;
+  return true;
+}
+
+template<typename real>
+void DriverReader<real>::seek(long unsigned offset) {
+  if(fmt=="xdr-xtc" || fmt=="xdr-trr") xd->seek(offset);
+  else if(lines) lines->seek(offset);
+  else if(std::fseek(fp,offset,SEEK_SET)!=0) plumed_merror("cannot go to the requested frame of the trajectory");
+}
+
+template<typename real>
+bool DriverReader<real>::readFrame(DriverFrame<real>& f) {
+  f.hasStep=false;
+  f.hasTimestep=false;
+  f.nlines=0;
+  f.cell.assign(9,real(0.0));
+  if(use_molfile) {
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+    int rc = api->read_next_timestep(h_in, natoms, ts_in);
+    if(rc==MOLFILE_EOF) return false;
+    f.natoms=natoms;
+    std::vector<real> & cell(f.cell);
+    if(pbc_cli_given==false) {
+      if(ts_in->A>0.0) { // this is negative if molfile does not provide box
+        // info on the cell: convert using pbcset.tcl from pbctools in vmd distribution
+        real cosBC=cos(real(ts_in->alpha)*pi/180.);
+        //double sinBC=sin(ts_in->alpha*pi/180.);
+        real cosAC=cos(real(ts_in->beta)*pi/180.);
+        real cosAB=cos(real(ts_in->gamma)*pi/180.);
+        real sinAB=sin(real(ts_in->gamma)*pi/180.);
+        real Ax=real(ts_in->A);
+        real Bx=real(ts_in->B)*cosAB;
+        real By=real(ts_in->B)*sinAB;
+        real Cx=real(ts_in->C)*cosAC;
+        real Cy=(real(ts_in->C)*real(ts_in->B)*cosBC-Cx*Bx)/By;
+        real Cz=sqrt(real(ts_in->C)*real(ts_in->C)-Cx*Cx-Cy*Cy);
+        cell[0]=Ax/10.; cell[1]=0.; cell[2]=0.;
+        cell[3]=Bx/10.; cell[4]=By/10.; cell[5]=0.;
+        cell[6]=Cx/10.; cell[7]=Cy/10.; cell[8]=Cz/10.;
+      }
+    } else {
+      for(unsigned i=0; i<9; i++)cell[i]=pbc_cli_box[i];
+    }
+    // info on coords
+    // the order is xyzxyz...
+    f.coordinates.resize(3*natoms);
+    for(int i=0; i<3*natoms; i++) {
+      f.coordinates[i]=real(ts_in->coords[i])/real(10.); //convert to nm
+    }
+#endif
+    return true;
+  }
+  if(fmt=="xdr-xtc" || fmt=="xdr-trr") {
+    long int localstep;
+    double time;
+    if(!xd->read(localstep,time,xdrBox,xdrPositions)) return false;
+    natoms=xdrPositions.size();
+    f.natoms=natoms;
+    if(stride==0) {
+      f.hasStep=true;
+      f.step=localstep;
+    }
+    for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) f.cell[3*i+j]=xdrBox(i,j);
+    f.coordinates.resize(3*natoms);
+    for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++)
+        f.coordinates[3*i+j]=real(xdrPositions[i][j]);
+    return true;
+  }
+// text formats: here the lines are only stored
+  if(!getline(f)) return false;
+  unsigned nlines=0;
+  if(fmt=="xyz" || fmt=="gro") {
+    if(fmt=="gro") if(!getline(f)) plumed_merror("premature end of trajectory file");
+    sscanf(f.lines[f.nlines-1].c_str(),"%100d",&natoms);
+    nlines=natoms+1;
+  } else if(fmt=="dlp4") {
+    nlines=dlp4Lines();
+  } else plumed_error();
+  f.natoms=natoms;
+  for(unsigned i=0; i<nlines; i++) if(!getline(f)) plumed_merror("premature end of trajectory file");
+  return true;
+}
+
+template<typename real>
+void DriverReader<real>::parse(DriverFrame<real>& f) const {
+  if(!isText()) return;
+  const int natoms=f.natoms;
+  std::vector<real> & cell(f.cell);
+  f.coordinates.resize(3*natoms);
+  unsigned l=1;
+  if(fmt=="xyz") {
+    const std::string & line(f.lines[l++]);
+    std::vector<double> celld(9,0.0);
+    if(pbc_cli_given==false) {
+      std::vector<std::string> words;
+      words=Tools::getWords(line);
+      if(words.size()==3) {
+        sscanf(line.c_str(),"%100lf %100lf %100lf",&celld[0],&celld[4],&celld[8]);
+      } else if(words.size()==9) {
+        sscanf(line.c_str(),"%100lf %100lf %100lf %100lf %100lf %100lf %100lf %100lf %100lf",
+               &celld[0], &celld[1], &celld[2],
+               &celld[3], &celld[4], &celld[5],
+               &celld[6], &celld[7], &celld[8]);
+      } else plumed_merror("needed box in second line of xyz file");
+    } else {			// from command line
+      celld=pbc_cli_box;
+    }
+    for(unsigned i=0; i<9; i++)cell[i]=real(celld[i]);
+  }
+  if(fmt=="gro") l=2;
+  if(fmt=="dlp4") {
+    char xa[9];
+    int xb,xc,xd;
+    double t;
+    sscanf(f.lines[0].c_str(),"%8s %ld %d %d %d %lf",xa,&f.step,&xb,&xc,&xd,&t);
+    f.hasStep=true;
+    f.timestep=real(t);
+    f.hasTimestep=true;
+    std::vector<double> celld(9,0.0);
+    if(pbc_cli_given==false) {
+      sscanf(f.lines[l++].c_str(),"%lf %lf %lf",&celld[0],&celld[1],&celld[2]);
+      sscanf(f.lines[l++].c_str(),"%lf %lf %lf",&celld[3],&celld[4],&celld[5]);
+      sscanf(f.lines[l++].c_str(),"%lf %lf %lf",&celld[6],&celld[7],&celld[8]);
+    } else {
+      celld=pbc_cli_box;
+    }
+    for(auto i=0; i<9; i++)cell[i]=real(celld[i])*0.1;
+    f.masses.resize(natoms);
+    f.charges.resize(natoms);
+  }
+  int ddist=0;
+  // Read coordinates
+  for(int i=0; i<natoms; i++) {
+    const std::string & line(f.lines[l++]);
+    double cc[3];
+    if(fmt=="xyz") {
+      char dummy[1000];
+      int ret=std::sscanf(line.c_str(),"%999s %100lf %100lf %100lf",dummy,&cc[0],&cc[1],&cc[2]);
+      if(ret!=4) plumed_merror("cannot read line"+line);
+    } else if(fmt=="gro") {
+      // do the gromacs way
+      if(!i) {
+        //
+        // calculate the distance between dots (as in gromacs gmxlib/confio.c, routine get_w_conf )
+        //
+        const char      *p1, *p2, *p3;
+        p1 = strchr(line.c_str(), '.');
+        if (p1 == NULL) plumed_merror("seems there are no coordinates in the gro file");
+        p2 = strchr(&p1[1], '.');
+        if (p2 == NULL) plumed_merror("seems there is only one coordinates in the gro file");
+        ddist = p2 - p1;
+        p3 = strchr(&p2[1], '.');
+        if (p3 == NULL) plumed_merror("seems there are only two coordinates in the gro file");
+        if (p3 - p2 != ddist) plumed_merror("not uniform spacing in fields in the gro file");
+      }
+      Tools::convert(line.substr(20,ddist),cc[0]);
+      Tools::convert(line.substr(20+ddist,ddist),cc[1]);
+      Tools::convert(line.substr(20+ddist+ddist,ddist),cc[2]);
+    } else if(fmt=="dlp4") {
+      char dummy[9];
+      int idummy;
+      double m,c;
+      sscanf(line.c_str(),"%8s %d %lf %lf",dummy,&idummy,&m,&c);
+      f.masses[i]=real(m);
+      f.charges[i]=real(c);
+      sscanf(f.lines[l++].c_str(),"%lf %lf %lf",&cc[0],&cc[1],&cc[2]);
+      cc[0]*=0.1;
+      cc[1]*=0.1;
+      cc[2]*=0.1;
+      // velocities and forces are skipped
+      if(lvl>0) l++;
+      if(lvl>1) l++;
+    } else plumed_error();
+    f.coordinates[3*i]=real(cc[0]);
+    f.coordinates[3*i+1]=real(cc[1]);
+    f.coordinates[3*i+2]=real(cc[2]);
+  }
+  if(fmt=="gro") {
+    std::vector<string> words=Tools::getWords(f.lines[l++]);
+    if(words.size()<3) plumed_merror("cannot understand box format");
+    Tools::convert(words[0],cell[0]);
+    Tools::convert(words[1],cell[4]);
+    Tools::convert(words[2],cell[8]);
+    if(words.size()>3) Tools::convert(words[3],cell[1]);
+    if(words.size()>4) Tools::convert(words[4],cell[2]);
+    if(words.size()>5) Tools::convert(words[5],cell[3]);
+    if(words.size()>6) Tools::convert(words[6],cell[5]);
+    if(words.size()>7) Tools::convert(words[7],cell[6]);
+    if(words.size()>8) Tools::convert(words[8],cell[7]);
+  }
+}
+
+template<typename real>
+void DriverReader<real>::buildIndex(const std::string & path) {
+  index.clear();
+  if(fmt=="xdr-xtc" || fmt=="xdr-trr") {
+    XdrFile x;
+    x.open(path,"r",fmt=="xdr-xtc" ? XdrFile::xtc : XdrFile::trr);
+    while(true) {
+      const long unsigned offset=x.tell();
+      if(!x.skip()) break;
+      index.push_back(offset);
+    }
+    return;
+  }
+  plumed_assert(isText());
+  DriverLineScanner scanner(path);
+  std::string line;
+// title and number of atoms
+  if(fmt=="dlp4") for(unsigned i=0; i<2; i++) if(!scanner.next()) plumed_merror("premature end of trajectory file");
+  while(true) {
+    const long unsigned offset=scanner.tell();
+    unsigned nlines=0;
+    if(fmt=="xyz" || fmt=="gro") {
+      if(!scanner.next(&line)) break;
+      if(fmt=="gro") if(!scanner.next(&line)) plumed_merror("premature end of trajectory file");
+      int n=0;
+      sscanf(line.c_str(),"%100d",&n);
+      nlines=n+1;
+    } else {
+      if(!scanner.next()) break;
+      nlines=dlp4Lines();
+    }
+    for(unsigned i=0; i<nlines; i++) if(!scanner.next()) plumed_merror("premature end of trajectory file");
+    index.push_back(offset);
+  }
+}
+
+/// A file containing the index of a trajectory starts with this string. It is followed by the format, the size
+/// in bytes and the checksum of the trajectory, by the number of frames and by their positions, in the native binary representation
+static const char frameIndexMagic[]="PLUMED frame index 2";
+
+template<typename real>
+bool DriverReader<real>::readIndex(const std::string & file,long unsigned trajsize,long unsigned checksum) {
+  FILE* fp=std::fopen(file.c_str(),"rb");
+  if(!fp) return false;
+  char magic[sizeof(frameIndexMagic)];
+  char fmtbuf[32];
+  long unsigned header[3];
+  bool ok=std::fread(magic,1,sizeof(magic),fp)==sizeof(magic) && std::memcmp(magic,frameIndexMagic,sizeof(magic))==0 &&
+          std::fread(fmtbuf,1,sizeof(fmtbuf),fp)==sizeof(fmtbuf) && fmtbuf[sizeof(fmtbuf)-1]==0 && fmt==fmtbuf &&
+          std::fread(header,sizeof(long unsigned),3,fp)==3 && header[0]==trajsize && header[1]==checksum && header[2]<=trajsize;
+  if(ok) {
+    index.resize(header[2]);
+    ok=std::fread(index.data(),sizeof(long unsigned),index.size(),fp)==index.size();
+  }
+  std::fclose(fp);
+  if(!ok) index.clear();
+  return ok;
+}
+
+// the index is written in a temporary file that is then renamed, so that other processes never read an incomplete index
+template<typename real>
+void DriverReader<real>::writeIndex(const std::string & file,long unsigned trajsize,long unsigned checksum) const {
+  const std::string tmp=file+".tmp";
+  FILE* fp=std::fopen(tmp.c_str(),"wb");
+  if(!fp) plumed_merror("cannot write frame index " + file);
+  char fmtbuf[32]= {0};
+  std::strncpy(fmtbuf,fmt.c_str(),sizeof(fmtbuf)-1);
+  const long unsigned header[3]= {trajsize,checksum,index.size()};
+  bool ok=std::fwrite(frameIndexMagic,1,sizeof(frameIndexMagic),fp)==sizeof(frameIndexMagic) &&
+          std::fwrite(fmtbuf,1,sizeof(fmtbuf),fp)==sizeof(fmtbuf) &&
+          std::fwrite(header,sizeof(long unsigned),3,fp)==3 &&
+          std::fwrite(index.data(),sizeof(long unsigned),index.size(),fp)==index.size();
+  if(std::fclose(fp)!=0) ok=false;
+  if(!ok || std::rename(tmp.c_str(),file.c_str())!=0) {
+    std::remove(tmp.c_str());
+    plumed_merror("cannot write frame index " + file);
+  }
+}
+
+/// Size of a file in bytes
+static long unsigned fileSize(const std::string & path) {
+  FILE* fp=std::fopen(path.c_str(),"rb");
+  if(!fp) plumed_merror("cannot open file " + path);
+  std::fseek(fp,0,SEEK_END);
+  const long int size=std::ftell(fp);
+  std::fclose(fp);
+  return size;
+}
+
+/// Checksum (FNV-1a) of the first and last 4 kB of a file of the given size. It is stored in the frame index,
+/// so that a trajectory that has been written again with the same size is indexed again
+static long unsigned fileChecksum(const std::string & path,long unsigned size) {
+  const long unsigned block=4096;
+  FILE* fp=std::fopen(path.c_str(),"rb");
+  if(!fp) plumed_merror("cannot open file " + path);
+  std::vector<unsigned char> buffer(std::min(size,block));
+  std::uint64_t hash=14695981039346656037ULL;
+  const long unsigned offsets[2]= {0,size>block ? size-block : 0};
+  for(unsigned k=0; k<(size>block ? 2 : 1); k++) {
+    std::fseek(fp,offsets[k],SEEK_SET);
+    const std::size_t n=std::fread(buffer.data(),1,buffer.size(),fp);
+    for(std::size_t i=0; i<n; i++) hash=(hash^buffer[i])*1099511628211ULL;
+  }
+  std::fclose(fp);
+  return hash;
+}
+
+#ifdef __PLUMED_HAS_THREADS
+/// Reads the frames of the trajectory ahead, while plumed is analyzing the previous ones.
+/// The frames are stored in a ring of buffers that are allocated once.
+/// A thread reads batches of frames into the free buffers. Text frames of a batch are then
+/// parsed in parallel with OpenMP. The driver takes the frames in order with get() and gives
+/// each buffer back with release().
+template<typename real>
+class DriverPrefetcher {
+  DriverReader<real> & reader;
+/// The buffers. Frame number n is stored in ring[n%ring.size()]
+  std::vector<DriverFrame<real> > ring;
+/// Number of frames that have been read
+  unsigned long nread=0;
+/// Number of frames that have been released by the driver
+  unsigned long nreleased=0;
+/// Set to stop the thread
+  bool stop=false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread thread;
+/// Loop executed by the thread
+  void loop();
+public:
+/// Start reading with n buffers
+  DriverPrefetcher(DriverReader<real> & reader,unsigned n);
+/// Stop reading and wait for the thread
+  ~DriverPrefetcher();
+/// Wait for the next frame
+  DriverFrame<real> & get();
+/// Give back the frame obtained with get()
+  void release();
+};
+
+template<typename real>
+DriverPrefetcher<real>::DriverPrefetcher(DriverReader<real> & reader,unsigned n):
+  reader(reader),
+  ring(n)
+{
+  plumed_assert(n>0);
+  thread=std::thread(&DriverPrefetcher<real>::loop,this);
+}
+
+template<typename real>
+DriverPrefetcher<real>::~DriverPrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop=true;
+  }
+  cv.notify_all();
+  thread.join();
+}
+
+template<typename real>
+void DriverPrefetcher<real>::loop() {
+  const unsigned n=ring.size();
+// frames are read in batches, so that the driver can work on half of the buffers while the other half is filled
+  const unsigned batch=(n>1 ? n/2 : 1);
+  while(true) {
+    unsigned long first;
+    unsigned nfree;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock,[&] {return stop || nread<nreleased+n;});
+      if(stop) return;
+      first=nread;
+      nfree=nreleased+n-nread;
+    }
+    if(nfree>batch) nfree=batch;
+// input/output is done by this thread
+    unsigned m=0;
+    bool end=false;
+    while(m<nfree && !end) {
+      DriverFrame<real> & f(ring[(first+m)%n]);
+      f.eof=false;
+      f.error=nullptr;
+      try {
+        if(!reader.read(f)) f.eof=true;
+      } catch(...) {
+        f.error=std::current_exception();
+      }
+      if(f.eof || f.error) end=true;
+      m++;
+    }
+// the frames of the batch are converted to numbers in parallel
+    unsigned nt=OpenMP::getNumThreads();
+    if(nt>m) nt=m;
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned i=0; i<m; i++) {
+      DriverFrame<real> & f(ring[(first+i)%n]);
+      if(f.eof || f.error) continue;
+      try {
+        reader.parse(f);
+      } catch(...) {
+        f.error=std::current_exception();
+      }
+    }
+    for(unsigned i=0; i<m; i++) if(ring[(first+i)%n].error) end=true;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      nread=first+m;
+    }
+    cv.notify_all();
+    if(end) return;
+  }
+}
+
+template<typename real>
+DriverFrame<real> & DriverPrefetcher<real>::get() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock,[&] {return nread>nreleased;});
+  return ring[nreleased%ring.size()];
+}
+
+template<typename real>
+void DriverPrefetcher<real>::release() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    nreleased++;
+  }
+  cv.notify_all();
+}
+#endif
+
+/// Return the first action of p that keeps a state between frames, or NULL if there is none
+static const Action* findStatefulAction(const PlumedMain& p) {
+  for(const auto & a : p.getActionSet()) if(a->isStateful()) return a.get();
+  return NULL;
+}
+
+/// Append to file path the parts written by the other processes with --frame-parallel,
+/// in frame order, and remove them. The parts are copied byte by byte, so that binary files
+/// (e.g. xtc and trr files written by DUMPATOMS) are merged correctly. Header lines (starting with #!)
+/// at the beginning of the parts are skipped, so that they are only kept from path.
+/// Compressed files are merged line by line, after they are decompressed
+static void appendFrameParallelParts(const std::string & path,const std::vector<std::string> & parts) {
+  if(Tools::extension(path)=="gz") {
+    OFile of;
+    of.enforceRestart();
+    of.open(path);
+    for(const auto & part : parts) {
+      IFile ifile;
+      if(!ifile.FileExist(part)) continue;
+      ifile.open(part);
+      std::string line;
+      bool header=true;
+      while(ifile.getline(line)) {
+        if(header && line.compare(0,2,"#!")==0) continue;
+        header=false;
+        of.printf("%s\n",line.c_str());
+      }
+      ifile.close();
+      std::remove(part.c_str());
+    }
+    return;
+  }
+  FILE* out=std::fopen(path.c_str(),"ab");
+  if(!out) plumed_merror("cannot open file " + path);
+  std::vector<char> buffer(1<<20);
+  for(const auto & part : parts) {
+    FILE* in=std::fopen(part.c_str(),"rb");
+    if(!in) continue;
+// skip the header lines
+    long int start=0;
+    std::string line;
+    int c;
+    while(true) {
+      line.clear();
+      while((c=std::fgetc(in))!=EOF && c!='\n' && line.length()<2) line.push_back(char(c));
+      if(line!="#!") break;
+      while(c!=EOF && c!='\n') c=std::fgetc(in);
+      if(c==EOF) break;
+      start=std::ftell(in);
+    }
+    std::fseek(in,start,SEEK_SET);
+    std::size_t n;
+    bool ok=true;
+    while((n=std::fread(buffer.data(),1,buffer.size(),in))>0) if(std::fwrite(buffer.data(),1,n,out)!=n) ok=false;
+    std::fclose(in);
+    if(!ok) plumed_merror("cannot write file " + path);
+    std::remove(part.c_str());
+  }
+  if(std::fclose(out)!=0) plumed_merror("cannot write file " + path);
+}
+
 template<typename real>
 class Driver : public CLTool {
 public:
@@ -214,21 +997,31 @@ void Driver<real>::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","--plumed","plumed.dat","specify the name of the plumed input file");
   keys.add("compulsory","--timestep","1.0","the timestep that was used in the calculation that produced this trajectory in picoseconds");
   keys.add("compulsory","--trajectory-stride","1","the frequency with which frames were output to this trajectory during the simulation"
-#ifdef __PLUMED_HAS_XDRFILE
            " (0 means that the number of the step is read from the trajectory file,"
-           " currently working only for xtc/trr files read with --ixtc/--trr)"
-#endif
-          );
+           " currently working only for xtc/trr files read with --ixtc/--trr)");
   keys.add("compulsory","--multi","0","set number of replicas for multi environment (needs MPI)");
+  keys.add("optional","--bias-matrix","with --multi, file where the bias of each replica evaluated on the frame of every replica is written at each frame");
+  keys.add("optional","--bias-matrix-fmt","( default=%%f ) the format to use to write the bias matrix");
+  keys.addFlag("--frame-parallel",false,"analyze a separate block of frames on each MPI process and merge the output files in frame order. "
+               "Only possible if the actions do not keep a state between frames");
   keys.addFlag("--noatoms",false,"don't read in a trajectory.  Just use colvar files as specified in plumed.dat");
   keys.addFlag("--parse-only",false,"read the plumed input file and stop");
+#ifdef __PLUMED_HAS_THREADS
+  keys.add("compulsory","--prefetch","0","number of frames that are read in advance by a separate thread while plumed analyzes the previous ones. "
+           "Frames in text formats are also converted to numbers in parallel. 0 means that each frame is read when it is needed");
+#endif
+  keys.add("optional","--frame-range","comma-separated numbers of the first and last frame of the trajectory that are analyzed, counting from zero. "
+           "If only the first one is given, frames are analyzed until the end of the trajectory");
+  keys.add("compulsory","--frame-stride","1","analyze one frame every this number of frames of the trajectory. The other frames are skipped without being converted");
+  keys.add("optional","--frame-index","file storing the position of each frame in the trajectory. It is written if it does not exist or if it refers to "
+           "a different trajectory, and it is used to go directly to the frames that are analyzed");
+  keys.add("optional","--read-checkpoint","binary checkpoint written with --write-checkpoint from which the state of the actions is restored before the first frame");
+  keys.add("optional","--write-checkpoint","file where a binary checkpoint of the state of the actions is written after the last frame");
   keys.add("atoms","--ixyz","the trajectory in xyz format");
   keys.add("atoms","--igro","the trajectory in gro format");
   keys.add("atoms","--idlp4","the trajectory in DL_POLY_4 format");
-#ifdef __PLUMED_HAS_XDRFILE
-  keys.add("atoms","--ixtc","the trajectory in xtc format (xdrfile implementation)");
-  keys.add("atoms","--itrr","the trajectory in trr format (xdrfile implementation)");
-#endif
+  keys.add("atoms","--ixtc","the trajectory in xtc format (PLUMED implementation)");
+  keys.add("atoms","--itrr","the trajectory in trr format (PLUMED implementation)");
   keys.add("optional","--length-units","units for length, either as a string or a number");
   keys.add("optional","--mass-units","units for mass in pdb and mc file, either as a string or a number");
   keys.add("optional","--charge-units","units for charge in pdb and mc file, either as a string or a number");
@@ -329,6 +1122,13 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 // set up for multi replica driver:
   int multi=0;
   parse("--multi",multi);
+// set up for frame parallel driver:
+  bool frame_parallel; parseFlag("--frame-parallel",frame_parallel);
+  if(frame_parallel) {
+    if(multi) error("--frame-parallel cannot be used together with --multi");
+    if(noatoms) error("--frame-parallel needs a trajectory");
+    if(debug_pd || debug_dd) error("--frame-parallel cannot be used together with domain/particle decomposition");
+  }
   Communicator intracomm;
   Communicator intercomm;
   if(multi) {
@@ -337,6 +1137,9 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     if(multi*nintra!=ntot) error("invalid number of processes for multi environment");
     pc.Split(pc.Get_rank()/nintra,pc.Get_rank(),intracomm);
     pc.Split(pc.Get_rank()%nintra,pc.Get_rank(),intercomm);
+  } else if(frame_parallel && Communicator::initialized()) {
+// each process has its own copy of plumed
+    pc.Split(pc.Get_rank(),0,intracomm);
   } else {
     intracomm.Set_comm(pc.Get_comm());
   }
@@ -358,6 +1161,23 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     }
   }
 
+// set up for the bias of all the replicas on all the frames:
+  string biasMatrix, biasMatrixFmt("%f");
+  FILE*fp_bias_matrix=NULL;
+  parse("--bias-matrix",biasMatrix);
+  if(biasMatrix.length()>0) {
+    if(noatoms) error("--bias-matrix needs a trajectory");
+    if(multi<2) error("--bias-matrix needs --multi with at least two replicas");
+    parse("--bias-matrix-fmt",biasMatrixFmt);
+    if(intercomm.Get_rank()==0 && intracomm.Get_rank()==0) {
+      fp_bias_matrix=fopen(biasMatrix.c_str(),"w");
+      if(!fp_bias_matrix) error("cannot open file " + biasMatrix);
+      fprintf(fp_bias_matrix,"#! FIELDS time");
+      for(int i=0; i<multi; i++) for(int j=0; j<multi; j++) fprintf(fp_bias_matrix," bias.%d.%d",i,j);
+      fprintf(fp_bias_matrix,"\n");
+    }
+  }
+
 // Read the plumed input file name
   string plumedFile; parse("--plumed",plumedFile);
 // the timestep
@@ -365,6 +1185,37 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   real timestep=real(t);
 // the stride
   unsigned stride; parse("--trajectory-stride",stride);
+// the frames that are analyzed
+  long unsigned frame_first=0;
+  long unsigned frame_count=std::numeric_limits<long unsigned>::max();
+  long unsigned frame_stride=1;
+  string frameIndexFile;
+  if(!noatoms) {
+    string frameRange; parse("--frame-range",frameRange);
+    if(frameRange.length()>0) {
+      vector<string> words=Tools::getWords(frameRange,",");
+      long unsigned frame_last=0;
+      if(words.size()<1 || words.size()>2 || !Tools::convert(words[0],frame_first)) error("cannot parse --frame-range " + frameRange);
+      if(words.size()==2) {
+        if(!Tools::convert(words[1],frame_last) || frame_last<frame_first) error("cannot parse --frame-range " + frameRange);
+        frame_count=frame_last-frame_first+1;
+      }
+    }
+    parse("--frame-stride",frame_stride);
+    if(frame_stride<1) error("--frame-stride should be at least 1");
+    if(frame_count!=std::numeric_limits<long unsigned>::max()) frame_count=(frame_count-1)/frame_stride+1;
+    parse("--frame-index",frameIndexFile);
+  }
+// binary checkpoints of the state of the actions
+  string readCheckpointFile, writeCheckpointFile;
+  parse("--read-checkpoint",readCheckpointFile);
+  parse("--write-checkpoint",writeCheckpointFile);
+  if((readCheckpointFile.length()>0 || writeCheckpointFile.length()>0) && frame_parallel) error("binary checkpoints cannot be used with --frame-parallel");
+// the number of frames read in advance
+  unsigned prefetch=0;
+#ifdef __PLUMED_HAS_THREADS
+  parse("--prefetch",prefetch);
+#endif
 // are we writing forces
   string dumpforces(""), debugforces(""), dumpforcesFmt("%f");;
   bool dumpfullvirial=false;
@@ -376,6 +1227,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   if(dumpforces!="") parseFlag("--dump-full-virial",dumpfullvirial);
   if( debugforces!="" && (debug_dd || debug_pd) ) error("cannot debug forces and domain/particle decomposition at same time");
   if( debugforces!="" && sizeof(real)!=sizeof(double) ) error("cannot debug forces in single precision mode");
+  if( debugforces!="" && frame_parallel ) error("cannot debug forces with --frame-parallel");
 
   real kt=-1.0;
   parse("--kt",kt);
@@ -405,10 +1257,8 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     std::string traj_dlp4; parse("--idlp4",traj_dlp4);
     std::string traj_xtc;
     std::string traj_trr;
-#ifdef __PLUMED_HAS_XDRFILE
     parse("--ixtc",traj_xtc);
     parse("--itrr",traj_trr);
-#endif
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
     for(unsigned i=0; i<plugins.size(); i++) {
       string molfile_key="--mf_"+string(plugins[i]->name);
@@ -433,6 +1283,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
       if(nn>1) {
         fprintf(stderr,"ERROR: cannot provide more than one trajectory file\n");
         if(grex_log)fclose(grex_log);
+        if(fp_bias_matrix) fclose(fp_bias_matrix);
         return 1;
       }
     }
@@ -459,8 +1310,10 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     if(trajectoryFile.length()==0&&!parseOnly) {
       fprintf(stderr,"ERROR: missing trajectory data\n");
       if(grex_log)fclose(grex_log);
+      if(fp_bias_matrix) fclose(fp_bias_matrix);
       return 1;
     }
+    if(trajectoryFile=="-" && frame_parallel) error("--frame-parallel cannot read the trajectory from standard input");
     string lengthUnits(""); parse("--length-units",lengthUnits);
     if(lengthUnits.length()>0) units.setLength(lengthUnits);
     string chargeUnits(""); parse("--charge-units",chargeUnits);
@@ -502,7 +1355,9 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
     if( !Communicator::initialized() ) error("needs mpi for debug-pd");
   }
 
-  PlumedMain p;
+// plumed is destroyed explicitly at the end, so that its output files are closed before they are merged
+  auto pmain=Tools::make_unique<PlumedMain>();
+  PlumedMain& p(*pmain);
   int rr=sizeof(real);
   p.cmd("setRealPrecision",&rr);
   int checknatoms=-1;
@@ -523,7 +1378,17 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   p.cmd("setMDEngine","driver");
   p.cmd("setTimestep",&timestep);
   p.cmd("setPlumedDat",plumedFile.c_str());
-  p.cmd("setLog",out);
+// with --frame-parallel, the files of the other processes have a suffix and are merged at the end,
+// whereas their log is discarded
+  FILE* frame_parallel_log=NULL;
+  if(frame_parallel && pc.Get_rank()>0) {
+    string n; Tools::convert(pc.Get_rank(),n);
+    p.setSuffix("."+n);
+    frame_parallel_log=fopen("/dev/null","w");
+    p.cmd("setLog",frame_parallel_log);
+  } else {
+    p.cmd("setLog",out);
+  }
 
   int natoms;
   int lvl=0;
@@ -536,9 +1401,8 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
 
   FILE* fp=NULL; FILE* fp_forces=NULL; OFile fp_dforces;
-#ifdef __PLUMED_HAS_XDRFILE
-  XDRFILE* xd=NULL;
-#endif
+  XdrFile xd;
+  std::unique_ptr<DriverLineScanner> lines;
   if(!noatoms&&!parseOnly) {
     if (trajectoryFile=="-")
       fp=in;
@@ -561,27 +1425,24 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
         ts_in.coords = ts_in_coords.get();
 #endif
       } else if(trajectory_fmt=="xdr-xtc" || trajectory_fmt=="xdr-trr") {
-#ifdef __PLUMED_HAS_XDRFILE
-        xd=xdrfile_open(trajectoryFile.c_str(),"r");
-        if(!xd) {
+        if(!IFile().FileExist(trajectoryFile)) {
           string msg="ERROR: Error opening trajectory file "+trajectoryFile;
           fprintf(stderr,"%s\n",msg.c_str());
           return 1;
         }
-        if(trajectory_fmt=="xdr-xtc") read_xtc_natoms(&trajectoryFile[0],&natoms);
-        if(trajectory_fmt=="xdr-trr") read_trr_natoms(&trajectoryFile[0],&natoms);
-#endif
+        xd.open(trajectoryFile,"r",trajectory_fmt=="xdr-xtc" ? XdrFile::xtc : XdrFile::trr);
       } else {
-        fp=fopen(trajectoryFile.c_str(),"r");
-        if(!fp) {
+        if(!IFile().FileExist(trajectoryFile)) {
           string msg="ERROR: Error opening trajectory file "+trajectoryFile;
           fprintf(stderr,"%s\n",msg.c_str());
           return 1;
         }
+// frames that are not read in order are found in the mapped region
+        lines=Tools::make_unique<DriverLineScanner>(trajectoryFile,frame_first==0 && frame_stride==1 && !frame_parallel);
       }
     }
     if(dumpforces.length()>0) {
-      if(Communicator::initialized() && pc.Get_size()>1) {
+      if(Communicator::initialized() && pc.Get_size()>1 && !(frame_parallel && pc.Get_rank()==0)) {
         string n;
         Tools::convert(pc.Get_rank(),n);
         dumpforces+="."+n;
@@ -622,44 +1483,123 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   Random rnd;
 
   if(trajectory_fmt=="dlp4") {
-    if(!Tools::getline(fp,line)) error("error reading title");
-    if(!Tools::getline(fp,line)) error("error reading atoms");
+    if(!(lines ? lines->next(&line) : Tools::getline(fp,line))) error("error reading title");
+    if(!(lines ? lines->next(&line) : Tools::getline(fp,line))) error("error reading atoms");
     sscanf(line.c_str(),"%d %d %d",&lvl,&pb,&natoms);
 
   }
-  bool lstep=true;
-  while(true) {
-    if(!noatoms&&!parseOnly) {
-      if(use_molfile==true) {
+
+// object reading the frames
+  DriverReader<real> reader;
+  reader.fmt=trajectory_fmt;
+  reader.use_molfile=use_molfile;
+  reader.lines=lines.get();
+  reader.fp=fp;
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
-        int rc;
-        rc = api->read_next_timestep(h_in, natoms, &ts_in);
-        if(rc==MOLFILE_EOF) {
-          break;
+  reader.api=api;
+  reader.h_in=h_in;
+  reader.ts_in=&ts_in;
+#endif
+  reader.xd=&xd;
+  if(!noatoms&&!parseOnly&&(use_molfile || trajectory_fmt=="dlp4")) reader.natoms=natoms;
+  reader.lvl=lvl;
+  reader.stride=stride;
+  reader.pbc_cli_given=pbc_cli_given;
+  reader.pbc_cli_box=pbc_cli_box;
+// frame that is used when frames are not read in advance
+  DriverFrame<real> localFrame;
+// the index of the frames is used if it is stored in a file and with --frame-parallel.
+// Trajectories read with molfile or from standard input are not indexed
+  const bool indexable=!noatoms && !parseOnly && !use_molfile && trajectoryFile!="-";
+  if(indexable && (frameIndexFile.length()>0 || frame_parallel)) {
+// with --frame-parallel, the first process builds the index and sends it to the others
+    if(!frame_parallel || pc.Get_rank()==0) {
+      if(multi && frameIndexFile.length()>0) {
+        string n; Tools::convert(intercomm.Get_rank(),n);
+        frameIndexFile=FileBase::appendSuffix(frameIndexFile,"."+n);
+      }
+      const long unsigned trajsize=fileSize(trajectoryFile);
+      const long unsigned checksum=fileChecksum(trajectoryFile,trajsize);
+      if(frameIndexFile.length()>0 && reader.readIndex(frameIndexFile,trajsize,checksum)) {
+        fprintf(out,"DRIVER: read the index of %lu frames from %s\n",reader.index.size(),frameIndexFile.c_str());
+      } else {
+        reader.buildIndex(trajectoryFile);
+        if(frameIndexFile.length()>0 && intracomm.Get_rank()==0) {
+          reader.writeIndex(frameIndexFile,trajsize,checksum);
+          fprintf(out,"DRIVER: wrote the index of %lu frames to %s\n",reader.index.size(),frameIndexFile.c_str());
         }
+      }
+    }
+    if(frame_parallel) {
+      long unsigned n=reader.index.size();
+      pc.Bcast(n,0);
+      reader.index.resize(n);
+      if(n>0) pc.Bcast(reader.index,0);
+    }
+  }
+  reader.first=frame_first;
+  reader.every=frame_stride;
+  reader.count=frame_count;
+  if(frame_parallel && !parseOnly) {
+    long unsigned nframes=reader.index.size();
+    if(!indexable) {
+// the first process counts the frames and then goes back to the beginning of the trajectory
+      if(pc.Get_rank()==0) {
+        while(reader.skip(localFrame)) nframes++;
+#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
+        api->close_file_read(h_in);
+        h_in=api->open_file_read(trajectoryFile.c_str(),trajectory_fmt.c_str(),&natoms);
+        reader.h_in=h_in;
 #endif
-      } else if(trajectory_fmt=="xyz" || trajectory_fmt=="gro" || trajectory_fmt=="dlp4") {
-        if(!Tools::getline(fp,line)) break;
+        reader.restart();
       }
+      pc.Bcast(nframes,0);
     }
-    bool first_step=false;
+// number of frames that are analyzed
+    long unsigned nselected=0;
+    if(nframes>frame_first) nselected=std::min((nframes-1-frame_first)/frame_stride+1,frame_count);
+// blocks are rounded up so that the first process always has some frames
+    long unsigned np=pc.Get_size();
+    long unsigned rank=pc.Get_rank();
+    long unsigned begin=(nselected*rank+np-1)/np;
+    long unsigned end=(nselected*(rank+1)+np-1)/np;
+    reader.first=frame_first+begin*frame_stride;
+    reader.count=end-begin;
+  }
+// pointer to the present frame
+  DriverFrame<real>* frame=NULL;
+#ifdef __PLUMED_HAS_THREADS
+  std::unique_ptr<DriverPrefetcher<real> > prefetcher;
+  if(prefetch>0 && !noatoms && !parseOnly) prefetcher=Tools::make_unique<DriverPrefetcher<real> >(reader,prefetch);
+#endif
+
+  const long int initial_step=step;
+  bool lstep=true;
+  while(true) {
     if(!noatoms&&!parseOnly) {
-      if(use_molfile==false && (trajectory_fmt=="xyz" || trajectory_fmt=="gro")) {
-        if(trajectory_fmt=="gro") if(!Tools::getline(fp,line)) error("premature end of trajectory file");
-        sscanf(line.c_str(),"%100d",&natoms);
+#ifdef __PLUMED_HAS_THREADS
+      if(prefetcher) frame=&prefetcher->get();
+      else
+#endif
+      {
+        frame=&localFrame;
+        frame->eof=!reader.read(*frame);
+        if(!frame->eof) reader.parse(*frame);
       }
-      if(use_molfile==false && trajectory_fmt=="dlp4") {
-        char xa[9];
-        int xb,xc,xd;
-        double t;
-        sscanf(line.c_str(),"%8s %ld %d %d %d %lf",xa,&step,&xb,&xc,&xd,&t);
-        timestep = real(t);
+      if(frame->error) std::rethrow_exception(frame->error);
+      if(frame->eof) break;
+      natoms=frame->natoms;
+      step=initial_step+long(frame->index)*stride;
+      if(frame->hasStep) step=frame->step;
+      if(frame->hasTimestep) {
+        timestep=frame->timestep;
         if (lstep) {
           p.cmd("setTimestep",&timestep);
           lstep = false;
         }
       }
     }
+    bool first_step=false;
     if(checknatoms<0 && !noatoms) {
       pd_nlocal=natoms;
       pd_start=0;
@@ -694,8 +1634,35 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
       }
       checknatoms=natoms;
       p.cmd("setNatoms",&natoms);
+// the checkpoint is read by the first process of each replica and passed to plumed before init
+      if(readCheckpointFile.length()>0) {
+        std::vector<char> checkpoint;
+        if(intracomm.Get_rank()==0) {
+          if(multi) {
+            string n; Tools::convert(intercomm.Get_rank(),n);
+            readCheckpointFile=FileBase::appendSuffix(readCheckpointFile,"."+n);
+          }
+          checkpoint.resize(fileSize(readCheckpointFile));
+          FILE* fp_checkpoint=std::fopen(readCheckpointFile.c_str(),"rb");
+          bool ok=fp_checkpoint && std::fread(checkpoint.data(),1,checkpoint.size(),fp_checkpoint)==checkpoint.size();
+          if(fp_checkpoint) std::fclose(fp_checkpoint);
+          if(!ok || checkpoint.size()<8) error("cannot read checkpoint " + readCheckpointFile);
+// the checkpoint starts with the size of the rest of the file
+          std::uint64_t n;
+          std::memcpy(&n,checkpoint.data(),sizeof(n));
+          if(n!=checkpoint.size()-sizeof(n)) error("checkpoint " + readCheckpointFile + " is truncated or corrupted");
+          fprintf(out,"DRIVER: read a checkpoint of %lu bytes from %s\n",(long unsigned)checkpoint.size(),readCheckpointFile.c_str());
+          long int size=checkpoint.size();
+          p.cmd("setCheckpointSize",&size);
+        }
+        p.cmd("setCheckpoint",checkpoint.size()>0?checkpoint.data():NULL);
+      }
       p.cmd("init");
       if(parseOnly) break;
+      if(frame_parallel) {
+        const Action* a=findStatefulAction(p);
+        if(a) error("action " + a->getLabel() + " (" + a->getName() + ") keeps a state between frames, or does not declare that it does not, and cannot be used with --frame-parallel");
+      }
     }
     if(checknatoms!=natoms) {
       std::string stepstr; Tools::convert(step,stepstr);
@@ -762,162 +1729,23 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
     int plumedStopCondition=0;
     if(!noatoms) {
-      if(use_molfile) {
-#ifdef __PLUMED_HAS_MOLFILE_PLUGINS
-        if(pbc_cli_given==false) {
-          if(ts_in.A>0.0) { // this is negative if molfile does not provide box
-            // info on the cell: convert using pbcset.tcl from pbctools in vmd distribution
-            real cosBC=cos(real(ts_in.alpha)*pi/180.);
-            //double sinBC=sin(ts_in.alpha*pi/180.);
-            real cosAC=cos(real(ts_in.beta)*pi/180.);
-            real cosAB=cos(real(ts_in.gamma)*pi/180.);
-            real sinAB=sin(real(ts_in.gamma)*pi/180.);
-            real Ax=real(ts_in.A);
-            real Bx=real(ts_in.B)*cosAB;
-            real By=real(ts_in.B)*sinAB;
-            real Cx=real(ts_in.C)*cosAC;
-            real Cy=(real(ts_in.C)*real(ts_in.B)*cosBC-Cx*Bx)/By;
-            real Cz=sqrt(real(ts_in.C)*real(ts_in.C)-Cx*Cx-Cy*Cy);
-            cell[0]=Ax/10.; cell[1]=0.; cell[2]=0.;
-            cell[3]=Bx/10.; cell[4]=By/10.; cell[5]=0.;
-            cell[6]=Cx/10.; cell[7]=Cy/10.; cell[8]=Cz/10.;
-          } else {
-            cell[0]=0.0; cell[1]=0.0; cell[2]=0.0;
-            cell[3]=0.0; cell[4]=0.0; cell[5]=0.0;
-            cell[6]=0.0; cell[7]=0.0; cell[8]=0.0;
-          }
-        } else {
-          for(unsigned i=0; i<9; i++)cell[i]=pbc_cli_box[i];
-        }
-        // info on coords
-        // the order is xyzxyz...
-        for(int i=0; i<3*natoms; i++) {
-          coordinates[i]=real(ts_in.coords[i])/real(10.); //convert to nm
-          //cerr<<"COOR "<<coordinates[i]<<endl;
-        }
-#endif
-      } else if(trajectory_fmt=="xdr-xtc" || trajectory_fmt=="xdr-trr") {
-#ifdef __PLUMED_HAS_XDRFILE
-        int localstep;
-        float time;
-        matrix box;
-        auto pos=Tools::make_unique<rvec[]>(natoms);
-        float prec,lambda;
-        int ret=exdrOK;
-        if(trajectory_fmt=="xdr-xtc") ret=read_xtc(xd,natoms,&localstep,&time,box,pos.get(),&prec);
-        if(trajectory_fmt=="xdr-trr") ret=read_trr(xd,natoms,&localstep,&time,&lambda,box,pos.get(),NULL,NULL);
-        if(stride==0) step=localstep;
-        if(ret==exdrENDOFFILE) break;
-        if(ret!=exdrOK) break;
-        for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) cell[3*i+j]=box[i][j];
-        for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++)
-            coordinates[3*i+j]=real(pos[i][j]);
-#endif
+      for(unsigned i=0; i<9; i++) cell[i]=frame->cell[i];
+// with text formats only the atoms of this process are set, to test particle decomposition
+      if(debug_pd && reader.isText()) {
+        for(int i=3*pd_start; i<3*(pd_start+pd_nlocal); i++) coordinates[i]=frame->coordinates[i];
       } else {
-        if(trajectory_fmt=="xyz") {
-          if(!Tools::getline(fp,line)) error("premature end of trajectory file");
-
-          std::vector<double> celld(9,0.0);
-          if(pbc_cli_given==false) {
-            std::vector<std::string> words;
-            words=Tools::getWords(line);
-            if(words.size()==3) {
-              sscanf(line.c_str(),"%100lf %100lf %100lf",&celld[0],&celld[4],&celld[8]);
-            } else if(words.size()==9) {
-              sscanf(line.c_str(),"%100lf %100lf %100lf %100lf %100lf %100lf %100lf %100lf %100lf",
-                     &celld[0], &celld[1], &celld[2],
-                     &celld[3], &celld[4], &celld[5],
-                     &celld[6], &celld[7], &celld[8]);
-            } else error("needed box in second line of xyz file");
-          } else {			// from command line
-            celld=pbc_cli_box;
-          }
-          for(unsigned i=0; i<9; i++)cell[i]=real(celld[i]);
-        }
-        if(trajectory_fmt=="dlp4") {
-          std::vector<double> celld(9,0.0);
-          if(pbc_cli_given==false) {
-            if(!Tools::getline(fp,line)) error("error reading vector a of cell");
-            sscanf(line.c_str(),"%lf %lf %lf",&celld[0],&celld[1],&celld[2]);
-            if(!Tools::getline(fp,line)) error("error reading vector b of cell");
-            sscanf(line.c_str(),"%lf %lf %lf",&celld[3],&celld[4],&celld[5]);
-            if(!Tools::getline(fp,line)) error("error reading vector c of cell");
-            sscanf(line.c_str(),"%lf %lf %lf",&celld[6],&celld[7],&celld[8]);
-          } else {
-            celld=pbc_cli_box;
-          }
-          for(auto i=0; i<9; i++)cell[i]=real(celld[i])*0.1;
-        }
-        int ddist=0;
-        // Read coordinates
+        for(int i=0; i<3*natoms; i++) coordinates[i]=frame->coordinates[i];
+      }
+      if(frame->masses.size()>0) {
         for(int i=0; i<natoms; i++) {
-          bool ok=Tools::getline(fp,line);
-          if(!ok) error("premature end of trajectory file");
-          double cc[3];
-          if(trajectory_fmt=="xyz") {
-            char dummy[1000];
-            int ret=std::sscanf(line.c_str(),"%999s %100lf %100lf %100lf",dummy,&cc[0],&cc[1],&cc[2]);
-            if(ret!=4) error("cannot read line"+line);
-          } else if(trajectory_fmt=="gro") {
-            // do the gromacs way
-            if(!i) {
-              //
-              // calculate the distance between dots (as in gromacs gmxlib/confio.c, routine get_w_conf )
-              //
-              const char      *p1, *p2, *p3;
-              p1 = strchr(line.c_str(), '.');
-              if (p1 == NULL) error("seems there are no coordinates in the gro file");
-              p2 = strchr(&p1[1], '.');
-              if (p2 == NULL) error("seems there is only one coordinates in the gro file");
-              ddist = p2 - p1;
-              p3 = strchr(&p2[1], '.');
-              if (p3 == NULL)error("seems there are only two coordinates in the gro file");
-              if (p3 - p2 != ddist)error("not uniform spacing in fields in the gro file");
-            }
-            Tools::convert(line.substr(20,ddist),cc[0]);
-            Tools::convert(line.substr(20+ddist,ddist),cc[1]);
-            Tools::convert(line.substr(20+ddist+ddist,ddist),cc[2]);
-          } else if(trajectory_fmt=="dlp4") {
-            char dummy[9];
-            int idummy;
-            double m,c;
-            sscanf(line.c_str(),"%8s %d %lf %lf",dummy,&idummy,&m,&c);
-            masses[i]=real(m);
-            charges[i]=real(c);
-            if(!Tools::getline(fp,line)) error("error reading coordinates");
-            sscanf(line.c_str(),"%lf %lf %lf",&cc[0],&cc[1],&cc[2]);
-            cc[0]*=0.1;
-            cc[1]*=0.1;
-            cc[2]*=0.1;
-            if(lvl>0) {
-              if(!Tools::getline(fp,line)) error("error skipping velocities");
-            }
-            if(lvl>1) {
-              if(!Tools::getline(fp,line)) error("error skipping forces");
-            }
-          } else plumed_error();
-          if(!debug_pd || ( i>=pd_start && i<pd_start+pd_nlocal) ) {
-            coordinates[3*i]=real(cc[0]);
-            coordinates[3*i+1]=real(cc[1]);
-            coordinates[3*i+2]=real(cc[2]);
-          }
-        }
-        if(trajectory_fmt=="gro") {
-          if(!Tools::getline(fp,line)) error("premature end of trajectory file");
-          std::vector<string> words=Tools::getWords(line);
-          if(words.size()<3) error("cannot understand box format");
-          Tools::convert(words[0],cell[0]);
-          Tools::convert(words[1],cell[4]);
-          Tools::convert(words[2],cell[8]);
-          if(words.size()>3) Tools::convert(words[3],cell[1]);
-          if(words.size()>4) Tools::convert(words[4],cell[2]);
-          if(words.size()>5) Tools::convert(words[5],cell[3]);
-          if(words.size()>6) Tools::convert(words[6],cell[5]);
-          if(words.size()>7) Tools::convert(words[7],cell[6]);
-          if(words.size()>8) Tools::convert(words[8],cell[7]);
+          masses[i]=frame->masses[i];
+          charges[i]=frame->charges[i];
         }
-
       }
+#ifdef __PLUMED_HAS_THREADS
+// the buffer can now be reused
+      if(prefetcher) prefetcher->release();
+#endif
 
       p.cmd("setStepLong",&step);
       p.cmd("setStopFlag",&plumedStopCondition);
@@ -969,8 +1797,9 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
       dd_forces.assign(3*natoms,0.0);
       intracomm.Sum(forces);
     }
-    if(debug_grex &&step%grex_stride==0) {
-      p.cmd("GREX savePositions");
+    const bool grex_step=debug_grex && step%grex_stride==0;
+    if(grex_step || biasMatrix.length()>0) p.cmd("GREX savePositions");
+    if(grex_step) {
       if(intracomm.Get_rank()>0) {
         p.cmd("GREX prepare");
       } else {
@@ -990,6 +1819,19 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
         if(grex_log) fprintf(grex_log,"\n");
       }
     }
+    if(biasMatrix.length()>0) {
+      p.cmd("GREX calculateBiasMatrix");
+      if(fp_bias_matrix) {
+        vector<real> b(multi*multi);
+        p.cmd("GREX getBiasMatrix",&b[0]);
+        fprintf(fp_bias_matrix,biasMatrixFmt.c_str(),step*timestep);
+        for(const auto & x : b) {
+          fprintf(fp_bias_matrix," ");
+          fprintf(fp_bias_matrix,biasMatrixFmt.c_str(),x);
+        }
+        fprintf(fp_bias_matrix,"\n");
+      }
+    }
 
 
     if(fp_forces) {
@@ -1033,18 +1875,65 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
     step+=stride;
   }
-  if(!parseOnly) p.cmd("runFinalJobs");
+#ifdef __PLUMED_HAS_THREADS
+// the reading thread should be stopped before the trajectory file is closed
+  prefetcher.reset();
+#endif
+// with --frame-parallel, a process with no frames has not initialized plumed
+  if(!parseOnly && !(frame_parallel && checknatoms<0)) p.cmd("runFinalJobs");
+
+// the checkpoint is written by the first process of each replica
+  if(writeCheckpointFile.length()>0 && !parseOnly && checknatoms>=0) {
+    long int size=0;
+    p.cmd("getCheckpointSize",&size);
+    std::vector<char> checkpoint(size);
+    p.cmd("getCheckpoint",checkpoint.data());
+    if(intracomm.Get_rank()==0) {
+      if(multi) {
+        string n; Tools::convert(intercomm.Get_rank(),n);
+        writeCheckpointFile=FileBase::appendSuffix(writeCheckpointFile,"."+n);
+      }
+      FILE* fp_checkpoint=std::fopen(writeCheckpointFile.c_str(),"wb");
+      bool ok=fp_checkpoint && std::fwrite(checkpoint.data(),1,checkpoint.size(),fp_checkpoint)==checkpoint.size();
+      if(fp_checkpoint && std::fclose(fp_checkpoint)!=0) ok=false;
+      if(!ok) error("cannot write checkpoint " + writeCheckpointFile);
+      fprintf(out,"DRIVER: wrote a checkpoint of %ld bytes to %s\n",size,writeCheckpointFile.c_str());
+    }
+  }
+
+  std::vector<std::string> frame_parallel_files;
+  if(frame_parallel) {
+    for(const auto & f : p.getFiles()) if(dynamic_cast<OFile*>(f)) frame_parallel_files.push_back(f->getPath());
+  }
+  pmain.reset();
 
   if(fp_forces) fclose(fp_forces);
   if(debugforces.length()>0) fp_dforces.close();
   if(fp && fp!=in)fclose(fp);
-#ifdef __PLUMED_HAS_XDRFILE
-  if(xd) xdrfile_close(xd);
-#endif
+  xd.close();
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
   if(h_in) api->close_file_read(h_in);
 #endif
   if(grex_log) fclose(grex_log);
+  if(fp_bias_matrix) fclose(fp_bias_matrix);
+  if(frame_parallel_log) fclose(frame_parallel_log);
+
+// the first process appends the files of the others, which all have the same names
+  if(frame_parallel && pc.Get_size()>1) {
+    if(dumpforces.length()>0) frame_parallel_files.push_back(dumpforces);
+    pc.Barrier();
+    if(pc.Get_rank()==0) {
+      for(const auto & f : frame_parallel_files) {
+        std::vector<std::string> parts;
+        for(int i=1; i<pc.Get_size(); i++) {
+          string n; Tools::convert(i,n);
+          if(f==dumpforces) parts.push_back(f+"."+n);
+          else parts.push_back(FileBase::appendSuffix(f,"."+n));
+        }
+        appendFrameParallelParts(f,parts);
+      }
+    }
+  }
 
   return 0;
 }
@@ -441,6 +441,7 @@ private:
     int         ndim;              // dimensionality of the system (1, 2, or 3)
     int         idum;              // seed
     int         plumedWantsToStop; // stop flag
+    StepDescriptor stepDescriptor{}; // data passed to plumed at every step
     bool        wrapatoms;         // if true, atomic coordinates are written wrapped in minimal cell
     string      inputfile;         // name of file with starting configuration (xyz)
     string      outputfile;        // name of file with final configuration (xyz)
@@ -535,6 +536,13 @@ private:
         plumed->cmd("setKbT",&temperature);
       }
       plumed->cmd("init");
+      plumed->cmd("setStopFlag",&plumedWantsToStop);
+// all the data of a step are passed with a single call
+      stepDescriptor.box=cell9;
+      stepDescriptor.masses=&masses[0];
+      stepDescriptor.positions=&positions[0];
+      stepDescriptor.forces=&forces[0];
+      stepDescriptor.energy=&engconf;
     }
 
 // neighbour list are computed, and reference positions are saved
@@ -586,14 +594,8 @@ private:
         plumedWantsToStop=0;
         for(int i=0; i<3; i++)for(int k=0; k<3; k++) cell9[i][k]=0.0;
         for(int i=0; i<3; i++) cell9[i][i]=cell[i];
-        plumed->cmd("setStep",&istepplusone);
-        plumed->cmd("setMasses",&masses[0]);
-        plumed->cmd("setForces",&forces[0]);
-        plumed->cmd("setEnergy",&engconf);
-        plumed->cmd("setPositions",&positions[0]);
-        plumed->cmd("setBox",cell9);
-        plumed->cmd("setStopFlag",&plumedWantsToStop);
-        plumed->cmd("calc");
+        stepDescriptor.step=istepplusone;
+        plumed->cmd("calcStep",&stepDescriptor);
         if(plumedWantsToStop) nstep=istep;
       }
 // remove forces if ndim<3
@@ -217,16 +217,20 @@ public:
       }
     }
 
+    // All the data of a step are passed to plumed with a single call
+    double fenergy=0.0; plumedWantsToStop=0;
+    plumed->cmd("setStopFlag",&plumedWantsToStop);
+    StepDescriptor stepDescriptor{};
+    if( lperiod ) stepDescriptor.box=&box[0];
+    stepDescriptor.masses=&masses[0];
+    stepDescriptor.positions=&positions[0];
+    stepDescriptor.forces=&forces[0];
+    stepDescriptor.energy=&fenergy;
+
     // Now call plumed to get initial forces
-    int istep=0; double zero=0;
-    plumed->cmd("setStep",&istep);
-    plumed->cmd("setMasses",&masses[0]);
+    stepDescriptor.step=0;
     for(unsigned i=0; i<forces.size(); ++i) forces[i].zero();
-    plumed->cmd("setForces",&forces[0]);
-    plumed->cmd("setEnergy",&zero);
-    if( lperiod ) plumed->cmd("setBox",&box[0]);
-    plumed->cmd("setPositions",&positions[0]);
-    plumed->cmd("calc");
+    plumed->cmd("calcStep",&stepDescriptor);
 
 
     double therm_eng=0;
@@ -257,17 +261,10 @@ public:
         }
       }
 
-      int istepplusone=istep+1;
       plumedWantsToStop=0;
-      plumed->cmd("setStep",&istepplusone);
-      plumed->cmd("setMasses",&masses[0]);
+      stepDescriptor.step=istep+1;
       for(unsigned i=0; i<forces.size(); ++i) forces[i].zero();
-      plumed->cmd("setForces",&forces[0]);
-      double fenergy=0.0;
-      plumed->cmd("setEnergy",&fenergy);
-      plumed->cmd("setPositions",&positions[0]);
-      plumed->cmd("setStopFlag",&plumedWantsToStop);
-      plumed->cmd("calc");
+      plumed->cmd("calcStep",&stepDescriptor);
       // if(istep%2000==0) plumed->cmd("writeCheckPointFile");
       if(plumedWantsToStop) nsteps=istep;
 
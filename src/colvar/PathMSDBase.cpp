@@ -50,6 +50,7 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
   nopbc(false),
   neigh_size(-1),
   neigh_stride(-1),
+  usemulti(false),
   epsilonClose(-1),
   debugClose(0),
   logClose(0),
@@ -106,6 +107,17 @@ PathMSDBase::PathMSDBase(const ActionOptions&ao):
     //set up rmsdRefClose, initialize it to the first structure loaded from reference file
     rmsdPosClose.set(pdbv[0], "OPTIMAL");
     firstPosClose = true;
+    // if all the frames use the same weights for alignment and displacement the
+    // distances from all of them can be computed together
+    usemulti=true;
+    std::vector<double> align0( msdv[0].getAlign() );
+    for(unsigned i=0; i<nframes; ++i) {
+      if( msdv[i].getAlign()!=align0 || msdv[i].getDisplace()!=align0 ) { usemulti=false; break; }
+    }
+    if( usemulti ) {
+      multimsd.setType("OPTIMAL"); multimsd.setAlign( align0 );
+      for(unsigned i=0; i<nframes; ++i) multimsd.addReference( msdv[i].getReference() );
+    }
   }
   if(neigh_stride>0 || neigh_size>0) {
     if(neigh_size>int(nframes)) {
@@ -234,6 +246,17 @@ void PathMSDBase::calculate() {
       }
     }
   }
+  else if( usemulti ) {
+    // store temporary local results
+    std::vector<unsigned> which;
+    for(unsigned i=rank; i<imgVec.size(); i+=stride) which.push_back( imgVec[i].index );
+    std::vector<double> mdist; multimsd.calculate( getPositions(), which, mdist, tmp_derivs, true );
+    for(unsigned i=rank, k=0; i<imgVec.size(); i+=stride, ++k) {
+      tmp_distances[i]=mdist[k];
+      #pragma omp simd
+      for(unsigned j=0; j<nat; j++) tmp_derivs2[i*nat+j]=tmp_derivs[k*nat+j];
+    }
+  }
   else {
     // store temporary local results
     for(unsigned i=rank; i<imgVec.size(); i+=stride) {
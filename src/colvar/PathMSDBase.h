@@ -27,6 +27,7 @@
 
 #include "tools/PDB.h"
 #include "tools/RMSD.h"
+#include "tools/MultiReferenceRMSD.h"
 
 namespace PLMD {
 namespace colvar {
@@ -64,6 +65,9 @@ class PathMSDBase : public Colvar {
   int neigh_size;
   int neigh_stride;
   std::vector<RMSD> msdv;
+/// computes the distances from all the frames at once when they all use the same weights
+  bool usemulti;
+  MultiReferenceRMSD multimsd;
   std::string reference;
   std::vector<Vector> derivs_s;
   std::vector<Vector> derivs_z;
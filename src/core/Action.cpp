@@ -62,6 +62,7 @@ Action::Action(const ActionOptions&ao):
   active(false),
   restart(ao.plumed.getRestart()),
   doCheckPoint(ao.plumed.getCPT()),
+  stateful(true),
   plumed(ao.plumed),
   log(plumed.getLog()),
   comm(plumed.comm),
@@ -278,5 +279,13 @@ bool Action::getCPT()const {
   return plumed.getCPT();
 }
 
+bool Action::getRestartFromCheckpoint()const {
+  return plumed.getRestartFromCheckpoint();
+}
+
+void Action::writeCheckpoint(CheckpointData&) {
+  if(stateful) error("this action keeps a state between steps, but it cannot be saved in a binary checkpoint");
+}
+
 }
 
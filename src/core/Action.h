@@ -34,6 +34,7 @@ class PDB;
 class PlumedMain;
 class Communicator;
 class ActionWithValue;
+class CheckpointData;
 
 /// This class is used to bring the relevant information to the Action constructor.
 /// Only Action and ActionRegister class can access to its content, which is
@@ -99,6 +100,9 @@ private:
 
   bool doCheckPoint;
 
+/// True if the action keeps a state between steps.  This is true unless the action declares otherwise
+  bool stateful;
+
 public:
 
 /// Reference to main plumed object
@@ -128,6 +132,10 @@ public:
 /// Return true if we are doing at a checkpoint step
   bool getCPT()const;
 
+/// Return true if the state of the action will be restored from a binary checkpoint before the first step.
+/// In this case the restart files should not be read
+  bool getRestartFromCheckpoint()const;
+
 /// Just read one of the keywords and return the whole thing as a string
   std::string getKeyword(const std::string& key);
 
@@ -225,6 +233,26 @@ public:
 /// The set of all Actions in run for the final time in forward order.
   virtual void runFinalJobs() {}
 
+/// Declare whether the action keeps a state between steps (e.g. a bias that is updated during the simulation).
+/// Actions are assumed to keep a state unless they call setStateful(false), which is done by the base classes
+/// of the actions that only use the current step (e.g. Colvar, Function and Bias).  Caches that are rebuilt
+/// from the positions, such as neighbor lists, are not a state.
+/// Stateful actions cannot be used when frames are analyzed out of order (driver --frame-parallel),
+/// and they should override writeCheckpoint() and readCheckpoint()
+  void setStateful(bool s=true) {stateful=s;}
+
+/// Return true if the action keeps a state between steps
+  bool isStateful()const {return stateful;}
+
+/// Save the state of the action in a binary checkpoint (see cmd("getCheckpointSize")).
+/// Actions that keep a state between steps should override this together with readCheckpoint().
+/// By default nothing is saved, and an error is raised if the action is stateful
+  virtual void writeCheckpoint(CheckpointData&);
+
+/// Restore the state saved with writeCheckpoint().
+/// This is called after all the actions have been created, before the first step
+  virtual void readCheckpoint(CheckpointData&) {}
+
 /// Tell to the Action to flush open files
   void fflush();
 
@@ -29,6 +29,7 @@ namespace PLMD {
 ActionAnyorder::ActionAnyorder(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
 }
 
 void ActionAnyorder::registerKeywords( Keywords& keys ) {
@@ -30,6 +30,7 @@ namespace PLMD {
 ActionSetup::ActionSetup(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
   const ActionSet& actionset(plumed.getActionSet());
   for(const auto & p : actionset) {
 // check that all the preceding actions are ActionSetup
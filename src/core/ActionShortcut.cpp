@@ -34,6 +34,7 @@ ActionShortcut::ActionShortcut(const ActionOptions&ao):
   Action(ao),
   shortcutlabel(label)
 {
+  setStateful(false);
   std::string s; Tools::convert(plumed.getActionSet().size(),s);
   if( shortcutlabel==("@" + s) ) {
     std::string t; Tools::convert(plumed.getActionSet().size()+1,t);
@@ -37,6 +37,7 @@ ActionWithVirtualAtom::ActionWithVirtualAtom(const ActionOptions&ao):
   ActionAtomistic(ao),
   boxDerivatives(3)
 {
+  setStateful(false);
   index=atoms.addVirtualAtom(this);
   log.printf("  serial associated to this virtual atom is %u\n",index.serial());
 }
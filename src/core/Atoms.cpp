@@ -180,6 +180,25 @@ void Atoms::shareAll() {
   share(unique);
 }
 
+void Atoms::shareAtoms(const std::set<AtomNumber>& atoms) {
+  unique.clear();
+  // keep in unique only those atoms that are local
+  if(dd && shuffledAtoms>0) {
+    for(const auto & p : atoms) if(g2l[p.index()]>=0) unique.insert(p);
+  } else {
+    unique=atoms;
+  }
+  atomsNeeded=true;
+  share(unique);
+}
+
+void Atoms::getNeededAtoms(std::set<AtomNumber>& needed)const {
+  needed.clear();
+  for(unsigned i=0; i<actions.size(); i++) {
+    if(actions[i]->isActive()) needed.insert(actions[i]->getUnique().begin(),actions[i]->getUnique().end());
+  }
+}
+
 void Atoms::share(const std::set<AtomNumber>& unique) {
   plumed_assert( positionsHaveBeenSet==3 && massesHaveBeenSet );
 
@@ -541,16 +560,17 @@ void Atoms::removeGroup(const std::string&name) {
   groups.erase(name);
 }
 
-void Atoms::writeBinary(std::ostream&o)const {
-  o.write(reinterpret_cast<const char*>(&positions[0][0]),natoms*3*sizeof(double));
-  o.write(reinterpret_cast<const char*>(&box(0,0)),9*sizeof(double));
-  o.write(reinterpret_cast<const char*>(&energy),sizeof(double));
+void Atoms::writeBinary(const std::vector<AtomNumber>&index,std::vector<double>&buffer)const {
+  buffer.reserve(buffer.size()+3*index.size()+10);
+  for(const auto & a : index) for(unsigned j=0; j<3; j++) buffer.push_back(positions[a.index()][j]);
+  for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) buffer.push_back(box(i,j));
+  buffer.push_back(energy);
 }
 
-void Atoms::readBinary(std::istream&i) {
-  i.read(reinterpret_cast<char*>(&positions[0][0]),natoms*3*sizeof(double));
-  i.read(reinterpret_cast<char*>(&box(0,0)),9*sizeof(double));
-  i.read(reinterpret_cast<char*>(&energy),sizeof(double));
+void Atoms::readBinary(const std::vector<AtomNumber>&index,const double*buffer) {
+  for(const auto & a : index) for(unsigned j=0; j<3; j++) positions[a.index()][j]=*buffer++;
+  for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) box(i,j)=*buffer++;
+  energy=*buffer;
   pbc.setBox(box);
 }
 
@@ -150,6 +150,10 @@ public:
 
   void share();
   void shareAll();
+/// Share the given atoms. With domain decomposition they are gathered on all the processes
+  void shareAtoms(const std::set<AtomNumber>&);
+/// Get the atoms requested by the actions that are active
+  void getNeededAtoms(std::set<AtomNumber>&)const;
   void wait();
   void updateForces();
 
@@ -225,8 +229,10 @@ public:
   bool isVirtualAtom(AtomNumber)const;
   void insertGroup(const std::string&name,const std::vector<AtomNumber>&a);
   void removeGroup(const std::string&name);
-  void writeBinary(std::ostream&)const;
-  void readBinary(std::istream&);
+/// Append the positions of the atoms in index, the box and the energy to buffer
+  void writeBinary(const std::vector<AtomNumber>&index,std::vector<double>&buffer)const;
+/// Read the positions of the atoms in index, the box and the energy from buffer, as written by writeBinary()
+  void readBinary(const std::vector<AtomNumber>&index,const double*buffer);
   double getKBoltzmann()const;
   double getMDKBoltzmann()const;
   bool usingNaturalUnits()const;
@@ -34,6 +34,7 @@ Colvar::Colvar(const ActionOptions&ao):
   isEnergy(false),
   isExtraCV(false)
 {
+  setStateful(false);
 }
 
 void Colvar::registerKeywords( Keywords& keys ) {
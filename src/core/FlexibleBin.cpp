@@ -25,6 +25,7 @@
 #include <iostream>
 #include <vector>
 #include "tools/Matrix.h"
+#include "tools/CheckpointData.h"
 
 using namespace std;
 namespace PLMD {
@@ -158,6 +159,16 @@ void FlexibleBin::update(bool nowAddAHill) {
   }
 }
 
+void FlexibleBin::writeCheckpoint(CheckpointData&cp) const {
+  cp.write(variance);
+  cp.write(average);
+}
+
+void FlexibleBin::readCheckpoint(CheckpointData&cp) {
+  cp.read(variance);
+  cp.read(average);
+}
+
 vector<double> FlexibleBin::getMatrix() const {
   return variance;
 }
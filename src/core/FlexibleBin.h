@@ -27,6 +27,7 @@
 namespace PLMD {
 
 class ActionWithArguments;
+class CheckpointData;
 
 class FlexibleBin {
 private:
@@ -54,6 +55,10 @@ public:
   std::vector<double> getMatrix() const;
   std::vector<double> getInverseMatrix() const;
   std::vector<double> getInverseMatrix(unsigned iarg) const;
+  /// save the running averages in a binary checkpoint
+  void writeCheckpoint(CheckpointData&) const;
+  /// restore the running averages saved with writeCheckpoint()
+  void readCheckpoint(CheckpointData&);
   enum AdaptiveHillsType { none, diffusion, geometry };
 };
 
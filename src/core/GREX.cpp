@@ -24,7 +24,8 @@
 #include "Atoms.h"
 #include "tools/Tools.h"
 #include "tools/Communicator.h"
-#include <sstream>
+#include <algorithm>
+#include <set>
 #include <unordered_map>
 
 using namespace std;
@@ -39,6 +40,7 @@ GREX::GREX(PlumedMain&p):
   foreignDeltaBias(0),
   localUNow(0),
   localUSwap(0),
+  localBias(0),
   myreplica(-1) // = unset
 {
   p.setSuffix(".NA");
@@ -127,6 +129,19 @@ void GREX::cmd(const string&key,void*val) {
       intracomm.Bcast(partner,0);
       calculate();
       break;
+    case cmd_calculateBiasMatrix:
+      CHECK_INIT(initialized,key);
+      calculateBiasMatrix();
+      break;
+    case cmd_getBiasMatrix:
+      CHECK_INIT(initialized,key);
+      CHECK_NOTNULL(val,key);
+      plumed_massert(biasMatrix.size()>0,"to retrieve the bias matrix with cmd(\"GREX getBiasMatrix\"), first calculate it with cmd(\"GREX calculateBiasMatrix\")");
+      for(unsigned i=0; i<biasMatrix.size(); i++) {
+        double d=biasMatrix[i]/(atoms.getMDUnits().getEnergy()/atoms.getUnits().getEnergy());
+        atoms.double2MD(d,static_cast<char*>(val)+i*atoms.getRealPrecision());
+      }
+      break;
     case cmd_getLocalDeltaBias:
       CHECK_INIT(initialized,key);
       CHECK_NOTNULL(val,key);
@@ -186,35 +201,87 @@ void GREX::cmd(const string&key,void*val) {
 }
 
 void GREX::savePositions() {
+  localBias=plumedMain.getBias();
   plumedMain.prepareDependencies();
   plumedMain.resetActive(true);
-  atoms.shareAll();
+// only the atoms used by the active actions of at least one replica are shared
+  std::set<AtomNumber> needed;
+  atoms.getNeededAtoms(needed);
+  neededAtoms.assign(needed.begin(),needed.end());
+  if(intracomm.Get_rank()==0) {
+    const int nrep=intercomm.Get_size();
+    replicaAtoms.resize(nrep);
+    if(nrep>1) {
+      vector<int> counts(nrep,0);
+      int n=neededAtoms.size();
+      intercomm.Allgather(n,counts);
+      vector<int> displs(nrep,0);
+      for(int i=1; i<nrep; i++) displs[i]=displs[i-1]+counts[i-1];
+      vector<AtomNumber> all(displs[nrep-1]+counts[nrep-1]);
+// a null send buffer would be interpreted as MPI_IN_PLACE
+      AtomNumber dummy;
+      intercomm.Allgatherv((n>0 ? neededAtoms.data() : &dummy),n,all.data(),counts.data(),displs.data());
+      for(int i=0; i<nrep; i++) replicaAtoms[i].assign(all.begin()+displs[i],all.begin()+displs[i]+counts[i]);
+      needed.insert(all.begin(),all.end());
+    } else {
+      replicaAtoms[0]=neededAtoms;
+    }
+  }
+  sharedAtoms.assign(needed.begin(),needed.end());
+  unsigned nshared=sharedAtoms.size();
+  intracomm.Bcast(nshared,0);
+  sharedAtoms.resize(nshared);
+  if(nshared>0) intracomm.Bcast(sharedAtoms,0);
+  atoms.shareAtoms(std::set<AtomNumber>(sharedAtoms.begin(),sharedAtoms.end()));
   plumedMain.waitData();
-  ostringstream o;
-  atoms.writeBinary(o);
-  buffer=o.str();
+  buffer.clear();
+  atoms.writeBinary(sharedAtoms,buffer);
+}
+
+void GREX::packPositions(int replica,std::vector<double>&buf)const {
+  const auto & atomsOfReplica(replicaAtoms[replica]);
+  buf.resize(3*atomsOfReplica.size()+10);
+  unsigned k=0;
+  for(const auto & a : atomsOfReplica) {
+    const unsigned i=std::lower_bound(sharedAtoms.begin(),sharedAtoms.end(),a)-sharedAtoms.begin();
+    plumed_dbg_assert(i<sharedAtoms.size() && sharedAtoms[i]==a);
+    for(unsigned j=0; j<3; j++) buf[k++]=buffer[3*i+j];
+  }
+  std::copy(buffer.end()-10,buffer.end(),buf.begin()+k);
+}
+
+double GREX::calculateBias(const std::vector<double>&positions) {
+  atoms.readBinary(neededAtoms,positions.data());
+  plumedMain.setExchangeStep(true);
+  plumedMain.prepareDependencies();
+  {
+    std::set<AtomNumber> needed;
+    atoms.getNeededAtoms(needed);
+    plumed_massert(std::includes(neededAtoms.begin(),neededAtoms.end(),needed.begin(),needed.end()),
+                   "the atoms requested by the actions changed after cmd(\"GREX savePositions\")");
+  }
+  plumedMain.justCalculate();
+  plumedMain.setExchangeStep(false);
+  return plumedMain.getBias();
 }
 
 void GREX::calculate() {
 //fprintf(stderr,"CALCULATE %d %d\n",intercomm.Get_rank(),partner);
-  unsigned nn=buffer.size();
-  vector<char> rbuf(nn);
+  vector<double> rbuf(3*neededAtoms.size()+10);
   localDeltaBias=-plumedMain.getBias();
+// the partner receives the positions of the atoms it needs, and then the box and the energy.
+// The message is sent without waiting, so that it is delivered while the bias is calculated
+  Communicator::Request reqPositions;
   if(intracomm.Get_rank()==0) {
-    Communicator::Request req=intercomm.Isend(buffer,partner,1066);
+    packPositions(partner,sendBuffer);
+    reqPositions=intercomm.Isend(sendBuffer,partner,1066);
     intercomm.Recv(rbuf,partner,1066);
-    req.wait();
   }
   intracomm.Bcast(rbuf,0);
-  istringstream i(string(&rbuf[0],rbuf.size()));
-  atoms.readBinary(i);
-  plumedMain.setExchangeStep(true);
-  plumedMain.prepareDependencies();
-  plumedMain.justCalculate();
-  plumedMain.setExchangeStep(false);
-  localDeltaBias+=plumedMain.getBias();
+  localDeltaBias+=calculateBias(rbuf);
   localDeltaBias+=localUSwap-localUNow;
   if(intracomm.Get_rank()==0) {
+    reqPositions.wait();
     Communicator::Request req=intercomm.Isend(localDeltaBias,partner,1067);
     intercomm.Recv(foreignDeltaBias,partner,1067);
     req.wait();
@@ -223,4 +290,38 @@ void GREX::calculate() {
   intracomm.Bcast(foreignDeltaBias,0);
 }
 
+void GREX::calculateBiasMatrix() {
+  int nrep=intercomm.Get_size();
+  intracomm.Bcast(nrep,0);
+  vector<double> bias(nrep,0.0);
+  bias[myreplica]=localBias;
+// two buffers are used, so that the positions for step k+1 are transferred while
+// those received at step k are used
+  vector<double> rbuf[2];
+  vector<double> sbuf[2];
+  Communicator::Request reqRecv[2];
+  Communicator::Request reqSend[2];
+  for(unsigned i=0; i<2; i++) rbuf[i].resize(3*neededAtoms.size()+10);
+  auto post=[&](int k) {
+    if(intracomm.Get_rank()!=0 || k>=nrep) return;
+    const int to=(myreplica+k)%nrep;
+    const int from=(myreplica-k+nrep)%nrep;
+    reqSend[k%2].wait();
+    packPositions(to,sbuf[k%2]);
+    reqRecv[k%2]=intercomm.Irecv(rbuf[k%2],from,1068);
+    reqSend[k%2]=intercomm.Isend(sbuf[k%2],to,1068);
+  };
+  post(1);
+  for(int k=1; k<nrep; k++) {
+    reqRecv[k%2].wait();
+    post(k+1);
+    intracomm.Bcast(rbuf[k%2],0);
+    bias[(myreplica-k+nrep)%nrep]=calculateBias(rbuf[k%2]);
+  }
+  for(unsigned i=0; i<2; i++) reqSend[i].wait();
+  biasMatrix.assign(nrep*nrep,0.0);
+  if(intracomm.Get_rank()==0) intercomm.Allgather(bias,biasMatrix);
+  intracomm.Bcast(biasMatrix,0);
+}
+
 }
@@ -24,6 +24,7 @@
 
 #include "WithCmd.h"
 #include "tools/ForwardDecl.h"
+#include "tools/AtomNumber.h"
 #include <string>
 #include <vector>
 
@@ -49,14 +50,35 @@ class GREX:
   double localUNow;
   double localUSwap;
   std::vector<double> allDeltaBias;
-  std::string buffer;
+/// Bias of this replica on its own positions, saved by savePositions()
+  double localBias;
+/// Bias of each replica (rows) evaluated on the positions of each replica (columns)
+  std::vector<double> biasMatrix;
+/// Atoms needed by the active actions of this replica
+  std::vector<AtomNumber> neededAtoms;
+/// Atoms needed by each replica (only on the first process of each replica)
+  std::vector<std::vector<AtomNumber> > replicaAtoms;
+/// Atoms needed by at least one replica. Their positions, the box and the energy are saved in buffer
+  std::vector<AtomNumber> sharedAtoms;
+  std::vector<double> buffer;
+/// Positions sent to the partner
+  std::vector<double> sendBuffer;
   int myreplica;
+/// Copy from buffer the positions of the atoms needed by a replica, followed by the box and the energy
+  void packPositions(int replica,std::vector<double>&buf)const;
+/// Calculate the bias of this replica using positions received from another replica
+  double calculateBias(const std::vector<double>&positions);
 public:
   explicit GREX(PlumedMain&);
   ~GREX();
   void cmd(const std::string&key,void*val=NULL) override;
   void calculate();
   void savePositions();
+/// Calculate the bias of this replica on the positions of all the replicas.
+/// The positions are circulated so that at the k-th step each replica receives
+/// those of the replica k places before it, and the message for the following step is
+/// transferred while the bias is calculated
+  void calculateBiasMatrix();
 };
 
 }
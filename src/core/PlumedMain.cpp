@@ -31,6 +31,7 @@
 #include "ExchangePatterns.h"
 #include "GREX.h"
 #include "config/Config.h"
+#include "tools/CheckpointData.h"
 #include "tools/Citations.h"
 #include "tools/Communicator.h"
 #include "tools/DLLoader.h"
@@ -40,6 +41,7 @@
 #include "tools/OpenMP.h"
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
+#include "tools/WorkerThread.h"
 #include "lepton/Exception.h"
 #include "DataFetchingObject.h"
 #include <cstdlib>
@@ -137,8 +139,11 @@ PlumedMain::PlumedMain():
   exchangeStep(false),
   restart(false),
   doCheckPoint(false),
+  restartFromCheckpoint(false),
+  checkpointSize(-1),
   stopFlag(NULL),
   stopNow(false),
+  asyncCalc(false),
   novirial(false),
   detailedTimers(false)
 {
@@ -148,6 +153,13 @@ PlumedMain::PlumedMain():
 
 // destructor needed to delete forward declarated objects
 PlumedMain::~PlumedMain() {
+// a calculation that was started and never waited for should complete before the actions are destroyed
+  if(asyncCalc) {
+    try {
+      worker.wait();
+    } catch(...) {
+    }
+  }
 }
 
 /////////////////////////////////////////////////////////////
@@ -158,31 +170,51 @@ PlumedMain::~PlumedMain() {
 #define CHECK_NOTNULL(val,word) plumed_massert(val,"NULL pointer received in cmd(\"" + word + "\")");
 
 
-void PlumedMain::cmd(const std::string & word,void*val) {
+namespace {
 
 // Enumerate all possible commands:
-  enum {
+enum {
 #include "PlumedMainEnum.inc"
-  };
+};
 
+// Index of a command, or -1 if the command does not exist
+int getCmdIndex(const std::string & word) {
 // Static object (initialized once) containing the map of commands:
   const static std::unordered_map<std::string, int> word_map = {
 #include "PlumedMainMap.inc"
   };
+  const auto it=word_map.find(word);
+  if(it!=word_map.end()) return it->second;
+  return -1;
+}
+
+}
+
+void PlumedMain::cmd(const std::string & word,void*val) {
+  std::vector<std::string> words=Tools::getWords(word);
+  if(words.size()>0) runCmd(getCmdIndex(words[0]),word,words,val);
+}
+
+void PlumedMain::cmdHandle(int handle,void*val) {
+  plumed_massert(handle>0 && handle<=int(cmdHandles.size()),"invalid handle passed to plumed_cmd_handle(), handles should be obtained with cmd(\"getCmdHandle\")");
+  const CmdHandle & h=cmdHandles[handle-1];
+  runCmd(h.iword,h.word,h.words,val);
+}
+
+void PlumedMain::runCmd(int iword,const std::string & word,const std::vector<std::string> & words,void*val) {
+
+// while the calculation started with startCalc is running nothing can be touched
+  if(asyncCalc && iword!=cmd_waitCalc) plumed_merror("cannot call cmd(\"" + word + "\") between startCalc and waitCalc");
 
   try {
 
-    auto ss=stopwatch.startPause();
+// the stopwatch might be in use by the thread that runs the calculation
+    Stopwatch::Handler ss;
+    if(!asyncCalc) ss=stopwatch.startPause();
 
-    std::vector<std::string> words=Tools::getWords(word);
     unsigned nw=words.size();
-    if(nw==0) {
-      // do nothing
-    } else {
-      int iword=-1;
+    {
       double d;
-      const auto it=word_map.find(words[0]);
-      if(it!=word_map.end()) iword=it->second;
       switch(iword) {
       case cmd_setBox:
         CHECK_INIT(initialized,word);
@@ -243,6 +275,24 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         CHECK_INIT(initialized,word);
         calc();
         break;
+      /* ADDED WITH API==9 */
+      case cmd_calcStep:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        {
+          const StepDescriptor* d=static_cast<const StepDescriptor*>(val);
+          step=d->step;
+          atoms.startStep();
+          if(d->box) atoms.setBox(d->box);
+          atoms.setMasses(d->masses);
+          if(d->charges) atoms.setCharges(d->charges);
+          atoms.setPositions(d->positions);
+          atoms.setForces(d->forces);
+          if(d->virial) atoms.setVirial(d->virial);
+          if(d->energy) atoms.setEnergy(d->energy);
+          calc();
+        }
+        break;
       case cmd_prepareDependencies:
         CHECK_INIT(initialized,word);
         prepareDependencies();
@@ -267,6 +317,16 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         CHECK_INIT(initialized,word);
         update();
         break;
+      /* ADDED WITH API==9 */
+      case cmd_startCalc:
+        CHECK_INIT(initialized,word);
+        startCalc();
+        break;
+      /* ADDED WITH API==9 */
+      case cmd_waitCalc:
+        CHECK_INIT(initialized,word);
+        waitCalc();
+        break;
       case cmd_setStep:
         CHECK_INIT(initialized,word);
         CHECK_NOTNULL(val,word);
@@ -358,7 +418,30 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         break;
       case cmd_getApiVersion:
         CHECK_NOTNULL(val,word);
-        *(static_cast<int*>(val))=8;
+        *(static_cast<int*>(val))=9;
+        break;
+      /* ADDED WITH API==9 */
+      case cmd_getCmdHandle:
+        CHECK_NOTNULL(val,word);
+        plumed_assert(nw>1);
+        {
+          std::vector<std::string> kk(words.begin()+1,words.end());
+          std::string key=kk[0];
+          for(unsigned i=1; i<kk.size(); i++) key+=" "+kk[i];
+          // the same command always gets the same handle
+          int handle=0;
+          for(unsigned i=0; i<cmdHandles.size(); i++) if(cmdHandles[i].word==key) handle=i+1;
+          if(handle==0) {
+            CmdHandle h;
+            h.iword=getCmdIndex(kk[0]);
+            plumed_massert(h.iword>=0,"cannot interpret cmd(\"" + key + "\"). check plumed developers manual to see the available commands.");
+            h.word=key;
+            h.words=kk;
+            cmdHandles.push_back(h);
+            handle=cmdHandles.size();
+          }
+          *(static_cast<int*>(val))=handle;
+        }
         break;
       // commands which can be used only before initialization:
       case cmd_init:
@@ -460,6 +543,49 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         doCheckPoint = false;
         if(*static_cast<int*>(val)!=0) doCheckPoint = true;
         break;
+      /* ADDED WITH API==9 */
+      case cmd_getCheckpointSize:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        plumed_massert(!restartFromCheckpoint,"the checkpoint passed with cmd(\"setCheckpoint\") has not been restored yet, a step should be done first");
+        {
+          CheckpointData cp;
+          writeCheckpoint(cp);
+          cp.swap(checkpointBuffer);
+          *static_cast<long int*>(val)=checkpointBuffer.size();
+        }
+        break;
+      /* ADDED WITH API==9 */
+      case cmd_getCheckpoint:
+        CHECK_INIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        plumed_massert(checkpointBuffer.size()>0 && !restartFromCheckpoint,"cmd(\"getCheckpointSize\") should be used before cmd(\"getCheckpoint\")");
+        std::memcpy(val,checkpointBuffer.data(),checkpointBuffer.size());
+        break;
+      /* ADDED WITH API==9 */
+      case cmd_setCheckpointSize:
+        CHECK_NOTINIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        checkpointSize=*static_cast<long int*>(val);
+        break;
+      /* ADDED WITH API==9 */
+      case cmd_setCheckpoint:
+        CHECK_NOTINIT(initialized,word);
+        // the checkpoint is only needed on the first process, it is broadcast in init()
+        if(val) {
+          plumed_massert(checkpointSize>=0,"cmd(\"setCheckpointSize\") should be used before cmd(\"setCheckpoint\")");
+          std::uint64_t n;
+          plumed_massert(checkpointSize>=long(sizeof(n)),"the checkpoint passed with cmd(\"setCheckpoint\") is too short");
+          std::memcpy(&n,val,sizeof(n));
+          // the size stored at the beginning of the checkpoint is only trusted if it matches the size of the buffer
+          plumed_massert(n==std::uint64_t(checkpointSize)-sizeof(n),"the checkpoint passed with cmd(\"setCheckpoint\") is truncated or corrupted");
+          const char* p=static_cast<const char*>(val);
+          checkpointBuffer.assign(p,p+checkpointSize);
+          checkpointSize=-1;
+        }
+        restartFromCheckpoint=true;
+        restart=true;
+        break;
       /* ADDED WITH API==6 */
       case cmd_setNumOMPthreads:
         CHECK_NOTNULL(val,word);
@@ -608,6 +734,14 @@ void PlumedMain::init() {
   log<<"Cache line size: "<<OpenMP::getCachelineSize()<<"\n";
   log.printf("Number of atoms: %d\n",atoms.getNatoms());
   if(grex) log.printf("GROMACS-like replica exchange is on\n");
+  if(restartFromCheckpoint) {
+    long unsigned n=checkpointBuffer.size();
+    comm.Bcast(n,0);
+    checkpointBuffer.resize(n);
+    if(n>0) comm.Bcast(checkpointBuffer,0);
+    plumed_massert(n>0,"the checkpoint passed with cmd(\"setCheckpoint\") is empty on the first process");
+    log.printf("The state of the actions will be restored from a binary checkpoint of %lu bytes\n",n);
+  }
   log.printf("File suffix: %s\n",getSuffix().c_str());
   if(plumedDat.length()>0) {
     readInputFile(plumedDat);
@@ -741,6 +875,14 @@ void PlumedMain::prepareDependencies() {
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("1 Prepare dependencies");
 
+// the checkpoint is restored here so that it also reaches the actions created after init()
+  if(restartFromCheckpoint) {
+    CheckpointData cp;
+    cp.swap(checkpointBuffer);
+    readCheckpoint(cp);
+    restartFromCheckpoint=false;
+  }
+
 // activate all the actions which are on step
 // activation is recursive and enables also the dependencies
 // before doing that, the prepare() method is called to see if there is some
@@ -851,11 +993,53 @@ void PlumedMain::justApply() {
   update();
 }
 
+void PlumedMain::startCalc() {
+  plumed_massert(!asyncCalc,"startCalc called twice without waitCalc");
+  auto task=[this]() {
+    waitData();
+    justCalculate();
+    if(active) {
+// Stopwatch is stopped when sw goes out of scope
+      auto sw=stopwatch.startStop("5 Applying (backward loop)");
+      backwardLoop();
+    }
+  };
+// with more than one process the actions communicate, and the MD engine might be calling MPI at the same time
+  if(comm.Get_size()>1 || multi_sim_comm.Get_size()>1) task();
+  else worker.start(task);
+  asyncCalc=true;
+}
+
+void PlumedMain::waitCalc() {
+  plumed_massert(asyncCalc,"waitCalc called without startCalc");
+  asyncCalc=false;
+  worker.wait();
+  if(active) {
+// Stopwatch is stopped when sw goes out of scope
+    auto sw=stopwatch.startStop("5B Update forces");
+// this is updating the MD copy of the forces
+    if(atoms.getNatoms()>0) atoms.updateForces();
+  }
+  update();
+  mydatafetcher->finishDataGrab();
+}
+
 void PlumedMain::backwardPropagate() {
   if(!active)return;
-  int iaction=0;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("5 Applying (backward loop)");
+  backwardLoop();
+
+// Stopwatch is stopped when sw goes out of scope.
+// We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
+  Stopwatch::Handler sw1;
+  if(detailedTimers) sw1=stopwatch.startStop("5B Update forces");
+// this is updating the MD copy of the forces
+  if(atoms.getNatoms()>0) atoms.updateForces();
+}
+
+void PlumedMain::backwardLoop() {
+  int iaction=0;
 // apply them in reverse order
   for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
     const auto & p(pp->get());
@@ -882,13 +1066,6 @@ void PlumedMain::backwardPropagate() {
     }
     iaction++;
   }
-
-// Stopwatch is stopped when sw goes out of scope.
-// We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
-  Stopwatch::Handler sw1;
-  if(detailedTimers) sw1=stopwatch.startStop("5B Update forces");
-// this is updating the MD copy of the forces
-  if(atoms.getNatoms()>0) atoms.updateForces();
 }
 
 void PlumedMain::update() {
@@ -988,6 +1165,60 @@ void PlumedMain::fflush() {
   }
 }
 
+void PlumedMain::writeCheckpoint(CheckpointData&cp) {
+// only the actions that have a state are stored, each one in its own section
+  std::vector<Action*> saved;
+  std::vector<CheckpointData> sections;
+  for(const auto & p : actionSet) {
+    CheckpointData section;
+    p->writeCheckpoint(section);
+    if(section.size()==0 && !p->isStateful()) continue;
+    saved.push_back(p.get());
+    sections.push_back(std::move(section));
+  }
+  CheckpointData body;
+  body.write(std::string("PLUMED checkpoint 1"));
+  body.write(std::uint64_t(saved.size()));
+  for(unsigned i=0; i<saved.size(); i++) {
+    body.write(saved[i]->getLabel());
+    body.write(saved[i]->getName());
+    body.write(sections[i]);
+  }
+// the checkpoint starts with its size, so that it can be passed back with cmd("setCheckpoint")
+  cp.clear();
+  cp.write(body);
+}
+
+void PlumedMain::readCheckpoint(CheckpointData&cp) {
+  CheckpointData body;
+  cp.read(body);
+  std::string magic;
+  body.read(magic);
+  plumed_massert(magic=="PLUMED checkpoint 1","this is not a PLUMED checkpoint, or it was written by an incompatible version");
+  std::uint64_t n;
+  body.read(n);
+  log.printf("Restoring the state of %u actions from a binary checkpoint\n",unsigned(n));
+  std::set<const Action*> restored;
+  for(unsigned i=0; i<n; i++) {
+    std::string label,name;
+    CheckpointData section;
+    body.read(label);
+    body.read(name);
+    body.read(section);
+    Action* a=actionSet.selectWithLabel<Action*>(label);
+    plumed_massert(a,"action " + label + " found in the checkpoint is not present in the input");
+    plumed_massert(a->getName()==name,"action " + label + " is a " + a->getName() + " but it was a " + name + " in the checkpoint");
+    a->readCheckpoint(section);
+    plumed_massert(section.eof(),"the state of action " + label + " in the checkpoint was not completely read");
+    log.printf("  %s %s\n",name.c_str(),label.c_str());
+    restored.insert(a);
+  }
+  plumed_assert(body.eof());
+// the other actions would start from scratch, while the restart files are not read
+  for(const auto & p : actionSet) plumed_massert(!p->isStateful() || restored.count(p.get()),
+        "action " + p->getLabel() + " keeps a state between steps, but its state is not in the checkpoint");
+}
+
 void PlumedMain::insertFile(FileBase&f) {
   files.insert(&f);
 }
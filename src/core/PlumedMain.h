@@ -23,6 +23,7 @@
 #define __PLUMED_core_PlumedMain_h
 
 #include "WithCmd.h"
+#include "StepDescriptor.h"
 #include "tools/ForwardDecl.h"
 #include <cstdio>
 #include <string>
@@ -64,6 +65,8 @@ class Citations;
 class ExchangePatterns;
 class FileBase;
 class DataFetchingObject;
+class WorkerThread;
+class CheckpointData;
 
 /**
 Main plumed object.
@@ -190,6 +193,16 @@ private:
 /// Flag for checkpointig
   bool doCheckPoint;
 
+/// Binary checkpoint of the actions.
+/// It contains the checkpoint written by cmd("getCheckpointSize") or the one passed with cmd("setCheckpoint")
+  std::vector<char> checkpointBuffer;
+
+/// True if the state of the actions should be restored from checkpointBuffer before the first step
+  bool restartFromCheckpoint;
+
+/// Size in bytes of the checkpoint that will be passed with cmd("setCheckpoint"), or -1 if it has not been set yet
+  long int checkpointSize;
+
 
 /// Stuff to make plumed stop the MD code cleanly
   int* stopFlag;
@@ -199,6 +212,32 @@ private:
 /// Store information used in class \ref generic::UpdateIf
   std::stack<bool> updateFlags;
 
+/// A command that was resolved with cmd("getCmdHandle")
+  struct CmdHandle {
+/// index of the command in the interpreter
+    int iword;
+/// full command string, used in error messages
+    std::string word;
+/// the command split into words
+    std::vector<std::string> words;
+  };
+/// Commands resolved so far. The handle of a command is its position in this vector plus one
+  std::vector<CmdHandle> cmdHandles;
+
+/// Forward declaration.
+  ForwardDecl<WorkerThread> worker_fwd;
+/// Thread used to run the calculation started with startCalc()
+  WorkerThread& worker=*worker_fwd;
+
+/// True between startCalc() and waitCalc()
+  bool asyncCalc;
+
+/// Perform the backward loop on active actions without passing the forces to the MD engine
+  void backwardLoop();
+
+/// Execute a command that has already been split into words
+  void runCmd(int iword,const std::string & word,const std::vector<std::string> & words,void*val);
+
 public:
 /// Flag to switch off virial calculation (for debug and MD codes with no barostat)
   bool novirial;
@@ -239,6 +278,14 @@ public:
    Notice that this interface should always keep retro-compatibility
   */
   void cmd(const std::string&key,void*val=NULL) override;
+  /**
+   Execute a command resolved with cmd("getCmdHandle key",&handle).
+   \param handle The handle returned for the command.
+   \param val The argument of the command to be executed.
+   This is equivalent to cmd(key,val), but the key is not parsed again.
+   It is called as plumed_cmd_handle() or as PLMD::Plumed::cmdHandle()
+  */
+  void cmdHandle(int handle,void*val=NULL);
   ~PlumedMain();
   /**
     Read an input file.
@@ -301,6 +348,20 @@ public:
     Shortcut for: waitData() + justCalculate() + backwardPropagate()
   */
   void performCalcNoUpdate();
+  /**
+    Start the calculation in the background.
+    Same as waitData() + justCalculate() + backwardPropagate(), but run on a thread owned by plumed
+    so that the MD engine can compute its own forces in the meanwhile. The forces and the virial
+    of the MD engine are not touched until waitCalc() is called. Should be called after prepareCalc().
+    When more than one process is used the calculation is done here and only the forces are passed back
+    in waitCalc(), so as not to call MPI from two threads.
+  */
+  void startCalc();
+  /**
+    Complete the calculation started with startCalc().
+    Waits for it, adds the forces and the virial to those of the MD engine and calls update().
+  */
+  void waitCalc();
   /**
     Complete PLUMED calculation.
     Shortcut for prepareCalc() + performCalc()
@@ -366,6 +427,8 @@ public:
   void insertFile(FileBase&);
 /// Erase a file
   void eraseFile(FileBase&);
+/// Get the files that are presently open in the actions
+  const std::set<FileBase*> & getFiles()const {return files;}
 /// Flush all files
   void fflush();
 /// Check if restarting
@@ -374,6 +437,12 @@ public:
   void setRestart(bool f) {restart=f;}
 /// Check if checkpointing
   bool getCPT()const;
+/// Check if the state of the actions will be restored from a binary checkpoint before the first step
+  bool getRestartFromCheckpoint()const {return restartFromCheckpoint;}
+/// Save the state of all the actions in a binary checkpoint
+  void writeCheckpoint(CheckpointData&);
+/// Restore the state of all the actions from a binary checkpoint written with writeCheckpoint()
+  void readCheckpoint(CheckpointData&);
 /// Set exchangeStep flag
   void setExchangeStep(bool f);
 /// Get exchangeStep flag
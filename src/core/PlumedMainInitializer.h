@@ -50,6 +50,8 @@ typedef struct {
   int version;
   plumed_plumedmain_function_holder functions;
   void (*cmd_nothrow)(void*plumed,const char*key,const void*val,plumed_nothrow_handler nothrow);
+  void (*cmd_handle)(void*plumed,int handle,const void*val);
+  void (*cmd_handle_nothrow)(void*plumed,int handle,const void*val,plumed_nothrow_handler nothrow);
 } plumed_symbol_table_type;
 
 
@@ -72,6 +74,11 @@ extern "C" void*plumed_plumedmain_create();
 */
 extern "C" void plumed_plumedmain_cmd(void*plumed,const char*key,const void*val);
 
+/**
+  Send a command resolved with cmd("getCmdHandle") and a pointer `val` to a void pointer returned by \ref plumed_plumedmain_create.
+*/
+extern "C" void plumed_plumedmain_cmd_handle(void*plumed,int handle,const void*val);
+
 /**
   Finalize a void pointer returned by \ref plumed_plumedmain_create
 */
@@ -0,0 +1,47 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_core_StepDescriptor_h
+#define __PLUMED_core_StepDescriptor_h
+
+// This header is also included by wrapper/PlumedStatic.cpp, so it should not include anything else
+
+namespace PLMD {
+
+/**
+Data passed by the MD engine at every step with cmd("calcStep").
+It has the same layout as the plumed_step_descriptor structure in Plumed.h,
+which is checked with static assertions in wrapper/PlumedStatic.cpp
+*/
+struct StepDescriptor {
+  long int step;
+  void* box;
+  void* masses;
+  void* charges;
+  void* positions;
+  void* forces;
+  void* virial;
+  void* energy;
+};
+
+}
+
+#endif
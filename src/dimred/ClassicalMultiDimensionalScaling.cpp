@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "DimensionalityReductionBase.h"
 #include "core/ActionRegister.h"
+#include "tools/Lanczos.h"
 
 //+PLUMEDOC DIMRED CLASSICAL_MDS
 /*
@@ -196,13 +197,13 @@ void ClassicalMultiDimensionalScaling::calculateProjections( const Matrix<double
     for(unsigned j=0; j<n; ++j) distances(j,i) -= sum/n;
   }
 
-  // Diagonalize matrix
-  std::vector<double> eigval(n); Matrix<double> eigvec(n,n);
-  diagMat( distances, eigval, eigvec );
+  // Find the eigenvectors with the largest eigenvalues.  This uses the Lanczos algorithm when the matrix is large
+  std::vector<double> eigval; Matrix<double> eigvec;
+  largestEigenpairs( distances, projections.ncols(), eigval, eigvec );
 
   // Pass final projections to map object
   for(unsigned i=0; i<n; ++i) {
-    for(unsigned j=0; j<projections.ncols(); ++j) projections(i,j)=sqrt(eigval[n-1-j])*eigvec(n-1-j,i);
+    for(unsigned j=0; j<projections.ncols(); ++j) projections(i,j)=sqrt(eigval[j])*eigvec(j,i);
   }
 }
 
@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "PCA.h"
 #include "tools/Matrix.h"
+#include "tools/Lanczos.h"
 #include "reference/MetricRegister.h"
 #include "reference/ReferenceValuePack.h"
 #include "analysis/ReadAnalysisFrames.h"
@@ -179,11 +180,10 @@ void PCA::performAnalysis() {
   for(unsigned i=0; i<myconf0->getNumberOfReferencePositions(); ++i) spos[i].zero();
 
   // Calculate the average displacement from the first frame
-  double norm=getWeight(0); std::vector<double> args( getNumberOfArguments() );
+  double norm=getWeight(0); std::vector<double> args; std::vector<Vector> pos;
   for(unsigned i=1; i<getNumberOfDataPoints(); ++i) {
-    my_input_data->getStoredData( i, false ).transferDataToPDB( mypdb );
-    for(unsigned j=0; j<getArguments().size(); ++j) mypdb.getArgumentValue( getArguments()[j]->getName(), args[j] );
-    myconf0->calc( mypdb.getPositions(), getPbc(), getArguments(), args, mypack, true );
+    retrieveFrame( my_input_data->getStoredData( i, false ), pos, args );
+    myconf0->calc( pos, getPbc(), getArguments(), args, mypack, true );
     // Accumulate average displacement of arguments (Here PBC could do fucked up things - really needs Berry Phase ) GAT
     for(unsigned j=0; j<myconf0->getNumberOfReferenceArguments(); ++j) sarg[j] += 0.5*getWeight(i)*mypack.getArgumentDerivative(j);
     // Accumulate average displacement of position
@@ -198,9 +198,8 @@ void PCA::performAnalysis() {
   unsigned narg=myconf0->getNumberOfReferenceArguments(), natoms=myconf0->getNumberOfReferencePositions();
   Matrix<double> covar( narg+3*natoms, narg+3*natoms ); covar=0;
   for(unsigned i=0; i<getNumberOfDataPoints(); ++i) {
-    my_input_data->getStoredData( i, false ).transferDataToPDB( mypdb );
-    for(unsigned j=0; j<getArguments().size(); ++j) mypdb.getArgumentValue( getArguments()[j]->getName(), args[j] );
-    myconf0->calc( mypdb.getPositions(), getPbc(), getArguments(), args, mypack, true );
+    retrieveFrame( my_input_data->getStoredData( i, false ), pos, args );
+    myconf0->calc( pos, getPbc(), getArguments(), args, mypack, true );
     for(unsigned jarg=0; jarg<narg; ++jarg) {
       // Need sorting for PBC with GAT
       double jarg_d = 0.5*mypack.getArgumentDerivative(jarg) + myconf0->getReferenceArguments()[jarg] - sarg[jarg];
@@ -227,10 +226,9 @@ void PCA::performAnalysis() {
     for(unsigned j=0; j<covar.ncols(); ++j) covar(i,j) *= inorm;
   }
 
-  // Diagonalise the covariance
-  std::vector<double> eigval( narg+3*natoms );
-  Matrix<double> eigvec( narg+3*natoms, narg+3*natoms );
-  diagMat( covar, eigval, eigvec );
+  // Find the eigenvectors of the covariance with the largest eigenvalues
+  std::vector<double> eigval; Matrix<double> eigvec;
+  largestEigenpairs( covar, nlow, eigval, eigvec );
 
   // Output the reference configuration
   mypdb.setAtomPositions( spos );
@@ -241,10 +239,9 @@ void PCA::performAnalysis() {
   // Store and print the eigenvectors
   std::vector<Vector> tmp_atoms( natoms );
   for(unsigned dim=0; dim<nlow; ++dim) {
-    unsigned idim = covar.ncols() - 1 - dim;
-    for(unsigned i=0; i<narg; ++i) mypdb.setArgumentValue( getArguments()[i]->getName(), eigvec(idim,i) );
+    for(unsigned i=0; i<narg; ++i) mypdb.setArgumentValue( getArguments()[i]->getName(), eigvec(dim,i) );
     for(unsigned i=0; i<natoms; ++i) {
-      for(unsigned k=0; k<3; ++k) tmp_atoms[i][k]=eigvec(idim,narg+3*i+k);
+      for(unsigned k=0; k<3; ++k) tmp_atoms[i][k]=eigvec(dim,narg+3*i+k);
     }
     mypdb.setAtomPositions( tmp_atoms );
     // Create a direction object so that we can calculate other PCA components
@@ -262,17 +259,27 @@ void PCA::getProjection( const unsigned& idata, std::vector<double>& point, doub
 }
 
 void PCA::getProjection( analysis::DataCollectionObject& myidata, std::vector<double>& point ) {
-  myidata.transferDataToPDB( mypdb ); std::vector<double> args( getArguments().size() );
-  for(unsigned j=0; j<getArguments().size(); ++j) mypdb.getArgumentValue( getArguments()[j]->getName(), args[j] );
+  std::vector<Vector> pos; std::vector<double> args; retrieveFrame( myidata, pos, args );
   // Create some storage space
-  MultiValue myval( 1, 3*mypdb.getPositions().size() + args.size() + 9);
-  ReferenceValuePack mypack( args.size(), mypdb.getPositions().size(), myval );
-  for(unsigned i=0; i<mypdb.getPositions().size(); ++i) mypack.setAtomIndex( i, i );
+  MultiValue myval( 1, 3*pos.size() + args.size() + 9);
+  ReferenceValuePack mypack( args.size(), pos.size(), myval );
+  for(unsigned i=0; i<pos.size(); ++i) mypack.setAtomIndex( i, i );
   myref->setupPCAStorage( mypack );
   // And calculate
-  myref->calculate( mypdb.getPositions(), getPbc(), getArguments(), mypack, true );
+  myref->calculate( pos, getPbc(), getArguments(), mypack, true );
   for(unsigned i=0; i<nlow; ++i) point[i]=myref->projectDisplacementOnVector( directions[i], getArguments(), args, mypack );
 }
 
+void PCA::retrieveFrame( const analysis::DataCollectionObject& myobj, std::vector<Vector>& pos, std::vector<double>& args ) const {
+  // The data is read straight from the stored frame.  The positions are copied as the reference configurations need a vector
+  unsigned natoms=mypdb.getAtomNumbers().size();
+  if( natoms>0 ) {
+    plumed_massert( myobj.getNumberOfAtoms()==natoms, "PCA can only use all the atoms that are stored" );
+    pos.assign( myobj.getAtomPositions(), myobj.getAtomPositions()+natoms );
+  } else pos.resize(0);
+  args.resize( getNumberOfArguments() );
+  for(unsigned j=0; j<args.size(); ++j) args[j]=myobj.getArgumentValue( getArguments()[j]->getName() );
+}
+
 }
 }
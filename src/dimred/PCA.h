@@ -42,6 +42,8 @@ private:
 /// The eigenvectors that we are using
   std::unique_ptr<ReferenceConfiguration> myref;
   std::vector<Direction> directions;
+/// Get the positions and arguments of a frame directly from the stored data
+  void retrieveFrame( const analysis::DataCollectionObject& myobj, std::vector<Vector>& pos, std::vector<double>& args ) const ;
 public:
   static void registerKeywords( Keywords& keys );
   explicit PCA(const ActionOptions&ao);
@@ -20,53 +20,75 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "SMACOF.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace dimred {
 
+/// The pairs of points are divided into square tiles of this size so the data for both points stays in cache
+static const unsigned tilesize=64;
+
+void SMACOF::multiply( const Matrix<double>& A, const Matrix<double>& B, Matrix<double>& C ) {
+  unsigned nr=A.nrows(), nk=A.ncols(), nc=B.ncols();
+  plumed_dbg_assert( B.nrows()==nk && C.nrows()==nr && C.ncols()==nc );
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for(unsigned i=0; i<nr; ++i) {
+    for(unsigned c=0; c<nc; ++c) C(i,c)=0;
+    for(unsigned j=0; j<nk; ++j) {
+      for(unsigned c=0; c<nc; ++c) C(i,c)+=A(i,j)*B(j,c);
+    }
+  }
+}
+
 void SMACOF::run( const Matrix<double>& Weights, const Matrix<double>& Distances, const double& tol, const unsigned& maxloops, Matrix<double>& InitialZ ) {
-  unsigned M = Distances.nrows();
+  unsigned M = Distances.nrows(), nlow = InitialZ.ncols();
+  // The workspace is only allocated when the size of the problem changes
+  if( V.nrows()!=M ) { V.resize( M, M ); dists.resize( M, M ); BZ.resize( M, M ); }
+  if( BZZ.nrows()!=M || BZZ.ncols()!=nlow ) { BZZ.resize( M, nlow ); newZ.resize( M, nlow ); }
 
   // Calculate V
-  Matrix<double> V(M,M); double totalWeight=0.;
+  double totalWeight=0.;
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) reduction(+:totalWeight)
   for(unsigned i=0; i<M; ++i) {
+    V(i,i)=0;
     for(unsigned j=0; j<M; ++j) {
       if(i==j) continue;
-      V(i,j)=-Weights(i,j);
+      V(i,j)=-Weights(i,j); V(i,i)+=Weights(i,j);
       if( j<i ) totalWeight+=Weights(i,j);
     }
-    for(unsigned j=0; j<M; ++j) {
-      if(i==j)continue;
-      V(i,i)-=V(i,j);
-    }
   }
 
-  // And pseudo invert V
-  Matrix<double> mypseudo(M, M); pseudoInvert(V, mypseudo);
-  Matrix<double> dists( M, M ); double myfirstsig = calculateSigma( Weights, Distances, InitialZ, dists ) / totalWeight;
+  // And pseudo invert V.  For large matrices the equations V newZ = BZ Z are solved with conjugate gradients in place of this.
+  // Conjugate gradients needs V to be positive semi-definite, which is only sure when none of the weights are negative
+  bool iterative=( M>=512 );
+  for(unsigned i=0; i<M && iterative; ++i) {
+    for(unsigned j=0; j<i; ++j) { if( Weights(i,j)<0 ) { iterative=false; break; } }
+  }
+  if( !iterative ) pseudoInvert(V, mypseudo);
+  double myfirstsig = calculateSigma( Weights, Distances, InitialZ, dists ) / totalWeight;
 
   // initial sigma is made up of the original distances minus the distances between the projections all squared.
-  Matrix<double> temp( M, M ), BZ( M, M ), newZ( M, InitialZ.ncols() );
   for(unsigned n=0; n<maxloops; ++n) {
     if(n==maxloops-1) plumed_merror("ran out of steps in SMACOF algorithm");
 
-    // Recompute BZ matrix
+    // Recompute BZ matrix.  The diagonal elements are minus the sum of the off diagonal elements (Equation 8.25)
+    #pragma omp parallel for num_threads(OpenMP::getNumThreads())
     for(unsigned i=0; i<M; ++i) {
+      BZ(i,i)=0;
       for(unsigned j=0; j<M; ++j) {
         if(i==j) continue;  //skips over the diagonal elements
-
         if( dists(i,j)>0 ) BZ(i,j) = -Weights(i,j)*Distances(i,j) / dists(i,j);
         else BZ(i,j)=0.;
-      }
-      //the diagonal elements are -off diagonal elements BZ(i,i)-=BZ(i,j)   (Equation 8.25)
-      BZ(i,i)=0; //create the space memory for the diagonal elements which are scalars
-      for(unsigned j=0; j<M; ++j) {
-        if(i==j) continue;
         BZ(i,i)-=BZ(i,j);
       }
     }
 
-    mult( mypseudo, BZ, temp); mult(temp, InitialZ, newZ);
+    // BZ is multiplied by Z first so the products cost M*M*nlow operations rather than M*M*M
+    multiply( BZ, InitialZ, BZZ );
+    // If rounding errors stop conjugate gradients from converging the pseudo inverse is used for the rest of the cycles
+    if( iterative && !solveLaplacian( V, BZZ, newZ ) ) { iterative=false; pseudoInvert(V, mypseudo); }
+    if( !iterative ) multiply( mypseudo, BZZ, newZ );
     //Compute new sigma
     double newsig = calculateSigma( Weights, Distances, newZ, dists ) / totalWeight;
     //Computing whether the algorithm has converged (has the mass of the potato changed
@@ -77,13 +99,55 @@ void SMACOF::run( const Matrix<double>& Weights, const Matrix<double>& Distances
   }
 }
 
+bool SMACOF::solveLaplacian( const Matrix<double>& V, const Matrix<double>& B, Matrix<double>& X ) {
+  unsigned M=V.nrows(), nc=B.ncols();
+  // Each column is solved with conjugate gradients starting from zero.  As V is positive semi-definite and the
+  // columns of B are in its range this gives the same solution as multiplying B by the pseudo inverse of V
+  Matrix<double> R( B ), P( B ), VP( M, nc ); X.resize( M, nc ); X=0;
+  std::vector<double> rr( nc, 0 ), rr0( nc ), tol( nc );
+  for(unsigned c=0; c<nc; ++c) {
+    for(unsigned i=0; i<M; ++i) rr[c]+=R(i,c)*R(i,c);
+    rr0[c]=rr[c]; tol[c]=1e-20*rr[c];
+  }
+  for(unsigned iter=0; iter<M; ++iter) {
+    bool converged=true;
+    for(unsigned c=0; c<nc; ++c) { if( rr[c]>tol[c] ) { converged=false; break; } }
+    if( converged ) break;
+    // The products of V with the search directions for all the columns are done in one pass through V
+    multiply( V, P, VP );
+    for(unsigned c=0; c<nc; ++c) {
+      if( rr[c]<=tol[c] ) continue;
+      double pvp=0; for(unsigned i=0; i<M; ++i) pvp+=P(i,c)*VP(i,c);
+      if( pvp<=0 ) return false;
+      double alpha=rr[c]/pvp, newrr=0;
+      for(unsigned i=0; i<M; ++i) { X(i,c)+=alpha*P(i,c); R(i,c)-=alpha*VP(i,c); newrr+=R(i,c)*R(i,c); }
+      double beta=newrr/rr[c]; rr[c]=newrr;
+      for(unsigned i=0; i<M; ++i) P(i,c)=R(i,c)+beta*P(i,c);
+    }
+  }
+  // In exact arithmetic the method converges in M steps.  Rounding errors can stop it from reaching the tolerance,
+  // which is fine as long as the residual is small, but a large residual means that the new projections are wrong
+  for(unsigned c=0; c<nc; ++c) {
+    if( rr[c]>1e-12*rr0[c] ) return false;
+  }
+  return true;
+}
+
 double SMACOF::calculateSigma( const Matrix<double>& Weights, const Matrix<double>& Distances, const Matrix<double>& InitialZ, Matrix<double>& dists ) {
-  unsigned M = Distances.nrows(); double sigma=0;
-  for(unsigned i=1; i<M; ++i) {
-    for(unsigned j=0; j<i; ++j) {
-      double dlow=0; for(unsigned k=0; k<InitialZ.ncols(); ++k) { double tmp=InitialZ(i,k) - InitialZ(j,k); dlow+=tmp*tmp; }
-      dists(i,j)=dists(j,i)=sqrt(dlow); double tmp3 = Distances(i,j) - dists(i,j);
-      sigma += Weights(i,j)*tmp3*tmp3;
+  unsigned M = Distances.nrows(), ntiles=(M+tilesize-1)/tilesize; double sigma=0;
+  // Each thread takes a row of tiles at a time.  The rows near the bottom of the matrix have more tiles so they are distributed dynamically
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic,1) reduction(+:sigma)
+  for(unsigned it=0; it<ntiles; ++it) {
+    unsigned istart=it*tilesize, iend=std::min( M, istart+tilesize );
+    for(unsigned jt=0; jt<=it; ++jt) {
+      unsigned jstart=jt*tilesize, jend=std::min( M, jstart+tilesize );
+      for(unsigned i=istart; i<iend; ++i) {
+        for(unsigned j=jstart; j<jend && j<i; ++j) {
+          double dlow=0; for(unsigned k=0; k<InitialZ.ncols(); ++k) { double tmp=InitialZ(i,k) - InitialZ(j,k); dlow+=tmp*tmp; }
+          dists(i,j)=dists(j,i)=sqrt(dlow); double tmp3 = Distances(i,j) - dists(i,j);
+          sigma += Weights(i,j)*tmp3*tmp3;
+        }
+      }
     }
   }
   return sigma;
@@ -29,9 +29,17 @@ namespace PLMD {
 namespace dimred {
 
 class SMACOF {
+private:
+/// Workspace that is kept between calls so that it is only allocated once
+  Matrix<double> V, mypseudo, dists, BZ, BZZ, newZ;
+/// Calculate C = A B with the rows of A divided between the threads
+  static void multiply( const Matrix<double>& A, const Matrix<double>& B, Matrix<double>& C );
 public:
   static double calculateSigma( const Matrix<double>& Weights, const Matrix<double>& Distances, const Matrix<double>& InitialZ, Matrix<double>& dists );
-  static void run( const Matrix<double>& Weights, const Matrix<double>& Distances, const double& tol, const unsigned& maxloops, Matrix<double>& InitialZ);
+/// Solve V X = B for a graph Laplacian V (positive semi-definite with rows that sum to zero) using conjugate gradients.
+/// This returns false if the residual is still large after M iterations
+  static bool solveLaplacian( const Matrix<double>& V, const Matrix<double>& B, Matrix<double>& X );
+  void run( const Matrix<double>& Weights, const Matrix<double>& Distances, const double& tol, const unsigned& maxloops, Matrix<double>& InitialZ);
 };
 
 }
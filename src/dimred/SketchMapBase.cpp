@@ -20,6 +20,8 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "SketchMapBase.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace dimred {
@@ -87,12 +89,20 @@ void SketchMapBase::calculateProjections( const Matrix<double>& targets, Matrix<
   for(unsigned i=0; i<targets.nrows() ; ++i) { pweights[i] = getWeight(i); normw+=pweights[i]; }
   normw*=normw;
 
-  // Transform the high dimensional distances
-  double df; distances=0.; transformed=0.;
-  for(unsigned i=1; i<distances.ncols(); ++i) {
-    for(unsigned j=0; j<i; ++j) {
-      distances(i,j)=distances(j,i)=sqrt( targets(i,j) );
-      transformed(i,j)=transformed(j,i)=transformHighDimensionalDistance( distances(i,j), df );
+  // Transform the high dimensional distances.  The pairs are divided into tiles and the rows of tiles are shared between the threads
+  distances=0.; transformed=0.;
+  unsigned M=distances.ncols(), ntiles=(M+tilesize-1)/tilesize;
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic,1)
+  for(unsigned it=0; it<ntiles; ++it) {
+    unsigned istart=it*tilesize, iend=std::min( M, istart+tilesize );
+    for(unsigned jt=0; jt<=it; ++jt) {
+      unsigned jstart=jt*tilesize, jend=std::min( M, jstart+tilesize );
+      for(unsigned i=istart; i<iend; ++i) {
+        for(unsigned j=jstart; j<jend && j<i; ++j) {
+          double df; distances(i,j)=distances(j,i)=sqrt( targets(i,j) );
+          transformed(i,j)=transformed(j,i)=transformHighDimensionalDistance( distances(i,j), df );
+        }
+      }
     }
   }
   // And minimse
@@ -130,30 +140,44 @@ double SketchMapBase::calculateStress( const std::vector<double>& p, std::vector
 double SketchMapBase::calculateFullStress( const std::vector<double>& p, std::vector<double>& d ) {
   // Zero derivative and stress accumulators
   for(unsigned i=0; i<p.size(); ++i) d[i]=0.0;
-  double stress=0; std::vector<double> dtmp( nlow );
-
-  for(unsigned i=1; i<distances.nrows(); ++i) {
-    double iweight = pweights[i];
-    for(unsigned j=0; j<i; ++j) {
-      double jweight =  pweights[j];
-      // Calculate distance in low dimensional space
-      double dd=0;
-      for(unsigned k=0; k<nlow; ++k) { dtmp[k]=p[nlow*i+k] - p[nlow*j+k]; dd+=dtmp[k]*dtmp[k]; }
-      dd = sqrt(dd);
-
-      // Now do transformations and calculate differences
-      double df, fd = transformLowDimensionalDistance( dd, df );
-      double ddiff = dd - distances(i,j);
-      double fdiff = fd - transformed(i,j);;
-
-      // Calculate derivatives
-      double pref = 2.*iweight*jweight*( (1-mixparam)*fdiff*df + mixparam*ddiff ) / dd;
-      for(unsigned k=0; k<nlow; ++k) {
-        double dterm=pref*dtmp[k]; d[nlow*i+k]+=dterm; d[nlow*j+k]-=dterm;
+  double stress=0; unsigned M=distances.nrows(), ntiles=(M+tilesize-1)/tilesize;
+  // The pairs are divided into tiles and the rows of tiles are shared between the threads.  Each thread
+  // accumulates the derivatives in its own array and these are added together at the end
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    std::vector<double> omp_d( d.size(), 0.0 ), dtmp( nlow ); double omp_stress=0;
+    #pragma omp for schedule(dynamic,1) nowait
+    for(unsigned it=0; it<ntiles; ++it) {
+      unsigned istart=it*tilesize, iend=std::min( M, istart+tilesize );
+      for(unsigned jt=0; jt<=it; ++jt) {
+        unsigned jstart=jt*tilesize, jend=std::min( M, jstart+tilesize );
+        for(unsigned i=istart; i<iend; ++i) {
+          double iweight = pweights[i];
+          for(unsigned j=jstart; j<jend && j<i; ++j) {
+            double jweight =  pweights[j];
+            // Calculate distance in low dimensional space
+            double dd=0;
+            for(unsigned k=0; k<nlow; ++k) { dtmp[k]=p[nlow*i+k] - p[nlow*j+k]; dd+=dtmp[k]*dtmp[k]; }
+            dd = sqrt(dd);
+            // Now do transformations and calculate differences
+            double df, fd = transformLowDimensionalDistance( dd, df );
+            double ddiff = dd - distances(i,j);
+            double fdiff = fd - transformed(i,j);
+            // Calculate derivatives
+            double pref = 2.*iweight*jweight*( (1-mixparam)*fdiff*df + mixparam*ddiff ) / dd;
+            for(unsigned k=0; k<nlow; ++k) {
+              double dterm=pref*dtmp[k]; omp_d[nlow*i+k]+=dterm; omp_d[nlow*j+k]-=dterm;
+            }
+            // Accumulate the total stress
+            omp_stress += iweight*jweight*( (1-mixparam)*fdiff*fdiff + mixparam*ddiff*ddiff );
+          }
+        }
       }
-
-      // Accumulate the total stress
-      stress += iweight*jweight*( (1-mixparam)*fdiff*fdiff + mixparam*ddiff*ddiff );
+    }
+    #pragma omp critical
+    {
+      for(unsigned k=0; k<d.size(); ++k) d[k]+=omp_d[k];
+      stress+=omp_stress;
     }
   }
   stress /= normw; for (unsigned k=0; k < d.size(); ++k) d[k] /= normw;
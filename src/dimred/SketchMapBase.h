@@ -39,10 +39,14 @@ private:
   SwitchingFunction lowdf, highdf;
 /// This is used within calculate stress to hold the target distances and the
 /// target values for the high dimensional switching function
-  std::vector<double> dtargets, ftargets, pweights;
+  std::vector<double> dtargets, ftargets;
 /// Stress normalization (sum_ij w_i w_j)
   double normw;
 protected:
+/// The pairs of points are divided into square tiles of this size so the data for both points stays in cache
+  static const unsigned tilesize=64;
+/// The weights of the points
+  std::vector<double> pweights;
 /// This holds the target distances and target transformed distances
   Matrix<double> distances, transformed;
 /// The fraction of pure distances to mix in when optimising
@@ -60,6 +60,7 @@ public:
   std::vector<Value*> getArgumentList() override;
   unsigned getDataPointIndexInBase( const unsigned& idata ) const override;
   double getDissimilarity( const unsigned& i, const unsigned& j ) override;
+  bool dissimilaritiesAreThreadSafe() const override { return false; }
   double getWeight( const unsigned& idata ) override;
 };
 
@@ -22,6 +22,8 @@
 #include "core/ActionRegister.h"
 #include "SketchMapBase.h"
 #include "SMACOF.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 //+PLUMEDOC DIMRED SKETCHMAP_SMACOF
 /*
@@ -39,6 +41,10 @@ class SketchMapSmacof : public SketchMapBase {
 private:
   unsigned max_smap, maxiter;
   double smap_tol, iter_tol, regulariser;
+/// The object that runs SMACOF.  This holds the workspace so it is only allocated once
+  SMACOF smacof;
+/// The weights of the pairs of points in the SMACOF stress
+  Matrix<double> weights;
   double recalculateWeights( const Matrix<double>& projections, Matrix<double>& weights );
 public:
   static void registerKeywords( Keywords& keys );
@@ -67,11 +73,11 @@ SketchMapSmacof::SketchMapSmacof( const ActionOptions& ao ):
 }
 
 void SketchMapSmacof::minimise( Matrix<double>& projections ) {
-  Matrix<double> weights( distances.nrows(), distances.ncols() ); weights=0.;
+  weights.resize( distances.nrows(), distances.ncols() ); weights=0.;
   double filt = recalculateWeights( projections, weights );
 
   for(unsigned i=0; i<maxiter; ++i) {
-    SMACOF::run( weights, distances, smap_tol, max_smap, projections );
+    smacof.run( weights, distances, smap_tol, max_smap, projections );
     // Recalculate weights matrix and sigma
     double newsig = recalculateWeights( projections, weights );
     // Test whether or not the algorithm has converged
@@ -82,25 +88,33 @@ void SketchMapSmacof::minimise( Matrix<double>& projections ) {
 }
 
 double SketchMapSmacof::recalculateWeights( const Matrix<double>& projections, Matrix<double>& weights ) {
-  double filt=0, totalWeight=0.;; double dr;
-  for(unsigned i=1; i<weights.nrows(); ++i) {
-    for(unsigned j=0; j<i; ++j) {
-      double ninj=getWeight(i)*getWeight(j); totalWeight += ninj;
-
-      double tempd=0;
-      for(unsigned k=0; k<projections.ncols(); ++k) {
-        double tmp = projections(i,k) - projections(j,k);
-        tempd += tmp*tmp;
+  unsigned M=weights.nrows(), ntiles=(M+tilesize-1)/tilesize; double filt=0, totalWeight=0.;
+  // The pairs are divided into tiles and the rows of tiles are shared between the threads
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic,1) reduction(+:filt,totalWeight)
+  for(unsigned it=0; it<ntiles; ++it) {
+    unsigned istart=it*tilesize, iend=std::min( M, istart+tilesize );
+    for(unsigned jt=0; jt<=it; ++jt) {
+      unsigned jstart=jt*tilesize, jend=std::min( M, jstart+tilesize );
+      for(unsigned i=istart; i<iend; ++i) {
+        for(unsigned j=jstart; j<jend && j<i; ++j) {
+          double ninj=pweights[i]*pweights[j]; totalWeight += ninj;
+
+          double tempd=0;
+          for(unsigned k=0; k<projections.ncols(); ++k) {
+            double tmp = projections(i,k) - projections(j,k);
+            tempd += tmp*tmp;
+          }
+          double dij=sqrt(tempd);
+
+          double dr, fij = transformLowDimensionalDistance( dij, dr );
+          double filter=transformed(i,j)-fij;
+          double diff=distances(i,j) - dij;
+
+          if( fabs(diff)<regulariser ) weights(i,j)=weights(j,i)=0.0;
+          else weights(i,j)=weights(j,i) = ninj*( (1-mixparam)*( filter*dr )/diff + mixparam );
+          filt += ninj*( (1-mixparam)*filter*filter + mixparam*diff*diff );
+        }
       }
-      double dij=sqrt(tempd);
-
-      double fij = transformLowDimensionalDistance( dij, dr );
-      double filter=transformed(i,j)-fij;
-      double diff=distances(i,j) - dij;
-
-      if( fabs(diff)<regulariser ) weights(i,j)=weights(j,i)=0.0;
-      else weights(i,j)=weights(j,i) = ninj*( (1-mixparam)*( filter*dr )/diff + mixparam );
-      filt += ninj*( (1-mixparam)*filter*filter + mixparam*diff*diff );
     }
   }
   return filt / totalWeight;
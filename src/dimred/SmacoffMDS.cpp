@@ -75,7 +75,7 @@ void SmacofMDS::calculateProjections( const Matrix<double>& targets, Matrix<doub
     }
   }
   // And run SMACOF
-  SMACOF::run( weights, targets, tol, maxloops, projections );
+  SMACOF smacof; smacof.run( weights, targets, tol, maxloops, projections );
 }
 
 }
@@ -21,6 +21,7 @@
 #include "core/Atoms.h"
 #include "core/PlumedMain.h"
 #include "DRR.h"
+#include "tools/CheckpointData.h"
 #include "tools/Random.h"
 #include "tools/Tools.h"
 #include "colvar_UIestimator.h"
@@ -34,6 +35,7 @@
 #include <iostream>
 #include <limits>
 #include <random>
+#include <sstream>
 #include <string>
 
 using namespace PLMD;
@@ -234,6 +236,8 @@ public:
   void update();
   void save(const string &filename, long long int step);
   void load(const string &filename);
+  void writeCheckpoint(CheckpointData &cp);
+  void readCheckpoint(CheckpointData &cp);
   void backupFile(const string &filename);
   static void registerKeywords(Keywords &keys);
   bool is_file_exist(const char *fileName);
@@ -435,7 +439,8 @@ DynamicReferenceRestraining::DynamicReferenceRestraining(
         "500(default)."
         << '\n';
   }
-  if (getRestart()) {
+  // with a binary checkpoint the state is restored later by readCheckpoint
+  if (getRestart() && !getRestartFromCheckpoint()) {
     if (restart_prefix.length() != 0) {
       isRestart = true;
       firsttime = false;
@@ -515,6 +520,7 @@ DynamicReferenceRestraining::DynamicReferenceRestraining(
     }
   }
   checkRead();
+  setStateful();
 
   // Set up kbt for extended system
   log << "eABF/DRR: The fullsamples is " << fullsamples << '\n';
@@ -853,6 +859,35 @@ void DynamicReferenceRestraining::load(const string &rfile_prefix) {
   backupFile(filename);
 }
 
+void DynamicReferenceRestraining::writeCheckpoint(CheckpointData &cp) {
+  if (useUIestimator) {
+    error("the state of the UI estimator cannot be saved in a binary checkpoint");
+  }
+  // the same data of the restart files, serialized with boost
+  std::ostringstream out;
+  {
+    boost::archive::binary_oarchive oa(out);
+    oa << fict << vfict << vfict_laststep << ffict << ABFGrid << CZARestimator;
+  }
+  cp.write(out.str());
+  cp.write(firsttime);
+  rand.writeCheckpoint(cp);
+}
+
+void DynamicReferenceRestraining::readCheckpoint(CheckpointData &cp) {
+  string data;
+  cp.read(data);
+  std::istringstream in(data);
+  {
+    boost::archive::binary_iarchive ia(in);
+    ia >> fict >> vfict >> vfict_laststep >> ffict >> ABFGrid >> CZARestimator;
+  }
+  // ABF Parametres are not saved in binary files
+  ABFGrid.setParameters(fullsamples, maxFactors);
+  cp.read(firsttime);
+  rand.readCheckpoint(cp);
+}
+
 void DynamicReferenceRestraining::backupFile(const string &filename) {
   bool isSuccess = false;
   long int i = 0;
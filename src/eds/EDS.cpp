@@ -20,6 +20,7 @@ along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 #include "core/ActionRegister.h"
 #include "core/Atoms.h"
 #include "core/PlumedMain.h"
+#include "tools/CheckpointData.h"
 #include "tools/File.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
@@ -271,6 +272,8 @@ public:
   void calculate();
   void update();
   void turnOnDerivatives();
+  void writeCheckpoint(CheckpointData&);
+  void readCheckpoint(CheckpointData&);
   static void registerKeywords(Keywords& keys);
   ~EDS();
 };
@@ -400,6 +403,7 @@ EDS::EDS(const ActionOptions&ao):
   parseFlag("COVAR",b_covar_);
   parse("IN_RESTART",in_restart_name_);
   checkRead();
+  setStateful();
 
   /*
    * Things that are different when using changing centers:
@@ -1046,6 +1050,65 @@ EDS::~EDS() {
   out_restart_.close();
 }
 
+void EDS::writeCheckpoint(CheckpointData&cp) {
+  cp.write(center_);
+  cp.write(scale_);
+  cp.write(current_coupling_);
+  cp.write(set_coupling_);
+  cp.write(target_coupling_);
+  cp.write(max_coupling_range_);
+  cp.write(max_coupling_grad_);
+  cp.write(coupling_rate_);
+  cp.write(coupling_accum_);
+  cp.write(means_);
+  cp.write(differences_);
+  cp.write(alpha_vector_);
+  cp.write(alpha_vector_2_);
+  cp.write(ssds_);
+  cp.write(step_size_);
+  cp.write(pseudo_virial_);
+  cp.write(covar_.getVector());
+  cp.write(covar2_.getVector());
+  cp.write(lm_inv_.getVector());
+  cp.write(b_equil_);
+  cp.write(avg_coupling_count_);
+  cp.write(update_calls_);
+  cp.write(pseudo_virial_sum_);
+  cp.write(max_logweight_);
+  cp.write(wsum_);
+  rand_.writeCheckpoint(cp);
+}
+
+void EDS::readCheckpoint(CheckpointData&cp) {
+  cp.read(center_);
+  cp.read(scale_);
+  cp.read(current_coupling_);
+  cp.read(set_coupling_);
+  cp.read(target_coupling_);
+  cp.read(max_coupling_range_);
+  cp.read(max_coupling_grad_);
+  cp.read(coupling_rate_);
+  cp.read(coupling_accum_);
+  cp.read(means_);
+  cp.read(differences_);
+  cp.read(alpha_vector_);
+  cp.read(alpha_vector_2_);
+  cp.read(ssds_);
+  cp.read(step_size_);
+  cp.read(pseudo_virial_);
+  cp.read(covar_.getVector());
+  cp.read(covar2_.getVector());
+  cp.read(lm_inv_.getVector());
+  cp.read(b_equil_);
+  cp.read(avg_coupling_count_);
+  cp.read(update_calls_);
+  cp.read(pseudo_virial_sum_);
+  cp.read(max_logweight_);
+  cp.read(wsum_);
+  rand_.readCheckpoint(cp);
+  for(unsigned int i = 0; i<ncvs_; ++i) out_coupling_[i]->set(current_coupling_[i]);
+}
+
 void EDS::turnOnDerivatives() {
   // do nothing
   // this is to avoid errors triggered when a bias is used as a CV
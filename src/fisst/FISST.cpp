@@ -259,6 +259,7 @@ FISST::FISST(const ActionOptions&ao):
   parse("OUT_OBSERVABLE",out_observable_name_);
   parse("IN_RESTART",in_restart_name_);
   checkRead();
+  setStateful();
 
   if(center_.size() != ncvs_)
     error("Must have same number of CENTER arguments as ARG arguments");
@@ -39,6 +39,7 @@ Function::Function(const ActionOptions&ao):
   ActionWithValue(ao),
   ActionWithArguments(ao)
 {
+  setStateful(false);
 }
 
 void Function::addValueWithDerivatives() {
@@ -91,6 +91,7 @@ DumpDerivatives::DumpDerivatives(const ActionOptions&ao):
   ActionWithArguments(ao),
   fmt("%15.10f")
 {
+  setStateful(false);
   parse("FILE",file);
   if( file.length()==0 ) error("name of output file was not specified");
   parse("FMT",fmt);
@@ -89,6 +89,7 @@ DumpForces::DumpForces(const ActionOptions&ao):
   ActionWithArguments(ao),
   fmt("%15.10f")
 {
+  setStateful(false);
   parse("FILE",file);
   if( file.length()==0 ) error("name of file was not specified");
   parse("FMT",fmt);
@@ -22,6 +22,7 @@
 #include "core/ActionAtomistic.h"
 #include "core/ActionPilot.h"
 #include "core/ActionRegister.h"
+#include "tools/CheckpointData.h"
 #include "tools/File.h"
 #include "core/PlumedMain.h"
 #include "core/Atoms.h"
@@ -106,6 +107,9 @@ public:
   void calculate() override {}
   void apply() override {}
   void update() override;
+// masses and charges are only written at the first step
+  void writeCheckpoint(CheckpointData&cp) override {cp.write(first);}
+  void readCheckpoint(CheckpointData&cp) override {cp.read(first);}
 };
 
 PLUMED_REGISTER_ACTION(DumpMassCharge,"DUMPMASSCHARGE")
@@ -159,6 +163,7 @@ DumpMassCharge::DumpMassCharge(const ActionOptions&ao):
 
 
   checkRead();
+  setStateful();
 
   log.printf("  printing the following atoms:" );
   for(unsigned i=0; i<atoms.size(); ++i) log.printf(" %d",atoms[i].serial() );
@@ -87,6 +87,7 @@ DumpProjections::DumpProjections(const ActionOptions&ao):
   ActionWithArguments(ao),
   fmt("%15.10f")
 {
+  setStateful(false);
   parse("FILE",file);
   if( file.length()==0 ) error("filename not specified");
   parse("FMT",fmt);
@@ -189,6 +189,7 @@ EffectiveEnergyDrift::EffectiveEnergyDrift(const ActionOptions&ao):
   indexR.resize(atoms.getNatoms());
   dataR.resize(atoms.getNatoms()*6);
   backmap.resize(atoms.getNatoms());
+  setStateful();
 }
 
 EffectiveEnergyDrift::~EffectiveEnergyDrift() {
@@ -73,6 +73,7 @@ void EndPlumed::registerKeywords( Keywords& keys ) {
 EndPlumed::EndPlumed(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
   checkRead();
   plumed.setEndPlumed();
 }
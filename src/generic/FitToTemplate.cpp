@@ -218,6 +218,7 @@ FitToTemplate::FitToTemplate(const ActionOptions&ao):
   ActionWithValue(ao),
   nopbc(false)
 {
+  setStateful(false);
   string reference;
   parse("REFERENCE",reference);
   type.assign("SIMPLE");
@@ -64,6 +64,7 @@ public:
     Action(ao),
     ActionPilot(ao)
   {
+    setStateful(false);
     checkRead();
   }
   static void registerKeywords( Keywords& keys );
@@ -148,6 +148,7 @@ Group::Group(const ActionOptions&ao):
   Action(ao),
   ActionAtomistic(ao)
 {
+  setStateful(false);
   vector<AtomNumber> atoms;
   parseAtomList("ATOMS",atoms);
   std::string ndxfile,ndxgroup;
@@ -274,6 +274,8 @@ API([&]() {
   }
 
   checkRead();
+// the state of the actions of the inner instance cannot be saved
+  setStateful();
 
   if(root) p.cmd("setMDEngine","plumed");
 
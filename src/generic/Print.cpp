@@ -135,6 +135,8 @@ Print::Print(const ActionOptions&ao):
 // they allow to change regularly the
 // printed argument
   parse("_ROTATE",rotate);
+// the argument that is printed changes with the number of steps that have been done
+  setStateful(rotate>0);
   if(rotate>0) {
     rotateCountdown=rotate;
     for(unsigned i=0; i<getNumberOfArguments(); ++i) rotateArguments.push_back( getPntrToArgument(i) );
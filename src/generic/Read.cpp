@@ -198,6 +198,7 @@ Read::Read(const ActionOptions&ao):
     log.printf("  reading value %s and storing as %s\n",valread[0].c_str(),getLabel().c_str() );
   }
   checkRead();
+  setStateful();
 }
 
 std::string Read::getFilename() const {
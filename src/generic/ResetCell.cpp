@@ -122,6 +122,7 @@ ResetCell::ResetCell(const ActionOptions&ao):
   ActionPilot(ao),
   ActionAtomistic(ao)
 {
+  setStateful(false);
   type.assign("TRIANGULAR");
   parse("TYPE",type);
 
@@ -63,6 +63,7 @@ void Time::registerKeywords( Keywords& keys ) {
 Time::Time(const ActionOptions&ao):
   Action(ao),ActionWithValue(ao)
 {
+  setStateful(false);
   addValueWithDerivatives(); setNotPeriodic();
   // resize derivative by hand to a nonzero value
   getPntrToValue()->resizeDerivatives(1);
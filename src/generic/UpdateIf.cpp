@@ -116,6 +116,7 @@ UpdateIf::UpdateIf(const ActionOptions&ao):
   on(false),
   end(false)
 {
+  setStateful(false);
   parseFlag("END",end);
   parseVector("LESS_THAN",upper);
   parseVector("MORE_THAN",lower);
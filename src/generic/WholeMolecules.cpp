@@ -139,6 +139,7 @@ WholeMolecules::WholeMolecules(const ActionOptions&ao):
   ActionAtomistic(ao),
   doref(false)
 {
+  setStateful(false);
   vector<AtomNumber> merge;
   for(int i=0;; i++) {
     vector<AtomNumber> group;
@@ -180,6 +180,7 @@ WrapAround::WrapAround(const ActionOptions&ao):
   ActionAtomistic(ao),
   groupby(1)
 {
+  setStateful(false);
   parseAtomList("ATOMS",atoms);
   parseAtomList("AROUND",reference);
   parse("GROUPBY",groupby);
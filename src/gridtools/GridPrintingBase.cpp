@@ -43,6 +43,7 @@ GridPrintingBase::GridPrintingBase(const ActionOptions&ao):
   fmt("%f"),
   output_for_all_replicas(false)
 {
+  setStateful(false);
   std::string mlab; parse("GRID",mlab);
   vesselbase::ActionWithVessel* mves= plumed.getActionSet().selectWithLabel<vesselbase::ActionWithVessel*>(mlab);
   if(!mves) error("action labelled " +  mlab + " does not exist or does not have vessels");
@@ -34,6 +34,7 @@
 #include <fstream>
 #include <iterator>
 #include <sstream>
+#include <algorithm>
 
 #include "MetainferenceBase.h"
 #include "core/ActionRegister.h"
@@ -414,6 +415,18 @@ class CS2Backbone : public MetainferenceBase {
     vector<int> xd1;            // additional couple of atoms
     vector<int> xd2;            // additional couple of atoms
     vector<unsigned> box_nb;    // non-bonded atoms
+    // the parameters used for this chemical shift are packed together
+    double const_cs;            // contribution of the residue types
+    vector<unsigned> bb_q;      // backbone atoms with a non zero parameter
+    vector<double> bb_c;        // and their parameters
+    vector<unsigned> sc_q;      // side chain atoms with a non zero parameter
+    vector<double> sc_c;        // and their parameters
+    vector<unsigned> xd_q;      // extra distances with a non zero parameter
+    vector<double> xd_c;        // and their parameters
+    double co_da[3];            // dihedral angles
+    double pars_da[3][5];       // dihedral angles
+    double co_ring[5];          // ring currents
+    double co_sphere[2][8];     // non-bonded atoms
 
     ChemicalShift():
       exp_cs(0.),
@@ -430,7 +443,8 @@ class CS2Backbone : public MetainferenceBase {
       totcsatoms(0),
       res_num(0),
       chain(0),
-      ipos(0)
+      ipos(0),
+      const_cs(0.)
     {
       xd1.reserve(26);
       xd2.reserve(26);
@@ -470,11 +484,14 @@ class CS2Backbone : public MetainferenceBase {
   unsigned         max_cs_atoms;
   unsigned         box_nupdate;
   unsigned         box_count;
+  vector<unsigned> my_cs;       // chemical shifts calculated by this process
+  vector<unsigned> my_cs_order; // the same chemical shifts from the most to the least expensive
   bool             camshift;
   bool             pbc;
   bool             serial;
 
   void init_cs(const string &file, const string &k, const PDB &pdb);
+  void init_params();
   void update_neighb();
   void compute_ring_parameters();
   void init_types(const PDB &pdb);
@@ -592,6 +609,7 @@ CS2Backbone::CS2Backbone(const ActionOptions&ao):
 
   init_types(pdb);
   init_rings(pdb);
+  init_params();
 
   log<<"  Bibliography "
      <<plumed.cite("Kohlhoff K, Robustelli P, Cavalli A, Salvatella A, Vendruscolo M, J. Am. Chem. Soc. 131, 13894 (2009)");
@@ -950,6 +968,51 @@ void CS2Backbone::init_rings(const PDB &pdb)
   for(unsigned cs=0; cs<chemicalshifts.size(); cs++) chemicalshifts[cs].csatoms += total_rings_atoms;
 }
 
+// this copies the parameters needed by each chemical shift from the database
+// and keeps only the distances with a non zero parameter
+void CS2Backbone::init_params()
+{
+  for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
+    ChemicalShift & myfrag = chemicalshifts[cs];
+    const unsigned aa_kind = myfrag.res_kind;
+    const unsigned at_kind = myfrag.atm_kind;
+    myfrag.const_cs = db.CONSTAAPREV(aa_kind,at_kind)[myfrag.res_type_prev] +
+                      db.CONSTAACURR(aa_kind,at_kind)[myfrag.res_type_curr] +
+                      db.CONSTAANEXT(aa_kind,at_kind)[myfrag.res_type_next];
+
+    const double * CONST_BB2 = db.CONST_BB2(aa_kind,at_kind);
+    for(unsigned q=0; q<16; q++) {
+      if(CONST_BB2[q]==0.||myfrag.bb[q]==myfrag.ipos) continue;
+      myfrag.bb_q.push_back(q);
+      myfrag.bb_c.push_back(CONST_BB2[q]);
+    }
+
+    const double * CONST_SC2 = db.CONST_SC2(aa_kind,at_kind,myfrag.res_type_curr);
+    for(unsigned q=0; q<myfrag.side_chain.size(); q++) {
+      if(CONST_SC2[q]==0.||myfrag.side_chain[q]==myfrag.ipos) continue;
+      myfrag.sc_q.push_back(q);
+      myfrag.sc_c.push_back(CONST_SC2[q]);
+    }
+
+    const double * CONST_XD = db.CONST_XD(aa_kind,at_kind);
+    for(unsigned q=0; q<myfrag.xd1.size(); q++) {
+      if(CONST_XD[q]==0.||myfrag.xd1[q]==-1||myfrag.xd2[q]==-1) continue;
+      myfrag.xd_q.push_back(q);
+      myfrag.xd_c.push_back(CONST_XD[q]);
+    }
+
+    for(unsigned k=0; k<3; k++) {
+      myfrag.co_da[k] = db.CO_DA(aa_kind,at_kind)[k];
+      for(unsigned l=0; l<5; l++) myfrag.pars_da[k][l] = db.PARS_DA(aa_kind,at_kind,k)[l];
+    }
+    for(unsigned k=0; k<5; k++) myfrag.co_ring[k] = db.CO_RING(aa_kind,at_kind)[k];
+    for(unsigned k=0; k<8; k++) {
+      myfrag.co_sphere[0][k] = db.CO_SPHERE(aa_kind,at_kind,0)[k];
+      myfrag.co_sphere[1][k] = db.CO_SPHERE(aa_kind,at_kind,1)[k];
+    }
+  }
+}
+
 void CS2Backbone::calculate()
 {
   if(pbc) makeWhole();
@@ -983,34 +1046,29 @@ void CS2Backbone::calculate()
   }
 
   unsigned nt=OpenMP::getNumThreads();
-  if(nt*stride*2>chemicalshifts.size()) nt=1;
+  if(nt*2>my_cs_order.size()) nt=1;
 
-  // a single loop over all chemical shifts
+  // a single loop over all chemical shifts, the most expensive are done first
   #pragma omp parallel num_threads(nt)
   {
     #pragma omp for schedule(dynamic)
-    for(unsigned cs=rank; cs<chemicalshifts.size(); cs+=stride) {
+    for(unsigned ics=0; ics<my_cs_order.size(); ics++) {
+      const unsigned cs=my_cs_order[ics];
       const unsigned kdx=cs*max_cs_atoms;
       const ChemicalShift *myfrag = &chemicalshifts[cs];
-      const unsigned aa_kind = myfrag->res_kind;
-      const unsigned at_kind = myfrag->atm_kind;
 
-      double shift = db.CONSTAAPREV(aa_kind,at_kind)[myfrag->res_type_prev] +
-                     db.CONSTAACURR(aa_kind,at_kind)[myfrag->res_type_curr] +
-                     db.CONSTAANEXT(aa_kind,at_kind)[myfrag->res_type_next];
+      double shift = myfrag->const_cs;
 
       const unsigned ipos = myfrag->ipos;
       cs_atoms[kdx+0] = ipos;
       unsigned atom_counter = 1;
 
       //BACKBONE (PREV CURR NEXT)
-      const double * CONST_BB2 = db.CONST_BB2(aa_kind,at_kind);
       const unsigned bbsize = 16;
-      for(unsigned q=0; q<bbsize; q++) {
-        const double cb2q = CONST_BB2[q];
-        if(cb2q==0.) continue;
+      for(unsigned k=0; k<myfrag->bb_q.size(); k++) {
+        const unsigned q = myfrag->bb_q[k];
+        const double cb2q = myfrag->bb_c[k];
         const unsigned jpos = myfrag->bb[q];
-        if(ipos==jpos) continue;
         const Vector distance = delta(getPosition(jpos),getPosition(ipos));
         const double d = distance.modulo();
         const double fact = cb2q/d;
@@ -1026,7 +1084,7 @@ void CS2Backbone::calculate()
       atom_counter += bbsize;
 
       //DIHEDRAL ANGLES
-      const double *CO_DA = db.CO_DA(aa_kind,at_kind);
+      const double *CO_DA = myfrag->co_da;
       //Phi
       {
         const Vector d0 = delta(getPosition(myfrag->bb[Nc]), getPosition(myfrag->bb[Cp]));
@@ -1035,7 +1093,7 @@ void CS2Backbone::calculate()
         Torsion t;
         Vector dd0, dd1, dd2;
         const double t_phi = t.compute(d0,d1,d2,dd0,dd1,dd2);
-        const double *PARS_DA = db.PARS_DA(aa_kind,at_kind,0);
+        const double *PARS_DA = myfrag->pars_da[0];
         const double val1 = 3.*t_phi+PARS_DA[3];
         const double val2 = t_phi+PARS_DA[4];
         shift += CO_DA[0]*(PARS_DA[0]*cos(val1)+PARS_DA[1]*cos(val2)+PARS_DA[2]);
@@ -1059,7 +1117,7 @@ void CS2Backbone::calculate()
         Torsion t;
         Vector dd0, dd1, dd2;
         const double t_psi = t.compute(d0,d1,d2,dd0,dd1,dd2);
-        const double *PARS_DA = db.PARS_DA(aa_kind,at_kind,1);
+        const double *PARS_DA = myfrag->pars_da[1];
         const double val1 = 3.*t_psi+PARS_DA[3];
         const double val2 = t_psi+PARS_DA[4];
         shift += CO_DA[1]*(PARS_DA[0]*cos(val1)+PARS_DA[1]*cos(val2)+PARS_DA[2]);
@@ -1083,7 +1141,7 @@ void CS2Backbone::calculate()
         Torsion t;
         Vector dd0, dd1, dd2;
         const double t_chi1 = t.compute(d0,d1,d2,dd0,dd1,dd2);
-        const double *PARS_DA = db.PARS_DA(aa_kind,at_kind,2);
+        const double *PARS_DA = myfrag->pars_da[2];
         const double val1 = 3.*t_chi1+PARS_DA[3];
         const double val2 = t_chi1+PARS_DA[4];
         shift += CO_DA[2]*(PARS_DA[0]*cos(val1)+PARS_DA[1]*cos(val2)+PARS_DA[2]);
@@ -1103,13 +1161,11 @@ void CS2Backbone::calculate()
       //END OF DIHE
 
       //SIDE CHAIN
-      const double * CONST_SC2 = db.CONST_SC2(aa_kind,at_kind,myfrag->res_type_curr);
       const unsigned sidsize = myfrag->side_chain.size();
-      for(unsigned q=0; q<sidsize; q++) {
-        const double cs2q = CONST_SC2[q];
-        if(cs2q==0.) continue;
+      for(unsigned k=0; k<myfrag->sc_q.size(); k++) {
+        const unsigned q = myfrag->sc_q[k];
+        const double cs2q = myfrag->sc_c[k];
         const unsigned jpos = myfrag->side_chain[q];
-        if(ipos==jpos) continue;
         const Vector distance = delta(getPosition(jpos),getPosition(ipos));
         const double d = distance.modulo();
         const double fact = cs2q/d;
@@ -1124,12 +1180,10 @@ void CS2Backbone::calculate()
       atom_counter += sidsize;
 
       //EXTRA DIST
-      const double * CONST_XD  = db.CONST_XD(aa_kind,at_kind);
       const unsigned xdsize=myfrag->xd1.size();
-      for(unsigned q=0; q<xdsize; q++) {
-        const double cxdq = CONST_XD[q];
-        if(cxdq==0.) continue;
-        if(myfrag->xd1[q]==-1||myfrag->xd2[q]==-1) continue;
+      for(unsigned k=0; k<myfrag->xd_q.size(); k++) {
+        const unsigned q = myfrag->xd_q[k];
+        const double cxdq = myfrag->xd_c[k];
         const Vector distance = delta(getPosition(myfrag->xd1[q]),getPosition(myfrag->xd2[q]));
         const double d = distance.modulo();
         const double fact = cxdq/d;
@@ -1145,7 +1199,7 @@ void CS2Backbone::calculate()
       atom_counter += 2*xdsize;
 
       //RINGS
-      const double *rc = db.CO_RING(aa_kind,at_kind);
+      const double *rc = myfrag->co_ring;
       const unsigned rsize = ringInfo.size();
       // cycle over the list of rings
       for(unsigned q=0; q<rsize; q++) {
@@ -1217,8 +1271,8 @@ void CS2Backbone::calculate()
       //END OF RINGS
 
       //NON BOND
-      const double * CONST_CO_SPHERE3 = db.CO_SPHERE(aa_kind,at_kind,0);
-      const double * CONST_CO_SPHERE  = db.CO_SPHERE(aa_kind,at_kind,1);
+      const double * CONST_CO_SPHERE3 = myfrag->co_sphere[0];
+      const double * CONST_CO_SPHERE  = myfrag->co_sphere[1];
       const unsigned boxsize = myfrag->box_nb.size();
       for(unsigned q=0; q<boxsize; q++) {
         const unsigned jpos = myfrag->box_nb[q];
@@ -1303,7 +1357,8 @@ void CS2Backbone::calculate()
   /* Metainference */
   if(getDoScore()) {
     score = getScore();
-    for(unsigned cs=rank; cs<chemicalshifts.size(); cs+=stride) {
+    for(unsigned ics=0; ics<my_cs.size(); ics++) {
+      const unsigned cs=my_cs[ics];
       const unsigned kdx=cs*max_cs_atoms;
       const double fact = getMetaDer(cs);
       for(unsigned i=0; i<chemicalshifts[cs].totcsatoms; i++) {
@@ -1314,7 +1369,8 @@ void CS2Backbone::calculate()
 
   /* camshift */
   if(camshift) {
-    for(unsigned cs=rank; cs<chemicalshifts.size(); cs+=stride) {
+    for(unsigned ics=0; ics<my_cs.size(); ics++) {
+      const unsigned cs=my_cs[ics];
       const unsigned kdx=cs*max_cs_atoms;
       score += (all_shifts[cs] - chemicalshifts[cs].exp_cs)*(all_shifts[cs] - chemicalshifts[cs].exp_cs)/camshift_sigma2[chemicalshifts[cs].atm_kind];
       double fact = 2.0*(all_shifts[cs] - chemicalshifts[cs].exp_cs)/camshift_sigma2[chemicalshifts[cs].atm_kind];
@@ -1354,27 +1410,82 @@ void CS2Backbone::calculate()
 }
 
 void CS2Backbone::update_neighb() {
+  // the atoms are sorted into cells as large as the cutoff so only the neighboring cells are searched
+  const unsigned natoms = getNumberOfAtoms();
+  Vector pmin = getPosition(0), pmax = getPosition(0);
+  for(unsigned i=1; i<natoms; i++) {
+    for(unsigned k=0; k<3; k++) {
+      pmin[k] = std::min(pmin[k], getPosition(i)[k]);
+      pmax[k] = std::max(pmax[k], getPosition(i)[k]);
+    }
+  }
+  unsigned ncells[3];
+  for(unsigned k=0; k<3; k++) ncells[k] = static_cast<unsigned>(floor((pmax[k]-pmin[k])/cutOffNB)) + 1;
+  vector<unsigned> acell(natoms), cell_start(ncells[0]*ncells[1]*ncells[2]+1, 0), cell_list(natoms);
+  for(unsigned i=0; i<natoms; i++) {
+    unsigned c[3];
+    for(unsigned k=0; k<3; k++) c[k] = std::min(ncells[k]-1, static_cast<unsigned>(floor((getPosition(i)[k]-pmin[k])/cutOffNB)));
+    acell[i] = (c[2]*ncells[1]+c[1])*ncells[0]+c[0];
+    cell_start[acell[i]+1]++;
+  }
+  for(unsigned c=0; c+1<cell_start.size(); c++) cell_start[c+1] += cell_start[c];
+  vector<unsigned> fill(cell_start.begin(), cell_start.end()-1);
+  for(unsigned i=0; i<natoms; i++) cell_list[fill[acell[i]]++] = i;
+
   // cycle over chemical shifts
   unsigned nt=OpenMP::getNumThreads();
-  #pragma omp parallel for num_threads(nt)
+  #pragma omp parallel for num_threads(nt) schedule(dynamic)
   for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
-    const unsigned boxsize = getNumberOfAtoms();
+    const unsigned ipos = chemicalshifts[cs].ipos;
     chemicalshifts[cs].box_nb.clear();
     chemicalshifts[cs].box_nb.reserve(150);
-    const unsigned res_curr = res_num[chemicalshifts[cs].ipos];
-    for(unsigned bat=0; bat<boxsize; bat++) {
-      const unsigned res_dist = abs(static_cast<int>(res_curr-res_num[bat]));
-      if(res_dist<2) continue;
-      const Vector distance = delta(getPosition(bat),getPosition(chemicalshifts[cs].ipos));
-      const double d2=distance.modulo2();
-      if(d2<cutOffNB2) chemicalshifts[cs].box_nb.push_back(bat);
+    const unsigned res_curr = res_num[ipos];
+    const unsigned c = acell[ipos];
+    const int cx = c%ncells[0], cy = (c/ncells[0])%ncells[1], cz = c/(ncells[0]*ncells[1]);
+    for(int nz=std::max(cz-1,0); nz<=std::min(cz+1,static_cast<int>(ncells[2])-1); nz++) {
+      for(int ny=std::max(cy-1,0); ny<=std::min(cy+1,static_cast<int>(ncells[1])-1); ny++) {
+        for(int nx=std::max(cx-1,0); nx<=std::min(cx+1,static_cast<int>(ncells[0])-1); nx++) {
+          const unsigned nc = (nz*ncells[1]+ny)*ncells[0]+nx;
+          for(unsigned k=cell_start[nc]; k<cell_start[nc+1]; k++) {
+            const unsigned bat = cell_list[k];
+            const unsigned res_dist = abs(static_cast<int>(res_curr-res_num[bat]));
+            if(res_dist<2) continue;
+            const Vector distance = delta(getPosition(bat),getPosition(ipos));
+            const double d2=distance.modulo2();
+            if(d2<cutOffNB2) chemicalshifts[cs].box_nb.push_back(bat);
+          }
+        }
+      }
     }
+    // keep the atoms in the same order as in the system
+    std::sort(chemicalshifts[cs].box_nb.begin(), chemicalshifts[cs].box_nb.end());
     chemicalshifts[cs].totcsatoms = chemicalshifts[cs].csatoms + chemicalshifts[cs].box_nb.size();
   }
   max_cs_atoms=0;
   for(unsigned cs=0; cs<chemicalshifts.size(); cs++) {
     if(chemicalshifts[cs].totcsatoms>max_cs_atoms) max_cs_atoms = chemicalshifts[cs].totcsatoms;
   }
+
+  // the cost of a chemical shift grows with the number of atoms it uses, so the chemical shifts are
+  // given one at a time, from the most to the least expensive, to the process with the smallest load
+  unsigned stride = comm.Get_size();
+  unsigned rank   = comm.Get_rank();
+  if(serial) {
+    stride = 1;
+    rank   = 0;
+  }
+  vector<pair<unsigned,unsigned> > cost(chemicalshifts.size());
+  for(unsigned cs=0; cs<chemicalshifts.size(); cs++) cost[cs] = make_pair(chemicalshifts[cs].totcsatoms, cs);
+  std::stable_sort(cost.begin(), cost.end(), [](const pair<unsigned,unsigned> & a, const pair<unsigned,unsigned> & b) { return a.first>b.first; });
+  vector<unsigned long> load(stride, 0);
+  my_cs_order.clear();
+  for(unsigned i=0; i<cost.size(); i++) {
+    const unsigned r = std::min_element(load.begin(), load.end()) - load.begin();
+    load[r] += cost[i].first;
+    if(r==rank) my_cs_order.push_back(cost[i].second);
+  }
+  my_cs = my_cs_order;
+  std::sort(my_cs.begin(), my_cs.end());
 }
 
 void CS2Backbone::compute_ring_parameters() {
@@ -167,6 +167,8 @@ Caliber::Caliber(const ActionOptions&ao):
     doregres_zero_=true;
     log.printf("  doing regression with zero intercept with stride: %d\n", nregres_zero_);
   }
+  // the force constant and the scaling are updated from the previous steps
+  setStateful(optsigmamean_stride_>0 || doregres_zero_);
 
 
   bool noensemble = false;
@@ -26,6 +26,7 @@
 #include "core/GenericMolInfo.h"
 #include "core/ActionSet.h"
 #include "tools/File.h"
+#include "tools/OpenMP.h"
 
 #include <string>
 #include <cmath>
@@ -79,6 +80,7 @@ parameters are listed in the file GMM_fit.dat. This file contains one line per G
 
 To accelerate the computation of the Bayesian score, one can:
 - use neighbor lists, specified by the keywords NL_CUTOFF and NL_STRIDE;
+- use a skin with the keyword NL_SKIN, so that the atoms that are close to each data GMM component are only searched for again once an atom has moved by more than the skin;
 - calculate the restraint every other step (or more).
 
 All the heavy atoms of the system are used to calculate the density map. This list can conveniently be provided
@@ -153,6 +155,27 @@ private:
   bool first_time_;
   bool no_aver_;
   vector<unsigned> nl_;
+// start of the block of the neighbor list that belongs to each data GMM component
+  vector<unsigned> nl_block_;
+// positions in the neighbor list of the pairs of each atom, which start at nl_atom_block_[im]
+  vector<unsigned> nl_atom_;
+  vector<unsigned> nl_atom_block_;
+// distance beyond which an atom has no overlap with each data GMM component
+  vector<double> nl_radius_;
+  double   nl_skin_;
+// grid of cells over the centers of the data GMM components. With PBC the cells divide the box and are wrapped periodically
+  double   grid_cutoff_;
+  Vector   grid_origin_;
+  double   grid_spacing_;
+  unsigned grid_n_[3];
+  bool     grid_periodic_;
+  Tensor   grid_box_;
+  vector<unsigned> grid_start_;
+  vector<unsigned> grid_list_;
+// atoms that are within the radius plus the skin of the data GMM components of this rank
+  vector<unsigned> cand_start_;
+  vector<unsigned> cand_list_;
+  vector<Vector>   cand_pos_;
 // parallel stuff
   unsigned size_;
   unsigned rank_;
@@ -234,6 +257,14 @@ private:
 // calculate exponent of overlap for neighbor list update
   double get_exp_overlap(const Vector &m_m, const Vector &d_m,
                          const VectorGeneric<6> &inv_cov_md);
+// build the grid over the data GMM components
+  void setup_grid();
+// build the periodic grid for the current box
+  void setup_periodic_grid();
+// sort the data GMM components by cell
+  void sort_grid(const vector<unsigned> & mycell);
+// find the atoms that are close to each data GMM component
+  void update_candidates();
 // update the neighbor list
   void update_neighbor_list();
 // calculate overlap
@@ -261,6 +292,7 @@ void EMMI::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","GMM_FILE","file with the parameters of the GMM components");
   keys.add("compulsory","NL_CUTOFF","The cutoff in overlap for the neighbor list");
   keys.add("compulsory","NL_STRIDE","The frequency with which we are updating the neighbor list");
+  keys.add("optional","NL_SKIN","The atoms that are within the overlap range of each data GMM component plus this skin are only searched for again when an atom has moved by more than the skin");
   keys.add("compulsory","SIGMA_MIN","minimum uncertainty");
   keys.add("compulsory","RESOLUTION", "Cryo-EM map resolution");
   keys.add("compulsory","NOISETYPE","functional form of the noise (GAUSS, OUTLIERS, MARGINAL)");
@@ -297,7 +329,7 @@ EMMI::EMMI(const ActionOptions&ao):
   PLUMED_COLVAR_INIT(ao),
   inv_sqrt2_(0.707106781186548),
   sqrt2_pi_(0.797884560802865),
-  first_time_(true), no_aver_(false), pbc_(true),
+  first_time_(true), no_aver_(false), nl_skin_(0.), grid_periodic_(false), pbc_(true),
   MCstride_(1), MCaccept_(0.), MCtrials_(0.),
   statusstride_(0), first_status_(true),
   nregres_(0), scale_(1.),
@@ -401,6 +433,8 @@ EMMI::EMMI(const ActionOptions&ao):
   if(nl_cutoff_<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
   parse("NL_STRIDE",nl_stride_);
   if(nl_stride_<=0) error("NL_STRIDE should be explicitly specified and positive");
+  parse("NL_SKIN",nl_skin_);
+  if(nl_skin_<0.0) error("NL_SKIN should be positive");
 
   // averaging or not
   parseFlag("NO_AVER",no_aver_);
@@ -439,6 +473,7 @@ EMMI::EMMI(const ActionOptions&ao):
   log.printf("  type of data noise : %s\n", noise.c_str());
   log.printf("  neighbor list cutoff : %lf\n", nl_cutoff_);
   log.printf("  neighbor list stride : %u\n",  nl_stride_);
+  if(nl_skin_>0.0) log.printf("  neighbor list skin : %lf\n", nl_skin_);
   log.printf("  minimum uncertainty : %f\n",sigma_min);
   log.printf("  scale factor : %lf\n",scale_);
   if(nregres_>0) {
@@ -539,9 +574,15 @@ EMMI::EMMI(const ActionOptions&ao):
   // read status file if restarting
   if(getRestart() && noise_!=2) read_status();
 
+  // sigma is sampled with Monte Carlo and the scale is updated every REGRESSION steps
+  if((noise_!=2 && dsigma>0) || nregres_>0) setStateful();
+
   // calculate auxiliary stuff
   calculate_useful_stuff(reso);
 
+  // grid used to find the atoms close to each data GMM component
+  setup_grid();
+
   // prepare data and derivative vectors
   ovmd_.resize(ovdd_.size());
   atom_der_.resize(GMM_m_type_.size());
@@ -1009,6 +1050,18 @@ void EMMI::calculate_useful_stuff(double reso)
   for(unsigned i=0; i<nexp_; ++i) {
     tab_exp_.push_back(exp(-static_cast<double>(i) * dexp_));
   }
+  // atoms are outside the tabulated range once md*inv_cov_md*md > 2*dpcutoff_+dexp_. The largest eigenvalue
+  // of the sum of the covariances is at most the variance of the widest atom type plus the Gershgorin bound
+  double s2max = 0.0;
+  for(unsigned i=0; i<GMM_m_s_.size(); ++i) s2max = std::max(s2max, 0.5 * GMM_m_s_[i] / pi / pi);
+  nl_radius_.resize(GMM_d_m_.size());
+  for(unsigned j=0; j<GMM_d_m_.size(); ++j) {
+    const VectorGeneric<6> & c = GMM_d_cov_[j];
+    double gersh = fabs(c[0]) + fabs(c[1]) + fabs(c[2]);
+    gersh = std::max(gersh, fabs(c[1]) + fabs(c[3]) + fabs(c[4]));
+    gersh = std::max(gersh, fabs(c[2]) + fabs(c[4]) + fabs(c[5]));
+    nl_radius_[j] = sqrt( (2.0*dpcutoff_+dexp_) * (s2max+gersh) );
+  }
 }
 
 // get prefactors
@@ -1095,25 +1148,196 @@ double EMMI::get_exp_overlap(const Vector &m_m, const Vector &d_m,
   return ov;
 }
 
+void EMMI::setup_grid()
+{
+  // the cells are at least as large as the largest radius plus the skin so only the neighboring cells are searched
+  double rmax = 0.0;
+  for(unsigned id=0; id<nl_radius_.size(); ++id) rmax = std::max(rmax, nl_radius_[id]);
+  grid_cutoff_ = rmax + nl_skin_;
+  grid_spacing_ = grid_cutoff_;
+  grid_periodic_ = false;
+  Vector dmin = GMM_d_m_[0], dmax = GMM_d_m_[0];
+  for(unsigned id=1; id<GMM_d_m_.size(); ++id) {
+    for(unsigned k=0; k<3; ++k) {
+      dmin[k] = std::min(dmin[k], GMM_d_m_[id][k]);
+      dmax[k] = std::max(dmax[k], GMM_d_m_[id][k]);
+    }
+  }
+  grid_origin_ = dmin;
+  // do not use many more cells than there are data GMM components
+  while(true) {
+    unsigned long ncells = 1;
+    for(unsigned k=0; k<3; ++k) {
+      grid_n_[k] = static_cast<unsigned>( floor((dmax[k]-dmin[k])/grid_spacing_) ) + 1;
+      ncells *= grid_n_[k];
+    }
+    if(ncells <= 2*GMM_d_m_.size()) break;
+    grid_spacing_ *= 1.25;
+  }
+  vector<unsigned> mycell(GMM_d_m_.size());
+  for(unsigned id=0; id<GMM_d_m_.size(); ++id) {
+    unsigned c[3];
+    for(unsigned k=0; k<3; ++k) c[k] = std::min(grid_n_[k]-1, static_cast<unsigned>( floor((GMM_d_m_[id][k]-dmin[k])/grid_spacing_) ));
+    mycell[id] = (c[2]*grid_n_[1]+c[1])*grid_n_[0]+c[0];
+  }
+  sort_grid(mycell);
+  log.printf("  grid of %u x %u x %u cells of size %lf for the data GMM components\n", grid_n_[0], grid_n_[1], grid_n_[2], grid_spacing_);
+  if(pbc_) log.printf("  with PBC the cells divide the box and are wrapped periodically\n");
+}
+
+void EMMI::setup_periodic_grid()
+{
+  // the box is divided along each lattice vector in slices that are at least as thick as the cells
+  grid_box_ = getBox();
+  grid_periodic_ = true;
+  Tensor reciprocal(transpose(getPbc().getInvBox()));
+  double width[3];
+  for(unsigned k=0; k<3; ++k) width[k] = 1.0/reciprocal.getRow(k).modulo();
+  double spacing = grid_cutoff_;
+  // do not use many more cells than there are data GMM components
+  while(true) {
+    unsigned long ncells = 1;
+    for(unsigned k=0; k<3; ++k) {
+      grid_n_[k] = std::max(1u, static_cast<unsigned>( floor(width[k]/spacing) ));
+      ncells *= grid_n_[k];
+    }
+    if(ncells <= 2*GMM_d_m_.size()) break;
+    spacing *= 1.25;
+  }
+  vector<unsigned> mycell(GMM_d_m_.size());
+  for(unsigned id=0; id<GMM_d_m_.size(); ++id) {
+    Vector s = getPbc().realToScaled(GMM_d_m_[id]);
+    unsigned c[3];
+    for(unsigned k=0; k<3; ++k) c[k] = std::min(grid_n_[k]-1, static_cast<unsigned>( floor((s[k]-floor(s[k]))*grid_n_[k]) ));
+    mycell[id] = (c[2]*grid_n_[1]+c[1])*grid_n_[0]+c[0];
+  }
+  sort_grid(mycell);
+}
+
+void EMMI::sort_grid(const vector<unsigned> & mycell)
+{
+  const unsigned ncells = grid_n_[0]*grid_n_[1]*grid_n_[2];
+  grid_start_.assign(ncells+1, 0);
+  for(unsigned id=0; id<mycell.size(); ++id) grid_start_[mycell[id]+1]++;
+  for(unsigned c=0; c<ncells; ++c) grid_start_[c+1] += grid_start_[c];
+  grid_list_.resize(mycell.size());
+  vector<unsigned> fill(grid_start_.begin(), grid_start_.end()-1);
+  for(unsigned id=0; id<mycell.size(); ++id) grid_list_[fill[mycell[id]]++] = id;
+}
+
+void EMMI::update_candidates()
+{
+  const unsigned GMM_m_size = GMM_m_type_.size();
+  const unsigned nmy = (static_cast<unsigned>(GMM_d_m_.size())+size_-1-rank_)/size_;
+  // with PBC the grid is built again whenever the box has changed
+  const bool periodic = pbc_ && getPbc().isSet();
+  bool new_grid = false;
+  if(periodic) {
+    const Tensor & box = getBox();
+    new_grid = !grid_periodic_;
+    for(unsigned i=0; i<3; ++i) for(unsigned j=0; j<3; ++j) if(box(i,j)!=grid_box_(i,j)) new_grid = true;
+    if(new_grid) setup_periodic_grid();
+  } else if(grid_periodic_) {
+    setup_grid();
+    new_grid = true;
+  }
+  // the data GMM components do not move so the list is valid until an atom has moved by more than the skin
+  if(nl_skin_>0.0 && !new_grid && cand_pos_.size()==GMM_m_size) {
+    double dmax = 0.0;
+    for(unsigned im=0; im<GMM_m_size; ++im) {
+      Vector d;
+      if(pbc_) d = pbcDistance(cand_pos_[im], getPosition(im));
+      else     d = delta(cand_pos_[im], getPosition(im));
+      dmax = std::max(dmax, modulo2(d));
+    }
+    if(dmax < nl_skin_*nl_skin_) return;
+  }
+  cand_pos_.resize(GMM_m_size);
+  for(unsigned im=0; im<GMM_m_size; ++im) cand_pos_[im] = getPosition(im);
+
+  // each thread looks at a contiguous block of atoms so the atoms are found in ascending order
+  const unsigned nt = OpenMP::getNumThreads();
+  vector<vector<pair<unsigned,unsigned> > > found(nt);
+  #pragma omp parallel num_threads(nt)
+  {
+    vector<pair<unsigned,unsigned> > & myfound = found[OpenMP::getThreadNum()];
+    #pragma omp for schedule(static)
+    for(unsigned im=0; im<GMM_m_size; ++im) {
+      const Vector & pos = getPosition(im);
+      // cells to search along each direction. With PBC they are wrapped, and all the cells
+      // are searched when there are fewer than three so that none is searched twice
+      unsigned cells[3][3], ncell[3];
+      bool outside = false;
+      if(periodic) {
+        Vector s = getPbc().realToScaled(pos);
+        for(unsigned k=0; k<3; ++k) {
+          const int n = grid_n_[k];
+          if(n<3) {
+            ncell[k] = n;
+            for(int i=0; i<n; ++i) cells[k][i] = i;
+          } else {
+            const int c = std::min(n-1, static_cast<int>( floor((s[k]-floor(s[k]))*n) ));
+            ncell[k] = 3;
+            for(int i=0; i<3; ++i) cells[k][i] = (c+i-1+n)%n;
+          }
+        }
+      } else {
+        for(unsigned k=0; k<3; ++k) {
+          const int c = static_cast<int>( floor((pos[k]-grid_origin_[k])/grid_spacing_) );
+          const int lo = std::max(c-1, 0);
+          const int hi = std::min(c+1, static_cast<int>(grid_n_[k])-1);
+          if(lo>hi) outside = true;
+          ncell[k] = 0;
+          for(int i=lo; i<=hi; ++i) cells[k][ncell[k]++] = i;
+        }
+      }
+      if(outside) continue;
+      for(unsigned iz=0; iz<ncell[2]; ++iz) for(unsigned iy=0; iy<ncell[1]; ++iy) for(unsigned ix=0; ix<ncell[0]; ++ix) {
+            const unsigned c = (cells[2][iz]*grid_n_[1]+cells[1][iy])*grid_n_[0]+cells[0][ix];
+            for(unsigned k=grid_start_[c]; k<grid_start_[c+1]; ++k) {
+              const unsigned id = grid_list_[k];
+              if(id%size_!=rank_) continue;
+              const double r = nl_radius_[id] + nl_skin_;
+              Vector d;
+              if(pbc_) d = pbcDistance(GMM_d_m_[id], pos);
+              else     d = delta(GMM_d_m_[id], pos);
+              if(modulo2(d) < r*r) myfound.push_back(make_pair(id/size_, im));
+            }
+          }
+    }
+  }
+  // sort the atoms by data GMM component
+  cand_start_.assign(nmy+1, 0);
+  for(unsigned t=0; t<nt; ++t) for(unsigned k=0; k<found[t].size(); ++k) cand_start_[found[t][k].first+1]++;
+  for(unsigned n=0; n<nmy; ++n) cand_start_[n+1] += cand_start_[n];
+  cand_list_.resize(cand_start_[nmy]);
+  vector<unsigned> fill(cand_start_.begin(), cand_start_.end()-1);
+  for(unsigned t=0; t<nt; ++t) for(unsigned k=0; k<found[t].size(); ++k) cand_list_[fill[found[t][k].first]++] = found[t][k].second;
+}
+
 void EMMI::update_neighbor_list()
 {
   // dimension of GMM and atom vectors
   unsigned GMM_d_size = GMM_d_m_.size();
   unsigned GMM_m_size = GMM_m_type_.size();
-  // local neighbor list
-  vector < unsigned > nl_l;
-  // clear old neighbor list
-  nl_.clear();
+  // atoms that can overlap with the GMM components of this rank
+  update_candidates();
+  const unsigned nmy = (GMM_d_size+size_-1-rank_)/size_;
+  // neighbor list of each GMM component
+  vector< vector<unsigned> > nl_id(nmy);
 
   // cycle on GMM components - in parallel
-  for(unsigned id=rank_; id<GMM_d_size; id+=size_) {
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic)
+  for(unsigned n=0; n<nmy; ++n) {
+    unsigned id = rank_ + n*size_;
     // overlap lists and map
     vector<double> ov_l;
     map<double, unsigned> ov_m;
     // total overlap with id
     double ov_tot = 0.0;
-    // cycle on all atoms
-    for(unsigned im=0; im<GMM_m_size; ++im) {
+    // cycle on the atoms that are close enough
+    for(unsigned k=cand_start_[n]; k<cand_start_[n+1]; ++k) {
+      unsigned im = cand_list_[k];
       // get index in auxiliary lists
       unsigned kaux = GMM_m_type_[im] * GMM_d_size + id;
       // calculate exponent of overlap
@@ -1147,9 +1371,12 @@ void EMMI::update_neighbor_list()
     }
     // now add atoms to neighborlist
     for(map<double, unsigned>::iterator it=ov_m.begin(); it!=ov_m.end(); ++it)
-      nl_l.push_back(id*GMM_m_size+it->second);
+      nl_id[n].push_back(id*GMM_m_size+it->second);
     // end cycle on GMM components in parallel
   }
+  // local neighbor list
+  vector < unsigned > nl_l;
+  for(unsigned n=0; n<nmy; ++n) nl_l.insert(nl_l.end(), nl_id[n].begin(), nl_id[n].end());
   // find total dimension of neighborlist
   vector <int> recvcounts(size_, 0);
   recvcounts[rank_] = nl_l.size();
@@ -1167,6 +1394,19 @@ void EMMI::update_neighbor_list()
   }
   // Allgather neighbor list
   comm.Allgatherv(&nl_l[0], recvcounts[rank_], &nl_[0], &recvcounts[0], &disp[0]);
+  // find where the block of each GMM component starts
+  nl_block_.clear();
+  for(unsigned i=0; i<nl_.size(); ++i) {
+    if(i==0 || nl_[i]/GMM_m_size!=nl_[i-1]/GMM_m_size) nl_block_.push_back(i);
+  }
+  nl_block_.push_back(nl_.size());
+  // sort the pairs by atom, so that the derivatives of each atom are accumulated by a single thread
+  nl_atom_block_.assign(GMM_m_size+1, 0);
+  for(unsigned i=0; i<nl_.size(); ++i) nl_atom_block_[nl_[i]%GMM_m_size+1]++;
+  for(unsigned im=0; im<GMM_m_size; ++im) nl_atom_block_[im+1] += nl_atom_block_[im];
+  nl_atom_.resize(nl_.size());
+  vector<unsigned> next(nl_atom_block_.begin(), nl_atom_block_.end()-1);
+  for(unsigned i=0; i<nl_.size(); ++i) nl_atom_[next[nl_[i]%GMM_m_size]++] = i;
   // now resize derivatives
   ovmd_der_.resize(tot_size);
 }
@@ -1189,17 +1429,22 @@ void EMMI::calculate_overlap() {
   for(unsigned i=0; i<ovmd_der_.size(); ++i) ovmd_der_[i] = Vector(0,0,0);
 
   // we have to cycle over all model and data GMM components in the neighbor list
+  // each data GMM component is dealt with by a single process and thread
   unsigned GMM_d_size = GMM_d_m_.size();
   unsigned GMM_m_size = GMM_m_type_.size();
-  for(unsigned i=rank_; i<nl_.size(); i=i+size_) {
-    // get data (id) and atom (im) indexes
-    unsigned id = nl_[i] / GMM_m_size;
-    unsigned im = nl_[i] % GMM_m_size;
-    // get index in auxiliary lists
-    unsigned kaux = GMM_m_type_[im] * GMM_d_size + id;
-    // add overlap with im component of model GMM
-    ovmd_[id] += get_overlap(GMM_d_m_[id], getPosition(im), pre_fact_[kaux],
-                             inv_cov_md_[kaux], ovmd_der_[i]);
+  unsigned nblocks = nl_block_.size()-1;
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads()) schedule(dynamic)
+  for(unsigned b=rank_; b<nblocks; b=b+size_) {
+    for(unsigned i=nl_block_[b]; i<nl_block_[b+1]; ++i) {
+      // get data (id) and atom (im) indexes
+      unsigned id = nl_[i] / GMM_m_size;
+      unsigned im = nl_[i] % GMM_m_size;
+      // get index in auxiliary lists
+      unsigned kaux = GMM_m_type_[im] * GMM_d_size + id;
+      // add overlap with im component of model GMM
+      ovmd_[id] += get_overlap(GMM_d_m_[id], getPosition(im), pre_fact_[kaux],
+                               inv_cov_md_[kaux], ovmd_der_[i]);
+    }
   }
   // communicate stuff
   if(size_>1) {
@@ -1385,22 +1630,34 @@ void EMMI::calculate()
     }
   }
 
-  // clean temporary vector
-  for(unsigned i=0; i<atom_der_.size(); ++i) atom_der_[i] = Vector(0,0,0);
-
-  // get derivatives of bias with respect to atoms
-  for(unsigned i=rank_; i<nl_.size(); i=i+size_) {
-    // get indexes of data and model component
-    unsigned id = nl_[i] / GMM_m_type_.size();
-    unsigned im = nl_[i] % GMM_m_type_.size();
-    // chain rule + replica normalization
-    Vector tot_der = GMMid_der_[id] * ovmd_der_[i] * escale * scale_ / anneal_;
-    Vector pos;
-    if(pbc_) pos = pbcDistance(GMM_d_m_[id], getPosition(im)) + GMM_d_m_[id];
-    else     pos = getPosition(im);
-    // increment derivatives and virial
-    atom_der_[im] += tot_der;
-    virial_ += Tensor(pos, -tot_der);
+  // get derivatives of bias with respect to atoms.
+  // Each atom belongs to a single thread, which goes through the pairs of the neighbor list of that atom
+  // that are dealt with by this process
+  const unsigned GMM_m_size = GMM_m_type_.size();
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    Tensor omp_virial;
+    #pragma omp for nowait
+    for(unsigned im=0; im<GMM_m_size; ++im) {
+      Vector der;
+      for(unsigned k=nl_atom_block_[im]; k<nl_atom_block_[im+1]; ++k) {
+        unsigned i = nl_atom_[k];
+        if(i%size_!=rank_) continue;
+        // get index of data component
+        unsigned id = nl_[i] / GMM_m_size;
+        // chain rule + replica normalization
+        Vector tot_der = GMMid_der_[id] * ovmd_der_[i] * escale * scale_ / anneal_;
+        Vector pos;
+        if(pbc_) pos = pbcDistance(GMM_d_m_[id], getPosition(im)) + GMM_d_m_[id];
+        else     pos = getPosition(im);
+        // increment derivatives and virial
+        der += tot_der;
+        omp_virial += Tensor(pos, -tot_der);
+      }
+      atom_der_[im] = der;
+    }
+    #pragma omp critical
+    virial_ += omp_virial;
   }
 
   // communicate local derivatives and virial
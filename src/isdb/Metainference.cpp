@@ -28,6 +28,7 @@
 #include "tools/File.h"
 #include "tools/OpenMP.h"
 #include "tools/Random.h"
+#include "tools/CheckpointData.h"
 #include <cmath>
 #include <chrono>
 #include <numeric>
@@ -281,6 +282,8 @@ public:
   ~Metainference();
   void calculate() override;
   void update() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords(Keywords& keys);
 };
 
@@ -603,6 +606,7 @@ Metainference::Metainference(const ActionOptions&ao):
   if(kbt_==0.0) error("Unless the MD engine passes the temperature to plumed, you must specify it using TEMP");
 
   checkRead();
+  setStateful();
 
   // set sigma_bias
   if(noise_type_==MGAUSS||noise_type_==MOUTLIERS||noise_type_==GENERIC) {
@@ -636,7 +640,7 @@ Metainference::Metainference(const ActionOptions&ao):
 
   IFile restart_sfile;
   restart_sfile.link(*this);
-  if(getRestart()&&restart_sfile.FileExist(status_file_name_)) {
+  if(getRestart()&&!getRestartFromCheckpoint()&&restart_sfile.FileExist(status_file_name_)) {
     firstTime = false;
     for(unsigned i=0; i<nsel; i++) firstTimeW[i] = false;
     restart_sfile.open(status_file_name_);
@@ -1738,6 +1742,54 @@ void Metainference::calculate()
   setBias(ene);
 }
 
+void Metainference::writeCheckpoint(CheckpointData&cp)
+{
+  cp.write(sigma_);
+  cp.write(sigma_max_);
+  cp.write(Dsigma_);
+  cp.write(sigma_mean2_);
+  cp.write(sigma_mean2_last_);
+  cp.write(ftilde_);
+  cp.write(scale_);
+  cp.write(offset_);
+  for(const auto & r : random) r.writeCheckpoint(cp);
+  cp.write(MCaccept_);
+  cp.write(MCacceptScale_);
+  cp.write(MCacceptFT_);
+  cp.write(MCtrial_);
+  cp.write(firstTime);
+  cp.write(std::vector<char>(firstTimeW.begin(),firstTimeW.end()));
+  cp.write(optimized_step_);
+  cp.write(sigmamax_opt_done_);
+  cp.write(sigma_max_est_);
+  cp.write(average_weights_);
+}
+
+void Metainference::readCheckpoint(CheckpointData&cp)
+{
+  cp.read(sigma_);
+  cp.read(sigma_max_);
+  cp.read(Dsigma_);
+  cp.read(sigma_mean2_);
+  cp.read(sigma_mean2_last_);
+  cp.read(ftilde_);
+  cp.read(scale_);
+  cp.read(offset_);
+  for(auto & r : random) r.readCheckpoint(cp);
+  cp.read(MCaccept_);
+  cp.read(MCacceptScale_);
+  cp.read(MCacceptFT_);
+  cp.read(MCtrial_);
+  cp.read(firstTime);
+  std::vector<char> firstTimeW_tmp;
+  cp.read(firstTimeW_tmp);
+  firstTimeW.assign(firstTimeW_tmp.begin(),firstTimeW_tmp.end());
+  cp.read(optimized_step_);
+  cp.read(sigmamax_opt_done_);
+  cp.read(sigma_max_est_);
+  cp.read(average_weights_);
+}
+
 void Metainference::writeStatus()
 {
   sfile_.rewind();
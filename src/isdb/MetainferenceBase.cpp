@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "MetainferenceBase.h"
 #include "tools/File.h"
+#include "tools/CheckpointData.h"
 #include <cmath>
 #include <chrono>
 #include <numeric>
@@ -45,6 +46,7 @@ void MetainferenceBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NOENSEMBLE",false,"don't perform any replica-averaging");
   keys.addFlag("REWEIGHT",false,"simple REWEIGHT using the ARG as energy");
   keys.add("optional","AVERAGING", "Stride for calculation of averaged weights and sigma_mean");
+  keys.add("optional","REPLICA_LAG","average the data of the other replicas from this number of steps before, so that the communication between replicas overlaps with the following steps");
   keys.add("compulsory","NOISETYPE","MGAUSS","functional form of the noise (GAUSS,MGAUSS,OUTLIERS,MOUTLIERS,GENERIC)");
   keys.add("compulsory","LIKELIHOOD","GAUSS","the likelihood for the GENERIC metainference model, GAUSS or LOGN");
   keys.add("compulsory","DFTILDE","0.1","fraction of sigma_mean used to evolve ftilde");
@@ -128,7 +130,9 @@ MetainferenceBase::MetainferenceBase(const ActionOptions&ao):
   N_optimized_step_(0),
   optimized_step_(0),
   sigmamax_opt_done_(false),
-  decay_w_(1.)
+  decay_w_(1.),
+  replica_lag_(0),
+  lag_count_(0)
 {
   parseFlag("DOSCORE", doscore_);
 
@@ -164,6 +168,10 @@ MetainferenceBase::MetainferenceBase(const ActionOptions&ao):
   if(!getRestart()) average_weights_.resize(nsel_, vector<double> (nrep_, 1./static_cast<double>(nrep_)));
   else average_weights_.resize(nsel_, vector<double> (nrep_, 0.));
 
+  parse("REPLICA_LAG", replica_lag_);
+  if(replica_lag_>0&&do_reweight_) error("REPLICA_LAG cannot be used together with REWEIGHT");
+  if(nrep_<2) replica_lag_=0;
+
   unsigned averaging=0;
   parse("AVERAGING", averaging);
   if(averaging>0) {
@@ -366,11 +374,15 @@ MetainferenceBase::MetainferenceBase(const ActionOptions&ao):
     sfile_.open(status_file_name_);
   }
 
+  // the Monte Carlo sampling and the lagged replica average keep a state between steps
+  setStateful(doscore_ || replica_lag_>0);
 }
 
 MetainferenceBase::~MetainferenceBase()
 {
   if(sfile_.isOpen()) sfile_.close();
+  // complete the reductions that are still in flight
+  for(unsigned k=0; k<lag_request_.size(); ++k) lag_request_[k].wait();
 }
 
 void MetainferenceBase::Initialise(const unsigned input)
@@ -432,7 +444,7 @@ void MetainferenceBase::Initialise(const unsigned input)
 
   IFile restart_sfile;
   restart_sfile.link(*this);
-  if(getRestart()&&restart_sfile.FileExist(status_file_name_)) {
+  if(getRestart()&&!getRestartFromCheckpoint()&&restart_sfile.FileExist(status_file_name_)) {
     firstTime = false;
     for(unsigned i=0; i<nsel_; i++) firstTimeW[i] = false;
     restart_sfile.open(status_file_name_);
@@ -650,6 +662,7 @@ void MetainferenceBase::Initialise(const unsigned input)
 
   log.printf("  number of experimental data points %u\n",narg);
   log.printf("  number of replicas %u\n",nrep_);
+  if(replica_lag_>0) log.printf("  the data of the other replicas are averaged with a lag of %u steps\n",replica_lag_);
   log.printf("  initial data uncertainties");
   for(unsigned i=0; i<sigma_.size(); ++i) log.printf(" %f", sigma_[i]);
   log.printf("\n");
@@ -1349,6 +1362,14 @@ void MetainferenceBase::get_sigma_mean(const double fact, const double var_fact,
       }
       comm.Sum(&sigma_mean2_now[0], narg);
       for(unsigned i=0; i<narg; ++i) sigma_mean2_now[i] = dnrep/(dnrep-1.)*(sigma_mean2_now[i] + mean[i]*mean[i]*var_fact);
+    } else if(replica_lag_>0) {
+      // the sum over the replicas of the squared deviations from the mean is obtained
+      // from the sums of the data and of their squares that are used for the mean
+      if(master) {
+        for(unsigned i=0; i<narg; ++i) sigma_mean2_now[i] = fact*std::max(lag_sum2_[i]-dnrep*mean[i]*mean[i],0.);
+      }
+      comm.Sum(&sigma_mean2_now[0], narg);
+      for(unsigned i=0; i<narg; ++i) sigma_mean2_now[i] /= dnrep;
     } else {
       if(master) {
         for(unsigned i=0; i<narg; ++i) {
@@ -1422,11 +1443,52 @@ void MetainferenceBase::get_sigma_mean(const double fact, const double var_fact,
   sigma_mean2_ = sigma_mean2_tmp;
 }
 
+void MetainferenceBase::replica_averaging_lagged(const double fact, vector<double> &mean)
+{
+  if(lag_sum_.size()==0) {
+    lag_sum_.resize(replica_lag_, vector<double>(2*narg));
+    lag_own_.resize(replica_lag_, vector<double>(2*narg));
+    lag_request_.resize(replica_lag_);
+    lag_sum2_.resize(narg);
+  }
+  const unsigned k = lag_count_%replica_lag_;
+  // the data of this replica and their squares
+  vector<double> own(2*narg);
+  for(unsigned i=0; i<narg; ++i) {
+    own[i]      = calc_data_[i];
+    own[narg+i] = calc_data_[i]*calc_data_[i];
+  }
+  // the contribution of the other replicas, which is exact for the first steps
+  vector<double> others(2*narg);
+  if(lag_count_<replica_lag_) {
+    others = own;
+    multi_sim_comm.Sum(&others[0], 2*narg);
+    for(unsigned i=0; i<2*narg; ++i) others[i] -= own[i];
+  } else {
+    lag_request_[k].wait();
+    for(unsigned i=0; i<2*narg; ++i) others[i] = lag_sum_[k][i]-lag_own_[k][i];
+  }
+  // start the reduction that will be used replica_lag_ steps from now
+  lag_own_[k] = own;
+  lag_sum_[k] = own;
+  lag_request_[k] = multi_sim_comm.Isum(&lag_sum_[k][0], 2*narg);
+  lag_count_++;
+
+  for(unsigned i=0; i<narg; ++i) {
+    mean[i]      = fact*(own[i]+others[i]);
+    lag_sum2_[i] = own[narg+i]+others[narg+i];
+  }
+}
+
 void MetainferenceBase::replica_averaging(const double fact, vector<double> &mean, vector<double> &dmean_b)
 {
   if(master) {
-    for(unsigned i=0; i<narg; ++i) mean[i] = fact*calc_data_[i];
-    if(nrep_>1) multi_sim_comm.Sum(&mean[0], narg);
+    if(replica_lag_>0) {
+      replica_averaging_lagged(fact, mean);
+    } else {
+      for(unsigned i=0; i<narg; ++i) mean[i] = fact*calc_data_[i];
+      if(nrep_>1) multi_sim_comm.Sum(&mean[0], narg);
+    }
   }
   comm.Sum(&mean[0], narg);
   // set the derivative of the mean with respect to the bias
@@ -1500,6 +1562,68 @@ double MetainferenceBase::getScore()
   return ene;
 }
 
+void MetainferenceBase::writeCheckpoint(CheckpointData&cp)
+{
+  if(!isStateful()) return;
+  cp.write(sigma_);
+  cp.write(sigma_max_);
+  cp.write(Dsigma_);
+  cp.write(sigma_mean2_);
+  cp.write(sigma_mean2_last_);
+  cp.write(ftilde_);
+  cp.write(scale_);
+  cp.write(offset_);
+  for(const auto & r : random) r.writeCheckpoint(cp);
+  cp.write(MCaccept_);
+  cp.write(MCacceptScale_);
+  cp.write(MCacceptFT_);
+  cp.write(MCtrial_);
+  cp.write(firstTime);
+  cp.write(std::vector<char>(firstTimeW.begin(),firstTimeW.end()));
+  cp.write(optimized_step_);
+  cp.write(sigmamax_opt_done_);
+  cp.write(sigma_max_est_);
+  cp.write(average_weights_);
+  // the reductions in flight are completed, so that the lagged sums can be saved
+  for(unsigned k=0; k<lag_request_.size(); ++k) lag_request_[k].wait();
+  cp.write(lag_count_);
+  cp.write(lag_sum_);
+  cp.write(lag_own_);
+  cp.write(lag_sum2_);
+}
+
+void MetainferenceBase::readCheckpoint(CheckpointData&cp)
+{
+  if(!isStateful()) return;
+  cp.read(sigma_);
+  cp.read(sigma_max_);
+  cp.read(Dsigma_);
+  cp.read(sigma_mean2_);
+  cp.read(sigma_mean2_last_);
+  cp.read(ftilde_);
+  cp.read(scale_);
+  cp.read(offset_);
+  for(auto & r : random) r.readCheckpoint(cp);
+  cp.read(MCaccept_);
+  cp.read(MCacceptScale_);
+  cp.read(MCacceptFT_);
+  cp.read(MCtrial_);
+  cp.read(firstTime);
+  std::vector<char> firstTimeW_tmp;
+  cp.read(firstTimeW_tmp);
+  firstTimeW.assign(firstTimeW_tmp.begin(),firstTimeW_tmp.end());
+  cp.read(optimized_step_);
+  cp.read(sigmamax_opt_done_);
+  cp.read(sigma_max_est_);
+  cp.read(average_weights_);
+  cp.read(lag_count_);
+  cp.read(lag_sum_);
+  cp.read(lag_own_);
+  cp.read(lag_sum2_);
+  // the saved sums are complete, so there is nothing to wait for
+  lag_request_.assign(lag_sum_.size(),Communicator::Request());
+}
+
 void MetainferenceBase::writeStatus()
 {
   if(!doscore_) return;
@@ -151,6 +151,15 @@ private:
   double decay_w_;
   std::vector< std::vector <double> >  average_weights_;
 
+  // lagged replica averaging: the sums over the replicas are started with a nonblocking
+  // reduction and used replica_lag_ calls later, together with the local data of this replica
+  unsigned replica_lag_;
+  unsigned lag_count_;
+  std::vector<std::vector<double> > lag_sum_;
+  std::vector<std::vector<double> > lag_own_;
+  std::vector<Communicator::Request> lag_request_;
+  std::vector<double> lag_sum2_;
+
   double getEnergyMIGEN(const std::vector<double> &mean, const std::vector<double> &ftilde, const std::vector<double> &sigma,
                         const double scale, const double offset);
   double getEnergySP(const std::vector<double> &mean, const std::vector<double> &sigma,
@@ -170,6 +179,7 @@ private:
   double getCalcData(const unsigned index);
   void get_weights(double &fact, double &var_fact);
   void replica_averaging(const double fact, std::vector<double> &mean, std::vector<double> &dmean_b);
+  void replica_averaging_lagged(const double fact, std::vector<double> &mean);
   void get_sigma_mean(const double fact, const double var_fact, const std::vector<double> &mean);
   void do_regression_zero(const std::vector<double> &mean);
   void moveTilde(const std::vector<double> &mean_, double old_energy);
@@ -197,6 +207,8 @@ public:
   void setDerivatives();
   double getMetaDer(const unsigned index);
   void writeStatus();
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   void turnOnDerivatives() override;
   unsigned getNumberOfDerivatives() override;
   void lockRequests() override;
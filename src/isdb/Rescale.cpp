@@ -273,6 +273,7 @@ Rescale::Rescale(const ActionOptions&ao):
   else kbt_=plumed.getAtoms().getKbT();
 
   checkRead();
+  setStateful();
 
   log.printf("  temperature of the system in energy unit %f\n",kbt_);
   log.printf("  name of the SELECTOR use for this action %s\n",selector_.c_str());
@@ -63,6 +63,11 @@ The calculated intensities can be scaled using the SCALEINT keywords. This is ap
 Experimental reference intensities can be added using the EXPINT keywords.
 By default SAXS is calculated using Debye on CPU, by adding the GPU flag it is possible to solve the equation on a GPU
 if the ARRAYFIRE libraries are installed and correctly linked.
+For large systems with the ATOMISTIC or MARTINI flags the HISTOGRAM_BIN keyword can be used to approximate the Debye equation
+using histograms of the distances between each pair of atom types. The exact intensities are still calculated every HISTOGRAM_STRIDE
+steps and the relative error of the approximation is written in the log. If this error is larger than HISTOGRAM_TOL the width of
+the bins is reduced to the one that should give an error of HISTOGRAM_TOL, since the error of the linear interpolation between
+the edges of the bins is proportional to the square of their width.
 \ref METAINFERENCE can be activated using DOSCORE and the other relevant keywords.
 
 \par Examples
@@ -126,12 +131,33 @@ private:
   int                        deviceid;
   vector<unsigned>           atoi;
   vector<double>             q_list;
+  bool                       q_evenly_spaced;
   vector<double>             FF_rank;
   vector<vector<double> >    FF_value;
   vector<vector<float> >     FFf_value;
+/// The pairs of tiles of atoms that are divided between processes and threads. They are grouped in rounds
+/// in which every tile appears at most once, and tile_round holds where each round starts
+  static const unsigned      tsize=32;
+  vector<unsigned>           tile_i, tile_j;
+  vector<unsigned>           tile_round;
+/// Width of the bins for the histograms of distances (zero if the exact sum is used)
+  double                     hist_bin;
+  unsigned                   hist_stride;
+  double                     hist_tol;
+/// The atom types that are present, the index of each atom in this list and the index of each pair of types
+  vector<unsigned>           hist_atoi;
+  vector<unsigned>           hist_type;
+  vector<unsigned>           hist_pair;
+/// sin(qr)/qr on the edges of the first hist_nbins bins, and cos(qr)-sin(qr)/qr multiplied by twice the
+/// structure factor of each atom type
+  unsigned                   hist_nbins;
+  vector<double>             hist_sinc;
+  vector<double>             hist_dcos;
 
   void calculate_gpu(vector<Vector> &deriv);
-  void calculate_cpu(vector<Vector> &deriv);
+  void calculate_cpu(vector<Vector> &deriv, vector<double> &sum);
+  void calculate_histogram(vector<Vector> &deriv, vector<double> &sum, const bool do_deriv);
+  void checkHistogram(const vector<double> &sum);
   void getMartiniSFparam(const vector<AtomNumber> &atoms, vector<vector<long double> > &parameter);
   double calculateASF(const vector<AtomNumber> &atoms, vector<vector<long double> > &FF_tmp, const double rho);
 
@@ -158,6 +184,9 @@ void SAXS::registerKeywords(Keywords& keys) {
   keys.add("numbered","PARAMETERS","Used parameter Keywords like PARAMETERS1, PARAMETERS2. These are used to calculate the structure factor for the \\f$i\\f$th atom/bead.");
   keys.add("compulsory","WATERDENS","0.334","Density of the water to be used for the correction of atomistic structure factors.");
   keys.add("numbered","EXPINT","Add an experimental value for each q value.");
+  keys.add("optional","HISTOGRAM_BIN","use the binned Debye approximation with histograms of the distances between each pair of atom types that have bins of this width (in nm)");
+  keys.add("compulsory","HISTOGRAM_STRIDE","100","with HISTOGRAM_BIN the exact intensities are calculated every this many steps and used to check the approximation");
+  keys.add("compulsory","HISTOGRAM_TOL","0.001","with HISTOGRAM_BIN the width of the bins is reduced whenever the largest relative error on the intensities is larger than this, so that the error becomes about this");
   keys.add("compulsory","SCALEINT","1.0","SCALING value of the calculated data. Useful to simplify the comparison.");
   keys.addOutputComponent("q","default","the # SAXS of q");
   keys.addOutputComponent("exp","EXPINT","the # experimental intensity");
@@ -168,7 +197,11 @@ SAXS::SAXS(const ActionOptions&ao):
   pbc(true),
   serial(false),
   gpu(false),
-  deviceid(0)
+  deviceid(0),
+  hist_bin(0.),
+  hist_stride(100),
+  hist_tol(0.001),
+  hist_nbins(0)
 {
   vector<AtomNumber> atoms;
   parseAtomList("ATOMS",atoms);
@@ -218,6 +251,17 @@ SAXS::SAXS(const ActionOptions&ao):
 
   if(martini&&atomistic) error("You cannot use MARTINI and ATOMISTIC at the same time");
 
+  parse("HISTOGRAM_BIN",hist_bin);
+  parse("HISTOGRAM_STRIDE",hist_stride);
+  parse("HISTOGRAM_TOL",hist_tol);
+  if(hist_bin>0.) {
+    if(gpu) error("HISTOGRAM_BIN cannot be used with GPU");
+    if(!atomistic&&!martini) error("HISTOGRAM_BIN can only be used with ATOMISTIC or MARTINI");
+    if(hist_stride==0) error("HISTOGRAM_STRIDE must be larger than zero");
+    log.printf("  using histograms of the distances with bins of width %f nm\n",hist_bin);
+    log.printf("  the exact intensities are calculated every %u steps and the bins are made narrower when the relative error is larger than %f\n",hist_stride,hist_tol);
+  }
+
   double rho = 0.334;
   parse("WATERDENS", rho);
 
@@ -294,6 +338,39 @@ SAXS::SAXS(const ActionOptions&ao):
       for(unsigned i=0; i<n_atom_types; i++) FF_value[i][k] = static_cast<double>(FF_tmp[k][i])/sqrt(scale_int);
       for(unsigned i=0; i<size; i++) FF_rank[k] += FF_value[atoi[i]][k]*FF_value[atoi[i]][k];
     }
+    // The pairs of different tiles are scheduled as a round-robin tournament, so that the threads working on the
+    // pairs of the same round never write the derivatives of the same atoms. The pairs of each tile with itself
+    // make the last round
+    const unsigned ntiles = (size+tsize-1)/tsize;
+    const unsigned m = ntiles + ntiles%2;
+    for(unsigned r=0; r+1<m; r++) {
+      tile_round.push_back(tile_i.size());
+      for(unsigned n=0; n<m/2; n++) {
+        const unsigned a = n==0 ? m-1 : (r+n)%(m-1);
+        const unsigned b = (r+m-1-n)%(m-1);
+        if(a>=ntiles || b>=ntiles) continue;
+        tile_i.push_back(std::min(a,b)); tile_j.push_back(std::max(a,b));
+      }
+    }
+    tile_round.push_back(tile_i.size());
+    for(unsigned it=0; it<ntiles; it++) { tile_i.push_back(it); tile_j.push_back(it); }
+    tile_round.push_back(tile_i.size());
+    if(hist_bin>0.) {
+      // Only the types of the atoms that are present are needed in the histograms
+      vector<int> compact(n_atom_types,-1);
+      hist_type.resize(size);
+      for(unsigned i=0; i<size; i++) {
+        if(compact[atoi[i]]<0) { compact[atoi[i]]=hist_atoi.size(); hist_atoi.push_back(atoi[i]); }
+        hist_type[i]=compact[atoi[i]];
+      }
+      const unsigned ntypes=hist_atoi.size();
+      hist_pair.resize(ntypes*ntypes);
+      unsigned npair=0;
+      for(unsigned a=0; a<ntypes; a++) {
+        for(unsigned b=a; b<ntypes; b++) { hist_pair[a*ntypes+b]=hist_pair[b*ntypes+a]=npair; npair++; }
+      }
+      log.printf("  there are %u atom types so %u histograms are used\n",ntypes,npair);
+    }
   } else {
     FFf_value.resize(numq,vector<float>(size));
     for(unsigned k=0; k<numq; ++k) {
@@ -337,6 +414,12 @@ SAXS::SAXS(const ActionOptions&ao):
   for(unsigned i=0; i<numq; ++i) {
     q_list[i]=q_list[i]*10.0;    //factor 10 to convert from A^-1 to nm^-1
   }
+  // When the q values are evenly spaced sin(qr) and cos(qr) are computed for all q with a recurrence
+  q_evenly_spaced=(numq>1);
+  for(unsigned i=2; i<numq; ++i) {
+    if( fabs( (q_list[i]-q_list[0]) - i*(q_list[1]-q_list[0]) ) > 1e-10*q_list[numq-1] ) q_evenly_spaced=false;
+  }
+  if(!gpu && q_evenly_spaced) log.printf("  q values are evenly spaced so a recurrence is used for the trigonometric functions\n");
   log<<"  Bibliography ";
   if(martini) {
     log<<plumed.cite("Niebling, Björling, Westenhoff, J Appl Crystallogr 47, 1190–1198 (2014).");
@@ -459,7 +542,7 @@ void SAXS::calculate_gpu(vector<Vector> &deriv)
 #endif
 }
 
-void SAXS::calculate_cpu(vector<Vector> &deriv)
+void SAXS::calculate_cpu(vector<Vector> &deriv, vector<double> &sum)
 {
   const unsigned size = getNumberOfAtoms();
   const unsigned numq = q_list.size();
@@ -471,44 +554,64 @@ void SAXS::calculate_cpu(vector<Vector> &deriv)
     rank   = 0;
   }
 
-  vector<double> sum(numq,0);
-  unsigned nt=OpenMP::getNumThreads();
-  #pragma omp parallel num_threads(nt)
+  // The pairs of tiles of each round are divided between the processes and the threads.
+  // Every pair of tiles has the same cost (apart from those on the diagonal) so the work is well balanced
+  const unsigned nrounds = tile_round.size()-1;
+  const double dq = numq>1 ? q_list[1]-q_list[0] : 0.;
+
+  sum.assign(numq,0.);
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
   {
-    std::vector<Vector> omp_deriv(deriv.size());
-    std::vector<double> omp_sum(numq,0);
-    #pragma omp for nowait
-    for (unsigned i=rank; i<size-1; i+=stride) {
-      Vector posi = getPosition(i);
-      for (unsigned j=i+1; j<size ; j++) {
-        Vector c_distances = delta(posi,getPosition(j));
-        double m_distances = c_distances.modulo();
-        c_distances = c_distances/m_distances/m_distances;
-        for (unsigned k=0; k<numq; k++) {
-          unsigned kdx=k*size;
-          double qdist = q_list[k]*m_distances;
-          double FFF = 2.*FF_value[atoi[i]][k]*FF_value[atoi[j]][k];
-          double tsq = sin(qdist)/qdist;
-          double tcq = cos(qdist);
-          double tmp = FFF*(tcq-tsq);
-          Vector dd  = c_distances*tmp;
-          if(nt>1) {
-            omp_deriv[kdx+i] -=dd;
-            omp_deriv[kdx+j] +=dd;
-            omp_sum[k] += FFF*tsq;
-          } else {
-            deriv[kdx+i] -= dd;
-            deriv[kdx+j] += dd;
-            sum[k]       += FFF*tsq;
+    // Each thread only holds the derivatives for the two tiles it is working on. No other thread works on
+    // these tiles in the same round, so they are added to deriv once the tile pair is finished
+    vector<Vector> ibuf(numq*tsize), jbuf(numq*tsize);
+    vector<double> omp_sum(numq,0);
+    for (unsigned r=0; r<nrounds; r++) {
+      #pragma omp for schedule(dynamic,1)
+      for (unsigned p=tile_round[r]+rank; p<tile_round[r+1]; p+=stride) {
+        const unsigned istart = tile_i[p]*tsize, iend = std::min(size,istart+tsize);
+        const unsigned jstart = tile_j[p]*tsize, jend = std::min(size,jstart+tsize);
+        for(unsigned n=0; n<numq*tsize; n++) { ibuf[n].zero(); jbuf[n].zero(); }
+        for (unsigned i=istart; i<iend; i++) {
+          const Vector posi = getPosition(i);
+          const vector<double> & FFi = FF_value[atoi[i]];
+          for (unsigned j=(tile_i[p]==tile_j[p] ? i+1 : jstart); j<jend; j++) {
+            const vector<double> & FFj = FF_value[atoi[j]];
+            Vector c_distances = delta(posi,getPosition(j));
+            double m_distances = c_distances.modulo();
+            c_distances = c_distances/m_distances/m_distances;
+            double sq = 0., cq = 0., sd = 0., cd = 0.;
+            if(q_evenly_spaced) {
+              sq = sin(q_list[0]*m_distances); cq = cos(q_list[0]*m_distances);
+              sd = sin(dq*m_distances); cd = cos(dq*m_distances);
+            }
+            for (unsigned k=0; k<numq; k++) {
+              double qdist = q_list[k]*m_distances;
+              if(!q_evenly_spaced) { sq = sin(qdist); cq = cos(qdist); }
+              double FFF = 2.*FFi[k]*FFj[k];
+              double tsq = sq/qdist;
+              double tmp = FFF*(cq-tsq);
+              Vector dd  = c_distances*tmp;
+              ibuf[k*tsize+i-istart] -= dd;
+              jbuf[k*tsize+j-jstart] += dd;
+              omp_sum[k] += FFF*tsq;
+              if(q_evenly_spaced) {
+                // sin and cos of (q+dq)r from those of qr and dq r
+                double snext = sq*cd + cq*sd;
+                cq = cq*cd - sq*sd; sq = snext;
+              }
+            }
           }
         }
+        for (unsigned k=0; k<numq; k++) {
+          for (unsigned i=istart; i<iend; i++) deriv[k*size+i] += ibuf[k*tsize+i-istart];
+          for (unsigned j=jstart; j<jend; j++) deriv[k*size+j] += jbuf[k*tsize+j-jstart];
+        }
       }
+      // the implicit barrier at the end of the loop separates the rounds
     }
     #pragma omp critical
-    if(nt>1) {
-      for(unsigned i=0; i<deriv.size(); i++) deriv[i]+=omp_deriv[i];
-      for(unsigned k=0; k<numq; k++) sum[k]+=omp_sum[k];
-    }
+    for(unsigned k=0; k<numq; k++) sum[k]+=omp_sum[k];
   }
 
   if(!serial) {
@@ -516,12 +619,188 @@ void SAXS::calculate_cpu(vector<Vector> &deriv)
     comm.Sum(&sum[0], numq);
   }
 
+  for (unsigned k=0; k<numq; k++) sum[k]+=FF_rank[k];
+}
+
+void SAXS::calculate_histogram(vector<Vector> &deriv, vector<double> &sum, const bool do_deriv)
+{
+  const unsigned size = getNumberOfAtoms();
+  const unsigned numq = q_list.size();
+
+  unsigned stride = comm.Get_size();
+  unsigned rank   = comm.Get_rank();
+  if(serial) {
+    stride = 1;
+    rank   = 0;
+  }
+
+  // No distance is larger than the diagonal of the box that contains all the atoms
+  Vector pmin = getPosition(0), pmax = getPosition(0);
+  for (unsigned i=1; i<size; i++) {
+    const Vector & pos = getPosition(i);
+    for(unsigned d=0; d<3; d++) { pmin[d]=std::min(pmin[d],pos[d]); pmax[d]=std::max(pmax[d],pos[d]); }
+  }
+  const unsigned ntypes = hist_atoi.size();
+  const unsigned nbins = static_cast<unsigned>( floor(delta(pmin,pmax).modulo()/hist_bin) ) + 2;
+  if(nbins>hist_nbins) {
+    // some more bins are tabulated so that the tables are not computed again every time the system expands a little
+    hist_nbins = nbins + nbins/4;
+    hist_sinc.resize(hist_nbins*numq);
+    hist_dcos.resize(ntypes*hist_nbins*numq);
+    for(unsigned b=0; b<hist_nbins; b++) {
+      for(unsigned k=0; k<numq; k++) {
+        const double qdist = q_list[k]*b*hist_bin;
+        const double sinc = b>0 ? sin(qdist)/qdist : 1.;
+        const double dcos = b>0 ? cos(qdist)-sinc : 0.;
+        hist_sinc[b*numq+k] = sinc;
+        for(unsigned a=0; a<ntypes; a++) hist_dcos[(a*hist_nbins+b)*numq+k] = 2.*FF_value[hist_atoi[a]][k]*dcos;
+      }
+    }
+  }
+
+  // Each pair of atoms is shared between the two nearest bins so the intensities and the derivatives are
+  // linear interpolations of the exact ones between the edges of the bins.
+  // For large systems the distance vectors from each atom to the others are first shared between the edges of the
+  // bins of each atom type in the same way, and the derivatives of the atom are obtained from these sums, so that
+  // the cost for each pair does not depend on the number of q values. Each pair is then visited twice, which costs
+  // about as much as seven q values, and the sums cost one q value for each edge. Otherwise the derivatives are
+  // added pair by pair as in the exact sum
+  const unsigned nhist = ntypes*(ntypes+1)/2*nbins;
+  const unsigned nnodes = ntypes*nbins;
+  const bool by_node = do_deriv && static_cast<double>(nnodes)*numq+7.*size < static_cast<double>(size)*numq;
+  const unsigned nrounds = tile_round.size()-1;
+  const unsigned nt = OpenMP::getNumThreads();
+  vector<vector<double> > omp_hist(nt);
+  vector<double> hist(nhist,0.);
+  #pragma omp parallel num_threads(nt)
+  {
+    const unsigned t = OpenMP::getThreadNum();
+    plumed_assert(t<nt);
+    vector<double> & myhist = omp_hist[t];
+    myhist.assign(nhist,0.);
+    if(by_node) {
+      vector<Vector> node(nnodes), acc(numq);
+      const double inv_bin = 1./hist_bin;
+      #pragma omp for schedule(dynamic,8) nowait
+      for (unsigned i=rank; i<size; i+=stride) {
+        const Vector posi = getPosition(i);
+        const unsigned* pairi = &hist_pair[hist_type[i]*ntypes];
+        for (unsigned n=0; n<nnodes; n++) node[n].zero();
+        for (unsigned j=0; j<size; j++) {
+          if(j==i) continue;
+          Vector c_distances = delta(posi,getPosition(j));
+          const double m2 = modulo2(c_distances);
+          const double x = sqrt(m2)*inv_bin;
+          const unsigned b = static_cast<unsigned>(x);
+          const double w = x-b;
+          if(j>i) {
+            double* h = &myhist[pairi[hist_type[j]]*nbins+b];
+            h[0] += 1.-w;
+            h[1] += w;
+          }
+          c_distances *= 1./m2;
+          Vector* nd = &node[hist_type[j]*nbins+b];
+          nd[0] += (1.-w)*c_distances;
+          nd[1] += w*c_distances;
+        }
+        for (unsigned k=0; k<numq; k++) acc[k].zero();
+        for (unsigned a=0; a<ntypes; a++) {
+          for (unsigned n=0; n<nbins; n++) {
+            const Vector & nd = node[a*nbins+n];
+            const double* tab = &hist_dcos[(a*hist_nbins+n)*numq];
+            for (unsigned k=0; k<numq; k++) acc[k] += tab[k]*nd;
+          }
+        }
+        const vector<double> & FFi = FF_value[atoi[i]];
+        for (unsigned k=0; k<numq; k++) deriv[k*size+i] -= FFi[k]*acc[k];
+      }
+    } else {
+      // as in calculate_cpu the tile pairs are shared round by round, so the derivatives of the two
+      // tiles are added directly to deriv
+      vector<Vector> ibuf, jbuf;
+      if(do_deriv) { ibuf.resize(numq*tsize); jbuf.resize(numq*tsize); }
+      for (unsigned r=0; r<nrounds; r++) {
+        #pragma omp for schedule(dynamic,1)
+        for (unsigned p=tile_round[r]+rank; p<tile_round[r+1]; p+=stride) {
+          const unsigned istart = tile_i[p]*tsize, iend = std::min(size,istart+tsize);
+          const unsigned jstart = tile_j[p]*tsize, jend = std::min(size,jstart+tsize);
+          if(do_deriv) for(unsigned n=0; n<numq*tsize; n++) { ibuf[n].zero(); jbuf[n].zero(); }
+          for (unsigned i=istart; i<iend; i++) {
+            const Vector posi = getPosition(i);
+            const unsigned* pairi = &hist_pair[hist_type[i]*ntypes];
+            const vector<double> & FFi = FF_value[atoi[i]];
+            for (unsigned j=(tile_i[p]==tile_j[p] ? i+1 : jstart); j<jend; j++) {
+              Vector c_distances = delta(posi,getPosition(j));
+              double m_distances = c_distances.modulo();
+              const double x = m_distances/hist_bin;
+              const unsigned b = static_cast<unsigned>(x);
+              const double w = x-b;
+              double* h = &myhist[pairi[hist_type[j]]*nbins+b];
+              h[0] += 1.-w;
+              h[1] += w;
+              if(!do_deriv) continue;
+              c_distances = c_distances/m_distances/m_distances;
+              const double* t0 = &hist_dcos[(hist_type[j]*hist_nbins+b)*numq];
+              const double* t1 = t0+numq;
+              for (unsigned k=0; k<numq; k++) {
+                double tmp = FFi[k]*((1.-w)*t0[k]+w*t1[k]);
+                Vector dd  = c_distances*tmp;
+                ibuf[k*tsize+i-istart] -= dd;
+                jbuf[k*tsize+j-jstart] += dd;
+              }
+            }
+          }
+          if(do_deriv) {
+            for (unsigned k=0; k<numq; k++) {
+              for (unsigned i=istart; i<iend; i++) deriv[k*size+i] += ibuf[k*tsize+i-istart];
+              for (unsigned j=jstart; j<jend; j++) deriv[k*size+j] += jbuf[k*tsize+j-jstart];
+            }
+          }
+        }
+      }
+    }
+    // the histograms of the threads are summed once at the end
+    #pragma omp barrier
+    #pragma omp for
+    for(unsigned n=0; n<nhist; n++) {
+      for(unsigned it=0; it<nt; it++) if(!omp_hist[it].empty()) hist[n] += omp_hist[it][n];
+    }
+  }
+
+  sum.assign(numq,0.);
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
   for (unsigned k=0; k<numq; k++) {
-    sum[k]+=FF_rank[k];
-    string num; Tools::convert(k,num);
-    Value* val=getPntrToComponent("q-"+num);
-    val->set(sum[k]);
-    if(getDoScore()) setCalcData(k, sum[k]);
+    for(unsigned a=0; a<ntypes; a++) {
+      for(unsigned b=a; b<ntypes; b++) {
+        const double* h = &hist[hist_pair[a*ntypes+b]*nbins];
+        double hs = 0.;
+        for(unsigned n=0; n<nbins; n++) hs += h[n]*hist_sinc[n*numq+k];
+        sum[k] += 2.*FF_value[hist_atoi[a]][k]*FF_value[hist_atoi[b]][k]*hs;
+      }
+    }
+  }
+
+  if(!serial) {
+    if(do_deriv) comm.Sum(&deriv[0][0], 3*deriv.size());
+    comm.Sum(&sum[0], numq);
+  }
+
+  for (unsigned k=0; k<numq; k++) sum[k]+=FF_rank[k];
+}
+
+void SAXS::checkHistogram(const vector<double> &sum)
+{
+  vector<Vector> deriv;
+  vector<double> approx;
+  calculate_histogram(deriv, approx, false);
+  double err = 0.;
+  for (unsigned k=0; k<sum.size(); k++) err = std::max(err, fabs(approx[k]-sum[k])/fabs(sum[k]));
+  log.printf("  SAXS %s: largest relative error of the histogram approximation at step %ld is %e\n",getLabel().c_str(),getStep(),err);
+  if(err>hist_tol) {
+    // the error of the linear interpolation between the edges of the bins is proportional to the square of their width
+    hist_bin *= 0.9*sqrt(hist_tol/err);
+    hist_nbins = 0;
+    log.printf("  SAXS %s: the width of the bins is reduced to %f nm\n",getLabel().c_str(),hist_bin);
   }
 }
 
@@ -534,7 +813,20 @@ void SAXS::calculate()
 
   vector<Vector> deriv(numq*size);
   if(gpu) calculate_gpu(deriv);
-  else calculate_cpu(deriv);
+  else {
+    vector<double> sum;
+    if(hist_bin>0. && getStep()%hist_stride!=0) calculate_histogram(deriv, sum, true);
+    else {
+      calculate_cpu(deriv, sum);
+      if(hist_bin>0.) checkHistogram(sum);
+    }
+    for (unsigned k=0; k<numq; k++) {
+      string num; Tools::convert(k,num);
+      Value* val=getPntrToComponent("q-"+num);
+      val->set(sum[k]);
+      if(getDoScore()) setCalcData(k, sum[k]);
+    }
+  }
 
   if(getDoScore()) {
     /* Metainference */
@@ -82,6 +82,7 @@ void Selector::registerKeywords( Keywords& keys ) {
 Selector::Selector(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
   string name;
   parse("NAME", name);
   double value;
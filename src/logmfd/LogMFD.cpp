@@ -600,6 +600,7 @@ LogMFD::LogMFD( const ActionOptions& ao ):
   }
 
   checkRead();
+  setStateful();
 
   // output messaages to Plumed's log file
   if( multi_sim_comm.Get_size()>1 ) {
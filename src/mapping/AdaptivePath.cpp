@@ -180,6 +180,7 @@ AdaptivePath::AdaptivePath(const ActionOptions& ao):
     log.printf("  writing path out every %u steps to file named %s with format %s \n",wstride,wfilename.c_str(),ofmt.c_str());
   }
   log<<"  Bibliography "<<plumed.cite("Diaz Leines and Ensing, Phys. Rev. Lett. 109, 020601 (2012)")<<"\n";
+  setStateful();
 }
 
 void AdaptivePath::calculate() {
@@ -222,6 +222,7 @@ PCAVars::PCAVars(const ActionOptions& ao):
   mypack(0,0,myvals),
   nopbc(false)
 {
+  setStateful(false);
 
   // What type of distance are we calculating
   std::string mtype; parse("TYPE",mtype);
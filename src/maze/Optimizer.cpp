@@ -365,6 +365,7 @@ Optimizer::Optimizer(const ActionOptions& ao)
   value_z_ = getPntrToComponent("z");
   value_action_ = getPntrToComponent("loss");
   value_sampling_radius_ = getPntrToComponent("sr");
+  setStateful();
 }
 
 double Optimizer::pairing(double distance) const {
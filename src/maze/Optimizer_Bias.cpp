@@ -264,6 +264,7 @@ OptimizerBias::OptimizerBias(const ActionOptions& ao)
     force_(0.0),
     total_distance_(0.0)
 {
+  setStateful();
   log.printf(
     "maze> You are using the maze module of PLUMED2,\
     please read and cite "
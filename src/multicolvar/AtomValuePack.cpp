@@ -22,6 +22,7 @@
 #include "AtomValuePack.h"
 #include "CatomPack.h"
 #include "tools/LinkCells.h"
+#include "tools/VerletList.h"
 
 namespace PLMD {
 namespace multicolvar {
@@ -54,6 +55,14 @@ unsigned AtomValuePack::setupAtomsFromLinkCells( const std::vector<unsigned>& ci
   return natoms;
 }
 
+unsigned AtomValuePack::setupAtomsFromVerletList( const std::vector<unsigned>& cind, const Vector& cpos, const VerletList& nlist, const unsigned& irow ) {
+  natoms=cind.size(); for(unsigned i=0; i<natoms; ++i) indices[i]=cind[i];
+  nlist.retrieveNeighboringAtoms( irow, natoms, indices );
+  for(unsigned i=0; i<natoms; ++i) myatoms[i]=mycolv->getPositionOfAtomForLinkCells( indices[i] ) - cpos;
+  if( mycolv->usesPbc() ) mycolv->applyPbc( myatoms, natoms );
+  return natoms;
+}
+
 void AtomValuePack::updateUsingIndices() {
   if( myvals.updateComplete() ) return;
 
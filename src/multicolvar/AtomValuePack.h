@@ -28,6 +28,7 @@
 namespace PLMD {
 
 class LinkCells;
+class VerletList;
 
 namespace multicolvar {
 
@@ -67,6 +68,8 @@ public:
   void setAtom( const unsigned& j, const unsigned& ind );
 ///
   unsigned setupAtomsFromLinkCells( const std::vector<unsigned>& cind, const Vector& cpos, const LinkCells& linkcells );
+///
+  unsigned setupAtomsFromVerletList( const std::vector<unsigned>& cind, const Vector& cpos, const VerletList& nlist, const unsigned& irow );
 ///
   unsigned getIndex( const unsigned& j ) const ;
 ///
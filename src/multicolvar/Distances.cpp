@@ -116,8 +116,11 @@ PRINT ARG=d1.lessthan,d1.morethan,d1.between,d1.min FILE=colvar STRIDE=10
 
 A calculation performed this way is fast because the expensive part of the calculation - the calculation of all the distances - is only
 done once per step.  Furthermore, it can be made faster by using the TOL keyword to discard those distance that make only a small contributions
-to the final values together with the NL_STRIDE keyword, which ensures that the distances that make only a small contribution to the final values aren't
-calculated at every step.
+to the final values.  When only LESS_THAN and BETWEEN are used, the distances that are larger than the cutoff of these functions are not calculated,
+and the pairs of atoms that are within the cutoff are found with link cells.  If the NL_SKIN keyword is used, these pairs are instead taken from a Verlet
+list that contains all the pairs within the cutoff plus the skin.  The list is stored in compressed sparse row format and it is only rebuilt when the
+atoms have moved far enough since the last rebuild that a pair that is not in the list might be within the cutoff or, if NL_STRIDE is set,
+after at most NL_STRIDE steps.  Each action keeps its own list.  NL_STRIDE can only be used together with NL_SKIN.
 
 */
 //+ENDPLUMEDOC
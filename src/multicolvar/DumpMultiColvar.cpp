@@ -102,6 +102,7 @@ DumpMultiColvar::DumpMultiColvar(const ActionOptions&ao):
   ActionAtomistic(ao),
   ActionWithInputVessel(ao)
 {
+  setStateful(false);
   readArgument("store");
   mycolv = dynamic_cast<MultiColvarBase*>( getDependencies()[0] );
   plumed_assert( getDependencies().size()==1 );
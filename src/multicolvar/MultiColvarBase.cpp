@@ -43,8 +43,10 @@ void MultiColvarBase::registerKeywords( Keywords& keys ) {
   ActionAtomistic::registerKeywords( keys );
   keys.addFlag("NOPBC",false,"ignore the periodic boundary conditions when calculating distances");
   ActionWithVessel::registerKeywords( keys );
-  keys.add("hidden","NL_STRIDE","the frequency with which the neighbor list should be updated. Between neighbour list update steps all quantities "
-           "that contributed less than TOL at the previous neighbor list update step are ignored.");
+  keys.add("optional","NL_SKIN","use a Verlet list in place of the link cells.  The list contains all the pairs of atoms that are within the cutoff plus this skin. "
+           "It is only rebuilt when the atoms have moved far enough that a pair that is not in the list might be within the cutoff");
+  keys.add("optional","NL_STRIDE","the maximum number of steps between rebuilds of the Verlet list.  If this is not set the list is only rebuilt when the "
+           "atoms have moved by more than the skin");
   keys.setComponentsIntroduction("When the label of this action is used as the input for a second you are not referring to a scalar quantity as you are in "
                                  "regular collective variables.  The label is used to reference the full set of quantities calculated by "
                                  "the action.  This is usual when using \\ref multicolvarfunction. Generally when doing this the previously calculated "
@@ -83,6 +85,8 @@ MultiColvarBase::MultiColvarBase(const ActionOptions&ao):
   uselinkforthree(false),
   linkcells(comm),
   threecells(comm),
+  nl_skin(0),
+  verletlist(comm),
   setup_completed(false),
   atomsWereRetrieved(false),
   matsums(false),
@@ -94,6 +98,16 @@ MultiColvarBase::MultiColvarBase(const ActionOptions&ao):
     usepbc=!nopbc;
   }
   if( keywords.exists("SPECIESA") ) { matsums=usespecies=true; }
+  if( keywords.exists("NL_SKIN") ) {
+    parse("NL_SKIN",nl_skin);
+    if( nl_skin<0 ) error("NL_SKIN should be positive");
+    unsigned nl_stride=0; parse("NL_STRIDE",nl_stride);
+    if( nl_skin>0 ) {
+      verletlist.setStride( nl_stride );
+      log.printf("  using a Verlet list with a skin of %f in place of link cells\n",nl_skin);
+      if( nl_stride>0 ) log.printf("  Verlet list will be rebuilt at least every %u steps\n",nl_stride);
+    } else if( nl_stride>0 ) error("NL_STRIDE can only be used with NL_SKIN");
+  }
 }
 
 void MultiColvarBase::readAtomsLikeKeyword( const std::string & key, const int& natoms, std::vector<AtomNumber>& all_atoms ) {
@@ -505,6 +519,7 @@ void MultiColvarBase::setLinkCellCutoff( const double& lcut, double tcut ) {
     if( lcut>linkcells.getCutoff() ) linkcells.setCutoff( lcut );
     if( tcut>threecells.getCutoff() ) threecells.setCutoff( tcut );
   }
+  if( nl_skin>0 ) verletlist.setCutoff( linkcells.getCutoff(), nl_skin );
 }
 
 double MultiColvarBase::getLinkCellCutoff()  const {
@@ -534,10 +549,9 @@ void MultiColvarBase::setupLinkCells() {
     if( isCurrentlyActive( ablocks[iblock][i] ) ) nactive_atoms++;
   }
 
+  std::vector<Vector> ltmp_pos( nactive_atoms );
+  std::vector<unsigned> ltmp_ind( nactive_atoms );
   if( nactive_atoms>0 ) {
-    std::vector<Vector> ltmp_pos( nactive_atoms );
-    std::vector<unsigned> ltmp_ind( nactive_atoms );
-
     nactive_atoms=0;
     if( usespecies ) {
       for(unsigned i=0; i<ablocks[0].size(); ++i) {
@@ -556,8 +570,28 @@ void MultiColvarBase::setupLinkCells() {
     }
 
     // Build the lists for the link cells
-    linkcells.buildCellLists( ltmp_pos, ltmp_ind, getPbc() );
+    if( !verletlist.enabled() ) linkcells.buildCellLists( ltmp_pos, ltmp_ind, getPbc() );
+  }
+  // Or update the Verlet list if it is being used in place of the link cells
+  if( verletlist.enabled() ) updateVerletList( ltmp_pos, ltmp_ind );
+}
+
+void MultiColvarBase::updateVerletList( const std::vector<Vector>& ltmp_pos, const std::vector<unsigned>& ltmp_ind ) {
+  // Rows of the list are the tasks if we are using species and the atoms in the first block otherwise
+  std::vector<Vector> ctmp_pos; std::vector<unsigned> ctmp_ind;
+  if( usespecies ) {
+    ctmp_pos.resize( getFullNumberOfTasks() ); ctmp_ind.resize( getFullNumberOfTasks() );
+    for(unsigned i=0; i<getFullNumberOfTasks(); ++i) {
+      ctmp_ind[i]=getTaskCode(i); plumed_dbg_assert( ctmp_ind[i]==i );
+      ctmp_pos[i]=getPositionOfAtomForLinkCells( ctmp_ind[i] );
+    }
+  } else {
+    ctmp_pos.resize( ablocks[0].size() ); ctmp_ind.resize( ablocks[0].size() );
+    for(unsigned i=0; i<ablocks[0].size(); ++i) {
+      ctmp_ind[i]=ablocks[0][i]; ctmp_pos[i]=getPositionOfAtomForLinkCells( ablocks[0][i] );
+    }
   }
+  verletlist.update( getStep(), ctmp_pos, ctmp_ind, ltmp_pos, ltmp_ind, usepbc, getPbc() );
 }
 
 void MultiColvarBase::setupNonUseSpeciesLinkCells( const unsigned& my_always_active ) {
@@ -577,7 +611,8 @@ void MultiColvarBase::setupNonUseSpeciesLinkCells( const unsigned& my_always_act
     for(unsigned i=rank; i<ablocks[0].size(); i+=stride) {
       if( !isCurrentlyActive( ablocks[0][i] ) ) continue;
       unsigned natomsper=1; linked_atoms[0]=my_always_active;  // Note we always check atom 0 because it is simpler than changing LinkCells.cpp
-      linkcells.retrieveNeighboringAtoms( getPositionOfAtomForLinkCells( ablocks[0][i] ), requiredlinkcells, natomsper, linked_atoms );
+      if( verletlist.enabled() ) verletlist.retrieveNeighboringAtoms( i, natomsper, linked_atoms );
+      else linkcells.retrieveNeighboringAtoms( getPositionOfAtomForLinkCells( ablocks[0][i] ), requiredlinkcells, natomsper, linked_atoms );
       for(unsigned j=0; j<natomsper; ++j) {
         for(unsigned k=bookeeping(i,linked_atoms[j]).first; k<bookeeping(i,linked_atoms[j]).second; ++k) taskFlags[k]=1;
       }
@@ -621,7 +656,8 @@ void MultiColvarBase::setupNonUseSpeciesLinkCells( const unsigned& my_always_act
     for(unsigned i=rank; i<ablocks[0].size(); i+=stride) {
       if( !isCurrentlyActive( ablocks[0][i] ) ) continue;
       unsigned natomsper=1; linked_atoms[0]=my_always_active;  // Note we always check atom 0 because it is simpler than changing LinkCells.cpp
-      linkcells.retrieveNeighboringAtoms( getPositionOfAtomForLinkCells( ablocks[0][i] ), requiredlinkcells, natomsper, linked_atoms );
+      if( verletlist.enabled() ) verletlist.retrieveNeighboringAtoms( i, natomsper, linked_atoms );
+      else linkcells.retrieveNeighboringAtoms( getPositionOfAtomForLinkCells( ablocks[0][i] ), requiredlinkcells, natomsper, linked_atoms );
       if( allthirdblockintasks ) {
         for(unsigned j=0; j<natomsper; ++j) {
           for(unsigned k=bookeeping(i,linked_atoms[j]).first; k<bookeeping(i,linked_atoms[j]).second; ++k) taskFlags[k]=1;
@@ -656,7 +692,9 @@ bool MultiColvarBase::setupCurrentAtomList( const unsigned& taskCode, AtomValueP
     myatoms.setNumberOfAtoms( 1 ); myatoms.setAtom( 0, taskCode ); return true;
   } else if( usespecies ) {
     std::vector<unsigned> task_atoms(1); task_atoms[0]=taskCode;
-    unsigned natomsper=myatoms.setupAtomsFromLinkCells( task_atoms, getPositionOfAtomForLinkCells( taskCode ), linkcells );
+    unsigned natomsper;
+    if( verletlist.enabled() ) natomsper=myatoms.setupAtomsFromVerletList( task_atoms, getPositionOfAtomForLinkCells( taskCode ), verletlist, taskCode );
+    else natomsper=myatoms.setupAtomsFromLinkCells( task_atoms, getPositionOfAtomForLinkCells( taskCode ), linkcells );
     return natomsper>1;
   } else if( matsums ) {
     myatoms.setNumberOfAtoms( getNumberOfAtoms() );
@@ -786,6 +824,8 @@ void MultiColvarBase::calculateNumericalDerivatives( ActionWithValue* a ) {
 
 void MultiColvarBase::prepare() {
   setup_completed=false; atomsWereRetrieved=false;
+  // The Verlet list replaces the link cells so it would be ignored by actions that do not use them
+  if( nl_skin>0 && !verletlist.enabled() ) error("NL_SKIN can only be used in actions that use link cells");
 }
 
 void MultiColvarBase::retrieveAtoms() {
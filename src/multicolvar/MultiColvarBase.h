@@ -26,6 +26,7 @@
 #include "core/ActionWithValue.h"
 #include "tools/DynamicList.h"
 #include "tools/LinkCells.h"
+#include "tools/VerletList.h"
 #include "vesselbase/StoreDataVessel.h"
 #include "vesselbase/ActionWithVessel.h"
 #include "CatomPack.h"
@@ -62,6 +63,10 @@ private:
   LinkCells linkcells;
 /// Link cells for third block of atoms
   LinkCells threecells;
+/// The skin for the Verlet list
+  double nl_skin;
+/// Verlet list that is used in place of the link cells for pairs of atoms if NL_SKIN is set
+  VerletList verletlist;
 /// Number of atoms that are being used for central atom position
   unsigned ncentral;
 /// Bool vector telling us which atoms are required to calculate central atom position
@@ -125,6 +130,8 @@ protected:
   void setupLinkCells();
 /// Get the cutoff for the link cells
   double getLinkCellCutoff()  const ;
+/// Update the Verlet list using the atoms that would have been put in the link cells
+  void updateVerletList( const std::vector<Vector>& ltmp_pos, const std::vector<unsigned>& ltmp_ind );
 /// This does setup of link cell stuff that is specific to the non-use of the usespecies keyword
   void setupNonUseSpeciesLinkCells( const unsigned& );
 /// This sets up the list of atoms that are involved in this colvar
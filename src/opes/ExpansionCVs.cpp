@@ -38,6 +38,7 @@ ExpansionCVs::ExpansionCVs(const ActionOptions&ao)
   , isReady_(false)
   , totNumECVs_(0)
 {
+  setStateful(false);
 //set kbt_
   const double Kb=plumed.getAtoms().getKBoltzmann();
   kbt_=plumed.getAtoms().getKbT();
@@ -233,6 +233,7 @@ OPESexpanded::OPESexpanded(const ActionOptions&ao)
   }
 
   checkRead();
+  setStateful();
 
 //check ECVs and link them
   init_pntrToECVsClass();
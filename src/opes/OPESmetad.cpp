@@ -21,6 +21,7 @@ along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 #include "tools/Communicator.h"
 #include "tools/File.h"
 #include "tools/OpenMP.h"
+#include "tools/CheckpointData.h"
 
 namespace PLMD {
 namespace opes {
@@ -186,6 +187,8 @@ public:
   explicit OPESmetad(const ActionOptions&);
   void calculate() override;
   void update() override;
+  void writeCheckpoint(CheckpointData&) override;
+  void readCheckpoint(CheckpointData&) override;
   static void registerKeywords(Keywords& keys);
 
   double getProbAndDerivatives(const std::vector<double>&,std::vector<double>&);
@@ -493,9 +496,12 @@ OPESmetad<mode>::OPESmetad(const ActionOptions& ao)
   }
 
   checkRead();
+  setStateful();
 
 //restart if needed
-  if(getRestart())
+  if(getRestart() && getRestartFromCheckpoint())
+    log.printf("  RESTART - the state will be read from the binary checkpoint\n");
+  else if(getRestart())
   {
     bool stateRestart=true;
     if(restartFileName.length()==0)
@@ -1427,6 +1433,94 @@ void OPESmetad<mode>::updateNlist(const std::vector<double>& new_center)
   nlist_update_=false;
 }
 
+template <class mode>
+void OPESmetad<mode>::writeCheckpoint(CheckpointData&cp)
+{
+  cp.write(counter_);
+  cp.write(adaptive_counter_);
+  cp.write(av_cv_);
+  cp.write(av_M2_);
+  cp.write(sum_weights_);
+  cp.write(sum_weights2_);
+  cp.write(Zed_);
+  cp.write(KDEnorm_);
+  cp.write(std::uint64_t(kernels_.size()));
+  for(const auto & k : kernels_)
+  {
+    cp.write(k.height);
+    cp.write(k.center);
+    cp.write(k.sigma);
+  }
+  cp.write(nlist_index_);
+  cp.write(nlist_center_);
+  cp.write(nlist_dev2_);
+  cp.write(nlist_steps_);
+  cp.write(nlist_update_);
+  cp.write(work_);
+  cp.write(old_KDEnorm_);
+  cp.write(old_Zed_);
+  cp.write(isFirstStep_);
+//these components are only set at some steps
+  if(calc_work_)
+    cp.write(getPntrToComponent("work")->get());
+  if(nlist_)
+    cp.write(getPntrToComponent("nlsteps")->get());
+}
+
+template <class mode>
+void OPESmetad<mode>::readCheckpoint(CheckpointData&cp)
+{
+  cp.read(counter_);
+  cp.read(adaptive_counter_);
+  cp.read(av_cv_);
+  cp.read(av_M2_);
+  cp.read(sum_weights_);
+  cp.read(sum_weights2_);
+  cp.read(Zed_);
+  cp.read(KDEnorm_);
+  std::uint64_t nker;
+  cp.read(nker);
+  kernels_.clear();
+  kernels_.reserve(nker);
+  for(unsigned k=0; k<nker; k++)
+  {
+    double height;
+    std::vector<double> center;
+    std::vector<double> sigma;
+    cp.read(height);
+    cp.read(center);
+    cp.read(sigma);
+    kernels_.emplace_back(height,center,sigma);
+  }
+  cp.read(nlist_index_);
+  cp.read(nlist_center_);
+  cp.read(nlist_dev2_);
+  cp.read(nlist_steps_);
+  cp.read(nlist_update_);
+  cp.read(work_);
+  cp.read(old_KDEnorm_);
+  cp.read(old_Zed_);
+  cp.read(isFirstStep_); //the next step is not treated as the first one, so no kernel is skipped
+  delta_kernels_.clear();
+  getPntrToComponent("rct")->set(kbt_*std::log(sum_weights_/counter_));
+  getPntrToComponent("zed")->set(Zed_);
+  getPntrToComponent("neff")->set(std::pow(1+sum_weights_,2)/(1+sum_weights2_));
+  getPntrToComponent("nker")->set(kernels_.size());
+  if(nlist_)
+    getPntrToComponent("nlker")->set(nlist_index_.size());
+  double value;
+  if(calc_work_)
+  {
+    cp.read(value);
+    getPntrToComponent("work")->set(value);
+  }
+  if(nlist_)
+  {
+    cp.read(value);
+    getPntrToComponent("nlsteps")->set(value);
+  }
+}
+
 template <class mode>
 void OPESmetad<mode>::dumpStateToFile()
 {
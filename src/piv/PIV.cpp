@@ -321,6 +321,8 @@ PIV::PIV(const ActionOptions&ao):
   if(keywords.exists("UPDATEPIV")) {
     parse("UPDATEPIV",updatePIV);
   }
+  // between the updates the PIV of the last update is used
+  setStateful(updatePIV>1);
 
   // Test
   parseFlag("COM",com);
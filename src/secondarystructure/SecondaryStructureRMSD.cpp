@@ -27,6 +27,7 @@
 #include "vesselbase/Vessel.h"
 #include "reference/MetricRegister.h"
 #include "reference/SingleDomainRMSD.h"
+#include "tools/OpenMP.h"
 
 namespace PLMD {
 namespace secondarystructure {
@@ -76,12 +77,14 @@ SecondaryStructureRMSD::SecondaryStructureRMSD(const ActionOptions&ao):
   ActionWithValue(ao),
   ActionWithVessel(ao),
   nopbc(false),
+  usemulti(false),
   align_strands(false),
   s_cutoff2(0),
   align_atom_1(0),
   align_atom_2(0)
 {
   parse("TYPE",alignType); parseFlag("NOPBC",nopbc);
+  if( alignType=="OPTIMAL" || alignType=="OPTIMAL-FAST" ) { usemulti=true; multiref.setType( alignType ); }
   log.printf("  distances from secondary structure elements are calculated using %s algorithm\n",alignType.c_str() );
   log<<"  Bibliography "<<plumed.cite("Pietrucci and Laio, J. Chem. Theory Comput. 5, 2197 (2009)"); log<<"\n";
 
@@ -176,6 +179,7 @@ void SecondaryStructureRMSD::setSecondaryStructure( std::vector<Vector>& structu
   std::vector<double> align( structure.size(), 1.0 ), displace( structure.size(), 1.0 );
   references[nn]->setBoundsOnDistances( true, bondlength );   // We always use pbc
   references[nn]->setReferenceAtoms( structure, align, displace );
+  if( usemulti ) multiref.addReference( structure );
 //  references[nn]->setNumberOfAtoms( structure.size() );
 
   // And prepare the task list
@@ -185,12 +189,15 @@ void SecondaryStructureRMSD::setSecondaryStructure( std::vector<Vector>& structu
 }
 
 void SecondaryStructureRMSD::calculate() {
+  if( taskbuffers.size()!=OpenMP::getNumThreads() ) taskbuffers.resize( OpenMP::getNumThreads() );
   runAllTasks();
 }
 
 void SecondaryStructureRMSD::performTask( const unsigned& task_index, const unsigned& current, MultiValue& myvals ) const {
   // Retrieve the positions
-  std::vector<Vector> pos( references[0]->getNumberOfAtoms() );
+  const unsigned t=OpenMP::getThreadNum(); plumed_assert( t<taskbuffers.size() );
+  TaskBuffers& buf=taskbuffers[t]; std::vector<Vector>& pos( buf.pos );
+  pos.resize( references[0]->getNumberOfAtoms() );
   const unsigned n=pos.size();
   for(unsigned i=0; i<n; ++i) pos[i]=ActionAtomistic::getPosition( getAtomIndex(current,i) );
 
@@ -235,18 +242,33 @@ void SecondaryStructureRMSD::performTask( const unsigned& task_index, const unsi
 
   // And now calculate the RMSD
   const Pbc& pbc=getPbc();
-  unsigned closest=0;
-  double r = references[0]->calculate( pos, pbc, mypack, false );
-  const unsigned rs = references.size();
-  for(unsigned i=1; i<rs; ++i) {
-    mypack.setValIndex( i+1 );
-    double nr=references[i]->calculate( pos, pbc, mypack, false );
-    if( nr<r ) { closest=i; r=nr; }
-  }
+  unsigned closest=0; double r;
+  if( usemulti ) {
+    // The distances from all the references are computed together and only the derivatives of the closest are kept.
+    // This is already inside the loop over tasks that is divided between the threads so the serial version is used
+    std::vector<double>& dist( buf.dist ); std::vector<Vector>& der( buf.der );
+    multiref.calculate( pos.data(), dist, der, false, buf.ws );
+    r=dist[0];
+    for(unsigned i=1; i<dist.size(); ++i) {
+      if( dist[i]<r ) { closest=i; r=dist[i]; }
+    }
+    mypack.clear();
+    for(unsigned i=0; i<n; ++i) mypack.setAtomDerivatives( i, der[closest*n+i] );
+    if( !mypack.updateComplete() ) mypack.updateDynamicLists();
+    myvals.setValue( 0, 1.0 ); myvals.setValue( 1, r );
+  } else {
+    r = references[0]->calculate( pos, pbc, mypack, false );
+    const unsigned rs = references.size();
+    for(unsigned i=1; i<rs; ++i) {
+      mypack.setValIndex( i+1 );
+      double nr=references[i]->calculate( pos, pbc, mypack, false );
+      if( nr<r ) { closest=i; r=nr; }
+    }
 
-  // Transfer everything to the value
-  myvals.setValue( 0, 1.0 ); myvals.setValue( 1, r );
-  if( closest>0 ) mypack.moveDerivatives( closest+1, 1 );
+    // Transfer everything to the value
+    myvals.setValue( 0, 1.0 ); myvals.setValue( 1, r );
+    if( closest>0 ) mypack.moveDerivatives( closest+1, 1 );
+  }
 
   if( !mypack.virialWasSet() ) {
     Tensor vir;
@@ -25,6 +25,7 @@
 #include "core/ActionAtomistic.h"
 #include "core/ActionWithValue.h"
 #include "vesselbase/ActionWithVessel.h"
+#include "tools/MultiReferenceRMSD.h"
 #include <vector>
 
 namespace PLMD {
@@ -51,6 +52,17 @@ private:
   std::vector< std::vector<unsigned> > colvar_atoms;
 /// The list of reference configurations
   std::vector<std::unique_ptr<SingleDomainRMSD>> references;
+/// Are the distances from all the references computed together (OPTIMAL and OPTIMAL-FAST)
+  bool usemulti;
+  MultiReferenceRMSD multiref;
+/// The buffers that each thread uses in performTask so that nothing is allocated for each segment
+  struct TaskBuffers {
+    std::vector<Vector> pos;
+    std::vector<double> dist;
+    std::vector<Vector> der;
+    MultiReferenceRMSD::Workspace ws;
+  };
+  mutable std::vector<TaskBuffers> taskbuffers;
 /// Variables for strands cutoff
   bool align_strands;
   double s_cutoff2;
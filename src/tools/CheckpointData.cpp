@@ -0,0 +1,85 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CheckpointData.h"
+#include "Exception.h"
+#include <cstring>
+
+namespace PLMD {
+
+CheckpointData::CheckpointData():
+  pos(0)
+{
+}
+
+void CheckpointData::clear() {
+  data.clear();
+  pos=0;
+}
+
+void CheckpointData::assign(const char*p,std::size_t n) {
+  data.assign(p,p+n);
+  pos=0;
+}
+
+void CheckpointData::swap(std::vector<char>&v) {
+  data.swap(v);
+  pos=0;
+}
+
+void CheckpointData::writeBytes(const void*p,std::size_t n) {
+  const char* c=static_cast<const char*>(p);
+  data.insert(data.end(),c,c+n);
+}
+
+void CheckpointData::readBytes(void*p,std::size_t n) {
+  plumed_massert(n<=data.size()-pos,"trying to read past the end of a checkpoint");
+  if(n>0) std::memcpy(p,data.data()+pos,n);
+  pos+=n;
+}
+
+void CheckpointData::write(const std::string&s) {
+  write(std::uint64_t(s.length()));
+  writeBytes(s.data(),s.length());
+}
+
+void CheckpointData::write(const CheckpointData&c) {
+  write(std::uint64_t(c.data.size()));
+  writeBytes(c.data.data(),c.data.size());
+}
+
+void CheckpointData::read(std::string&s) {
+  std::uint64_t n;
+  read(n);
+  plumed_massert(n<=data.size()-pos,"trying to read past the end of a checkpoint");
+  s.assign(data.data()+pos,n);
+  pos+=n;
+}
+
+void CheckpointData::read(CheckpointData&c) {
+  std::uint64_t n;
+  read(n);
+  plumed_massert(n<=data.size()-pos,"trying to read past the end of a checkpoint");
+  c.assign(data.data()+pos,n);
+  pos+=n;
+}
+
+}
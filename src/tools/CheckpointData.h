@@ -0,0 +1,117 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_CheckpointData_h
+#define __PLUMED_tools_CheckpointData_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Binary buffer where the actions save their state in a checkpoint.
+/// Numbers are copied with their representation in memory, so that a state is restored exactly.
+/// For this reason, a checkpoint can only be read on the same architecture where it was written.
+/// Data should be read in the same order in which they were written.
+/// Vectors and strings are preceded by their size.
+class CheckpointData {
+  std::vector<char> data;
+/// Position of the next read
+  std::size_t pos;
+  void writeBytes(const void*,std::size_t);
+  void readBytes(void*,std::size_t);
+  template<class T> void writeElements(const std::vector<T>&v,std::true_type) {
+    if(v.size()>0) writeBytes(v.data(),v.size()*sizeof(T));
+  }
+  template<class T> void writeElements(const std::vector<T>&v,std::false_type) {
+    for(const auto & x : v) write(x);
+  }
+  template<class T> void readElements(std::vector<T>&v,std::true_type) {
+    if(v.size()>0) readBytes(v.data(),v.size()*sizeof(T));
+  }
+  template<class T> void readElements(std::vector<T>&v,std::false_type) {
+    for(auto & x : v) read(x);
+  }
+public:
+  CheckpointData();
+/// Remove all the data
+  void clear();
+/// Replace the data with a copy of n bytes
+  void assign(const char*p,std::size_t n);
+/// Exchange the data with the content of a vector, without copying them
+  void swap(std::vector<char>&);
+/// Pointer to the data
+  const char* getData()const {return data.data();}
+/// Size of the data, in bytes
+  std::size_t size()const {return data.size();}
+/// True if all the data have been read
+  bool eof()const {return pos==data.size();}
+/// Write a number or a plain struct
+  template<class T> void write(const T&);
+/// Write a vector
+  template<class T> void write(const std::vector<T>&);
+/// Write a string
+  void write(const std::string&);
+/// Write the content of another buffer, so that it can be read back as a separate buffer
+  void write(const CheckpointData&);
+/// Read a number or a plain struct
+  template<class T> void read(T&);
+/// Read a vector. It is resized to the size that was written
+  template<class T> void read(std::vector<T>&);
+/// Read a string
+  void read(std::string&);
+/// Read a buffer written with write(const CheckpointData&)
+  void read(CheckpointData&);
+};
+
+template<class T>
+void CheckpointData::write(const T&t) {
+  static_assert(std::is_trivially_copyable<T>::value,"only plain data can be written in a checkpoint");
+  writeBytes(&t,sizeof(T));
+}
+
+template<class T>
+void CheckpointData::write(const std::vector<T>&v) {
+  write(std::uint64_t(v.size()));
+  writeElements(v,std::is_trivially_copyable<T>());
+}
+
+template<class T>
+void CheckpointData::read(T&t) {
+  static_assert(std::is_trivially_copyable<T>::value,"only plain data can be read from a checkpoint");
+  readBytes(&t,sizeof(T));
+}
+
+template<class T>
+void CheckpointData::read(std::vector<T>&v) {
+  std::uint64_t n;
+  read(n);
+  v.resize(n);
+  readElements(v,std::is_trivially_copyable<T>());
+}
+
+}
+
+#endif
@@ -133,6 +133,21 @@ void Communicator::Sum(Data data) {
 #endif
 }
 
+Communicator::Request Communicator::Isum(Data data) {
+  Request req;
+#if defined(__PLUMED_HAS_MPI)
+#if MPI_VERSION>=3
+  if(initialized()) MPI_Iallreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator,&req.r);
+#else
+  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
+#endif
+#else
+  (void) data;
+  req.r.started=true;
+#endif
+  return req;
+}
+
 void Communicator::Prod(Data data) {
 #if defined(__PLUMED_HAS_MPI)
   if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_PROD,communicator);
@@ -218,6 +233,20 @@ void Communicator::Allgather(ConstData in,Data out) {
 #endif
 }
 
+Communicator::Request Communicator::Irecv(Data data,int source,int tag) {
+  Request req;
+#ifdef __PLUMED_HAS_MPI
+  plumed_massert(initialized(),"you are trying to use an MPI function, but MPI is not initialized");
+  MPI_Irecv(data.pointer,data.size,data.type,source,tag,communicator,&req.r);
+#else
+  (void) data;
+  (void) source;
+  (void) tag;
+  plumed_merror("you are trying to use an MPI function, but PLUMED has been compiled without MPI support");
+#endif
+  return req;
+}
+
 void Communicator::Recv(Data data,int source,int tag,Status&status) {
 #ifdef __PLUMED_HAS_MPI
   plumed_massert(initialized(),"you are trying to use an MPI function, but MPI is not initialized");
@@ -256,14 +285,21 @@ bool Communicator::initialized() {
   return false;
 }
 
+Communicator::Request::Request() {
+#ifdef __PLUMED_HAS_MPI
+  r=MPI_REQUEST_NULL;
+#endif
+}
+
 void Communicator::Request::wait(Status&s) {
 #ifdef __PLUMED_HAS_MPI
+  if(r==MPI_REQUEST_NULL) return;
   plumed_massert(initialized(),"you are trying to use an MPI function, but MPI is not initialized");
   if(&s==&StatusIgnore) MPI_Wait(&r,MPI_STATUS_IGNORE);
   else MPI_Wait(&r,&s.s);
 #else
   (void) s;
-  plumed_merror("you are trying to use an MPI function, but PLUMED has been compiled without MPI support");
+  plumed_massert(r.started,"you are waiting on a request that was never started");
 #endif
 }
 
@@ -41,8 +41,12 @@ class MPI_Comm {};
 class MPI_Datatype {};
 /// Surrogate of MPI_Status when MPI library is not available
 class MPI_Status {};
-/// Surrogate of MPI_Request when MPI library is not available
-class MPI_Request {};
+/// Surrogate of MPI_Request when MPI library is not available.
+/// It only records whether it was returned by a nonblocking call
+class MPI_Request {
+public:
+  bool started=false;
+};
 #endif
 
 /// \ingroup TOOLBOX
@@ -137,6 +141,10 @@ public:
   class Request {
   public:
     MPI_Request r;
+/// With MPI the request is null until it is returned by a nonblocking call, and waiting on a null request does nothing.
+/// Without MPI the only nonblocking call is Isum, which completes immediately, and waiting on
+/// a request that was not returned by it is an error
+    Request();
     void wait(Status&s=StatusIgnore);
   };
 /// Default constructor
@@ -177,6 +185,14 @@ public:
   template <class T> void Sum(T*buf,int count) {Sum(Data(buf,count));}
 /// Wrapper for MPI_Allreduce with MPI_SUM (reference)
   template <class T> void Sum(T&buf) {Sum(Data(buf));}
+/// Wrapper for MPI_Iallreduce with MPI_SUM (data struct).
+/// The sum is done in place and the buffer should not be used until wait() is called on the returned request.
+/// If the MPI library does not support nonblocking collectives the sum is done immediately
+  Request Isum(Data);
+/// Wrapper for MPI_Iallreduce with MPI_SUM (pointer)
+  template <class T> Request Isum(T*buf,int count) {return Isum(Data(buf,count));}
+/// Wrapper for MPI_Iallreduce with MPI_SUM (reference)
+  template <class T> Request Isum(T&buf) {return Isum(Data(buf));}
 /// Wrapper for MPI_Allreduce with MPI_PROD (data struct)
   void Prod(Data);
 /// Wrapper for MPI_Allreduce with MPI_PROD (pointer)
@@ -232,6 +248,13 @@ public:
     Allgather(ConstData(sendbuf),Data(recvbuf));
   }
 
+/// Wrapper for MPI_Irecv (data struct)
+  Request Irecv(Data,int,int);
+/// Wrapper for MPI_Irecv (pointer)
+  template <class T> Request Irecv(T*buf,int count,int source,int tag) {return Irecv(Data(buf,count),source,tag);}
+/// Wrapper for MPI_Irecv (reference)
+  template <class T> Request Irecv(T&buf,int source,int tag) {return Irecv(Data(buf),source,tag);}
+
 /// Wrapper for MPI_Recv (data struct)
   void Recv(Data,int,int,Status&s=StatusIgnore);
 /// Wrapper for MPI_Recv (pointer)
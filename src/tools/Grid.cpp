@@ -28,6 +28,7 @@
 #include "KernelFunctions.h"
 #include "RootFindingBase.h"
 #include "Communicator.h"
+#include "CheckpointData.h"
 
 #include <vector>
 #include <cmath>
@@ -522,6 +523,19 @@ void Grid::writeToFile(OFile& ofile) {
   }
 }
 
+void Grid::writeCheckpoint(CheckpointData&cp)const {
+  cp.write(grid_);
+  cp.write(der_);
+}
+
+void Grid::readCheckpoint(CheckpointData&cp) {
+  const std::size_t size=grid_.size();
+  const std::size_t dsize=der_.size();
+  cp.read(grid_);
+  cp.read(der_);
+  plumed_massert(grid_.size()==size && der_.size()==dsize,"the grid " + funcname + " in the checkpoint has a different size");
+}
+
 void GridBase::writeCubeFile(OFile& ofile, const double& lunit) {
   plumed_assert( dimension_==3 );
   ofile.printf("PLUMED CUBE FILE\n");
@@ -847,6 +861,42 @@ void SparseGrid::writeToFile(OFile& ofile) {
   }
 }
 
+void SparseGrid::writeCheckpoint(CheckpointData&cp)const {
+  std::vector<index_t> indices;
+  std::vector<double> values;
+  indices.reserve(map_.size());
+  values.reserve(map_.size());
+  for(const auto & it : map_) {
+    indices.push_back(it.first);
+    values.push_back(it.second);
+  }
+  cp.write(indices);
+  cp.write(values);
+  indices.clear();
+  values.clear();
+  for(const auto & it : der_) {
+    indices.push_back(it.first);
+    values.insert(values.end(),it.second.begin(),it.second.end());
+  }
+  cp.write(indices);
+  cp.write(values);
+}
+
+void SparseGrid::readCheckpoint(CheckpointData&cp) {
+  std::vector<index_t> indices;
+  std::vector<double> values;
+  cp.read(indices);
+  cp.read(values);
+  plumed_assert(indices.size()==values.size());
+  map_.clear();
+  for(unsigned i=0; i<indices.size(); i++) map_[indices[i]]=values[i];
+  cp.read(indices);
+  cp.read(values);
+  plumed_assert(values.size()==indices.size()*dimension_);
+  der_.clear();
+  for(unsigned i=0; i<indices.size(); i++) der_[indices[i]].assign(values.begin()+i*dimension_,values.begin()+(i+1)*dimension_);
+}
+
 double SparseGrid::getMinValue() const {
   double minval;
   minval=0.0;
@@ -66,6 +66,7 @@ class IFile;
 class OFile;
 class KernelFunctions;
 class Communicator;
+class CheckpointData;
 
 /// \ingroup TOOLBOX
 class GridBase
@@ -195,6 +196,10 @@ public:
 
 /// dump grid on file
   virtual void writeToFile(OFile&)=0;
+/// save values and derivatives in a binary checkpoint
+  virtual void writeCheckpoint(CheckpointData&)const=0;
+/// restore values and derivatives saved with writeCheckpoint()
+  virtual void readCheckpoint(CheckpointData&)=0;
 /// dump grid to gaussian cube file
   void writeCubeFile(OFile&, const double& lunit);
 
@@ -266,6 +271,8 @@ public:
   void logAllValuesAndDerivatives( const double& scalef );
 /// dump grid on file
   void writeToFile(OFile&) override;
+  void writeCheckpoint(CheckpointData&)const override;
+  void readCheckpoint(CheckpointData&) override;
 
 /// Set the minimum value of the grid to zero and translates accordingly
   void setMinToZero();
@@ -330,6 +337,8 @@ public:
   double getMaxValue() const override;
 /// dump grid on file
   void writeToFile(OFile&) override;
+  void writeCheckpoint(CheckpointData&)const override;
+  void readCheckpoint(CheckpointData&) override;
 
   virtual ~SparseGrid() {}
 };
@@ -0,0 +1,134 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "Lanczos.h"
+#include "OpenMP.h"
+#include "Random.h"
+#include <cmath>
+#include <limits>
+
+namespace PLMD {
+
+/// Calculate y = A x with the rows of A divided between the threads
+static void parallelMult( const Matrix<double>& A, const std::vector<double>& x, std::vector<double>& y ) {
+  unsigned n=A.nrows();
+  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  for(unsigned i=0; i<n; ++i) {
+    double sum=0; for(unsigned j=0; j<n; ++j) sum+=A(i,j)*x[j];
+    y[i]=sum;
+  }
+}
+
+/// Calculate the dot product of two vectors
+static double dot( const std::vector<double>& a, const std::vector<double>& b ) {
+  double sum=0; for(unsigned i=0; i<a.size(); ++i) sum+=a[i]*b[i];
+  return sum;
+}
+
+/// Remove the components of w along the first m vectors in the orthonormal basis q (stored one after the other).
+/// This is done twice as a single pass of Gram-Schmidt does not keep the basis orthogonal
+static void orthogonalize( const std::vector<double>& q, const unsigned& m, std::vector<double>& w ) {
+  unsigned n=w.size();
+  for(unsigned pass=0; pass<2; ++pass) {
+    for(unsigned i=0; i<m; ++i) {
+      const double* qi=&q[i*n]; double c=0;
+      for(unsigned j=0; j<n; ++j) c+=qi[j]*w[j];
+      for(unsigned j=0; j<n; ++j) w[j]-=c*qi[j];
+    }
+  }
+}
+
+bool lanczosIsFaster( const unsigned& n, const unsigned& k ) {
+  return n>=512 && 16*k<=n;
+}
+
+void lanczosEigenpairs( const Matrix<double>& A, const unsigned& k, std::vector<double>& eigvals, Matrix<double>& eigvecs ) {
+  unsigned n=A.nrows(); plumed_assert( A.ncols()==n && k>0 && k<=n );
+  const double eps=std::numeric_limits<double>::epsilon();
+  // The Lanczos vectors are stored one after the other in q.  alpha and beta are the diagonal and off-diagonal of the tridiagonal matrix
+  std::vector<double> q, alpha, beta, w( n ), evals; Matrix<double> T, S;
+  // The starting vector is random but the seed is fixed so the results are reproducible
+  Random rnd; std::vector<double> v( n ); double anorm=0;
+  for(unsigned j=0; j<n; ++j) v[j]=rnd.U01()-0.5;
+  double vnorm=std::sqrt( dot( v, v ) ); for(unsigned j=0; j<n; ++j) v[j]/=vnorm;
+
+  for(unsigned m=1; m<=n; ++m) {
+    q.insert( q.end(), v.begin(), v.end() );
+    parallelMult( A, v, w );
+    double a=dot( v, w ); alpha.push_back( a );
+    orthogonalize( q, m, w );
+    double b=std::sqrt( dot( w, w ) ); beta.push_back( b );
+    anorm=std::max( anorm, std::fabs(a) + b + ( m>1 ? beta[m-2] : 0 ) );
+
+    // Check the convergence of the largest Ritz values every few steps
+    bool invariant=( b<=100*eps*anorm );
+    if( m>=k && ( m%5==0 || m==n || invariant ) ) {
+      T.resize( m, m ); T=0;
+      for(unsigned i=0; i<m; ++i) {
+        T(i,i)=alpha[i]; if( i+1<m ) { T(i,i+1)=T(i+1,i)=beta[i]; }
+      }
+      diagMat( T, evals, S );
+      bool converged=true;
+      for(unsigned i=0; i<k; ++i) {
+        // The residual of a Ritz pair is the last off-diagonal element times the last component of the eigenvector of T
+        if( b*std::fabs( S(m-1-i,m-1) ) > 1e-10*anorm ) { converged=false; break; }
+      }
+      if( converged || m==n ) {
+        eigvals.resize( k ); eigvecs.resize( k, n ); eigvecs=0;
+        for(unsigned i=0; i<k; ++i) {
+          unsigned ind=m-1-i; eigvals[i]=evals[ind];
+          for(unsigned l=0; l<m; ++l) {
+            double c=S(ind,l); const double* ql=&q[l*n];
+            for(unsigned j=0; j<n; ++j) eigvecs(i,j)+=c*ql[j];
+          }
+          // Use the same convention for the phase as diagMat
+          unsigned j=0;
+          for(j=0; j<n; ++j) if( eigvecs(i,j)*eigvecs(i,j)>1e-14 ) break;
+          if( j<n && eigvecs(i,j)<0.0 ) for(j=0; j<n; ++j) eigvecs(i,j)*=-1;
+        }
+        return;
+      }
+    }
+
+    if( invariant ) {
+      // The Krylov space is invariant under A so continue with a new random vector that is orthogonal to all the others.
+      // The zero off-diagonal element decouples the two blocks in the tridiagonal matrix
+      beta[m-1]=0;
+      for(unsigned j=0; j<n; ++j) w[j]=rnd.U01()-0.5;
+      orthogonalize( q, m, w ); b=std::sqrt( dot( w, w ) );
+    }
+    for(unsigned j=0; j<n; ++j) v[j]=w[j]/b;
+  }
+  plumed_error();
+}
+
+void largestEigenpairs( const Matrix<double>& A, const unsigned& k, std::vector<double>& eigvals, Matrix<double>& eigvecs ) {
+  unsigned n=A.nrows(); plumed_assert( k<=n );
+  if( lanczosIsFaster( n, k ) ) { lanczosEigenpairs( A, k, eigvals, eigvecs ); return; }
+  std::vector<double> evals; Matrix<double> evecs; diagMat( A, evals, evecs );
+  eigvals.resize( k ); eigvecs.resize( k, n );
+  for(unsigned i=0; i<k; ++i) {
+    eigvals[i]=evals[n-1-i];
+    for(unsigned j=0; j<n; ++j) eigvecs(i,j)=evecs(n-1-i,j);
+  }
+}
+
+}
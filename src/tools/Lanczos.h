@@ -0,0 +1,50 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_Lanczos_h
+#define __PLUMED_tools_Lanczos_h
+
+#include <vector>
+#include "Matrix.h"
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Find the k largest eigenvalues of the symmetric matrix A and the corresponding eigenvectors using
+/// the Lanczos algorithm with full reorthogonalization.  The eigenvalues are returned in descending
+/// order and the eigenvectors are stored row-wise in eigvecs with the same sign convention as diagMat.
+/// The cost is dominated by the products between A and the Lanczos vectors, which are divided between
+/// the OpenMP threads, so this is much cheaper than diagMat when k is much smaller than the size of A.
+void lanczosEigenpairs( const Matrix<double>& A, const unsigned& k, std::vector<double>& eigvals, Matrix<double>& eigvecs );
+
+/// \ingroup TOOLBOX
+/// Find the k largest eigenvalues of the symmetric matrix A (in descending order) and the corresponding
+/// eigenvectors (row-wise).  lanczosEigenpairs is used when k is much smaller than the size of A and
+/// diagMat is used otherwise.
+void largestEigenpairs( const Matrix<double>& A, const unsigned& k, std::vector<double>& eigvals, Matrix<double>& eigvecs );
+
+/// \ingroup TOOLBOX
+/// Is it cheaper to find k eigenpairs of an n by n matrix with lanczosEigenpairs than with diagMat
+bool lanczosIsFaster( const unsigned& n, const unsigned& k );
+
+}
+
+#endif
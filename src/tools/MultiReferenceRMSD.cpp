@@ -0,0 +1,230 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "MultiReferenceRMSD.h"
+#include "RMSD.h"
+#include "Tensor.h"
+#include "OpenMP.h"
+#include "Exception.h"
+#include <cmath>
+
+namespace PLMD {
+
+MultiReferenceRMSD::MultiReferenceRMSD():
+  fast(false),
+  natoms(0),
+  nrefs(0),
+  stride(0)
+{
+}
+
+void MultiReferenceRMSD::clear() {
+  natoms=nrefs=stride=0; align.resize(0); refpos.resize(0); rr11.resize(0);
+  refx.resize(0); refy.resize(0); refz.resize(0);
+}
+
+void MultiReferenceRMSD::setType( const std::string& mytype ) {
+  if( mytype=="OPTIMAL" ) fast=false;
+  else if( mytype=="OPTIMAL-FAST" ) fast=true;
+  else plumed_merror("MultiReferenceRMSD only works with OPTIMAL and OPTIMAL-FAST alignment");
+}
+
+void MultiReferenceRMSD::setAlign( const std::vector<double>& w ) {
+  plumed_massert( nrefs==0, "weights must be set before the references are added");
+  double wsum=0; for(unsigned i=0; i<w.size(); ++i) wsum+=w[i];
+  plumed_massert( wsum>0, "the sum of the weights must be positive");
+  natoms=w.size(); align.resize( natoms );
+  for(unsigned i=0; i<natoms; ++i) align[i]=w[i]/wsum;
+}
+
+void MultiReferenceRMSD::addReference( const std::vector<Vector>& reference ) {
+  plumed_assert( reference.size()>0 ); addReference( reference.size(), &reference[0] );
+}
+
+void MultiReferenceRMSD::addReference( const unsigned& n, const Vector* reference ) {
+  if( align.size()==0 ) setAlign( std::vector<double>( n, 1.0 ) );
+  plumed_massert( n==natoms, "all the references must have the same number of atoms");
+  Vector center; for(unsigned i=0; i<natoms; ++i) center+=align[i]*reference[i];
+  double r11=0;
+  for(unsigned i=0; i<natoms; ++i) {
+    refpos.push_back( reference[i]-center ); r11+=align[i]*modulo2( reference[i]-center );
+  }
+  rr11.push_back( r11 );
+  // The arrays in which the reference index runs fastest are only rebuilt when they are full
+  if( nrefs==stride ) {
+    stride = stride>0 ? 2*stride : 4;
+    refx.resize( natoms*stride ); refy.resize( natoms*stride ); refz.resize( natoms*stride );
+    for(unsigned j=0; j<nrefs; ++j) {
+      for(unsigned i=0; i<natoms; ++i) {
+        refx[i*stride+j]=refpos[j*natoms+i][0]; refy[i*stride+j]=refpos[j*natoms+i][1]; refz[i*stride+j]=refpos[j*natoms+i][2];
+      }
+    }
+  }
+  for(unsigned i=0; i<natoms; ++i) {
+    refx[i*stride+nrefs]=refpos[nrefs*natoms+i][0]; refy[i*stride+nrefs]=refpos[nrefs*natoms+i][1]; refz[i*stride+nrefs]=refpos[nrefs*natoms+i][2];
+  }
+  nrefs++;
+}
+
+void MultiReferenceRMSD::calculate( const std::vector<Vector>& positions, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const {
+  std::vector<unsigned> which( nrefs ); for(unsigned i=0; i<nrefs; ++i) which[i]=i;
+  calculate( positions, which, dist, derivatives, squared );
+}
+
+void MultiReferenceRMSD::calculate( const std::vector<Vector>& positions, const std::vector<unsigned>& which, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const {
+  plumed_assert( positions.size()==natoms && natoms>0 );
+  calculate( &positions[0], which, dist, derivatives, squared );
+}
+
+void MultiReferenceRMSD::calculate( const Vector* positions, const std::vector<unsigned>& which, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const {
+  const unsigned nw=which.size();
+  if( dist.size()!=nw ) dist.resize( nw );
+  if( derivatives.size()!=nw*natoms ) derivatives.resize( nw*natoms );
+  if( nw==0 ) return;
+
+  // The positions are centered only once as all the references use the same weights
+  std::vector<Vector> cpos; double rr00=centerPositions( positions, cpos );
+
+  unsigned nt=OpenMP::getNumThreads(); if( nt>nw ) nt=nw;
+  // Each thread deals with a contiguous block of the requested references
+  #pragma omp parallel for num_threads(nt) schedule(static,1)
+  for(unsigned b=0; b<nt; ++b) {
+    unsigned kstart=(nw*b)/nt, nk=(nw*(b+1))/nt-kstart;
+    Workspace ws;
+    if( nk>0 ) calculateReferences( cpos, rr00, &which[kstart], nk, &dist[kstart], &derivatives[kstart*natoms], squared, ws );
+  }
+}
+
+void MultiReferenceRMSD::calculate( const Vector* positions, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared, Workspace& ws ) const {
+  if( dist.size()!=nrefs ) dist.resize( nrefs );
+  if( derivatives.size()!=nrefs*natoms ) derivatives.resize( nrefs*natoms );
+  if( nrefs==0 ) return;
+  double rr00=centerPositions( positions, ws.cpos );
+  calculateReferences( ws.cpos, rr00, NULL, nrefs, &dist[0], &derivatives[0], squared, ws );
+}
+
+void MultiReferenceRMSD::calculate( const Vector* positions, const std::vector<unsigned>& which, std::vector<double>& dist, const bool& squared, Workspace& ws ) const {
+  const unsigned nw=which.size();
+  if( dist.size()!=nw ) dist.resize( nw );
+  if( nw==0 ) return;
+  double rr00=centerPositions( positions, ws.cpos );
+  calculateReferences( ws.cpos, rr00, &which[0], nw, &dist[0], NULL, squared, ws );
+}
+
+double MultiReferenceRMSD::centerPositions( const Vector* positions, std::vector<Vector>& cpos ) const {
+  Vector center; for(unsigned i=0; i<natoms; ++i) center+=align[i]*positions[i];
+  if( cpos.size()!=natoms ) cpos.resize( natoms );
+  double rr00=0;
+  for(unsigned i=0; i<natoms; ++i) { cpos[i]=positions[i]-center; rr00+=align[i]*modulo2( cpos[i] ); }
+  return rr00;
+}
+
+void MultiReferenceRMSD::calculateReferences( const std::vector<Vector>& cpos, const double& rr00, const unsigned* which, const unsigned& nk,
+    double* dist, Vector* derivatives, const bool& squared, Workspace& ws ) const {
+  // The coordinates are read from the stored arrays when the references that are needed are contiguous.  Otherwise
+  // only the references in which are gathered so that the innermost loop is contiguous.  When which is NULL all the
+  // references are needed
+  bool contiguous=true;
+  if( which ) for(unsigned k=1; k<nk && contiguous; ++k) contiguous=( which[k]==which[0]+k );
+  const double* lx; const double* ly; const double* lz; unsigned ld;
+  if( contiguous ) {
+    unsigned first = which ? which[0] : 0;
+    lx=&refx[first]; ly=&refy[first]; lz=&refz[first]; ld=stride;
+  } else {
+    if( ws.lx.size()<natoms*nk ) { ws.lx.resize( natoms*nk ); ws.ly.resize( natoms*nk ); ws.lz.resize( natoms*nk ); }
+    for(unsigned i=0; i<natoms; ++i) {
+      for(unsigned k=0; k<nk; ++k) {
+        unsigned j=i*stride+which[k];
+        ws.lx[i*nk+k]=refx[j]; ws.ly[i*nk+k]=refy[j]; ws.lz[i*nk+k]=refz[j];
+      }
+    }
+    lx=ws.lx.data(); ly=ws.ly.data(); lz=ws.lz.data(); ld=nk;
+  }
+  // The covariance matrices between the positions and all the references
+  ws.c.assign( 9*nk, 0.0 );
+  double* c00=&ws.c[0]; double* c01=&ws.c[nk]; double* c02=&ws.c[2*nk];
+  double* c10=&ws.c[3*nk]; double* c11=&ws.c[4*nk]; double* c12=&ws.c[5*nk];
+  double* c20=&ws.c[6*nk]; double* c21=&ws.c[7*nk]; double* c22=&ws.c[8*nk];
+  for(unsigned i=0; i<natoms; ++i) {
+    const double px=align[i]*cpos[i][0], py=align[i]*cpos[i][1], pz=align[i]*cpos[i][2];
+    const double* rx=&lx[i*ld]; const double* ry=&ly[i*ld]; const double* rz=&lz[i*ld];
+    #pragma omp simd
+    for(unsigned k=0; k<nk; ++k) {
+      c00[k]+=px*rx[k]; c01[k]+=px*ry[k]; c02[k]+=px*rz[k];
+      c10[k]+=py*rx[k]; c11[k]+=py*ry[k]; c12[k]+=py*rz[k];
+      c20[k]+=pz*rx[k]; c21[k]+=pz*ry[k]; c22[k]+=pz*rz[k];
+    }
+  }
+  // Now find the optimal rotation for each reference in turn
+  for(unsigned k=0; k<nk; ++k) {
+    unsigned iref = which ? which[k] : k;
+    Tensor4d m;
+    m[0][0]=2.0*(-c00[k]-c11[k]-c22[k]);
+    m[1][1]=2.0*(-c00[k]+c11[k]+c22[k]);
+    m[2][2]=2.0*(+c00[k]-c11[k]+c22[k]);
+    m[3][3]=2.0*(+c00[k]+c11[k]-c22[k]);
+    m[0][1]=2.0*(-c12[k]+c21[k]);
+    m[0][2]=2.0*(+c02[k]-c20[k]);
+    m[0][3]=2.0*(-c01[k]+c10[k]);
+    m[1][2]=2.0*(-c01[k]-c10[k]);
+    m[1][3]=2.0*(-c02[k]-c20[k]);
+    m[2][3]=2.0*(-c12[k]-c21[k]);
+    m[1][0]=m[0][1]; m[2][0]=m[0][2]; m[2][1]=m[1][2];
+    m[3][0]=m[0][3]; m[3][1]=m[1][3]; m[3][2]=m[2][3];
+    double eval; Vector4d q; lowestQuaternionEigenpair( m, eval, q );
+
+    Tensor rotation;
+    rotation[0][0]=q[0]*q[0]+q[1]*q[1]-q[2]*q[2]-q[3]*q[3];
+    rotation[1][1]=q[0]*q[0]-q[1]*q[1]+q[2]*q[2]-q[3]*q[3];
+    rotation[2][2]=q[0]*q[0]-q[1]*q[1]-q[2]*q[2]+q[3]*q[3];
+    rotation[0][1]=2*(+q[0]*q[3]+q[1]*q[2]);
+    rotation[0][2]=2*(-q[0]*q[2]+q[1]*q[3]);
+    rotation[1][2]=2*(+q[0]*q[1]+q[2]*q[3]);
+    rotation[1][0]=2*(-q[0]*q[3]+q[1]*q[2]);
+    rotation[2][0]=2*(+q[0]*q[2]+q[1]*q[3]);
+    rotation[2][1]=2*(-q[0]*q[1]+q[2]*q[3]);
+
+    // The derivatives of the rotation and the centers are zero by construction so
+    // the derivative with respect to each atom is just the weighted displacement
+    double d2=0;
+    if( derivatives ) {
+      const Vector* ref=&refpos[iref*natoms]; Vector* der=&derivatives[k*natoms];
+      for(unsigned i=0; i<natoms; ++i) {
+        Vector d=cpos[i]-matmul(rotation,ref[i]);
+        d2+=align[i]*modulo2(d); der[i]=2*align[i]*d;
+      }
+    } else if( !fast ) {
+      const Vector* ref=&refpos[iref*natoms];
+      for(unsigned i=0; i<natoms; ++i) d2+=align[i]*modulo2( cpos[i]-matmul(rotation,ref[i]) );
+    }
+    if( fast ) d2=eval+rr00+rr11[iref];
+    if( !squared ) {
+      d2=sqrt(d2);
+      if( derivatives ) {
+        double prefactor=0.5/d2; Vector* der=&derivatives[k*natoms];
+        for(unsigned i=0; i<natoms; ++i) der[i]*=prefactor;
+      }
+    }
+    dist[k]=d2;
+  }
+}
+
+}
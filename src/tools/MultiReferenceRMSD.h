@@ -0,0 +1,110 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_MultiReferenceRMSD_h
+#define __PLUMED_tools_MultiReferenceRMSD_h
+
+#include "Vector.h"
+#include <vector>
+#include <string>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Calculates the MSD after optimal alignment between one set of positions and many reference
+/// structures in a single pass.  All the references must use the same weights for alignment
+/// and displacement so the positions only have to be centered once.  The reference coordinates are
+/// stored with the reference index running fastest so the covariance matrices for all the
+/// references are accumulated together in the loop over atoms.  The work is divided between
+/// OpenMP threads by reference unless a Workspace is passed to calculate, which is what should be done
+/// when the distances are calculated inside a loop that is already divided between threads.  The result
+/// is the same as that obtained with RMSD objects of type OPTIMAL or OPTIMAL-FAST with align equal to displace.
+class MultiReferenceRMSD {
+public:
+/// The buffers used by calculate.  These can be kept between calls so that nothing is allocated
+  struct Workspace {
+    std::vector<Vector> cpos;
+    std::vector<double> lx, ly, lz, c;
+  };
+private:
+/// Is the MSD taken from the eigenvalue (OPTIMAL-FAST) or recomputed from the rotation (OPTIMAL)
+  bool fast;
+/// The number of atoms and the number of references
+  unsigned natoms, nrefs;
+/// The stride of the arrays in which the reference index runs fastest.  This grows geometrically
+/// so adding a reference has an amortized cost that is linear in the number of atoms
+  unsigned stride;
+/// The weights of the atoms (normalized so they sum to one)
+  std::vector<double> align;
+/// The centered reference positions.  The reference index runs fastest.
+  std::vector<double> refx, refy, refz;
+/// The centered reference positions with the atom index running fastest
+  std::vector<Vector> refpos;
+/// The weighted sum of the squares of the centered reference positions
+  std::vector<double> rr11;
+/// Center the positions and return the weighted sum of their squares
+  double centerPositions( const Vector* positions, std::vector<Vector>& cpos ) const ;
+/// Calculate the distances between the centered positions and the nk references in which.  The derivatives
+/// are only calculated if derivatives is not NULL
+  void calculateReferences( const std::vector<Vector>& cpos, const double& rr00, const unsigned* which, const unsigned& nk,
+                            double* dist, Vector* derivatives, const bool& squared, Workspace& ws ) const ;
+public:
+  MultiReferenceRMSD();
+/// Remove all the references
+  void clear();
+/// Set the alignment method (OPTIMAL or OPTIMAL-FAST)
+  void setType( const std::string& mytype );
+/// Set the weights of the atoms.  This must be done before adding any reference.
+  void setAlign( const std::vector<double>& w );
+/// Add a reference structure
+  void addReference( const std::vector<Vector>& reference );
+/// Add a reference structure that is made of the n positions that start at reference
+  void addReference( const unsigned& n, const Vector* reference );
+/// Get the number of references
+  unsigned getNumberOfReferences() const ;
+/// Get the number of atoms
+  unsigned getNumberOfAtoms() const ;
+/// Calculate the distances from the references in the list which.  The derivatives of the
+/// distance from which[k] are returned in derivatives[k*natoms] to derivatives[(k+1)*natoms-1]
+  void calculate( const std::vector<Vector>& positions, const std::vector<unsigned>& which, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const ;
+/// Calculate the distances from the references in the list which for the natoms positions that start at positions
+  void calculate( const Vector* positions, const std::vector<unsigned>& which, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const ;
+/// Calculate the distances from the references in the list which without using threads and without derivatives
+  void calculate( const Vector* positions, const std::vector<unsigned>& which, std::vector<double>& dist, const bool& squared, Workspace& ws ) const ;
+/// Calculate the distances from all the references without using threads
+  void calculate( const Vector* positions, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared, Workspace& ws ) const ;
+/// Calculate the distances from all the references
+  void calculate( const std::vector<Vector>& positions, std::vector<double>& dist, std::vector<Vector>& derivatives, const bool& squared ) const ;
+};
+
+inline
+unsigned MultiReferenceRMSD::getNumberOfReferences() const {
+  return nrefs;
+}
+
+inline
+unsigned MultiReferenceRMSD::getNumberOfAtoms() const {
+  return natoms;
+}
+
+}
+
+#endif
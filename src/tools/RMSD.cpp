@@ -29,6 +29,113 @@
 using namespace std;
 namespace PLMD {
 
+namespace {
+
+/// The determinant of the 3x3 matrix obtained by removing row i and column j from a
+inline double minor3( const Tensor4d& a, const unsigned& i, const unsigned& j ) {
+  unsigned r[3], c[3];
+  for(unsigned k=0, kr=0, kc=0; k<4; ++k) { if(k!=i) r[kr++]=k; if(k!=j) c[kc++]=k; }
+  return a[r[0]][c[0]]*(a[r[1]][c[1]]*a[r[2]][c[2]]-a[r[1]][c[2]]*a[r[2]][c[1]])
+         -a[r[0]][c[1]]*(a[r[1]][c[0]]*a[r[2]][c[2]]-a[r[1]][c[2]]*a[r[2]][c[0]])
+         +a[r[0]][c[2]]*(a[r[1]][c[0]]*a[r[2]][c[1]]-a[r[1]][c[1]]*a[r[2]][c[0]]);
+}
+
+/// The adjugate of a symmetric 4x4 matrix
+void symmetricAdjugate( const Tensor4d& a, Tensor4d& adj ) {
+  for(unsigned i=0; i<4; ++i) for(unsigned j=i; j<4; ++j) {
+      adj[i][j]=adj[j][i]=( (i+j)%2 ? -1.0 : 1.0 )*minor3( a, j, i );
+    }
+}
+
+/// Make the first non-null element of the eigenvector positive as is done in diagMatSym
+void fixEigenvectorSign( Vector4d& evec ) {
+  for(unsigned j=0; j<4; ++j) {
+    if( evec[j]*evec[j]>1e-14 ) {
+      if( evec[j]<0.0 ) evec*=-1.0;
+      return;
+    }
+  }
+}
+
+/// The root mean square of the elements of m, which sets the scale of the eigenvalues
+double quaternionScale( const Tensor4d& m ) {
+  double p2=0.0;
+  for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) p2+=m[i][j]*m[i][j];
+  return sqrt(p2);
+}
+
+}
+
+bool lowestEigenpairQCP( const Tensor4d& m, double& eval, Vector4d& evec ) {
+  // The quaternion matrix is traceless so the characteristic polynomial is l^4 + c2 l^2 + c1 l + c0
+  double scale=quaternionScale( m );
+  if( scale<epsilon ) return false;
+  double p3=0.0;
+  for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) for(unsigned k=0; k<4; ++k) p3+=m[i][j]*m[j][k]*m[k][i];
+  Tensor4d adj; symmetricAdjugate( m, adj );
+  double c2=-0.5*scale*scale, c1=-p3/3.0, c0=0.0;
+  for(unsigned j=0; j<4; ++j) c0+=m[0][j]*adj[j][0];
+
+  // All the roots are real and no eigenvalue can be smaller than minus the Frobenius norm.  Newton's
+  // method thus converges monotonically to the lowest eigenvalue if we start from there
+  double lambda=-scale; bool converged=false;
+  for(unsigned iter=0; iter<100; ++iter) {
+    double l2=lambda*lambda;
+    double p=(l2+c2)*l2 + c1*lambda + c0;
+    double dp=(4.0*l2+2.0*c2)*lambda + c1;
+    if( dp==0.0 ) break;
+    double delta=p/dp; lambda-=delta;
+    if( std::abs(delta)<=1e-15*scale ) { converged=true; break; }
+  }
+  if( !converged ) return false;
+
+  // Any non-null column of the adjugate of m-lambda is parallel to the eigenvector
+  Tensor4d a(m); for(unsigned i=0; i<4; ++i) a[i][i]-=lambda;
+  symmetricAdjugate( a, adj );
+  unsigned jmax=0; double nmax=0.0;
+  for(unsigned j=0; j<4; ++j) {
+    double n2=0.0; for(unsigned i=0; i<4; ++i) n2+=adj[i][j]*adj[i][j];
+    if( n2>nmax ) { nmax=n2; jmax=j; }
+  }
+  // The norm of the adjugate is the product of the gaps between lambda and the other eigenvalues so if it is
+  // small the lowest eigenvalue is (nearly) degenerate and the eigenvector cannot be found accurately this way
+  nmax=sqrt(nmax);
+  if( nmax<1e-6*scale*scale*scale ) return false;
+  for(unsigned i=0; i<4; ++i) evec[i]=adj[i][jmax]/nmax;
+  fixEigenvectorSign( evec );
+  // The Rayleigh quotient is a more accurate estimate of the eigenvalue than the root of the polynomial
+  eval=0.0;
+  for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) eval+=evec[i]*m[i][j]*evec[j];
+  return true;
+}
+
+void lowestQuaternionEigenpair( const Tensor4d& m, double& eval, Vector4d& evec ) {
+  if( lowestEigenpairQCP( m, eval, evec ) ) return;
+  VectorGeneric<1> eigenvals; TensorGeneric<1,4> eigenvecs;
+  diagMatSym( m, eigenvals, eigenvecs );
+  eval=eigenvals[0]; for(unsigned i=0; i<4; ++i) evec[i]=eigenvecs[0][i];
+}
+
+void lowestQuaternionEigenpair( const Tensor4d& m, double& eval, Vector4d& evec, Tensor4d& pert ) {
+  if( lowestEigenpairQCP( m, eval, evec ) ) {
+    // m - eval + scale*q*q^T is positive definite and its inverse is q*q^T/scale - pert
+    double scale=quaternionScale( m );
+    Tensor4d b(m), adj;
+    for(unsigned i=0; i<4; ++i) { b[i][i]-=eval; for(unsigned j=0; j<4; ++j) b[i][j]+=scale*evec[i]*evec[j]; }
+    symmetricAdjugate( b, adj );
+    double det=0.0; for(unsigned j=0; j<4; ++j) det+=b[0][j]*adj[j][0];
+    for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) pert[i][j]=evec[i]*evec[j]/scale - adj[i][j]/det;
+    return;
+  }
+  Vector4d eigenvals; Tensor4d eigenvecs;
+  diagMatSym( m, eigenvals, eigenvecs );
+  eval=eigenvals[0]; for(unsigned i=0; i<4; ++i) evec[i]=eigenvecs[0][i];
+  for(unsigned i=0; i<4; ++i) for(unsigned j=0; j<4; ++j) {
+      pert[i][j]=0.0;
+      for(unsigned l=1; l<4; ++l) pert[i][j]+=eigenvecs[l][i]*eigenvecs[l][j]/(eigenvals[0]-eigenvals[l]);
+    }
+}
+
 RMSD::RMSD() : alignmentMethod(SIMPLE),reference_center_is_calculated(false),reference_center_is_removed(false),positions_center_is_calculated(false),positions_center_is_removed(false) {}
 
 ///
@@ -498,18 +605,13 @@ double RMSD::optimalAlignment(const  std::vector<double>  & align,
 
   Tensor dq_drr01[4];
   if(!alEqDis) {
-    Vector4d eigenvals;
-    Tensor4d eigenvecs;
-    diagMatSym(m, eigenvals, eigenvecs );
-    dist=eigenvals[0]+rr00+rr11;
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    double eigenval;
+    Tensor4d pert;
+    lowestQuaternionEigenpair(m, eigenval, q, pert );
+    dist=eigenval+rr00+rr11;
     double dq_dm[4][4][4];
-    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) {
-          double tmp=0.0;
 // perturbation theory for matrix m
-          for(unsigned l=1; l<4; l++) tmp+=eigenvecs[l][j]*eigenvecs[l][i]/(eigenvals[0]-eigenvals[l])*eigenvecs[0][k];
-          dq_dm[i][j][k]=tmp;
-        }
+    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) dq_dm[i][j][k]=pert[i][j]*q[k];
 // propagation to _drr01
     for(unsigned i=0; i<4; i++) {
       Tensor tmp;
@@ -519,11 +621,9 @@ double RMSD::optimalAlignment(const  std::vector<double>  & align,
       dq_drr01[i]=tmp;
     }
   } else {
-    VectorGeneric<1> eigenvals;
-    TensorGeneric<1,4> eigenvecs;
-    diagMatSym(m, eigenvals, eigenvecs );
-    dist=eigenvals[0]+rr00+rr11;
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    double eigenval;
+    lowestQuaternionEigenpair(m, eigenval, q );
+    dist=eigenval+rr00+rr11;
   }
 
 
@@ -1035,15 +1135,12 @@ void RMSDCoreData::doCoreCalc(bool safe,bool alEqDis, bool only_rotation) {
 
   Tensor dq_drr01[4];
   if(!alEqDis or !only_rotation) {
-    diagMatSym(m, eigenvals, eigenvecs );
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    Tensor4d pert;
+    lowestQuaternionEigenpair(m, eigenvals[0], q, pert );
+    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=q[i];
     double dq_dm[4][4][4];
-    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) {
-          double tmp=0.0;
 // perturbation theory for matrix m
-          for(unsigned l=1; l<4; l++) tmp+=eigenvecs[l][j]*eigenvecs[l][i]/(eigenvals[0]-eigenvals[l])*eigenvecs[0][k];
-          dq_dm[i][j][k]=tmp;
-        }
+    for(unsigned i=0; i<4; i++) for(unsigned j=0; j<4; j++) for(unsigned k=0; k<4; k++) dq_dm[i][j][k]=pert[i][j]*q[k];
 // propagation to _drr01
     for(unsigned i=0; i<4; i++) {
       Tensor tmp;
@@ -1053,12 +1150,8 @@ void RMSDCoreData::doCoreCalc(bool safe,bool alEqDis, bool only_rotation) {
       dq_drr01[i]=tmp;
     }
   } else {
-    TensorGeneric<1,4> here_eigenvecs;
-    VectorGeneric<1> here_eigenvals;
-    diagMatSym(m, here_eigenvals, here_eigenvecs );
-    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=here_eigenvecs[0][i];
-    eigenvals[0]=here_eigenvals[0];
-    q=Vector4d(eigenvecs[0][0],eigenvecs[0][1],eigenvecs[0][2],eigenvecs[0][3]);
+    lowestQuaternionEigenpair(m, eigenvals[0], q );
+    for(unsigned i=0; i<4; i++) eigenvecs[0][i]=q[i];
   }
 
 // This is the rotation matrix that brings reference to positions
@@ -34,6 +34,17 @@ namespace PLMD {
 class Log;
 class PDB;
 
+/// Find the lowest eigenvalue and the corresponding eigenvector of the 4x4 quaternion matrix that is used for
+/// optimal alignment with the quaternion characteristic polynomial (QCP) method.  The eigenvalue is found by Newton's
+/// method on the characteristic polynomial and the eigenvector from the adjugate of m-eval.  This returns false if
+/// the method fails (e.g. because the lowest eigenvalue is degenerate), in which case diagMatSym should be used instead
+bool lowestEigenpairQCP( const Tensor4d& m, double& eval, Vector4d& evec );
+/// Find the lowest eigenvalue and eigenvector of the quaternion matrix.  QCP is used if possible and LAPACK otherwise.
+void lowestQuaternionEigenpair( const Tensor4d& m, double& eval, Vector4d& evec );
+/// As above but also compute the matrix \f$\sum_{l>0} v_l v_l^T / (\lambda_0-\lambda_l)\f$, which is needed
+/// to compute the derivative of the eigenvector with respect to the elements of m
+void lowestQuaternionEigenpair( const Tensor4d& m, double& eval, Vector4d& evec, Tensor4d& pert );
+
 /** \ingroup TOOLBOX
 A class that implements RMSD calculations
 This is a class that implements the various infrastructure to calculate the
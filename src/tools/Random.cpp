@@ -20,6 +20,7 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Random.h"
+#include "CheckpointData.h"
 #include <cmath>
 #include <cstdlib>
 #include <sstream>
@@ -133,6 +134,22 @@ void Random::fromString(const std::string & str) {
   for (int i = 0; i < NTAB; i++) istr>>iv[i];
 }
 
+void Random::writeCheckpoint(CheckpointData&cp)const {
+  cp.write(idum);
+  cp.write(iy);
+  cp.write(iv);
+  cp.write(switchGaussian);
+  cp.write(saveGaussian);
+}
+
+void Random::readCheckpoint(CheckpointData&cp) {
+  cp.read(idum);
+  cp.read(iy);
+  cp.read(iv);
+  cp.read(switchGaussian);
+  cp.read(saveGaussian);
+}
+
 // This allows to have the same stream of random numbers
 // with different compilers:
 #ifdef __INTEL_COMPILER
@@ -28,6 +28,8 @@
 
 namespace PLMD {
 
+class CheckpointData;
+
 /// \ingroup TOOLBOX
 class Random {
   static const int IA=16807,IM=2147483647,IQ=127773,IR=2836,NTAB=32;
@@ -56,6 +58,10 @@ public:
   void ReadStateFull (std::istream &);
   void fromString(const std::string & str);
   void toString(std::string & str)const;
+/// Save the full state in a binary checkpoint
+  void writeCheckpoint(CheckpointData&)const;
+/// Restore the state saved with writeCheckpoint()
+  void readCheckpoint(CheckpointData&);
   friend std::ostream & operator<<(std::ostream & out,const Random & rng) {
     rng.WriteStateFull(out); return out;
   }
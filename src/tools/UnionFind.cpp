@@ -0,0 +1,89 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "UnionFind.h"
+#include "OpenMP.h"
+#include "Exception.h"
+
+namespace PLMD {
+
+UnionFind::UnionFind( const unsigned& n ):
+  nnodes(0)
+{
+  resize(n);
+}
+
+void UnionFind::resize( const unsigned& n ) {
+  if( n!=nnodes ) {
+    nnodes=n; parent.reset( new std::atomic<unsigned>[n] );
+  }
+  clear();
+}
+
+void UnionFind::clear() {
+  for(unsigned i=0; i<nnodes; ++i) parent[i].store(i);
+}
+
+unsigned UnionFind::find( unsigned i ) {
+  plumed_dbg_assert( i<nnodes );
+  while( true ) {
+    unsigned p=parent[i].load();
+    if( p==i ) return i;
+    // Path halving.  If another thread has changed the parent in the meantime nothing is lost
+    unsigned gp=parent[p].load();
+    if( gp!=p ) parent[i].compare_exchange_weak( p, gp );
+    i=gp;
+  }
+}
+
+void UnionFind::merge( unsigned i, unsigned j ) {
+  while( true ) {
+    i=find(i); j=find(j);
+    if( i==j ) return;
+    // Always attach the root with the larger index to the root with the smaller index
+    if( i<j ) std::swap(i,j);
+    // This fails if some other thread has attached root i somewhere else, in which case we try again
+    unsigned expected=i;
+    if( parent[i].compare_exchange_strong( expected, j ) ) return;
+  }
+}
+
+void UnionFind::mergeEdges( const unsigned& nedge, const std::vector<std::pair<unsigned,unsigned> >& edge_list ) {
+  plumed_dbg_assert( nedge<=edge_list.size() );
+  if( nedge==0 ) return;
+  unsigned nt=OpenMP::getGoodNumThreads( &edge_list[0], nedge );
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned i=0; i<nedge; ++i) merge( edge_list[i].first, edge_list[i].second );
+}
+
+unsigned UnionFind::getComponents( std::vector<unsigned>& which_cluster ) {
+  if( which_cluster.size()!=nnodes ) which_cluster.resize( nnodes );
+  // Roots have lower indices than the other members of their sets so they are always labelled first
+  unsigned ncomponents=0;
+  for(unsigned i=0; i<nnodes; ++i) {
+    unsigned root=find(i);
+    if( root==i ) { which_cluster[i]=ncomponents; ncomponents++; }
+    else which_cluster[i]=which_cluster[root];
+  }
+  return ncomponents;
+}
+
+}
@@ -0,0 +1,72 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_UnionFind_h
+#define __PLUMED_tools_UnionFind_h
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// A concurrent union-find (disjoint set) structure that can be used to find the connected
+/// components of a graph from a list of edges.  Edges can be merged from several OpenMP threads
+/// at the same time as the parent of each node is only ever changed with a compare and swap.
+/// The parent of a node always has an index that is lower than or equal to the index of the node
+/// so the root of each set is the node with the lowest index.  Components are thus numbered
+/// in the same order as they would be by a depth first search that starts from node zero.
+class UnionFind {
+private:
+/// The number of nodes
+  unsigned nnodes;
+/// The parent of each node
+  std::unique_ptr<std::atomic<unsigned>[]> parent;
+public:
+/// Constructor
+  explicit UnionFind( const unsigned& n=0 );
+/// Set the number of nodes and put each node in its own set
+  void resize( const unsigned& n );
+/// Put each node in its own set
+  void clear();
+/// Get the number of nodes
+  unsigned size() const ;
+/// Find the root of the set that contains node i
+  unsigned find( unsigned i );
+/// Merge the sets that contain nodes i and j
+  void merge( unsigned i, unsigned j );
+/// Merge the sets connected by the first nedge edges in the edge list.  This is done in parallel
+  void mergeEdges( const unsigned& nedge, const std::vector<std::pair<unsigned,unsigned> >& edge_list );
+/// Find the connected components.  Returns the number of components and which_cluster
+/// is used to return the component each node is in
+  unsigned getComponents( std::vector<unsigned>& which_cluster );
+};
+
+inline
+unsigned UnionFind::size() const {
+  return nnodes;
+}
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "VerletList.h"
+#include "Communicator.h"
+#include "OpenMP.h"
+#include "Pbc.h"
+#include "Tools.h"
+#include <algorithm>
+
+namespace PLMD {
+
+VerletList::VerletList( Communicator& cc ) :
+  cutoff(0.0),
+  skin(0.0),
+  stride(0),
+  built(false),
+  laststep(0),
+  nbuilds(0),
+  cells(cc)
+{
+}
+
+void VerletList::setCutoff( const double& lcut, const double& lskin ) {
+  plumed_assert( lcut>0 && lskin>=0 );
+  cutoff=lcut; skin=lskin; reset();
+  if( enabled() ) cells.setCutoff( cutoff + skin );
+}
+
+void VerletList::setStride( const unsigned& nstride ) {
+  stride=nstride;
+}
+
+void VerletList::reset() {
+  built=false;
+}
+
+double VerletList::getMaximumDisplacement( const std::vector<Vector>& ref, const std::vector<Vector>& pos, const bool& usepbc, const Pbc& pbc ) const {
+  plumed_dbg_assert( ref.size()==pos.size() );
+  double maxd2=0;
+  for(unsigned i=0; i<pos.size(); ++i) {
+    Vector disp;
+    if( usepbc ) disp=pbc.distance( ref[i], pos[i] );
+    else disp=delta( ref[i], pos[i] );
+    double d2=disp.modulo2(); if( d2>maxd2 ) maxd2=d2;
+  }
+  return sqrt( maxd2 );
+}
+
+bool VerletList::needsUpdate( const long int& step, const std::vector<Vector>& cpos, const std::vector<unsigned>& cind,
+                              const std::vector<Vector>& pos, const std::vector<unsigned>& ind, const bool& usepbc, const Pbc& pbc ) const {
+  if( !built || step<laststep ) return true;
+  if( stride>0 && step-laststep>=stride ) return true;
+  // The sets of atoms have changed (e.g. because of a filter)
+  if( cind!=ref_cind || ind!=ref_ind ) return true;
+  // Changes in the cell vectors move the periodic images of the atoms
+  double boxshift=0;
+  if( usepbc ) {
+    for(unsigned k=0; k<3; ++k) boxshift += delta( refbox.getRow(k), pbc.getBox().getRow(k) ).modulo();
+  }
+  // The distance between a central atom and a neighbor can change by at most the sum of their displacements
+  double maxdisp = getMaximumDisplacement( ref_cpos, cpos, usepbc, pbc ) + getMaximumDisplacement( ref_pos, pos, usepbc, pbc );
+  return maxdisp + boxshift > skin;
+}
+
+bool VerletList::update( const long int& step, const std::vector<Vector>& cpos, const std::vector<unsigned>& cind,
+                         const std::vector<Vector>& pos, const std::vector<unsigned>& ind, const bool& usepbc, const Pbc& pbc ) {
+  plumed_assert( enabled() && cpos.size()==cind.size() && pos.size()==ind.size() );
+  if( !needsUpdate( step, cpos, cind, pos, ind, usepbc, pbc ) ) return false;
+
+  // Store everything we need to check if the list is still valid
+  built=true; laststep=step; nbuilds++;
+  refbox=pbc.getBox(); ref_cind=cind; ref_ind=ind; ref_cpos=cpos; ref_pos=pos;
+
+  // Build the link cells using the positions in the list of neighbors
+  row_starts.resize( cpos.size()+1 ); row_starts[0]=0;
+  if( pos.size()==0 ) {
+    for(unsigned i=0; i<cpos.size(); ++i) row_starts[i+1]=0;
+    neighbors.resize(0); return true;
+  }
+  std::vector<unsigned> lind( pos.size() );
+  for(unsigned i=0; i<pos.size(); ++i) lind[i]=i;
+  cells.buildCellLists( pos, lind, pbc );
+
+  // Each thread gets a contiguous block of rows so that the rows can be merged in order afterwards
+  double lcut2=getListCutoff()*getListCutoff();
+  unsigned nt=OpenMP::getGoodNumThreads( cpos );
+  std::vector<std::vector<unsigned> > tneighbors( nt );
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<unsigned> cell_list, latoms( 1+pos.size() );
+    std::vector<unsigned>& myneigh( tneighbors[OpenMP::getThreadNum()] );
+    #pragma omp for schedule(static)
+    for(unsigned i=0; i<cpos.size(); ++i) {
+      // pos.size() is never a valid index so nothing is removed from the list of atoms in the cells
+      unsigned natomsper=1; latoms[0]=pos.size();
+      cells.retrieveNeighboringAtoms( cpos[i], cell_list, natomsper, latoms );
+      unsigned nstart=myneigh.size();
+      for(unsigned j=1; j<natomsper; ++j) {
+        Vector sep;
+        if( usepbc ) sep=pbc.distance( cpos[i], pos[latoms[j]] );
+        else sep=delta( cpos[i], pos[latoms[j]] );
+        if( sep.modulo2()<=lcut2 ) myneigh.push_back( ind[latoms[j]] );
+      }
+      std::sort( myneigh.begin()+nstart, myneigh.end() );
+      row_starts[i+1]=myneigh.size()-nstart;
+    }
+  }
+
+  // Now merge everything in compressed sparse row format
+  for(unsigned i=0; i<cpos.size(); ++i) row_starts[i+1]+=row_starts[i];
+  neighbors.resize( row_starts[cpos.size()] ); unsigned k=0;
+  for(unsigned t=0; t<nt; ++t) {
+    for(unsigned j=0; j<tneighbors[t].size(); ++j) { neighbors[k]=tneighbors[t][j]; k++; }
+  }
+  plumed_assert( k==neighbors.size() );
+  return true;
+}
+
+void VerletList::retrieveNeighboringAtoms( const unsigned& irow, unsigned& natomsper, std::vector<unsigned>& atoms ) const {
+  plumed_dbg_assert( built && irow<getNumberOfRows() );
+  plumed_assert( natomsper==1 || natomsper==2 );
+  for(unsigned k=row_starts[irow]; k<row_starts[irow+1]; ++k) {
+    if( neighbors[k]!=atoms[0] ) { atoms[natomsper]=neighbors[k]; natomsper++; }
+  }
+}
+
+}
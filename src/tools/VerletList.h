@@ -0,0 +1,133 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_VerletList_h
+#define __PLUMED_tools_VerletList_h
+
+#include <vector>
+#include "Vector.h"
+#include "Tensor.h"
+#include "LinkCells.h"
+
+namespace PLMD {
+
+class Communicator;
+class Pbc;
+
+/// \ingroup TOOLBOX
+/// A Verlet list that stores, for each of a set of central atoms, the atoms that are
+/// within cutoff+skin of it.  The list is built using link cells and is stored in
+/// compressed sparse row format.  It only needs to be rebuilt once the atoms have moved
+/// far enough that some pair that was outside cutoff+skin may now be inside the cutoff.
+class VerletList {
+private:
+/// The cutoff
+  double cutoff;
+/// The skin that is added to the cutoff when the list is built
+  double skin;
+/// The list is rebuilt at least this often if this is larger than zero
+  unsigned stride;
+/// Has the list been built
+  bool built;
+/// The step at which the list was last built
+  long int laststep;
+/// The number of times the list was built
+  unsigned nbuilds;
+/// The link cells that are used to build the list
+  LinkCells cells;
+/// The box at the time the list was last built
+  Tensor refbox;
+/// The indices of the central atoms and the neighbors used in the last build
+  std::vector<unsigned> ref_cind, ref_ind;
+/// The positions of the central atoms and the neighbors in the last build
+  std::vector<Vector> ref_cpos, ref_pos;
+/// The start of each row in the list of neighbors (size number of central atoms + 1)
+  std::vector<unsigned> row_starts;
+/// The neighbors of each of the central atoms
+  std::vector<unsigned> neighbors;
+/// Get the largest displacement between a set of positions and the reference positions
+  double getMaximumDisplacement( const std::vector<Vector>& ref, const std::vector<Vector>& pos, const bool& usepbc, const Pbc& pbc ) const ;
+public:
+///
+  explicit VerletList( Communicator& comm );
+/// Set the cutoff and the skin
+  void setCutoff( const double& lcut, const double& lskin );
+/// Set the maximum number of steps between rebuilds of the list
+  void setStride( const unsigned& nstride );
+/// Is the list being used
+  bool enabled() const ;
+/// Get the cutoff that is used to decide whether atoms are in the list
+  double getListCutoff() const ;
+/// Get the number of times the list has been built
+  unsigned getNumberOfBuilds() const ;
+/// Force a rebuild of the list at the next call to update
+  void reset();
+/// Check if the list needs to be rebuilt given the current positions of the atoms
+  bool needsUpdate( const long int& step, const std::vector<Vector>& cpos, const std::vector<unsigned>& cind,
+                    const std::vector<Vector>& pos, const std::vector<unsigned>& ind, const bool& usepbc, const Pbc& pbc ) const ;
+/// Rebuild the list if needed.  Returns true if the list was rebuilt.
+  bool update( const long int& step, const std::vector<Vector>& cpos, const std::vector<unsigned>& cind,
+               const std::vector<Vector>& pos, const std::vector<unsigned>& ind, const bool& usepbc, const Pbc& pbc );
+/// Get the number of rows (central atoms) in the list
+  unsigned getNumberOfRows() const ;
+/// Get the number of neighbors of the irow th central atom
+  unsigned getNumberOfNeighbors( const unsigned& irow ) const ;
+/// Get the jth neighbor of the irow th central atom
+  unsigned getNeighbor( const unsigned& irow, const unsigned& j ) const ;
+/// Retrieve the neighbors of the irow th central atom.  This works like LinkCells::retrieveAtomsInCells
+/// in that atoms that are equal to atoms[0] are not added to the list
+  void retrieveNeighboringAtoms( const unsigned& irow, unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
+};
+
+inline
+bool VerletList::enabled() const {
+  return skin>0;
+}
+
+inline
+double VerletList::getListCutoff() const {
+  return cutoff + skin;
+}
+
+inline
+unsigned VerletList::getNumberOfBuilds() const {
+  return nbuilds;
+}
+
+inline
+unsigned VerletList::getNumberOfRows() const {
+  if( row_starts.size()==0 ) return 0;
+  return row_starts.size()-1;
+}
+
+inline
+unsigned VerletList::getNumberOfNeighbors( const unsigned& irow ) const {
+  return row_starts[irow+1] - row_starts[irow];
+}
+
+inline
+unsigned VerletList::getNeighbor( const unsigned& irow, const unsigned& j ) const {
+  return neighbors[row_starts[irow]+j];
+}
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "WorkerThread.h"
+#include "Exception.h"
+#include <exception>
+
+#ifdef __PLUMED_HAS_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace PLMD {
+
+class WorkerThread::Impl {
+public:
+/// Task to be run
+  std::function<void()> task;
+/// Exception thrown by the last task
+  std::exception_ptr error;
+/// True between start() and wait()
+  bool running=false;
+#ifdef __PLUMED_HAS_THREADS
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+/// True when a task has been handed over and is not completed yet
+  bool busy=false;
+/// True when the thread should exit
+  bool quit=false;
+/// Loop executed by the thread
+  void loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+      cv.wait(lock,[this] {return busy || quit;});
+      if(!busy) return;
+      lock.unlock();
+      try {
+        task();
+      } catch(...) {
+        error=std::current_exception();
+      }
+      lock.lock();
+      busy=false;
+      cv.notify_all();
+    }
+  }
+#endif
+/// Run the task in the calling thread
+  void runHere() {
+    try {
+      task();
+    } catch(...) {
+      error=std::current_exception();
+    }
+  }
+};
+
+WorkerThread::WorkerThread():
+  impl(new Impl)
+{
+}
+
+WorkerThread::~WorkerThread() {
+#ifdef __PLUMED_HAS_THREADS
+  if(impl->thread.joinable()) {
+    {
+      std::unique_lock<std::mutex> lock(impl->mutex);
+      impl->cv.wait(lock,[this] {return !impl->busy;});
+      impl->quit=true;
+    }
+    impl->cv.notify_all();
+    impl->thread.join();
+  }
+#endif
+}
+
+void WorkerThread::start(const std::function<void()> & task) {
+  plumed_massert(!impl->running,"a task was started before the previous one was waited for");
+  impl->task=task;
+  impl->error=nullptr;
+  impl->running=true;
+#ifdef __PLUMED_HAS_THREADS
+  {
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    impl->busy=true;
+  }
+  if(!impl->thread.joinable()) impl->thread=std::thread(&Impl::loop,impl.get());
+  else impl->cv.notify_all();
+#else
+  impl->runHere();
+#endif
+}
+
+void WorkerThread::wait() {
+  if(!impl->running) return;
+#ifdef __PLUMED_HAS_THREADS
+  {
+    std::unique_lock<std::mutex> lock(impl->mutex);
+    impl->cv.wait(lock,[this] {return !impl->busy;});
+  }
+#endif
+  impl->running=false;
+  impl->task=nullptr;
+  if(impl->error) {
+    std::exception_ptr e=impl->error;
+    impl->error=nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+bool WorkerThread::isRunning() const {
+  return impl->running;
+}
+
+bool WorkerThread::hasThreads() {
+#ifdef __PLUMED_HAS_THREADS
+  return true;
+#else
+  return false;
+#endif
+}
+
+}
@@ -0,0 +1,58 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_WorkerThread_h
+#define __PLUMED_tools_WorkerThread_h
+
+#include <functional>
+#include <memory>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// A thread that executes tasks in the background of the thread that owns it.
+/// The thread is created with the first task and is then reused for all the following ones,
+/// so that the cost of starting a thread is not paid every time.  Only one task can be run at a time:
+/// start() hands a task over and returns immediately, wait() returns when the task is completed.
+/// If the task throws, the exception is stored and rethrown by wait() in the thread that owns the object.
+/// When plumed is compiled without thread support (__PLUMED_HAS_THREADS not defined) the task is run by start().
+class WorkerThread {
+/// Implementation, hidden so as not to include the thread headers here
+  class Impl;
+  std::unique_ptr<Impl> impl;
+public:
+/// Constructor
+  WorkerThread();
+/// Destructor. If a task is still running it waits for it, discarding its exceptions
+  ~WorkerThread();
+/// Start a task. It is an error to start a task while the previous one has not been waited for
+  void start(const std::function<void()> & task);
+/// Wait for the task started with start() and rethrow the exception it might have thrown
+  void wait();
+/// True between start() and wait()
+  bool isRunning() const;
+/// True if tasks are run in a separate thread
+  static bool hasThreads();
+};
+
+}
+
+#endif
@@ -0,0 +1,714 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "XdrFile.h"
+#include "Exception.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// The compression of xtc coordinates is the 3dfcoord algorithm written by
+// Frans van Hoesel as part of the Europort project in 1995, as it is
+// implemented in GROMACS and in the xdrfile library.
+
+namespace PLMD {
+
+namespace {
+
+const int xtcMagic=1995;
+const int trrMagic=1993;
+const char trrVersion[]="GMX_trn_file";
+
+/// Sizes of the triplets of small integers. magicints[i]^3 is just below 2^i,
+/// so that a triplet of integers smaller than magicints[i] can be stored in i bits
+const int magicints[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 10, 12, 16, 20, 25, 32, 40, 50, 64,
+  80, 101, 128, 161, 203, 256, 322, 406, 512, 645, 812, 1024, 1290,
+  1625, 2048, 2580, 3250, 4096, 5060, 6501, 8192, 10321, 13003, 16384,
+  20642, 26007, 32768, 41285, 52015, 65536, 82570, 104031, 131072,
+  165140, 208063, 262144, 330280, 416127, 524287, 660561, 832255,
+  1048576, 1321122, 1664510, 2097152, 2642245, 3329021, 4194304,
+  5284491, 6658042, 8388607, 10568983, 13316085, 16777216
+};
+
+const int firstidx=9;
+const int lastidx=sizeof(magicints)/sizeof(magicints[0]);
+const int maxabs=INT_MAX-2;
+
+/// masks[n] has the n lowest bits set
+const uint32_t masks[33] = {
+  0x0u, 0x1u, 0x3u, 0x7u, 0xfu, 0x1fu, 0x3fu, 0x7fu, 0xffu,
+  0x1ffu, 0x3ffu, 0x7ffu, 0xfffu, 0x1fffu, 0x3fffu, 0x7fffu, 0xffffu,
+  0x1ffffu, 0x3ffffu, 0x7ffffu, 0xfffffu, 0x1fffffu, 0x3fffffu, 0x7fffffu, 0xffffffu,
+  0x1ffffffu, 0x3ffffffu, 0x7ffffffu, 0xfffffffu, 0x1fffffffu, 0x3fffffffu, 0x7fffffffu, 0xffffffffu
+};
+
+inline uint32_t bswap(uint32_t x) {
+  return (x>>24) | ((x>>8)&0xff00u) | ((x<<8)&0xff0000u) | (x<<24);
+}
+
+/// XDR stores everything in big endian units of four bytes
+inline uint32_t getUnsigned(const unsigned char*p) {
+  return (uint32_t(p[0])<<24) | (uint32_t(p[1])<<16) | (uint32_t(p[2])<<8) | uint32_t(p[3]);
+}
+
+inline int getInt(const unsigned char*p) {
+  return int32_t(getUnsigned(p));
+}
+
+inline float getFloat(const unsigned char*p) {
+  uint32_t u=getUnsigned(p);
+  float f;
+  std::memcpy(&f,&u,4);
+  return f;
+}
+
+inline double getDouble(const unsigned char*p) {
+  uint64_t u=(uint64_t(getUnsigned(p))<<32) | getUnsigned(p+4);
+  double d;
+  std::memcpy(&d,&u,8);
+  return d;
+}
+
+inline void putInt(std::vector<unsigned char>&b,int i) {
+  uint32_t u=uint32_t(i);
+  b.push_back(u>>24); b.push_back(u>>16); b.push_back(u>>8); b.push_back(u);
+}
+
+inline void putFloat(std::vector<unsigned char>&b,float f) {
+  uint32_t u;
+  std::memcpy(&u,&f,4);
+  putInt(b,int32_t(u));
+}
+
+/// Number of bits needed to store integers smaller than size
+int sizeofint(unsigned size) {
+  unsigned num=1;
+  int nbits=0;
+  while(size>=num && nbits<32) {
+    nbits++;
+    num<<=1;
+  }
+  return nbits;
+}
+
+/// Number of bits needed to store nints integers, the i-th one being smaller than sizes[i]
+int sizeofints(int nints,const unsigned sizes[]) {
+  unsigned bytes[32];
+  unsigned nbytes=1;
+  bytes[0]=1;
+  for(int i=0; i<nints; i++) {
+    unsigned tmp=0;
+    unsigned bytecnt;
+    for(bytecnt=0; bytecnt<nbytes; bytecnt++) {
+      tmp=bytes[bytecnt]*sizes[i]+tmp;
+      bytes[bytecnt]=tmp&0xff;
+      tmp>>=8;
+    }
+    while(tmp!=0) {
+      bytes[bytecnt++]=tmp&0xff;
+      tmp>>=8;
+    }
+    nbytes=bytecnt;
+  }
+  unsigned num=1;
+  int nbits=0;
+  nbytes--;
+  while(bytes[nbytes]>=num) {
+    nbits++;
+    num*=2;
+  }
+  return nbits+nbytes*8;
+}
+
+/// Reads bits from the compressed coordinates. Four bytes at a time are loaded in a 64 bit buffer,
+/// so that at most one load is needed for each request of up to 32 bits
+class BitReader {
+  const unsigned char* p;
+  const unsigned char* end;
+  uint64_t acc;
+  unsigned nacc;
+public:
+/// The data between p and end must be a multiple of four bytes
+  BitReader(const unsigned char*p,const unsigned char*end): p(p), end(end), acc(0), nacc(0) {}
+/// Get the next n bits, n<=32
+  uint32_t get(unsigned n) {
+    if(nacc<n) {
+      plumed_massert(p<end,"corrupted xtc data");
+      acc=(acc<<32) | getUnsigned(p);
+      p+=4;
+      nacc+=32;
+    }
+    nacc-=n;
+    return uint32_t(acc>>nacc) & masks[n];
+  }
+};
+
+/// Read nints integers stored in nbits bits, the i-th one being smaller than sizes[i].
+/// The bytes of the packed number are stored starting from the least significant one
+void receiveints(BitReader&br,int nbits,const unsigned sizes[3],int nums[3]) {
+  if(nbits<=64) {
+// the full bytes are read up to four at a time and then reordered
+    unsigned nfull=(nbits-1)/8;
+    unsigned rest=nbits-8*nfull;
+    uint64_t v=0;
+    unsigned shift=0;
+    while(nfull>=4) {
+      v|=uint64_t(bswap(br.get(32)))<<shift;
+      shift+=32;
+      nfull-=4;
+    }
+    if(nfull>0) {
+      v|=uint64_t(bswap(br.get(8*nfull)<<(32-8*nfull)))<<shift;
+      shift+=8*nfull;
+    }
+    v|=uint64_t(br.get(rest))<<shift;
+    nums[2]=int(v%sizes[2]);
+    v/=sizes[2];
+    nums[1]=int(v%sizes[1]);
+    nums[0]=int(uint32_t(v/sizes[1]));
+    return;
+  }
+// generic version, with the packed number stored as an array of bytes
+  int bytes[32];
+  int nbytes=0;
+  bytes[1]=bytes[2]=bytes[3]=0;
+  while(nbits>8) {
+    bytes[nbytes++]=br.get(8);
+    nbits-=8;
+  }
+  if(nbits>0) bytes[nbytes++]=br.get(nbits);
+  for(int i=2; i>0; i--) {
+    unsigned num=0;
+    for(int j=nbytes-1; j>=0; j--) {
+      num=(num<<8) | bytes[j];
+      unsigned p=num/sizes[i];
+      bytes[j]=p;
+      num=num-p*sizes[i];
+    }
+    nums[i]=num;
+  }
+  nums[0]=bytes[0] | (bytes[1]<<8) | (bytes[2]<<16) | (bytes[3]<<24);
+}
+
+/// Writes bits in the same way as the reference implementation, so that the files are identical
+class BitWriter {
+  std::vector<unsigned char>& buf;
+  unsigned cnt;
+  unsigned lastbits;
+  unsigned lastbyte;
+public:
+  explicit BitWriter(std::vector<unsigned char>&buf): buf(buf), cnt(0), lastbits(0), lastbyte(0) {}
+  void send(int nbits,unsigned num) {
+    while(nbits>=8) {
+      lastbyte=(lastbyte<<8) | (num>>(nbits-8));
+      buf[cnt++]=lastbyte>>lastbits;
+      nbits-=8;
+    }
+    if(nbits>0) {
+      lastbyte=(lastbyte<<nbits) | num;
+      lastbits+=nbits;
+      if(lastbits>=8) {
+        lastbits-=8;
+        buf[cnt++]=lastbyte>>lastbits;
+      }
+    }
+    if(lastbits>0) buf[cnt]=lastbyte<<(8-lastbits);
+  }
+/// Number of bytes written, including the last incomplete one
+  unsigned size() const {
+    return cnt+(lastbits!=0 ? 1 : 0);
+  }
+};
+
+/// Write nints integers in nbits bits, the i-th one being smaller than sizes[i]
+void sendints(BitWriter&bw,int nints,int nbits,const unsigned sizes[],const unsigned nums[]) {
+  unsigned bytes[32];
+  int nbytes=0;
+  unsigned tmp=nums[0];
+  do {
+    bytes[nbytes++]=tmp&0xff;
+    tmp>>=8;
+  } while(tmp!=0);
+  for(int i=1; i<nints; i++) {
+    plumed_massert(nums[i]<sizes[i],"major breakdown in xtc compression");
+    tmp=nums[i];
+    int bytecnt;
+    for(bytecnt=0; bytecnt<nbytes; bytecnt++) {
+      tmp=bytes[bytecnt]*sizes[i]+tmp;
+      bytes[bytecnt]=tmp&0xff;
+      tmp>>=8;
+    }
+    while(tmp!=0) {
+      bytes[bytecnt++]=tmp&0xff;
+      tmp>>=8;
+    }
+    nbytes=bytecnt;
+  }
+  if(nbits>=nbytes*8) {
+    for(int i=0; i<nbytes; i++) bw.send(8,bytes[i]);
+    bw.send(nbits-nbytes*8,0);
+  } else {
+    for(int i=0; i<nbytes-1; i++) bw.send(8,bytes[i]);
+    bw.send(nbits-(nbytes-1)*8,bytes[nbytes-1]);
+  }
+}
+
+/// Read n bytes. Returns false if the file ended before the first byte
+bool readBytes(FILE*fp,std::vector<unsigned char>&b,size_t n,const std::string&path) {
+  if(b.size()<n) b.resize(n);
+  size_t nread=std::fread(b.data(),1,n,fp);
+  if(nread==0 && n>0) return false;
+  plumed_massert(nread==n,"premature end of file "+path);
+  return true;
+}
+
+void writeBytes(FILE*fp,const std::vector<unsigned char>&b,const std::string&path) {
+  plumed_massert(std::fwrite(b.data(),1,b.size(),fp)==b.size(),"error writing file "+path);
+}
+
+}
+
+XdrFile::XdrFile():
+  fp(NULL),
+  type(xtc),
+  precision(1000.0)
+{
+}
+
+XdrFile::~XdrFile() {
+  if(fp) std::fclose(fp);
+}
+
+void XdrFile::open(const std::string&path,const std::string&mode,Type type) {
+  plumed_massert(!fp,"file "+this->path+" is already open");
+  plumed_massert(mode=="r" || mode=="w" || mode=="a","mode should be r, w or a");
+  fp=std::fopen(path.c_str(),(mode+"b").c_str());
+  plumed_massert(fp,"cannot open file "+path);
+  this->path=path;
+  this->type=type;
+}
+
+void XdrFile::close() {
+  if(fp) std::fclose(fp);
+  fp=NULL;
+}
+
+bool XdrFile::read(long int&step,double&time,Tensor&box,std::vector<Vector>&positions) {
+  plumed_massert(fp,"file is not open");
+  if(type==xtc) return readXtc(step,time,box,positions);
+  else return readTrr(step,time,box,positions);
+}
+
+void XdrFile::write(long int step,double time,const Tensor&box,const std::vector<Vector>&positions) {
+  plumed_massert(fp,"file is not open");
+  if(type==xtc) writeXtc(step,time,box,positions);
+  else writeTrr(step,time,box,positions);
+}
+
+bool XdrFile::skip() {
+  plumed_massert(fp,"file is not open");
+  if(type==xtc) return skipXtc();
+  else return skipTrr();
+}
+
+long int XdrFile::tell()const {
+  plumed_massert(fp,"file is not open");
+  return std::ftell(fp);
+}
+
+void XdrFile::seek(long int offset) {
+  plumed_massert(fp,"file is not open");
+  plumed_massert(std::fseek(fp,offset,SEEK_SET)==0,"cannot go to the requested position of file "+path);
+}
+
+bool XdrFile::skipXtc() {
+  if(!readBytes(fp,buffer,14*4,path)) return false;
+  plumed_massert(getInt(buffer.data())==xtcMagic,"file "+path+" is not in xtc format");
+  const int natoms=getInt(buffer.data()+4);
+  plumed_massert(natoms>=0,"corrupted xtc file "+path);
+  long int nbytes=12*long(natoms);
+  if(natoms>9) {
+    readBytes(fp,buffer,9*4,path);
+    nbytes=getInt(buffer.data()+32);
+    plumed_massert(nbytes>=0,"corrupted xtc file "+path);
+    nbytes=(nbytes+3)/4*4;
+  }
+  plumed_massert(std::fseek(fp,nbytes,SEEK_CUR)==0,"premature end of file "+path);
+  return true;
+}
+
+bool XdrFile::readXtc(long int&step,double&time,Tensor&box,std::vector<Vector>&positions) {
+// header: magic, natoms, step, time, box, natoms again
+  if(!readBytes(fp,buffer,14*4,path)) return false;
+  const unsigned char* h=buffer.data();
+  plumed_massert(getInt(h)==xtcMagic,"file "+path+" is not in xtc format");
+  const int natoms=getInt(h+4);
+  plumed_massert(natoms>=0 && getInt(h+13*4)==natoms,"corrupted xtc file "+path);
+  step=getInt(h+8);
+  time=getFloat(h+12);
+  for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) box(i,j)=getFloat(h+16+4*(3*i+j));
+  positions.resize(natoms);
+// small systems are not compressed
+  if(natoms<=9) {
+    readBytes(fp,buffer,12*natoms,path);
+    for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++) positions[i][j]=getFloat(buffer.data()+12*i+4*j);
+    return true;
+  }
+// precision, minint, maxint, smallidx and length of the compressed data
+  readBytes(fp,buffer,9*4,path);
+  const float prec=getFloat(buffer.data());
+  int minint[3];
+  int maxint[3];
+  for(unsigned j=0; j<3; j++) {
+    minint[j]=getInt(buffer.data()+4+4*j);
+    maxint[j]=getInt(buffer.data()+16+4*j);
+  }
+  int smallidx=getInt(buffer.data()+28);
+  const int nbytes=getInt(buffer.data()+32);
+  plumed_massert(smallidx>=firstidx && smallidx<lastidx && nbytes>=0,"corrupted xtc file "+path);
+// data are padded to four bytes
+  const int padded=(nbytes+3)/4*4;
+  readBytes(fp,buffer,padded,path);
+  BitReader br(buffer.data(),buffer.data()+padded);
+
+  unsigned sizeint[3];
+  int bitsizeint[3]= {0,0,0};
+  int bitsize=0;
+  for(unsigned j=0; j<3; j++) sizeint[j]=unsigned(maxint[j])-unsigned(minint[j])+1;
+// if one of the sizes is too large to be multiplied, each integer is stored separately
+  if((sizeint[0] | sizeint[1] | sizeint[2])>0xffffff) {
+    for(unsigned j=0; j<3; j++) bitsizeint[j]=sizeofint(sizeint[j]);
+  } else {
+    bitsize=sizeofints(3,sizeint);
+  }
+
+  int smaller=magicints[std::max(firstidx,smallidx-1)]/2;
+  int small=magicints[smallidx]/2;
+  unsigned sizesmall[3];
+  sizesmall[0]=sizesmall[1]=sizesmall[2]=magicints[smallidx];
+  const float invprec=1.0f/prec;
+  int run=0;
+  int i=0;
+  while(i<natoms) {
+    int thiscoord[3];
+    if(bitsize==0) {
+      for(unsigned j=0; j<3; j++) thiscoord[j]=br.get(bitsizeint[j]);
+    } else {
+      receiveints(br,bitsize,sizeint,thiscoord);
+    }
+    int prevcoord[3];
+    for(unsigned j=0; j<3; j++) {
+      thiscoord[j]+=minint[j];
+      prevcoord[j]=thiscoord[j];
+    }
+    int is_smaller=0;
+    if(br.get(1)) {
+      run=br.get(5);
+      is_smaller=run%3;
+      run-=is_smaller;
+      is_smaller--;
+    }
+    plumed_massert(i+1+run/3<=natoms,"corrupted xtc file "+path);
+    if(run>0) {
+      for(int k=0; k<run; k+=3) {
+        receiveints(br,smallidx,sizesmall,thiscoord);
+        for(unsigned j=0; j<3; j++) thiscoord[j]+=prevcoord[j]-small;
+        if(k==0) {
+// the first two atoms of the run were swapped for a better compression of water molecules
+          for(unsigned j=0; j<3; j++) std::swap(thiscoord[j],prevcoord[j]);
+          positions[i++]=Vector(prevcoord[0]*invprec,prevcoord[1]*invprec,prevcoord[2]*invprec);
+        } else {
+          for(unsigned j=0; j<3; j++) prevcoord[j]=thiscoord[j];
+        }
+        positions[i++]=Vector(thiscoord[0]*invprec,thiscoord[1]*invprec,thiscoord[2]*invprec);
+      }
+    } else {
+      positions[i++]=Vector(thiscoord[0]*invprec,thiscoord[1]*invprec,thiscoord[2]*invprec);
+    }
+    smallidx+=is_smaller;
+    plumed_massert(smallidx>=firstidx && smallidx<lastidx,"corrupted xtc file "+path);
+    if(is_smaller<0) {
+      small=smaller;
+      if(smallidx>firstidx) smaller=magicints[smallidx-1]/2;
+      else smaller=0;
+    } else if(is_smaller>0) {
+      smaller=small;
+      small=magicints[smallidx]/2;
+    }
+    sizesmall[0]=sizesmall[1]=sizesmall[2]=magicints[smallidx];
+  }
+  return true;
+}
+
+void XdrFile::writeXtc(long int step,double time,const Tensor&box,const std::vector<Vector>&positions) {
+  const int natoms=positions.size();
+  std::vector<unsigned char> out;
+  out.reserve(4*(9+14)+13*natoms+32);
+  putInt(out,xtcMagic);
+  putInt(out,natoms);
+  putInt(out,int(step));
+  putFloat(out,float(time));
+  for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) putFloat(out,float(box(i,j)));
+  putInt(out,natoms);
+  if(natoms<=9) {
+    for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++) putFloat(out,float(positions[i][j]));
+    writeBytes(fp,out,path);
+    return;
+  }
+  putFloat(out,precision);
+
+// convert to integers and find their range and the smallest distance between consecutive atoms
+  ints.resize(3*natoms);
+  int minint[3]= {INT_MAX,INT_MAX,INT_MAX};
+  int maxint[3]= {INT_MIN,INT_MIN,INT_MIN};
+  int mindiff=INT_MAX;
+  int oldlint[3]= {0,0,0};
+  for(int i=0; i<natoms; i++) {
+    int diff=0;
+    for(unsigned j=0; j<3; j++) {
+// the product is in single precision and the rounding in double precision, as in the reference implementation
+      const float f=float(positions[i][j]);
+      const float lf=(f>=0.0 ? f*precision+0.5 : f*precision-0.5);
+      plumed_massert(std::fabs(lf)<=maxabs,"coordinates are too large to be written in xtc file "+path);
+      const int lint=int(lf);
+      if(lint<minint[j]) minint[j]=lint;
+      if(lint>maxint[j]) maxint[j]=lint;
+      ints[3*i+j]=lint;
+      diff+=std::abs(oldlint[j]-lint);
+      oldlint[j]=lint;
+    }
+    if(diff<mindiff && i>0) mindiff=diff;
+  }
+  for(unsigned j=0; j<3; j++) putInt(out,minint[j]);
+  for(unsigned j=0; j<3; j++) putInt(out,maxint[j]);
+  for(unsigned j=0; j<3; j++) plumed_massert(float(maxint[j])-float(minint[j])<maxabs,"internal overflow compressing coordinates in file "+path);
+
+  unsigned sizeint[3];
+  int bitsizeint[3]= {0,0,0};
+  int bitsize=0;
+  for(unsigned j=0; j<3; j++) sizeint[j]=unsigned(maxint[j])-unsigned(minint[j])+1;
+  if((sizeint[0] | sizeint[1] | sizeint[2])>0xffffff) {
+    for(unsigned j=0; j<3; j++) bitsizeint[j]=sizeofint(sizeint[j]);
+  } else {
+    bitsize=sizeofints(3,sizeint);
+  }
+  int smallidx=firstidx;
+  while(smallidx<lastidx && magicints[smallidx]<mindiff) smallidx++;
+  putInt(out,smallidx);
+
+  const int maxidx=std::min(lastidx,smallidx+8);
+  const int minidx=maxidx-8;
+  int smaller=magicints[std::max(firstidx,smallidx-1)]/2;
+  int small=magicints[smallidx]/2;
+  unsigned sizesmall[3];
+  sizesmall[0]=sizesmall[1]=sizesmall[2]=magicints[smallidx];
+  const int larger=magicints[std::min(maxidx,lastidx-1)]/2;
+
+// each atom takes at most 13 bytes
+  buffer.assign(13*natoms+16,0);
+  BitWriter bw(buffer);
+  int prevcoord[3]= {0,0,0};
+  unsigned tmpcoord[30];
+  int prevrun=-1;
+  int i=0;
+  while(i<natoms) {
+    int is_small=0;
+    int is_smaller;
+    int* thiscoord=&ints[3*i];
+    if(smallidx<maxidx && i>=1 &&
+        std::abs(thiscoord[0]-prevcoord[0])<larger &&
+        std::abs(thiscoord[1]-prevcoord[1])<larger &&
+        std::abs(thiscoord[2]-prevcoord[2])<larger) {
+      is_smaller=1;
+    } else if(smallidx>minidx) {
+      is_smaller=-1;
+    } else {
+      is_smaller=0;
+    }
+    if(i+1<natoms) {
+      if(std::abs(thiscoord[0]-thiscoord[3])<small &&
+          std::abs(thiscoord[1]-thiscoord[4])<small &&
+          std::abs(thiscoord[2]-thiscoord[5])<small) {
+// swap the first two atoms for a better compression of water molecules
+        for(unsigned j=0; j<3; j++) std::swap(thiscoord[j],thiscoord[3+j]);
+        is_small=1;
+      }
+    }
+    for(unsigned j=0; j<3; j++) tmpcoord[j]=thiscoord[j]-minint[j];
+    if(bitsize==0) {
+      for(unsigned j=0; j<3; j++) bw.send(bitsizeint[j],tmpcoord[j]);
+    } else {
+      sendints(bw,3,bitsize,sizeint,tmpcoord);
+    }
+    for(unsigned j=0; j<3; j++) prevcoord[j]=thiscoord[j];
+    thiscoord+=3;
+    i++;
+
+    int run=0;
+    if(is_small==0 && is_smaller==-1) is_smaller=0;
+    while(is_small && run<8*3) {
+      if(is_smaller==-1) {
+// the reference implementation computes these squares with int, which overflows with large precisions.
+// The same 32 bit wrap around is used here so that the files are identical
+        uint32_t d2=0;
+        for(unsigned j=0; j<3; j++) {
+          const uint32_t d=uint32_t(thiscoord[j]-prevcoord[j]);
+          d2+=d*d;
+        }
+        if(int32_t(d2)>=int32_t(uint32_t(smaller)*uint32_t(smaller))) is_smaller=0;
+      }
+      for(unsigned j=0; j<3; j++) tmpcoord[run++]=thiscoord[j]-prevcoord[j]+small;
+      for(unsigned j=0; j<3; j++) prevcoord[j]=thiscoord[j];
+      i++;
+      thiscoord+=3;
+      is_small=0;
+      if(i<natoms &&
+          std::abs(thiscoord[0]-prevcoord[0])<small &&
+          std::abs(thiscoord[1]-prevcoord[1])<small &&
+          std::abs(thiscoord[2]-prevcoord[2])<small) {
+        is_small=1;
+      }
+    }
+    if(run!=prevrun || is_smaller!=0) {
+      prevrun=run;
+// flag the change in run length
+      bw.send(1,1);
+      bw.send(5,run+is_smaller+1);
+    } else {
+      bw.send(1,0);
+    }
+    for(int k=0; k<run; k+=3) sendints(bw,3,smallidx,sizesmall,&tmpcoord[k]);
+    if(is_smaller!=0) {
+      smallidx+=is_smaller;
+      if(is_smaller<0) {
+        small=smaller;
+        smaller=magicints[smallidx-1]/2;
+      } else {
+        smaller=small;
+        small=magicints[smallidx]/2;
+      }
+      sizesmall[0]=sizesmall[1]=sizesmall[2]=magicints[smallidx];
+    }
+  }
+  const unsigned nbytes=bw.size();
+  putInt(out,nbytes);
+  out.insert(out.end(),buffer.begin(),buffer.begin()+nbytes);
+  while(out.size()%4) out.push_back(0);
+  writeBytes(fp,out,path);
+}
+
+bool XdrFile::readTrr(long int&step,double&time,Tensor&box,std::vector<Vector>&positions) {
+// magic number and version string
+  if(!readBytes(fp,buffer,3*4,path)) return false;
+  plumed_massert(getInt(buffer.data())==trrMagic,"file "+path+" is not in trr format");
+  const int slen=getInt(buffer.data()+8);
+  plumed_massert(slen>=0 && slen<1024,"corrupted trr file "+path);
+  readBytes(fp,buffer,(slen+3)/4*4,path);
+// sizes of the blocks, number of atoms, step and number of energies
+  readBytes(fp,buffer,13*4,path);
+  int sizes[13];
+  for(unsigned i=0; i<13; i++) sizes[i]=getInt(buffer.data()+4*i);
+  const int ir_size=sizes[0], e_size=sizes[1], box_size=sizes[2], vir_size=sizes[3], pres_size=sizes[4];
+  const int top_size=sizes[5], sym_size=sizes[6], x_size=sizes[7], v_size=sizes[8], f_size=sizes[9];
+  const int natoms=sizes[10];
+  plumed_massert(ir_size==0 && e_size==0 && top_size==0 && sym_size==0,"unsupported trr file "+path);
+  plumed_massert(x_size>0,"trr file "+path+" does not contain positions");
+  plumed_massert(natoms>0 && x_size%(3*natoms)==0,"corrupted trr file "+path);
+  const int realsize=x_size/(3*natoms);
+  plumed_massert(realsize==4 || realsize==8,"corrupted trr file "+path);
+  step=sizes[11];
+// time and lambda
+  readBytes(fp,buffer,2*realsize,path);
+  time=(realsize==4 ? getFloat(buffer.data()) : getDouble(buffer.data()));
+  box.zero();
+  if(box_size>0) {
+    plumed_massert(box_size==9*realsize,"corrupted trr file "+path);
+    readBytes(fp,buffer,box_size,path);
+    for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) {
+        const unsigned char* p=buffer.data()+realsize*(3*i+j);
+        box(i,j)=(realsize==4 ? getFloat(p) : getDouble(p));
+      }
+  }
+  readBytes(fp,buffer,vir_size+pres_size,path);
+  readBytes(fp,buffer,x_size,path);
+  positions.resize(natoms);
+  for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++) {
+      const unsigned char* p=buffer.data()+realsize*(3*i+j);
+      positions[i][j]=(realsize==4 ? getFloat(p) : getDouble(p));
+    }
+// velocities and forces are skipped
+  readBytes(fp,buffer,v_size+f_size,path);
+  return true;
+}
+
+bool XdrFile::skipTrr() {
+  if(!readBytes(fp,buffer,3*4,path)) return false;
+  plumed_massert(getInt(buffer.data())==trrMagic,"file "+path+" is not in trr format");
+  const int slen=getInt(buffer.data()+8);
+  plumed_massert(slen>=0 && slen<1024,"corrupted trr file "+path);
+  readBytes(fp,buffer,(slen+3)/4*4+13*4,path);
+  const unsigned char* h=buffer.data()+(slen+3)/4*4;
+// the frame contains time and lambda, and then all the blocks
+  const int x_size=getInt(h+7*4);
+  const int natoms=getInt(h+10*4);
+  plumed_massert(x_size>0,"trr file "+path+" does not contain positions");
+  plumed_massert(natoms>0 && x_size%(3*natoms)==0,"corrupted trr file "+path);
+  long int nbytes=2*(x_size/(3*natoms));
+  for(unsigned i=0; i<10; i++) {
+    const int size=getInt(h+4*i);
+    plumed_massert(size>=0,"corrupted trr file "+path);
+    nbytes+=size;
+  }
+  plumed_massert(std::fseek(fp,nbytes,SEEK_CUR)==0,"premature end of file "+path);
+  return true;
+}
+
+void XdrFile::writeTrr(long int step,double time,const Tensor&box,const std::vector<Vector>&positions) {
+  const int natoms=positions.size();
+  std::vector<unsigned char> out;
+  out.reserve(4*(24+9)+12*natoms);
+  putInt(out,trrMagic);
+// the version string is written with its length including the terminating zero, and then as an xdr string
+  const int slen=std::strlen(trrVersion);
+  putInt(out,slen+1);
+  putInt(out,slen);
+  for(int i=0; i<slen; i++) out.push_back(trrVersion[i]);
+  while(out.size()%4) out.push_back(0);
+// ir, e, box, vir, pres, top, sym, x, v and f sizes, single precision
+  const int sizes[10]= {0,0,9*4,0,0,0,0,3*4*natoms,0,0};
+  for(unsigned i=0; i<10; i++) putInt(out,sizes[i]);
+  putInt(out,natoms);
+  putInt(out,int(step));
+// number of energies
+  putInt(out,0);
+  putFloat(out,float(time));
+// lambda
+  putFloat(out,0.0);
+  for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++) putFloat(out,float(box(i,j)));
+  for(int i=0; i<natoms; i++) for(unsigned j=0; j<3; j++) putFloat(out,float(positions[i][j]));
+  writeBytes(fp,out,path);
+}
+
+}
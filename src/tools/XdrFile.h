@@ -0,0 +1,90 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2020 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_XdrFile_h
+#define __PLUMED_tools_XdrFile_h
+
+#include "Tensor.h"
+#include "Vector.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Reads and writes trajectories in the xtc and trr formats used by GROMACS.
+/// This is a self-contained implementation that does not need the xdrfile library.
+/// Files written here are identical to those written by xdrfile.
+/// The xtc decoder reads the compressed coordinates through a 64-bit bit buffer
+/// and unpacks the triplets of small integers with 64-bit arithmetic whenever they fit.
+/// Replacing the divisions with a table of reciprocals does not make decoding faster,
+/// since most of the time is spent extracting the bits.
+/// Lengths are in nm and times in ps, as in GROMACS.
+/// Only positions are read from trr files; velocities and forces are skipped.
+class XdrFile {
+public:
+/// Type of trajectory
+  enum Type {xtc,trr};
+private:
+  FILE* fp;
+  Type type;
+  std::string path;
+/// Precision used to write xtc files
+  float precision;
+/// Buffers reused between frames
+  std::vector<unsigned char> buffer;
+  std::vector<int> ints;
+  bool readXtc(long int&step,double&time,Tensor&box,std::vector<Vector>&positions);
+  bool readTrr(long int&step,double&time,Tensor&box,std::vector<Vector>&positions);
+  bool skipXtc();
+  bool skipTrr();
+  void writeXtc(long int step,double time,const Tensor&box,const std::vector<Vector>&positions);
+  void writeTrr(long int step,double time,const Tensor&box,const std::vector<Vector>&positions);
+public:
+  XdrFile();
+  ~XdrFile();
+  XdrFile(const XdrFile&) = delete;
+  XdrFile& operator=(const XdrFile&) = delete;
+/// Open a file. mode can be "r", "w" or "a"
+  void open(const std::string&path,const std::string&mode,Type type);
+/// Close the file
+  void close();
+/// True if the file is open
+  bool isOpen()const {return fp;}
+/// Set the precision used to write xtc files (default 1000, that is three decimal digits in nm)
+  void setPrecision(double p) {precision=p;}
+/// Read the next frame. Returns false at the end of the file.
+/// The number of atoms is the size of positions
+  bool read(long int&step,double&time,Tensor&box,std::vector<Vector>&positions);
+/// Write a frame
+  void write(long int step,double time,const Tensor&box,const std::vector<Vector>&positions);
+/// Go past the next frame without decoding it. Returns false at the end of the file.
+  bool skip();
+/// Position of the file, in bytes. Frames can be read again from this position with seek()
+  long int tell()const;
+/// Go to a position obtained with tell()
+  void seek(long int offset);
+};
+
+}
+
+#endif
@@ -75,6 +75,7 @@ BasisFunctions::BasisFunctions(const ActionOptions&ao):
   vesbias_pntr_(NULL),
   action_pntr_(NULL)
 {
+  setStateful(false);
   bf_keywords_.push_back(getName());
   if(keywords.exists("ORDER")) {
     parse("ORDER",norder_); addKeywordToList("ORDER",norder_);
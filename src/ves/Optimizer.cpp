@@ -758,6 +758,7 @@ Optimizer::Optimizer(const ActionOptions&ao):
     }
   }
 
+  setStateful();
 }
 
 
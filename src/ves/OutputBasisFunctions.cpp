@@ -116,6 +116,7 @@ OutputBasisFunctions::OutputBasisFunctions(const ActionOptions&ao):
   Action(ao),
   bf_pntrs(0)
 {
+  setStateful(false);
   std::vector<std::string> basisset_labels(0);
   parseVector("BASIS_FUNCTIONS",basisset_labels);
   if(basisset_labels.size()>1) {plumed_merror("Only one basis set label allowed in keyword BASIS_FUNCTIONS of "+getName());}
@@ -123,6 +123,7 @@ void OutputFesBias::registerKeywords(Keywords& keys) {
 OutputFesBias::OutputFesBias(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
 
   std::vector<std::string> bias_labels;
   parseVector("BIAS",bias_labels);
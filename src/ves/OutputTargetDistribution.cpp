@@ -107,6 +107,7 @@ void OutputTargetDistribution::registerKeywords(Keywords& keys) {
 OutputTargetDistribution::OutputTargetDistribution(const ActionOptions&ao):
   Action(ao)
 {
+  setStateful(false);
 
   std::string targetdist_fname;
   parse("TARGETDIST_FILE",targetdist_fname);
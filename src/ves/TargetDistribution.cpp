@@ -70,6 +70,7 @@ TargetDistribution::TargetDistribution(const ActionOptions&ao):
   allow_bias_cutoff_(true),
   bias_cutoff_active_(false)
 {
+  setStateful(false);
   //
   if(keywords.exists("WELLTEMPERED_FACTOR")) {
     double welltempered_factor=0.0;
@@ -225,7 +225,7 @@ VesBias::VesBias(const ActionOptions&ao):
     }
   }
 
-
+  setStateful();
 }
 
 
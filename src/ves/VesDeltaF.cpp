@@ -391,6 +391,7 @@ VesDeltaF::VesDeltaF(const ActionOptions&ao)
   }
 
   checkRead();
+  setStateful();
 
 //restart if needed
   if(getRestart())
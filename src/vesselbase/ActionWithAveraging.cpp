@@ -98,6 +98,7 @@ ActionWithAveraging::ActionWithAveraging( const ActionOptions& ao ):
     else if( normstr=="ndata" ) normalization=ndata;
     else error("invalid instruction for NORMALIZATION flag should be true, false, or ndata");
   }
+  setStateful();
 }
 
 bool ActionWithAveraging::ignoreNormalization() const {
@@ -62,6 +62,7 @@ ActionWithVessel::ActionWithVessel(const ActionOptions&ao):
   weightHasDerivatives(false),
   mydata(NULL)
 {
+  setStateful(false);
   maxderivatives=309; parse("MAXDERIVATIVES",maxderivatives);
   if( keywords.exists("SERIAL") ) parseFlag("SERIAL",serial);
   else serial=true;
@@ -593,6 +593,41 @@ typedef struct {
   void (*handler)(void*,int,const char*,const void*);
 } plumed_nothrow_handler;
 
+/**
+  \brief Descriptor of a MD step, passed to `plumed_cmd(p,"calcStep",&descriptor)`.
+
+  It contains all the data that a MD engine usually passes at every step with separate commands,
+  so that the whole calculation is done with a single call. The pointers have the same meaning
+  as the argument of the corresponding command ("setBox", "setMasses", ...), so they should point to
+  real numbers with the precision set with "setRealPrecision".
+  Masses, positions and forces are always passed. The other pointers are ignored if they are NULL.
+  The descriptor can be kept by the MD engine and reused at every step, updating the step number
+  and, if needed, the pointers.
+
+  From FORTRAN, an interoperable derived type with the same components
+  (`integer(c_long)` followed by seven `type(c_ptr)`) can be passed to plumed_f_cmd.
+
+  Available as of PLUMED 2.8 (API version 9).
+*/
+typedef struct {
+  /** step number, as in "setStepLong" */
+  long int step;
+  /** box, as in "setBox" */
+  void* box;
+  /** masses, as in "setMasses" */
+  void* masses;
+  /** charges, as in "setCharges" */
+  void* charges;
+  /** positions, as in "setPositions" */
+  void* positions;
+  /** forces, as in "setForces" */
+  void* forces;
+  /** virial, as in "setVirial" */
+  void* virial;
+  /** potential energy, as in "setEnergy" */
+  void* energy;
+} plumed_step_descriptor;
+
 /** \relates plumed
     \brief Constructor
 
@@ -774,6 +809,39 @@ __PLUMED_WRAPPER_C_BEGIN
 void plumed_cmd_nothrow(plumed p,const char*key,const void*val,plumed_nothrow_handler nothrow);
 __PLUMED_WRAPPER_C_END
 
+/**
+  \relates plumed
+  \brief Tells p to execute a command that was resolved in advance.
+
+  A command key can be resolved once into an integer handle with
+  `plumed_cmd(p,"getCmdHandle key",&handle)`, where handle is an int.
+  Calling `plumed_cmd_handle(p,handle,val)` is then equivalent to calling
+  `plumed_cmd(p,"key",val)`, but the key is not parsed again. This reduces the
+  overhead of the commands that are sent at every step (e.g. "setPositions" or "calc").
+  Handles are only valid for the object that returned them.
+
+  Available as of PLUMED 2.8 (API version 9). If the kernel is older, this command will exit.
+
+  \param p The plumed object on which command is acting
+  \param handle The handle of the command
+  \param val The argument, as in \ref plumed_cmd.
+*/
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle(plumed p,int handle,const void*val);
+__PLUMED_WRAPPER_C_END
+
+/**
+  \relates plumed
+  \brief Same as \ref plumed_cmd_handle, but does not throw exceptions.
+
+  Errors are reported with the nothrow handler as in \ref plumed_cmd_nothrow.
+*/
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle_nothrow(plumed p,int handle,const void*val,plumed_nothrow_handler nothrow);
+__PLUMED_WRAPPER_C_END
+
 /** \relates plumed
     \brief Destructor.
 
@@ -1753,6 +1821,21 @@ Plumed(Plumed&&p)__PLUMED_WRAPPER_CXX_NOEXCEPT :
     if(h.code!=0) rethrow(h);
   }
 
+  /**
+     Send a command that was resolved in advance to this plumed object
+      \param handle The handle of the command, obtained with cmd("getCmdHandle key",&handle)
+      \param val The argument, as in \ref cmd
+      \note Similar to \ref plumed_cmd_handle(). It actually calls \ref plumed_cmd_handle_nothrow() and
+            rethrow any exception raised within PLUMED. Available as of PLUMED 2.8.
+  */
+  void cmdHandle(int handle,const void*val=NULL) {
+    NothrowHandler h;
+    h.code=0;
+    plumed_nothrow_handler nothrow= {&h,nothrow_handler};
+    plumed_cmd_handle_nothrow(main,handle,val,nothrow);
+    if(h.code!=0) rethrow(h);
+  }
+
   /**
      Destructor
 
@@ -1984,6 +2067,12 @@ typedef struct {
   is very risky since and object created in that way would not report any error if manipulated from the C interface.
   So, it looks like this is the only possibility.
 
+  version=3, cmd_handle and cmd_handle_nothrow.
+
+  These functions execute a command that was resolved with cmd("getCmdHandle"), passing an integer handle instead of
+  the key. They cannot be implemented with cmd strings since the purpose is to avoid parsing a string at every call,
+  which is a measurable overhead for the commands that MD codes send at every step.
+
 */
 typedef struct {
   /**
@@ -2004,6 +2093,18 @@ typedef struct {
     Available with version>=2.
   */
   void (*cmd_nothrow)(void*plumed,const char*key,const void*val,plumed_nothrow_handler);
+  /**
+    Pointer to a cmd function that takes a resolved handle.
+
+    Available with version>=3.
+  */
+  void (*cmd_handle)(void*plumed,int handle,const void*val);
+  /**
+    Pointer to a cmd function that takes a resolved handle and is guaranteed not to throw exceptions.
+
+    Available with version>=3.
+  */
+  void (*cmd_handle_nothrow)(void*plumed,int handle,const void*val,plumed_nothrow_handler);
 } plumed_symbol_table_type;
 
 /* Utility to convert function pointers to pointers, just for the sake of printing them */
@@ -2542,6 +2643,49 @@ void plumed_cmd_nothrow(plumed p,const char*key,const void*val,plumed_nothrow_ha
 }
 __PLUMED_WRAPPER_C_END
 
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle(plumed p,int handle,const void*val) {
+  plumed_implementation* pimpl;
+  /* obtain pimpl */
+  pimpl=(plumed_implementation*) p.p;
+  assert(plumed_check_pimpl(pimpl));
+  if(!pimpl->p) {
+    __PLUMED_FPRINTF(stderr,"+++ ERROR: You are trying to use an invalid plumed object. +++\n");
+    if(pimpl->used_plumed_kernel) __PLUMED_FPRINTF(stderr,"+++ Check your PLUMED_KERNEL environment variable. +++\n");
+    __PLUMED_WRAPPER_STD exit(1);
+  }
+  if(!pimpl->table || pimpl->table->version<3) {
+    __PLUMED_FPRINTF(stderr,"+++ ERROR: plumed_cmd_handle is not available with this PLUMED kernel (requires PLUMED>=2.8). +++\n");
+    __PLUMED_WRAPPER_STD exit(1);
+  }
+  /* execute */
+  (*(pimpl->table->cmd_handle))(pimpl->p,handle,val);
+}
+__PLUMED_WRAPPER_C_END
+
+__PLUMED_WRAPPER_C_BEGIN
+void plumed_cmd_handle_nothrow(plumed p,int handle,const void*val,plumed_nothrow_handler nothrow) {
+  plumed_implementation* pimpl;
+  /* obtain pimpl */
+  pimpl=(plumed_implementation*) p.p;
+  assert(plumed_check_pimpl(pimpl));
+  if(!pimpl->p) {
+    if(pimpl->used_plumed_kernel) {
+      nothrow.handler(nothrow.ptr,1,"You are trying to use plumed, but it is not available.\nCheck your PLUMED_KERNEL environment variable.",NULL);
+    } else {
+      nothrow.handler(nothrow.ptr,1,"You are trying to use plumed, but it is not available.",NULL);
+    }
+    return;
+  }
+  if(!pimpl->table || pimpl->table->version<3) {
+    nothrow.handler(nothrow.ptr,1,"plumed_cmd_handle is not available with this PLUMED kernel (requires PLUMED>=2.8).",NULL);
+    return;
+  }
+  /* execute */
+  (*(pimpl->table->cmd_handle_nothrow))(pimpl->p,handle,val,nothrow);
+}
+__PLUMED_WRAPPER_C_END
+
 
 
 __PLUMED_WRAPPER_C_BEGIN
@@ -42,3 +42,25 @@
 #define __PLUMED_WRAPPER_FORTRAN 1
 
 #include "Plumed.h"
+
+/*
+  The kernel reads the plumed_step_descriptor passed with cmd("calcStep") as a PLMD::StepDescriptor.
+  The layout of the two structures is checked here so that the kernel does not need Plumed.h.
+*/
+#include "../core/StepDescriptor.h"
+#include <cstddef>
+
+#define __PLUMED_CHECK_STEP_DESCRIPTOR(member) \
+  static_assert(offsetof(PLMD::StepDescriptor,member)==offsetof(plumed_step_descriptor,member) && \
+                sizeof(PLMD::StepDescriptor::member)==sizeof(plumed_step_descriptor::member), \
+                "StepDescriptor and plumed_step_descriptor differ in " #member)
+static_assert(sizeof(PLMD::StepDescriptor)==sizeof(plumed_step_descriptor),"StepDescriptor and plumed_step_descriptor have different sizes");
+__PLUMED_CHECK_STEP_DESCRIPTOR(step);
+__PLUMED_CHECK_STEP_DESCRIPTOR(box);
+__PLUMED_CHECK_STEP_DESCRIPTOR(masses);
+__PLUMED_CHECK_STEP_DESCRIPTOR(charges);
+__PLUMED_CHECK_STEP_DESCRIPTOR(positions);
+__PLUMED_CHECK_STEP_DESCRIPTOR(forces);
+__PLUMED_CHECK_STEP_DESCRIPTOR(virial);
+__PLUMED_CHECK_STEP_DESCRIPTOR(energy);
+#undef __PLUMED_CHECK_STEP_DESCRIPTOR